@@ -0,0 +1,120 @@
+// 主机端数据包编码微基准：对比旧的 std::vector 拼包方式与 PacketEncoder
+// 编译运行：cmake -S . -B build && cmake --build build && ./build/bench_encode
+#include <stdio.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "protocol.h"
+
+static const int ITERATIONS = 1000000;
+
+// 防止编译器把结果优化掉
+static volatile uint32_t g_sink = 0;
+
+// 旧实现：逐字节push_back到新分配的vector（与原 STServo::make_a_packet 相同）
+static std::vector<uint8_t> legacy_make_a_packet(uint8_t dev_id, uint8_t instruction, const std::vector<uint8_t>& params_tx) {
+    std::vector<uint8_t> packet;
+    packet.push_back(0xFF);
+    packet.push_back(0xFF);
+    packet.push_back(dev_id);
+    packet.push_back(params_tx.size() + 2);
+    packet.push_back(instruction);
+    for (uint8_t param : params_tx) {
+        packet.push_back(param);
+    }
+    int sum = 0;
+    for (size_t i = 2; i < packet.size(); i++) {
+        sum += packet[i];
+    }
+    packet.push_back(255 - (sum & 0xFF));
+    return packet;
+}
+
+struct FrameShape {
+    const char* name;
+    uint8_t     instruction;
+    size_t      servos;     // 0表示单舵机指令
+    size_t      data_len;   // 每个舵机的数据长度
+};
+
+// 旧方式：调用方先构造params_tx（与原 write_data / sync_write 相同，额外一次分配）
+static size_t encode_legacy(const FrameShape& shape, const uint8_t* data) {
+    std::vector<uint8_t> params_tx = {0x2A};
+    if (shape.servos == 0) {
+        params_tx.insert(params_tx.end(), data, data + shape.data_len);
+        return legacy_make_a_packet(1, shape.instruction, params_tx).size();
+    }
+    params_tx.push_back(shape.data_len);
+    for (size_t i = 0; i < shape.servos; i++) {
+        params_tx.push_back(i + 1);
+        params_tx.insert(params_tx.end(), data, data + shape.data_len);
+    }
+    return legacy_make_a_packet(0xFE, shape.instruction, params_tx).size();
+}
+
+static size_t encode_fixed(const FrameShape& shape, const uint8_t* data, uint8_t* buf) {
+    PacketEncoder packet(buf, STProtocol::MAX_PACKET_SIZE);
+    if (shape.servos == 0) {
+        packet.begin(1, shape.instruction);
+        packet.put(0x2A);
+        packet.put(data, shape.data_len);
+        return packet.finish();
+    }
+    packet.begin(0xFE, shape.instruction);
+    packet.put(0x2A);
+    packet.put(shape.data_len);
+    for (size_t i = 0; i < shape.servos; i++) {
+        packet.put(i + 1);
+        packet.put(data, shape.data_len);
+    }
+    return packet.finish();
+}
+
+template<typename F>
+static double ns_per_frame(F encode) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        g_sink += encode();
+    }
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count() / ITERATIONS;
+}
+
+int main() {
+    const FrameShape shapes[] = {
+        {"read",             0x02,  0, 1},
+        {"write_data(7)",    0x03,  0, 7},
+        {"sync_write(12x6)", 0x83, 12, 6},
+    };
+    const uint8_t data[7] = {160, 0x00, 0x08, 0x00, 0x00, 0x20, 0x03};
+    uint8_t buf[STProtocol::MAX_PACKET_SIZE];
+
+    // 先校验两种实现输出一致
+    for (const FrameShape& shape : shapes) {
+        size_t size = encode_fixed(shape, data, buf);
+        std::vector<uint8_t> params_tx = {0x2A};
+        if (shape.servos == 0) {
+            params_tx.insert(params_tx.end(), data, data + shape.data_len);
+        } else {
+            params_tx.push_back(shape.data_len);
+            for (size_t i = 0; i < shape.servos; i++) {
+                params_tx.push_back(i + 1);
+                params_tx.insert(params_tx.end(), data, data + shape.data_len);
+            }
+        }
+        std::vector<uint8_t> legacy = legacy_make_a_packet(shape.servos ? 0xFE : 1, shape.instruction, params_tx);
+        if (legacy.size() != size || !std::equal(legacy.begin(), legacy.end(), buf)) {
+            printf("MISMATCH: %s\n", shape.name);
+            return 1;
+        }
+    }
+
+    printf("%-18s %8s %12s %12s\n", "frame", "bytes", "vector(ns)", "encoder(ns)");
+    for (const FrameShape& shape : shapes) {
+        double legacy = ns_per_frame([&]() { return encode_legacy(shape, data); });
+        double fixed  = ns_per_frame([&]() { return encode_fixed(shape, data, buf); });
+        printf("%-18s %8zu %12.1f %12.1f\n", shape.name, encode_fixed(shape, data, buf), legacy, fixed);
+    }
+    return 0;
+}
@@ -0,0 +1,605 @@
+// 协议性能基准：在模拟总线上测量各指令的往返延时、N个舵机的控制环频率、编解码和轨迹插值的CPU时间，结果输出为JSON
+// 用法：bench_protocol [--iterations N] [--baud B] [--return-delay-us D] [--noise P] [--label NAME]
+// 延时为虚拟总线时间（请求发出到最后一个字节离开总线或调用返回），cpu_ns为主机墙钟时间（含模拟器开销）
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "servo_bus_sim.h"
+#include "st3215.h"
+#include "bus_group.h"
+#include "trajectory.h"
+#include "binary_protocol.h"
+#ifdef BENCH_WITH_ARDUINOJSON
+#include <ArduinoJson.h>
+#endif
+
+// 防止编译器把结果优化掉
+static volatile uint32_t g_sink = 0;
+
+struct BenchConfig {
+    int         iterations;
+    uint32_t    baudrate;
+    uint32_t    returnDelayUs;
+    double      noise;
+    const char* label;
+};
+
+// 延时样本和统计
+class LatencySamples {
+    public:
+        void add(uint32_t bus_us, double cpu_ns, bool ok) {
+            _bus.push_back(bus_us);
+            _cpuNs += cpu_ns;
+            if (!ok) {
+                _errors++;
+            }
+        }
+
+        uint32_t percentile(double p) {
+            if (_bus.empty()) {
+                return 0;
+            }
+            std::sort(_bus.begin(), _bus.end());
+            size_t index = static_cast<size_t>(p * (_bus.size() - 1) + 0.5);
+            return _bus[index];
+        }
+
+        double mean() const {
+            double sum = 0;
+            for (size_t i = 0; i < _bus.size(); i++) {
+                sum += _bus[i];
+            }
+            return _bus.empty() ? 0 : sum / _bus.size();
+        }
+
+        // "name": {"count", "errors", "p50_us", "p99_us", "max_us", "mean_us", "cpu_ns", "histogram_us": [[上界, 次数]...]}
+        // 直方图按2的幂划分桶
+        void print_json(const char* name, bool last) {
+            uint32_t p50 = percentile(0.50);
+            uint32_t p99 = percentile(0.99);
+            uint32_t max = _bus.empty() ? 0 : _bus.back();
+            printf("    \"%s\": {\"count\": %u, \"errors\": %u, \"p50_us\": %u, \"p99_us\": %u, \"max_us\": %u, "
+                   "\"mean_us\": %.1f, \"cpu_ns\": %.0f, \"histogram_us\": [",
+                   name, static_cast<unsigned>(_bus.size()), _errors, p50, p99, max,
+                   mean(), _bus.empty() ? 0 : _cpuNs / _bus.size());
+            size_t   i     = 0;
+            bool     first = true;
+            for (uint32_t bound = 1; i < _bus.size(); bound <<= 1) {
+                uint32_t count = 0;
+                while (i < _bus.size() && _bus[i] <= bound) {
+                    count++;
+                    i++;
+                }
+                if (count > 0) {
+                    printf("%s[%u, %u]", first ? "" : ", ", bound, count);
+                    first = false;
+                }
+            }
+            printf("]}%s\n", last ? "" : ",");
+        }
+
+    private:
+        std::vector<uint32_t> _bus;
+        double                _cpuNs  = 0;
+        uint32_t              _errors = 0;
+};
+
+// 模拟总线上的一个ST3215链
+class BenchBus {
+    public:
+        BenchBus(const BenchConfig& config, size_t servo_count)
+            : bus(clock), servo(bus, config.baudrate, false, &clock) {
+            bus.add_servos(1, servo_count);
+            bus.set_return_delay(config.returnDelayUs);
+            bus.set_noise(config.noise);
+            servo.setReturnDelay(config.returnDelayUs);
+            for (size_t i = 0; i < servo_count; i++) {
+                ids.push_back(i + 1);
+            }
+        }
+
+        // 执行一次调用，样本记录到总线空闲为止的虚拟时间和墙钟时间
+        template<typename F>
+        void measure(LatencySamples& samples, F call) {
+            uint64_t start      = clock.now();
+            auto     wall_start = std::chrono::steady_clock::now();
+            bool     ok         = call();
+            auto     wall_stop  = std::chrono::steady_clock::now();
+            uint64_t stop       = std::max(clock.now(), bus.idle_at());
+            clock.advance(stop - clock.now());
+            samples.add(static_cast<uint32_t>(stop - start),
+                        std::chrono::duration<double, std::nano>(wall_stop - wall_start).count(), ok);
+        }
+
+        SimClock             clock;
+        ServoBusSim          bus;
+        ST3215               servo;
+        std::vector<uint8_t> ids;
+};
+
+// 单条指令的往返延时
+static void bench_instructions(const BenchConfig& config) {
+    const size_t SYNC_SERVOS = 12;
+    BenchBus bench(config, SYNC_SERVOS);
+    STServo& servo = bench.servo;
+
+    LatencySamples ping, read, write, sync_read, sync_write;
+    uint8_t error;
+    std::vector<uint8_t> params_rx;
+    std::vector<std::vector<uint8_t>> params_rx_vec;
+    std::vector<uint8_t> motion = {0, 0x00, 0x08, 0x00, 0x00, 0x20, 0x03};
+    std::vector<std::vector<uint8_t>> motion_vec(SYNC_SERVOS, motion);
+
+    for (int i = 0; i < config.iterations; i++) {
+        bench.measure(ping,       [&]() { return bool(servo.ping(1, error, params_rx)); });
+        bench.measure(read,       [&]() { return bool(servo.read(1, STSMemoryMap::PRESENT_POSITION, 2, error, params_rx)); });
+        bench.measure(write,      [&]() { return bool(servo.write_data(1, STSMemoryMap::ACC, motion, error, params_rx)); });
+        bench.measure(sync_read,  [&]() { return bool(servo.sync_read(bench.ids, STSMemoryMap::PRESENT_POSITION, 4, params_rx_vec)); });
+        bench.measure(sync_write, [&]() { return bool(servo.sync_write(bench.ids, STSMemoryMap::ACC, motion_vec)); });
+    }
+
+    printf("  \"instructions\": {\n");
+    printf("    \"sync_servos\": %u,\n", static_cast<unsigned>(SYNC_SERVOS));
+    ping.print_json("ping", false);
+    read.print_json("read", false);
+    write.print_json("write_data", false);
+    sync_read.print_json("sync_read", false);
+    sync_write.print_json("sync_write", true);
+    printf("  },\n");
+}
+
+// 控制环：每个周期sync_write目标位置（ACC起7字节）并sync_read位置和速度（4字节）
+// 单帧参数不超过MAX_PARAMS，舵机较多时按帧容量分批
+static void bench_control_loop(const BenchConfig& config) {
+    const size_t counts[] = {1, 4, 8, 16, 32, 64, 128, 253};
+    const size_t WRITE_LEN = 7;
+    const size_t READ_LEN  = 4;
+    const size_t write_batch = (STProtocol::MAX_PARAMS - 2) / (WRITE_LEN + 1);
+    const size_t read_batch  = STProtocol::MAX_PARAMS - 2;
+
+    printf("  \"control_loop\": [\n");
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        BenchBus bench(config, counts[c]);
+        LatencySamples tick;
+        std::vector<std::vector<uint8_t>> params_rx_vec;
+
+        for (int i = 0; i < config.iterations; i++) {
+            uint16_t goal = (i & 1) ? 1024 : 3072;
+            uint8_t  motion[WRITE_LEN] = {0, static_cast<uint8_t>(goal & 0xFF), static_cast<uint8_t>(goal >> 8), 0, 0, 0, 0};
+            bench.measure(tick, [&]() {
+                bool ok = true;
+                for (size_t first = 0; first < bench.ids.size(); first += write_batch) {
+                    size_t last = std::min(first + write_batch, bench.ids.size());
+                    std::vector<uint8_t> ids(bench.ids.begin() + first, bench.ids.begin() + last);
+                    std::vector<std::vector<uint8_t>> data(ids.size(), std::vector<uint8_t>(motion, motion + WRITE_LEN));
+                    ok &= bool(bench.servo.sync_write(ids, STSMemoryMap::ACC, data));
+                }
+                for (size_t first = 0; first < bench.ids.size(); first += read_batch) {
+                    size_t last = std::min(first + read_batch, bench.ids.size());
+                    std::vector<uint8_t> ids(bench.ids.begin() + first, bench.ids.begin() + last);
+                    ok &= bool(bench.servo.sync_read(ids, STSMemoryMap::PRESENT_POSITION, READ_LEN, params_rx_vec));
+                }
+                return ok;
+            });
+        }
+
+        double mean = tick.mean();
+        printf("    {\"servos\": %u, \"rate_hz\": %.1f, ", static_cast<unsigned>(counts[c]), mean > 0 ? 1e6 / mean : 0);
+        printf("\"tick\": {\"p50_us\": %u, \"p99_us\": %u, \"max_us\": %u}}%s\n",
+               tick.percentile(0.50), tick.percentile(0.99), tick.percentile(1.0),
+               (c + 1 < sizeof(counts) / sizeof(counts[0])) ? "," : "");
+    }
+    printf("  ],\n");
+}
+
+// 读取计划：每个周期读取12个舵机的位置、负载和温度，对比逐字段sync_read与合并后的区间
+static void bench_read_plan(const BenchConfig& config) {
+    using namespace STSRegisters;
+    const size_t SERVOS = 12;
+    BenchBus bench(config, SERVOS);
+    LatencySamples separate, planned;
+    std::vector<std::vector<uint8_t>> params_rx_vec;
+    std::vector<ServoResult> result_vec;
+
+    ReadPlan plan;
+    plan.add<PRESENT_POSITION>().add<PRESENT_LOAD>().add<PRESENT_TEMPERATURE>();
+
+    for (int i = 0; i < config.iterations; i++) {
+        bench.measure(separate, [&]() {
+            bool ok = bool(bench.servo.sync_read(bench.ids, PRESENT_POSITION::ADDRESS, PRESENT_POSITION::WIDTH, params_rx_vec));
+            ok &= bool(bench.servo.sync_read(bench.ids, PRESENT_LOAD::ADDRESS, PRESENT_LOAD::WIDTH, params_rx_vec));
+            ok &= bool(bench.servo.sync_read(bench.ids, PRESENT_TEMPERATURE::ADDRESS, PRESENT_TEMPERATURE::WIDTH, params_rx_vec));
+            return ok;
+        });
+        bench.measure(planned, [&]() { return bool(bench.servo.sync_read(bench.ids, plan, result_vec)); });
+    }
+
+    printf("  \"read_plan\": {\"servos\": %u, \"fields\": 3, \"spans\": %u, "
+           "\"separate_mean_us\": %.1f, \"planned_mean_us\": %.1f},\n",
+           static_cast<unsigned>(SERVOS), static_cast<unsigned>(plan.span_count()), separate.mean(), planned.mean());
+}
+
+// 总线组：24个舵机放在1条或2条总线上，每个周期sync_write目标（7字节）并sync_read位置和速度（4字节）
+static void bench_bus_group(const BenchConfig& config) {
+    const size_t SERVOS    = 24;
+    const size_t WRITE_LEN = 7;
+    const size_t READ_LEN  = 4;
+
+    printf("  \"bus_group\": [\n");
+    for (size_t bus_count = 1; bus_count <= 2; bus_count++) {
+        SimClock clock;
+        std::vector<ServoBusSim*> sims;
+        std::vector<STServo*>     buses;
+        ServoBusGroup group;
+        std::vector<uint8_t> ids;
+        for (size_t b = 0; b < bus_count; b++) {
+            sims.push_back(new ServoBusSim(clock, b + 1));
+            sims[b]->set_return_delay(config.returnDelayUs);
+            sims[b]->set_noise(config.noise);
+            buses.push_back(new STServo(*sims[b], config.baudrate, false, &clock));
+            buses[b]->setReturnDelay(config.returnDelayUs);
+            group.add_bus(*buses[b]);
+        }
+        // 按ID连续分段放到各总线上
+        for (size_t i = 0; i < SERVOS; i++) {
+            uint8_t id  = i + 1;
+            uint8_t bus = i * bus_count / SERVOS;
+            sims[bus]->add_servo(id);
+            group.assign(id, bus);
+            ids.push_back(id);
+        }
+
+        LatencySamples tick;
+        std::vector<std::vector<uint8_t>> params_rx_vec;
+        std::vector<ServoResult> result_vec;
+        for (int i = 0; i < config.iterations; i++) {
+            uint16_t goal = (i & 1) ? 1024 : 3072;
+            std::vector<uint8_t> motion = {0, static_cast<uint8_t>(goal & 0xFF), static_cast<uint8_t>(goal >> 8), 0, 0, 0, 0};
+            std::vector<std::vector<uint8_t>> data(SERVOS, motion);
+
+            uint64_t start      = clock.now();
+            auto     wall_start = std::chrono::steady_clock::now();
+            bool ok = bool(group.sync_write(ids, STSMemoryMap::ACC, data));
+            ok &= bool(group.sync_read(ids, STSMemoryMap::PRESENT_POSITION, READ_LEN, params_rx_vec, result_vec));
+            auto     wall_stop  = std::chrono::steady_clock::now();
+            uint64_t stop       = clock.now();
+            for (size_t b = 0; b < bus_count; b++) {
+                stop = std::max(stop, sims[b]->idle_at());
+            }
+            clock.advance(stop - clock.now());
+            tick.add(static_cast<uint32_t>(stop - start),
+                     std::chrono::duration<double, std::nano>(wall_stop - wall_start).count(), ok);
+        }
+
+        double mean = tick.mean();
+        printf("    {\"buses\": %u, \"servos\": %u, \"write_len\": %u, \"read_len\": %u, \"rate_hz\": %.1f, ",
+               static_cast<unsigned>(bus_count), static_cast<unsigned>(SERVOS), static_cast<unsigned>(WRITE_LEN),
+               static_cast<unsigned>(READ_LEN), mean > 0 ? 1e6 / mean : 0);
+        printf("\"tick\": {\"p50_us\": %u, \"p99_us\": %u, \"max_us\": %u}}%s\n",
+               tick.percentile(0.50), tick.percentile(0.99), tick.percentile(1.0), bus_count < 2 ? "," : "");
+
+        for (size_t b = 0; b < bus_count; b++) {
+            delete buses[b];
+            delete sims[b];
+        }
+    }
+    printf("  ],\n");
+}
+
+template<typename F>
+static double ns_per_call(int iterations, F call) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        g_sink += call();
+    }
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count() / iterations;
+}
+
+// 编码请求帧和解析应答帧的CPU时间（不经过总线）
+static void bench_codec(const BenchConfig& config) {
+    const int iterations = config.iterations * 100;
+    uint8_t buf[STProtocol::MAX_PACKET_SIZE];
+
+    const uint8_t read_params[2] = {STSMemoryMap::PRESENT_POSITION, 4};
+    double encode_read = ns_per_call(iterations, [&]() {
+        return encode_packet(buf, sizeof(buf), 1, STServo::INST_READ, read_params, sizeof(read_params));
+    });
+
+    const uint8_t motion[7] = {0, 0x00, 0x08, 0x00, 0x00, 0x20, 0x03};
+    double encode_sync_write = ns_per_call(iterations, [&]() {
+        PacketEncoder packet(buf, sizeof(buf));
+        packet.begin(STProtocol::BROADCAST_ID, STServo::INST_SYNC_WRITE);
+        packet.put(STSMemoryMap::ACC);
+        packet.put(sizeof(motion));
+        for (uint8_t id = 1; id <= 12; id++) {
+            packet.put(id);
+            packet.put(motion, sizeof(motion));
+        }
+        return packet.finish();
+    });
+
+    // 12个舵机的sync_read应答流
+    std::vector<uint8_t> stream;
+    const uint8_t position[4] = {0x00, 0x08, 0x00, 0x00};
+    for (uint8_t id = 1; id <= 12; id++) {
+        size_t size = encode_packet(buf, sizeof(buf), id, 0, position, sizeof(position));
+        stream.insert(stream.end(), buf, buf + size);
+    }
+    FrameParser parser;
+    double decode_stream = ns_per_call(iterations, [&]() {
+        size_t frames = 0;
+        size_t offset = 0;
+        while (offset < stream.size()) {
+            ParseResult result;
+            offset += parser.feed(stream.data() + offset, stream.size() - offset, result);
+            if (result != PARSE_NEED_MORE) {
+                frames++;
+                parser.reset();
+            }
+        }
+        return frames;
+    });
+
+    printf("  \"codec\": {\"encode_read_ns\": %.1f, \"encode_sync_write_12x7_ns\": %.1f, "
+           "\"decode_sync_read_12x4_ns\": %.1f, \"decode_ns_per_byte\": %.2f},\n",
+           encode_read, encode_sync_write, decode_stream, decode_stream / stream.size());
+}
+
+// 轨迹插值：各插值方式的单点CPU时间、16个舵机一个节拍的设定值计算时间，以及每个节拍sync_write的总线时间
+static void bench_trajectory(const BenchConfig& config) {
+    const int    iterations = config.iterations * 100;
+    const size_t SERVOS     = TrajectoryPlayer::MAX_SERVOS;
+    static const char* const names[] = {"linear", "cubic", "trapezoid", "scurve"};
+
+    SimClock    clock;
+    ServoBusSim sim(clock);
+    STServo     bus(sim, config.baudrate, false, &clock);
+    std::vector<uint8_t> ids;
+    for (size_t i = 0; i < SERVOS; i++) {
+        ids.push_back(i + 1);
+        sim.add_servo(i + 1);
+    }
+
+    printf("  \"trajectory\": [\n");
+    for (int p = TRAJECTORY_LINEAR; p <= TRAJECTORY_SCURVE; p++) {
+        TrajectoryProfile profile = static_cast<TrajectoryProfile>(p);
+        float u = 0.0f;
+        double kernel_ns = ns_per_call(iterations, [&]() {
+            u = (u >= 1.0f) ? 0.0f : u + 0.001f;
+            return static_cast<uint32_t>(TrajectoryPlayer::interpolate(profile, 1000.0f, 3000.0f, 200.0f, -100.0f, u));
+        });
+
+        // 8个关键帧、每帧250ms，在整条轨迹上均匀取样
+        TrajectoryPlayer player;
+        player.set_servos(ids);
+        player.set_profile(profile);
+        for (uint32_t k = 0; k < 8; k++) {
+            player.add_keyframe(k * 250, std::vector<uint16_t>(SERVOS, static_cast<uint16_t>((k & 1) ? 3000 : 1000)));
+        }
+        uint16_t positions[TrajectoryPlayer::MAX_SERVOS];
+        uint32_t elapsed = 0;
+        double sample_ns = ns_per_call(config.iterations * 10, [&]() {
+            elapsed = (elapsed >= player.duration_ms() * 1000) ? 0 : elapsed + 997;
+            player.sample(elapsed, positions);
+            return positions[0];
+        });
+
+        LatencySamples tick;
+        player.start(static_cast<uint32_t>(clock.now()), 2000);
+        for (int i = 0; i < config.iterations && player.running(); i++) {
+            uint64_t start      = clock.now();
+            auto     wall_start = std::chrono::steady_clock::now();
+            bool ok = bool(player.tick(bus, clock));
+            auto     wall_stop  = std::chrono::steady_clock::now();
+            uint64_t stop       = std::max(clock.now(), sim.idle_at());
+            tick.add(static_cast<uint32_t>(stop - start),
+                     std::chrono::duration<double, std::nano>(wall_stop - wall_start).count(), ok);
+            if (start + 2000 > clock.now()) {
+                clock.advance(start + 2000 - clock.now());
+            }
+        }
+
+        printf("    {\"profile\": \"%s\", \"kernel_ns\": %.1f, \"sample_%ux_ns\": %.1f, ",
+               names[p], kernel_ns, static_cast<unsigned>(SERVOS), sample_ns);
+        printf("\"tick_bus_us\": %u, \"max_rate_hz\": %.0f}%s\n",
+               tick.percentile(0.50), tick.percentile(0.50) ? 1e6 / tick.percentile(0.50) : 0,
+               p < TRAJECTORY_SCURVE ? "," : "");
+    }
+    printf("  ]\n");
+}
+
+#ifdef BENCH_WITH_ARDUINOJSON
+// 固件JSON/MessagePack路径的主体：解析请求、按func分派、取出参数、执行、序列化应答
+static bool json_request(ST3215& servo, const std::string& line, std::string& out, bool msgpack = false) {
+    JsonDocument request;
+    DeserializationError error = msgpack ? deserializeMsgPack(request, line) : deserializeJson(request, line);
+    if (error) {
+        return false;
+    }
+    JsonDocument response;
+    std::vector<uint8_t>     ids;
+    std::vector<uint16_t>    posi, velo;
+    std::vector<int16_t>     present, speed;
+    std::vector<ServoResult> results;
+    const char* func = request["func"] | "";
+    for (JsonVariantConst v : request["dev_id"].as<JsonArrayConst>()) {
+        ids.push_back(v.as<uint8_t>());
+    }
+    ServoResult result;
+    if (strcmp(func, "setPosition") == 0) {
+        for (JsonVariantConst v : request["posi"].as<JsonArrayConst>()) {
+            posi.push_back(v.as<uint16_t>());
+            velo.push_back(request["velo"] | 800);
+        }
+        result = servo.setPosition(ids, posi, velo);
+    } else {
+        result = servo.getPosition(ids, present, speed, results);
+        JsonArray posiArray = response["posi"].to<JsonArray>();
+        JsonArray veloArray = response["velo"].to<JsonArray>();
+        for (size_t i = 0; i < present.size(); i++) {
+            posiArray.add(present[i]);
+            veloArray.add(speed[i]);
+        }
+    }
+    response["error"] = result ? 0 : 4;
+    out.clear();
+    if (msgpack) {
+        serializeMsgPack(response, out);
+    } else {
+        serializeJson(response, out);
+    }
+    return bool(result);
+}
+#endif
+
+// 控制端口每个请求的处理开销：同一请求直接调用、经过二进制帧、经过JSON和MessagePack（编译时找到ArduinoJson）
+// 三条路径都在模拟总线上执行，差值即协议解析和格式化的CPU时间；requests_per_sec按主机墙钟时间计算
+static void bench_control_port(const BenchConfig& config) {
+    const size_t SERVOS     = 6;
+    const int    iterations = config.iterations * 10;
+    BenchBus bench(config, SERVOS);
+    ST3215& servo = bench.servo;
+
+    // 客户端发来的帧，预先编码
+    std::vector<uint8_t> set_frame = {0, 0, BIN_OP_SET_POSITION, 1, 0, static_cast<uint8_t>(SERVOS)};
+    std::vector<uint8_t> get_frame = {0, 0, BIN_OP_GET_POSITION, 2, 0, static_cast<uint8_t>(SERVOS)};
+    set_frame.insert(set_frame.end(), bench.ids.begin(), bench.ids.end());
+    get_frame.insert(get_frame.end(), bench.ids.begin(), bench.ids.end());
+    for (size_t i = 0; i < SERVOS * 2; i++) {
+        uint16_t value = (i < SERVOS) ? 2048 : 800;
+        set_frame.push_back(value & 0xFF);
+        set_frame.push_back(value >> 8);
+    }
+    set_frame[0] = set_frame.size() - 2;
+    get_frame[0] = get_frame.size() - 2;
+
+    std::vector<uint16_t> posi(SERVOS, 2048), velo(SERVOS, 800);
+    std::vector<int16_t>  present, speed;
+    std::vector<ServoResult> results;
+    double direct_set = ns_per_call(iterations, [&]() { return uint32_t(bool(servo.setPosition(bench.ids, posi, velo))); });
+    double direct_get = ns_per_call(iterations, [&]() { return uint32_t(bool(servo.getPosition(bench.ids, present, speed, results))); });
+
+    ServoBusGroup group;
+    ServoRouter router(group);
+    router.add_bus(servo);
+    FrameReader reader;
+    std::vector<uint8_t> response;
+    auto binary = [&](const std::vector<uint8_t>& frame) {
+        reader.feed(frame.data(), frame.size());
+        BinaryProtocol::handle(router, reader.payload(), reader.length(), response);
+        reader.next();
+        return static_cast<uint32_t>(response[5] == SERVO_OK);
+    };
+    double binary_set = ns_per_call(iterations, [&]() { return binary(set_frame); });
+    double binary_get = ns_per_call(iterations, [&]() { return binary(get_frame); });
+
+    std::string set_line = "{\"func\":\"setPosition\",\"dev_id\":[1,2,3,4,5,6],\"posi\":[2048,2048,2048,2048,2048,2048],\"velo\":800}";
+    std::string get_line = "{\"func\":\"getPosition\",\"dev_id\":[1,2,3,4,5,6]}";
+    printf("  \"control_port\": {\"servos\": %u, \"request_bytes\": {\"set_binary\": %u, \"set_json\": %u},\n",
+           static_cast<unsigned>(SERVOS), static_cast<unsigned>(set_frame.size()), static_cast<unsigned>(set_line.size() + 1));
+#ifdef BENCH_WITH_ARDUINOJSON
+    std::string out;
+    double json_set = ns_per_call(iterations, [&]() { return uint32_t(json_request(servo, set_line, out)); });
+    double json_get = ns_per_call(iterations, [&]() { return uint32_t(json_request(servo, get_line, out)); });
+
+    // 同一命令的MessagePack编码
+    std::string set_msgpack, get_msgpack;
+    JsonDocument doc;
+    deserializeJson(doc, set_line);
+    serializeMsgPack(doc, set_msgpack);
+    deserializeJson(doc, get_line);
+    serializeMsgPack(doc, get_msgpack);
+    double msgpack_set = ns_per_call(iterations, [&]() { return uint32_t(json_request(servo, set_msgpack, out, true)); });
+    double msgpack_get = ns_per_call(iterations, [&]() { return uint32_t(json_request(servo, get_msgpack, out, true)); });
+
+    // 只计解析请求和序列化getPosition应答（不上总线）
+    JsonDocument response;
+    JsonArray posiArray = response["posi"].to<JsonArray>();
+    JsonArray veloArray = response["velo"].to<JsonArray>();
+    for (size_t i = 0; i < SERVOS; i++) {
+        posiArray.add(2048);
+        veloArray.add(0);
+    }
+    response["error"] = 0;
+    const int codec_iterations = iterations * 10;
+    double json_parse = ns_per_call(codec_iterations, [&]() {
+        return uint32_t(deserializeJson(doc, set_line) == DeserializationError::Ok);
+    });
+    double json_serialize = ns_per_call(codec_iterations, [&]() {
+        out.clear();
+        return uint32_t(serializeJson(response, out));
+    });
+    double msgpack_parse = ns_per_call(codec_iterations, [&]() {
+        return uint32_t(deserializeMsgPack(doc, set_msgpack) == DeserializationError::Ok);
+    });
+    double msgpack_serialize = ns_per_call(codec_iterations, [&]() {
+        out.clear();
+        return uint32_t(serializeMsgPack(response, out));
+    });
+    printf("    \"codec\": {\"json_parse_ns\": %.0f, \"json_serialize_ns\": %.0f, \"msgpack_parse_ns\": %.0f, "
+           "\"msgpack_serialize_ns\": %.0f, \"set_msgpack_bytes\": %u},\n",
+           json_parse, json_serialize, msgpack_parse, msgpack_serialize, static_cast<unsigned>(set_msgpack.size() + 2));
+#else
+    double json_set    = 0;
+    double json_get    = 0;
+    double msgpack_set = 0;
+    double msgpack_get = 0;
+#endif
+    const char* names[]  = {"set_position", "get_position"};
+    double      direct[] = {direct_set, direct_get};
+    double      bin[]    = {binary_set, binary_get};
+    double      json[]   = {json_set, json_get};
+    double      msgpack[] = {msgpack_set, msgpack_get};
+    for (int k = 0; k < 2; k++) {
+        printf("    \"%s\": {\"direct_ns\": %.0f, \"binary_ns\": %.0f, \"binary_rps\": %.0f, \"binary_overhead_ns\": %.0f, ",
+               names[k], direct[k], bin[k], 1e9 / bin[k], bin[k] - direct[k]);
+        if (json[k] > 0) {
+            printf("\"json_ns\": %.0f, \"json_rps\": %.0f, \"json_overhead_ns\": %.0f, "
+                   "\"msgpack_ns\": %.0f, \"msgpack_rps\": %.0f, \"msgpack_overhead_ns\": %.0f}%s\n",
+                   json[k], 1e9 / json[k], json[k] - direct[k],
+                   msgpack[k], 1e9 / msgpack[k], msgpack[k] - direct[k], k ? "" : ",");
+        } else {
+            printf("\"json_ns\": null, \"msgpack_ns\": null}%s\n", k ? "" : ",");
+        }
+    }
+    printf("  },\n");
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config = {1000, 1000000, 0, 0, "host"};
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if      (strcmp(argv[i], "--iterations") == 0)      config.iterations    = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--baud") == 0)            config.baudrate      = strtoul(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--return-delay-us") == 0) config.returnDelayUs = strtoul(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--noise") == 0)           config.noise         = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--label") == 0)           config.label         = argv[i + 1];
+        else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (config.iterations <= 0 || config.baudrate == 0) {
+        fprintf(stderr, "Invalid iterations or baudrate\n");
+        return 2;
+    }
+
+    printf("{\n");
+    printf("  \"label\": \"%s\",\n", config.label);
+    printf("  \"config\": {\"iterations\": %d, \"baudrate\": %u, \"return_delay_us\": %u, \"noise\": %g},\n",
+           config.iterations, config.baudrate, config.returnDelayUs, config.noise);
+    bench_instructions(config);
+    bench_control_loop(config);
+    bench_read_plan(config);
+    bench_bus_group(config);
+    bench_codec(config);
+    bench_control_port(config);
+    bench_trajectory(config);
+    printf("}\n");
+    return 0;
+}
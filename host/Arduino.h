@@ -0,0 +1,39 @@
+#ifndef STServo_HOST_ARDUINO_H
+#define STServo_HOST_ARDUINO_H
+
+// 主机编译用的最小Arduino接口，只覆盖test_core.cpp和test_st3215.cpp用到的部分
+// 时间函数转发到host_clock()，配合SimClock时delay()立即返回
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "hal.h"
+
+// Serial：输出到stdout，同时保留一份副本供测试程序检查
+class HostSerial {
+    public:
+        size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+        size_t print(const char* str);
+        size_t println(const char* str = "");
+
+        const std::string& output() const { return _output; }
+        void               clearOutput()  { _output.clear(); }
+
+    private:
+        std::string _output;
+};
+
+extern HostSerial Serial;
+
+// 设置Arduino时间函数使用的时钟，NULL时恢复平台默认时钟
+void        host_set_clock(ServoClock* clock);
+ServoClock& host_clock();
+
+inline uint32_t millis()            { return host_clock().millis(); }
+inline uint32_t micros()            { return host_clock().micros(); }
+inline void     delay(uint32_t ms)  { host_clock().delay(ms); }
+inline void     yield()             { host_clock().idle(); }
+
+#endif // STServo_HOST_ARDUINO_H
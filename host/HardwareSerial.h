@@ -0,0 +1,6 @@
+#ifndef STServo_HOST_HARDWARE_SERIAL_H
+#define STServo_HOST_HARDWARE_SERIAL_H
+
+#include "Arduino.h"
+
+#endif // STServo_HOST_HARDWARE_SERIAL_H
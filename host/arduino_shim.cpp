@@ -0,0 +1,33 @@
+#include <stdarg.h>
+#include "Arduino.h"
+
+HostSerial Serial;
+
+static ServoClock* g_clock = NULL;
+
+void host_set_clock(ServoClock* clock) {
+    g_clock = clock;
+}
+
+ServoClock& host_clock() {
+    return g_clock ? *g_clock : servo_default_clock();
+}
+
+size_t HostSerial::printf(const char* format, ...) {
+    char buf[512];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    return print(buf) > 0 ? static_cast<size_t>(len) : 0;
+}
+
+size_t HostSerial::print(const char* str) {
+    _output += str;
+    fputs(str, stdout);
+    return strlen(str);
+}
+
+size_t HostSerial::println(const char* str) {
+    return print(str) + print("\n");
+}
@@ -0,0 +1,105 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "fd_transport.h"
+
+FdTransport::FdTransport(const char* path) : _path(path), _fd(-1), _ownsFd(true) {}
+
+FdTransport::FdTransport(int fd) : _path(NULL), _fd(fd), _ownsFd(false) {}
+
+FdTransport::~FdTransport() {
+    end();
+}
+
+// 波特率转换为termios常量，不支持时返回B0
+static speed_t to_speed(uint32_t baudrate) {
+    switch (baudrate) {
+        case 9600:    return B9600;
+        case 19200:   return B19200;
+        case 38400:   return B38400;
+        case 57600:   return B57600;
+        case 115200:  return B115200;
+        case 230400:  return B230400;
+#ifdef B500000
+        case 500000:  return B500000;
+#endif
+#ifdef B1000000
+        case 1000000: return B1000000;
+#endif
+        default:      return B0;
+    }
+}
+
+bool FdTransport::configure_tty(uint32_t baudrate) {
+    struct termios tio;
+    if (tcgetattr(_fd, &tio) != 0) {
+        return true;    // 不是终端（socketpair、管道），无需配置
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN]  = 0;
+    tio.c_cc[VTIME] = 0;
+    speed_t speed = to_speed(baudrate);
+    if (speed == B0) {
+        servo_log("[Error] [FdTransport::begin()] Unsupported baudrate %u\n", baudrate);
+        return false;
+    }
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    return tcsetattr(_fd, TCSANOW, &tio) == 0;
+}
+
+bool FdTransport::begin(uint32_t baudrate) {
+    if (_fd < 0 && _path) {
+        _fd = open(_path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (_fd < 0) {
+            servo_log("[Error] [FdTransport::begin()] Cannot open %s: %s\n", _path, strerror(errno));
+            return false;
+        }
+    }
+    if (_fd < 0) {
+        return false;
+    }
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+    return configure_tty(baudrate);
+}
+
+void FdTransport::end() {
+    if (_ownsFd && _fd >= 0) {
+        close(_fd);
+        _fd = -1;
+    }
+}
+
+int FdTransport::available() {
+    int count = 0;
+    if (_fd < 0 || ioctl(_fd, FIONREAD, &count) != 0) {
+        return 0;
+    }
+    return count;
+}
+
+size_t FdTransport::read(uint8_t* buf, size_t len) {
+    if (_fd < 0) {
+        return 0;
+    }
+    ssize_t count = ::read(_fd, buf, len);
+    return count > 0 ? static_cast<size_t>(count) : 0;
+}
+
+size_t FdTransport::write(const uint8_t* buf, size_t len) {
+    size_t written = 0;
+    while (_fd >= 0 && written < len) {
+        ssize_t count = ::write(_fd, buf + written, len - written);
+        if (count > 0) {
+            written += count;
+        } else if (count < 0 && errno != EAGAIN && errno != EINTR) {
+            break;
+        }
+    }
+    return written;
+}
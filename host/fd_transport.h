@@ -0,0 +1,32 @@
+#ifndef STServo_FD_TRANSPORT_H
+#define STServo_FD_TRANSPORT_H
+
+#include "hal.h"
+
+// 基于文件描述符的传输：USB串口（/dev/ttyUSB0）、pty或socketpair
+// 终端设备会被设置为原始模式和指定波特率，其他描述符原样使用
+class FdTransport : public ServoTransport {
+    public:
+        // 打开设备路径，begin()时配置
+        explicit FdTransport(const char* path);
+        // 使用已打开的描述符（不负责关闭）
+        explicit FdTransport(int fd);
+        ~FdTransport();
+
+        bool   begin(uint32_t baudrate);
+        void   end();
+        int    available();
+        size_t read(uint8_t* buf, size_t len);
+        size_t write(const uint8_t* buf, size_t len);
+
+        int    fd() const { return _fd; }
+
+    private:
+        const char* _path;
+        int         _fd;
+        bool        _ownsFd;
+
+        bool configure_tty(uint32_t baudrate);
+};
+
+#endif // STServo_FD_TRANSPORT_H
@@ -0,0 +1,43 @@
+// 主机（Linux/POSIX）平台的默认时钟和日志实现
+#include <stdarg.h>
+#include <stdio.h>
+#include <sched.h>
+#include <time.h>
+#include "hal.h"
+
+// 基于CLOCK_MONOTONIC的时钟，与Arduino一样从0开始计时并按32位回绕
+class PosixClock : public ServoClock {
+    public:
+        PosixClock() : _start(now_us()) {}
+
+        uint32_t micros()            { return static_cast<uint32_t>(now_us() - _start); }
+        uint32_t millis()            { return static_cast<uint32_t>((now_us() - _start) / 1000); }
+        void     idle()              { sched_yield(); }
+        void     delay(uint32_t ms) {
+            struct timespec ts;
+            ts.tv_sec  = ms / 1000;
+            ts.tv_nsec = (ms % 1000) * 1000000L;
+            while (nanosleep(&ts, &ts) != 0) {}
+        }
+
+    private:
+        uint64_t _start;
+
+        static uint64_t now_us() {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return static_cast<uint64_t>(ts.tv_sec) * 1000000ULL + ts.tv_nsec / 1000;
+        }
+};
+
+ServoClock& servo_default_clock() {
+    static PosixClock clock;
+    return clock;
+}
+
+void servo_log(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
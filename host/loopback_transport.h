@@ -0,0 +1,62 @@
+#ifndef STServo_LOOPBACK_TRANSPORT_H
+#define STServo_LOOPBACK_TRANSPORT_H
+
+#include <deque>
+#include <vector>
+#include "hal.h"
+
+// 内存回环传输：记录STServo写出的字节，由测试代码注入应答字节
+// 子类可重写on_write()，在请求写出时立即生成应答（例如总线模拟器）
+class LoopbackTransport : public ServoTransport {
+    public:
+        LoopbackTransport() : _baudrate(0) {}
+
+        bool begin(uint32_t baudrate) {
+            _baudrate = baudrate;
+            return true;
+        }
+
+        void end() {}
+
+        int available() {
+            return static_cast<int>(_rx.size());
+        }
+
+        size_t read(uint8_t* buf, size_t len) {
+            size_t count = 0;
+            while (count < len && !_rx.empty()) {
+                buf[count++] = _rx.front();
+                _rx.pop_front();
+            }
+            return count;
+        }
+
+        size_t write(const uint8_t* buf, size_t len) {
+            _tx.insert(_tx.end(), buf, buf + len);
+            on_write(buf, len);
+            return len;
+        }
+
+        // 注入待STServo读取的字节
+        void inject(const uint8_t* data, size_t len) {
+            _rx.insert(_rx.end(), data, data + len);
+        }
+        void inject(const std::vector<uint8_t>& data) {
+            inject(data.data(), data.size());
+        }
+
+        // 已写出的字节（全部请求按顺序拼接）
+        const std::vector<uint8_t>& written() const { return _tx; }
+        void                        clear_written() { _tx.clear(); }
+        uint32_t                    baudrate()      const { return _baudrate; }
+
+    protected:
+        virtual void on_write(const uint8_t* buf, size_t len) { (void)buf; (void)len; }
+
+    private:
+        std::deque<uint8_t>  _rx;
+        std::vector<uint8_t> _tx;
+        uint32_t             _baudrate;
+};
+
+#endif // STServo_LOOPBACK_TRANSPORT_H
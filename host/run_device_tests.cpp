@@ -0,0 +1,75 @@
+// 在模拟总线上运行设备功能测试（src/test_core.cpp、src/test_st3215.cpp）
+// 用法：run_device_tests core|ext [servo_count]
+// 从ID 3开始模拟servo_count个舵机（默认2个，即测试用的ID 3和4），
+// ID 99留空给testPingFunction()的无应答测试；第二条总线上模拟ID 3和4（位置与第一条不同），供多总线测试使用
+// 任何"❌"输出都视为失败
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Arduino.h"
+#include "servo_bus_sim.h"
+#include "st3215.h"
+#include "test_core.h"
+#include "test_st3215.h"
+
+ST3215* servo = nullptr;
+ST3215* servo2 = nullptr;
+TestBus* testBus = nullptr;
+
+// 测试通过TestBus访问第一条模拟总线
+class SimTestBus : public TestBus {
+    public:
+        explicit SimTestBus(ServoBusSim& bus) : _bus(bus) {}
+
+        uint8_t* memory(uint8_t id)              { return _bus.memory(id); }
+        bool     add_servo(uint8_t id)           { return _bus.add_servo(id); }
+        void     set_dead(uint8_t id, bool dead) { _bus.set_dead(id, dead); }
+        void     inject_before_reply(const uint8_t* data, size_t len) { _bus.inject_before_reply(data, len); }
+
+    private:
+        ServoBusSim& _bus;
+};
+
+int main(int argc, char** argv) {
+    const char* suite = (argc > 1) ? argv[1] : "core";
+    size_t      count = (argc > 2) ? strtoul(argv[2], NULL, 10) : 2;
+
+    SimClock    clock;
+    ServoBusSim bus(clock);
+    host_set_clock(&clock);
+    for (uint8_t id = 3; count > 0 && id < STProtocol::BROADCAST_ID; id++) {
+        if (id != 99 && bus.add_servo(id)) {
+            count--;
+        }
+    }
+
+    ST3215 st3215(bus, 1000000, false, &clock);
+    servo = &st3215;
+    SimTestBus simTestBus(bus);
+    testBus = &simTestBus;
+    
+    ServoBusSim bus2(clock, 2);
+    bus2.add_servo(3, 1024);
+    bus2.add_servo(4, 3072);
+    ST3215 st3215b(bus2, 1000000, false, &clock);
+    servo2 = &st3215b;
+
+    if (strcmp(suite, "core") == 0) {
+        runAllTests();
+    } else if (strcmp(suite, "ext") == 0) {
+        runAllExtTests();
+    } else {
+        fprintf(stderr, "Unknown suite: %s\n", suite);
+        return 2;
+    }
+
+    const BusSimStats& stats = bus.stats();
+    printf("[sim] servos=%u requests=%llu replies=%llu bus_busy=%lluus virtual_time=%llums\n",
+           static_cast<unsigned>(bus.servo_count()),
+           static_cast<unsigned long long>(stats.requests),
+           static_cast<unsigned long long>(stats.replies),
+           static_cast<unsigned long long>(stats.busyMicros),
+           static_cast<unsigned long long>(clock.now() / 1000));
+
+    return (Serial.output().find("❌") == std::string::npos) ? 0 : 1;
+}
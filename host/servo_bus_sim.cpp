@@ -0,0 +1,392 @@
+#include <math.h>
+#include <string.h>
+#include "core.h"
+#include "servo_bus_sim.h"
+
+ServoBusSim::ServoBusSim(SimClock& clock, uint32_t seed)
+    : _clock(clock), _baudrate(1000000), _rng(seed ? seed : 1), _noiseRate(0), _dropRate(0), _busFreeAt(0), _requestEnd(0) {
+    rebuild_index();
+    reset_stats();
+}
+
+bool ServoBusSim::begin(uint32_t baudrate) {
+    _baudrate = baudrate;
+    return true;
+}
+
+void ServoBusSim::end() {}
+
+// 只返回虚拟时间已经到达的字节，并让时钟的idle()跳到下一个字节的到达时刻
+int ServoBusSim::available() {
+    uint64_t now   = _clock.now();
+    size_t   count = 0;
+    while (count < _rx.size() && _rx[count].time <= now) {
+        count++;
+    }
+    _clock.wake_at(count < _rx.size() ? _rx[count].time : 0);
+    return static_cast<int>(count);
+}
+
+size_t ServoBusSim::read(uint8_t* buf, size_t len) {
+    uint64_t now   = _clock.now();
+    size_t   count = 0;
+    while (count < len && !_rx.empty() && _rx.front().time <= now) {
+        buf[count++] = _rx.front().byte;
+        _rx.pop_front();
+    }
+    return count;
+}
+
+// 请求在当前时刻开始发送，舵机在最后一个字节到达后处理
+size_t ServoBusSim::write(const uint8_t* buf, size_t len) {
+    uint64_t request_end = _clock.now() + wire_time_us(len);
+    _requestEnd          = request_end;
+    _stats.requestBytes += len;
+    _stats.busyMicros   += wire_time_us(len);
+
+    size_t offset = 0;
+    while (offset < len) {
+        ParseResult result;
+        offset += _parser.feed(buf + offset, len - offset, result);
+        if (result == PARSE_FRAME_OK) {
+            _stats.requests++;
+            handle_request(_parser.id(), _parser.error(), _parser.params(), _parser.paramsLength(), request_end);
+            _parser.reset();
+        } else if (result == PARSE_CHECKSUM_ERROR) {
+            _stats.badRequests++;
+            _parser.reset();
+        }
+    }
+    return len;
+}
+
+bool ServoBusSim::add_servo(uint8_t id, uint16_t position) {
+    if (id >= STProtocol::BROADCAST_ID || _byId[id] >= 0) {
+        return false;
+    }
+    Servo servo;
+    memset(servo.mem, 0, sizeof(servo.mem));
+    servo.mem[0]                              = 3;       // 固件主版本
+    servo.mem[1]                              = 10;      // 固件次版本
+    servo.mem[STSMemoryMap::SMS_STS_MODEL]     = DEFAULT_MODEL & 0xFF;
+    servo.mem[STSMemoryMap::SMS_STS_MODEL + 1] = DEFAULT_MODEL >> 8;
+    servo.mem[STSMemoryMap::ID]                = id;
+    servo.mem[STSMemoryMap::RESPONSE_LEVEL]    = 1;
+    servo.mem[STSMemoryMap::EPROM_LOCK]        = 1;
+    servo.mem[STSMemoryMap::GOAL_POSITION]     = position & 0xFF;
+    servo.mem[STSMemoryMap::GOAL_POSITION + 1] = position >> 8;
+    servo.mem[STSMemoryMap::PRESENT_VOLTAGE]   = 120;    // 12.0V
+    servo.mem[STSMemoryMap::PRESENT_TEMPERATURE] = 30;
+    servo.pos         = position;
+    servo.lastUpdate  = _clock.now();
+    servo.dead        = false;
+    servo.pending     = false;
+    servo.pendingAddr = 0;
+    update_motion(servo, servo.lastUpdate);
+    _servos.push_back(servo);
+    rebuild_index();
+    return true;
+}
+
+void ServoBusSim::add_servos(uint8_t first_id, size_t count) {
+    for (size_t i = 0; i < count && first_id + i < STProtocol::BROADCAST_ID; i++) {
+        add_servo(first_id + i);
+    }
+}
+
+uint8_t* ServoBusSim::memory(uint8_t id) {
+    Servo* servo = find(id);
+    if (!servo) {
+        return NULL;
+    }
+    update_motion(*servo, _clock.now());
+    return servo->mem;
+}
+
+uint16_t ServoBusSim::position(uint8_t id) {
+    uint8_t* mem = memory(id);
+    return mem ? (mem[STSMemoryMap::PRESENT_POSITION] | (mem[STSMemoryMap::PRESENT_POSITION + 1] << 8)) : 0;
+}
+
+void ServoBusSim::set_dead(uint8_t id, bool dead) {
+    Servo* servo = find(id);
+    if (servo) {
+        servo->dead = dead;
+    }
+}
+
+void ServoBusSim::set_noise(double byte_error_rate) {
+    _noiseRate = byte_error_rate;
+}
+
+void ServoBusSim::set_drop_rate(double byte_drop_rate) {
+    _dropRate = byte_drop_rate;
+}
+
+// 插入的字节排在已排队的应答字节之后，保持到达时间有序
+void ServoBusSim::inject(const uint8_t* data, size_t len) {
+    uint64_t now = _clock.now();
+    if (!_rx.empty() && _rx.back().time > now) {
+        now = _rx.back().time;
+    }
+    for (size_t i = 0; i < len; i++) {
+        TimedByte timed = { now, data[i] };
+        _rx.push_back(timed);
+    }
+}
+
+void ServoBusSim::inject_before_reply(const uint8_t* data, size_t len) {
+    _preamble.insert(_preamble.end(), data, data + len);
+}
+
+void ServoBusSim::set_return_delay(uint32_t delay_us) {
+    uint32_t units = delay_us / 2;
+    for (size_t i = 0; i < _servos.size(); i++) {
+        _servos[i].mem[STSMemoryMap::RETURN_DELAY] = (units > 0xFF) ? 0xFF : units;
+    }
+}
+
+void ServoBusSim::reset_stats() {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+// 8N1：每字节10位，向上取整
+uint64_t ServoBusSim::wire_time_us(size_t bytes) const {
+    return (static_cast<uint64_t>(bytes) * 10 * 1000000ULL + _baudrate - 1) / _baudrate;
+}
+
+// xorshift32，保证故障注入可复现
+double ServoBusSim::random() {
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    return _rng / 4294967296.0;
+}
+
+void ServoBusSim::rebuild_index() {
+    for (int i = 0; i < 256; i++) {
+        _byId[i] = -1;
+    }
+    for (size_t i = 0; i < _servos.size(); i++) {
+        uint8_t id = _servos[i].mem[STSMemoryMap::ID];
+        if (_byId[id] < 0) {
+            _byId[id] = static_cast<int>(i);
+        }
+    }
+}
+
+ServoBusSim::Servo* ServoBusSim::find(uint8_t id) {
+    return (_byId[id] >= 0) ? &_servos[_byId[id]] : NULL;
+}
+
+// 按经过的虚拟时间向目标位置匀速运动，并刷新只读状态寄存器
+void ServoBusSim::update_motion(Servo& servo, uint64_t now) {
+    uint8_t* mem = servo.mem;
+    double   dt  = (now > servo.lastUpdate) ? (now - servo.lastUpdate) / 1e6 : 0;
+    servo.lastUpdate = now;
+
+    uint16_t goal_raw  = mem[STSMemoryMap::GOAL_POSITION] | (mem[STSMemoryMap::GOAL_POSITION + 1] << 8);
+    uint16_t speed_raw = mem[STSMemoryMap::GOAL_SPEED]    | (mem[STSMemoryMap::GOAL_SPEED + 1]    << 8);
+    double   goal      = (goal_raw & 0x8000) ? 0 : (goal_raw > 4095 ? 4095 : goal_raw);  // 位置模式不支持负位置
+    double   speed     = (speed_raw & 0x7FFF) ? (speed_raw & 0x7FFF) : MAX_SPEED;
+    bool     torque    = mem[STSMemoryMap::TORQUE_SWITCH] != 0;
+
+    double velocity = 0;
+    if (torque && servo.pos != goal) {
+        double step = speed * dt;
+        if (fabs(goal - servo.pos) <= step) {
+            servo.pos = goal;
+        } else {
+            velocity   = (goal > servo.pos) ? speed : -speed;
+            servo.pos += (goal > servo.pos) ? step : -step;
+        }
+    }
+
+    uint16_t pos      = static_cast<uint16_t>(lround(servo.pos));
+    uint16_t velo     = static_cast<uint16_t>(fabs(velocity)) | (velocity < 0 ? 0x8000 : 0);
+    bool     moving   = torque && servo.pos != goal;
+    mem[STSMemoryMap::PRESENT_POSITION]     = pos & 0xFF;
+    mem[STSMemoryMap::PRESENT_POSITION + 1] = pos >> 8;
+    mem[STSMemoryMap::PRESENT_SPEED]        = velo & 0xFF;
+    mem[STSMemoryMap::PRESENT_SPEED + 1]    = velo >> 8;
+    mem[STSMemoryMap::MOVING]               = moving ? 1 : 0;
+    mem[STSMemoryMap::ASYNC_ACTION]         = servo.pending ? 1 : 0;
+}
+
+// 只有ID到EPROM_LOCK之间的地址可写，只读地址的写入被忽略
+void ServoBusSim::write_memory(Servo& servo, uint8_t addr, const uint8_t* data, size_t len, uint64_t now) {
+    update_motion(servo, now);
+    bool id_changed   = false;
+    bool goal_written = false;
+    for (size_t i = 0; i < len; i++) {
+        size_t a = addr + i;
+        if (a < STSMemoryMap::ID || a > STSMemoryMap::EPROM_LOCK) {
+            continue;
+        }
+        id_changed   |= (a == STSMemoryMap::ID && servo.mem[a] != data[i]);
+        goal_written |= (a == STSMemoryMap::GOAL_POSITION || a == STSMemoryMap::GOAL_POSITION + 1);
+        servo.mem[a]  = data[i];
+    }
+    // 与实际舵机一致：收到位置指令时自动打开扭矩
+    if (goal_written) {
+        servo.mem[STSMemoryMap::TORQUE_SWITCH] = 1;
+    }
+    if (id_changed) {
+        rebuild_index();
+    }
+    update_motion(servo, now);
+}
+
+bool ServoBusSim::replies_to_writes(const Servo& servo) const {
+    return servo.mem[STSMemoryMap::RESPONSE_LEVEL] != 0;
+}
+
+void ServoBusSim::handle_request(uint8_t id, uint8_t instruction, const uint8_t* params, size_t len, uint64_t now) {
+    bool broadcast = (id == STProtocol::BROADCAST_ID);
+
+    // 广播请求作用于所有存活的舵机，单播只作用于对应ID
+    std::vector<Servo*> targets;
+    if (broadcast) {
+        for (size_t i = 0; i < _servos.size(); i++) {
+            if (!_servos[i].dead) {
+                targets.push_back(&_servos[i]);
+            }
+        }
+    } else {
+        Servo* servo = find(id);
+        if (!servo || servo->dead) {
+            return;
+        }
+        targets.push_back(servo);
+    }
+
+    switch (instruction) {
+        case STServo::INST_PING:
+            if (!broadcast) {
+                reply(*targets[0], id, NULL, 0, now);
+            }
+            break;
+
+        case STServo::INST_READ:
+            if (!broadcast && len == 2) {
+                update_motion(*targets[0], now);
+                uint8_t data[MEMORY_SIZE];
+                for (size_t i = 0; i < params[1]; i++) {
+                    data[i] = targets[0]->mem[(params[0] + i) & 0xFF];
+                }
+                reply(*targets[0], id, data, params[1], now);
+            }
+            break;
+
+        case STServo::INST_WRITE:
+        case STServo::INST_REG_WRITE:
+            if (len < 1) {
+                break;
+            }
+            for (size_t i = 0; i < targets.size(); i++) {
+                if (instruction == STServo::INST_WRITE) {
+                    write_memory(*targets[i], params[0], params + 1, len - 1, now);
+                } else {
+                    targets[i]->pending     = true;
+                    targets[i]->pendingAddr = params[0];
+                    targets[i]->pendingData.assign(params + 1, params + len);
+                    update_motion(*targets[i], now);
+                }
+            }
+            if (!broadcast && replies_to_writes(*targets[0])) {
+                reply(*targets[0], id, NULL, 0, now);
+            }
+            break;
+
+        case STServo::INST_ACTION:
+            for (size_t i = 0; i < targets.size(); i++) {
+                Servo& servo = *targets[i];
+                if (servo.pending) {
+                    servo.pending = false;
+                    write_memory(servo, servo.pendingAddr, servo.pendingData.data(), servo.pendingData.size(), now);
+                }
+            }
+            if (!broadcast && replies_to_writes(*targets[0])) {
+                reply(*targets[0], id, NULL, 0, now);
+            }
+            break;
+
+        case STServo::INST_SYNC_WRITE: {
+            // params: addr, len, (id, data[len])...
+            if (len < 2 || params[1] == 0) {
+                break;
+            }
+            size_t stride = params[1] + 1;
+            for (size_t offset = 2; offset + stride <= len; offset += stride) {
+                Servo* servo = find(params[offset]);
+                if (servo && !servo->dead) {
+                    write_memory(*servo, params[0], params + offset + 1, params[1], now);
+                }
+            }
+            break;
+        }
+
+        case STServo::INST_SYNC_READ: {
+            // params: addr, len, id...，各舵机按请求顺序依次应答
+            if (len < 2) {
+                break;
+            }
+            uint64_t cursor = now;
+            for (size_t i = 2; i < len; i++) {
+                Servo* servo = find(params[i]);
+                if (!servo || servo->dead) {
+                    continue;
+                }
+                update_motion(*servo, cursor);
+                uint8_t data[MEMORY_SIZE];
+                for (size_t j = 0; j < params[1]; j++) {
+                    data[j] = servo->mem[(params[0] + j) & 0xFF];
+                }
+                cursor = reply(*servo, params[i], data, params[1], cursor);
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+// 应答在请求结束（或前一个应答结束）后经过RETURN_DELAY开始发送，返回应答结束时刻
+// 应答使用请求中的ID，修改ID的WRITE仍以旧ID应答
+uint64_t ServoBusSim::reply(Servo& servo, uint8_t id, const uint8_t* params, size_t len, uint64_t request_end) {
+    uint8_t frame[STProtocol::MAX_PACKET_SIZE];
+    size_t  size  = encode_packet(frame, sizeof(frame), id, 0, params, len);
+    uint64_t start = request_end + servo.mem[STSMemoryMap::RETURN_DELAY] * 2;
+    schedule(frame, size, start);
+    _stats.replies++;
+    return _busFreeAt;
+}
+
+void ServoBusSim::schedule(const uint8_t* frame, size_t len, uint64_t start) {
+    if (start < _busFreeAt) {
+        start = _busFreeAt;
+    }
+    // 注入的字节占用应答之前的线上时间，不受噪声和丢字节影响
+    for (size_t i = 0; i < _preamble.size(); i++) {
+        TimedByte timed = { start + wire_time_us(i + 1), _preamble[i] };
+        _rx.push_back(timed);
+    }
+    start += wire_time_us(_preamble.size());
+    _preamble.clear();
+    for (size_t i = 0; i < len; i++) {
+        TimedByte timed = { start + wire_time_us(i + 1), frame[i] };
+        _stats.replyBytes++;
+        if (_dropRate > 0 && random() < _dropRate) {
+            _stats.droppedBytes++;
+            continue;
+        }
+        if (_noiseRate > 0 && random() < _noiseRate) {
+            timed.byte ^= static_cast<uint8_t>(1 << static_cast<int>(random() * 8));
+            _stats.corruptedBytes++;
+        }
+        _rx.push_back(timed);
+    }
+    _busFreeAt = start + wire_time_us(len);
+    _stats.busyMicros += wire_time_us(len);
+}
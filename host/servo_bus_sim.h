@@ -0,0 +1,124 @@
+#ifndef STServo_BUS_SIM_H
+#define STServo_BUS_SIM_H
+
+#include <deque>
+#include <vector>
+#include "hal.h"
+#include "protocol.h"
+
+// 虚拟时钟：delay()立即返回并推进时间，idle()直接跳到下一个应答字节到达的时刻
+class SimClock : public ServoClock {
+    public:
+        static const uint32_t IDLE_STEP_US = 10;   // 没有待到达字节时每次idle()推进的时间
+
+        SimClock() : _now(0), _wakeAt(0) {}
+
+        uint32_t micros()           { return static_cast<uint32_t>(_now); }
+        uint32_t millis()           { return static_cast<uint32_t>(_now / 1000); }
+        void     idle()             { _now = (_wakeAt > _now) ? _wakeAt : _now + IDLE_STEP_US; }
+        void     delay(uint32_t ms) { _now += static_cast<uint64_t>(ms) * 1000; }
+
+        void     advance(uint64_t us)      { _now += us; }
+        void     wake_at(uint64_t time_us) { _wakeAt = time_us; }
+        uint64_t now() const               { return _now; }
+
+    private:
+        uint64_t _now;
+        uint64_t _wakeAt;
+};
+
+// 模拟总线统计
+struct BusSimStats {
+    uint64_t requests;         // 解析成功的请求帧
+    uint64_t badRequests;      // 校验和错误的请求帧（舵机忽略）
+    uint64_t replies;          // 应答帧
+    uint64_t requestBytes;     // 主机写出的字节
+    uint64_t replyBytes;       // 舵机应答的字节（含被丢弃的）
+    uint64_t droppedBytes;     // 注入的丢字节
+    uint64_t corruptedBytes;   // 注入的错误字节
+    uint64_t busyMicros;       // 总线占用时间（请求+应答线上时间）
+};
+
+// 进程内ST3215/STS舵机链模拟器，作为ServoTransport接在STServo后面
+// 按STSMemoryMap地址模拟内存表，支持PING/READ/WRITE/REG_WRITE/ACTION/SYNC_READ/SYNC_WRITE，
+// 按波特率和RETURN_DELAY计算应答字节的到达时间，并按GOAL_SPEED向GOAL_POSITION匀速运动
+class ServoBusSim : public ServoTransport {
+    public:
+        static const size_t   MEMORY_SIZE   = 256;
+        static const uint16_t DEFAULT_MODEL = 777;    // ST3215型号
+        static const uint16_t MAX_SPEED     = 3400;   // GOAL_SPEED为0时的速度（步/秒）
+
+        explicit ServoBusSim(SimClock& clock, uint32_t seed = 1);
+
+        // ServoTransport
+        bool   begin(uint32_t baudrate);
+        void   end();
+        int    available();
+        size_t read(uint8_t* buf, size_t len);
+        size_t write(const uint8_t* buf, size_t len);
+
+        // 舵机管理
+        bool     add_servo(uint8_t id, uint16_t position = 2048);
+        void     add_servos(uint8_t first_id, size_t count);
+        size_t   servo_count() const { return _servos.size(); }
+        uint8_t* memory(uint8_t id);          // 舵机内存表，不存在时返回NULL
+        uint16_t position(uint8_t id);        // 当前位置（按虚拟时间更新运动）
+
+        // 故障注入
+        void set_dead(uint8_t id, bool dead);              // 舵机不再应答也不执行指令
+        void set_noise(double byte_error_rate);            // 应答字节随机翻转位的概率
+        void set_drop_rate(double byte_drop_rate);         // 应答字节丢失的概率
+        void inject(const uint8_t* data, size_t len);      // 在当前时刻向接收端插入原始字节
+        void inject_before_reply(const uint8_t* data, size_t len);  // 下一个应答帧之前先在线上发出这些字节
+
+        // 时序
+        void     set_return_delay(uint32_t delay_us);      // 写入所有舵机的RETURN_DELAY（单位2us）
+        uint32_t baudrate() const { return _baudrate; }
+        // 最后一个请求或应答字节离开总线的时刻
+        uint64_t idle_at()  const { return (_busFreeAt > _requestEnd) ? _busFreeAt : _requestEnd; }
+
+        const BusSimStats& stats() const { return _stats; }
+        void               reset_stats();
+
+    private:
+        struct Servo {
+            uint8_t              mem[MEMORY_SIZE];
+            double               pos;
+            uint64_t             lastUpdate;
+            bool                 dead;
+            bool                 pending;          // REG_WRITE等待ACTION
+            uint8_t              pendingAddr;
+            std::vector<uint8_t> pendingData;
+        };
+        struct TimedByte {
+            uint64_t time;
+            uint8_t  byte;
+        };
+
+        SimClock&              _clock;
+        uint32_t               _baudrate;
+        uint32_t               _rng;
+        double                 _noiseRate;
+        double                 _dropRate;
+        std::vector<Servo>     _servos;
+        int                    _byId[256];     // ID -> _servos下标，-1表示不存在
+        FrameParser            _parser;
+        std::deque<TimedByte>  _rx;            // 按到达时间排序的应答字节
+        std::vector<uint8_t>   _preamble;      // inject_before_reply()的字节
+        uint64_t               _busFreeAt;     // 最后一个应答字节的到达时间
+        uint64_t               _requestEnd;    // 最后一个请求字节的发送结束时间
+        BusSimStats            _stats;
+
+        uint64_t wire_time_us(size_t bytes) const;
+        double   random();
+        void     rebuild_index();
+        Servo*   find(uint8_t id);
+        void     update_motion(Servo& servo, uint64_t now);
+        void     write_memory(Servo& servo, uint8_t addr, const uint8_t* data, size_t len, uint64_t now);
+        bool     replies_to_writes(const Servo& servo) const;
+        void     handle_request(uint8_t id, uint8_t instruction, const uint8_t* params, size_t len, uint64_t now);
+        uint64_t reply(Servo& servo, uint8_t id, const uint8_t* params, size_t len, uint64_t request_end);
+        void     schedule(const uint8_t* frame, size_t len, uint64_t start);
+};
+
+#endif // STServo_BUS_SIM_H
@@ -0,0 +1,72 @@
+// 主机端总线扫描工具：通过USB串口（或pty）对指定ID发送PING
+// 用法：servo_ping [--margin-us N] /dev/ttyUSB0 [baudrate] [id...]，未指定ID时扫描0-253
+// --margin-us：自适应超时在应答线上时间之外的余量。USB串口适配器按latency timer（FTDI默认16ms）批量上送数据，
+// 库默认的300us只适合板载UART，因此这里默认20000us；latency timer调小后可以相应减小以加快扫描
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "fd_transport.h"
+#include "st3215.h"
+
+static const uint32_t TTY_MARGIN_US = 20000;
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--margin-us N] <device> [baudrate] [id...]\n", program);
+    fprintf(stderr, "  --margin-us N  reply timeout margin in microseconds (default %u, covers USB adapter latency)\n",
+            (unsigned)TTY_MARGIN_US);
+}
+
+int main(int argc, char** argv) {
+    uint32_t margin_us = TTY_MARGIN_US;
+    std::vector<const char*> args;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--margin-us") == 0) {
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+                return 2;
+            }
+            margin_us = strtoul(argv[++i], NULL, 10);
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    if (args.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+    uint32_t baudrate = (args.size() > 1) ? strtoul(args[1], NULL, 10) : 1000000;
+
+    std::vector<uint8_t> ids;
+    for (size_t i = 2; i < args.size(); i++) {
+        ids.push_back(static_cast<uint8_t>(atoi(args[i])));
+    }
+    bool listed = !ids.empty();
+    if (!listed) {
+        for (int id = 0; id < STProtocol::BROADCAST_ID; id++) {
+            ids.push_back(id);
+        }
+    }
+
+    FdTransport transport(args[0]);
+    ST3215 servo(transport, baudrate);
+    if (transport.fd() < 0) {
+        return 1;
+    }
+    servo.setTimeoutMargin(margin_us);
+
+    int found = 0;
+    for (size_t i = 0; i < ids.size(); i++) {
+        uint8_t error;
+        std::vector<uint8_t> params_rx;
+        ServoResult result = servo.ping(ids[i], error, params_rx);
+        if (result) {
+            printf("ID %3d: ok (error=0x%02X)\n", ids[i], error);
+            found++;
+        } else if (listed) {
+            printf("ID %3d: %s\n", ids[i], result.name());
+        }
+    }
+    printf("%d servo(s) found\n", found);
+    return found > 0 ? 0 : 1;
+}
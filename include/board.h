@@ -2,6 +2,10 @@
 #define SERVO_RXD_PIN           18
 #define SERVO_TXD_PIN           19
 
+// 第二条舵机总线（Serial2，可选）：取消注释后启用
+// #define SERVO2_RXD_PIN          16
+// #define SERVO2_TXD_PIN          17
+
 // SSD1306显示器配置
 #define SSD1306_SDA_PIN         21
 #define SSD1306_SCL_PIN         22
@@ -0,0 +1,324 @@
+#include <string.h>
+#include "binary_protocol.h"
+
+size_t FrameReader::feed(const uint8_t* data, size_t len) {
+    size_t used = 0;
+    while (used < len && !_ready && !_invalid) {
+        if (_received < sizeof(_header)) {
+            _header[_received++] = data[used++];
+            if (_received == sizeof(_header)) {
+                _length  = _header[0] | (_header[1] << 8);
+                _invalid = (_length == 0 || _length > MAX_PAYLOAD);
+            }
+            continue;
+        }
+        size_t offset = _received - sizeof(_header);
+        size_t take   = _length - offset;
+        take = (take < len - used) ? take : len - used;
+        memcpy(_payload + offset, data + used, take);
+        used      += take;
+        _received += take;
+        _ready     = (_received == _length + sizeof(_header));
+    }
+    return used;
+}
+
+void FrameReader::next() {
+    _length   = 0;
+    _received = 0;
+    _ready    = false;
+}
+
+void FrameReader::reset() {
+    next();
+    _invalid = false;
+}
+
+// 请求参数游标：越界后ok()为false，之后的读取返回0
+class PayloadCursor {
+    public:
+        PayloadCursor(const uint8_t* data, size_t len) : _data(data), _len(len), _pos(0), _ok(true) {}
+
+        uint8_t u8() {
+            if (_pos + 1 > _len) {
+                _ok = false;
+                return 0;
+            }
+            return _data[_pos++];
+        }
+
+        uint16_t u16() {
+            uint8_t lo = u8();
+            uint8_t hi = u8();
+            return lo | (hi << 8);
+        }
+
+        // 读取n个字节，不足时返回NULL
+        const uint8_t* bytes(size_t n) {
+            if (_pos + n > _len) {
+                _ok = false;
+                return NULL;
+            }
+            const uint8_t* p = _data + _pos;
+            _pos += n;
+            return p;
+        }
+
+        size_t remaining() const { return _len - _pos; }
+        // 参数完整且没有多余字节
+        bool   done() const { return _ok && _pos == _len; }
+
+    private:
+        const uint8_t* _data;
+        size_t         _len;
+        size_t         _pos;
+        bool           _ok;
+};
+
+static void put_u16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(value & 0xFF);
+    out.push_back(value >> 8);
+}
+
+static void put_u32(std::vector<uint8_t>& out, uint32_t value) {
+    put_u16(out, value & 0xFFFF);
+    put_u16(out, value >> 16);
+}
+
+static void put_codes(std::vector<uint8_t>& out, const std::vector<ServoResult>& results) {
+    for (size_t i = 0; i < results.size(); i++) {
+        out.push_back(static_cast<uint8_t>(results[i].code));
+    }
+}
+
+// 舵机数n和n个ID；n为0时失败
+static bool read_ids(PayloadCursor& args, std::vector<uint8_t>& ids) {
+    uint8_t n = args.u8();
+    const uint8_t* p = args.bytes(n);
+    if (n == 0 || !p) {
+        return false;
+    }
+    ids.assign(p, p + n);
+    return true;
+}
+
+static void read_u16_array(PayloadCursor& args, size_t n, std::vector<uint16_t>& values) {
+    values.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        values[i] = args.u16();
+    }
+}
+
+static ServoResult dispatch(ServoRouter& router, uint8_t opcode, PayloadCursor& args, std::vector<uint8_t>& out) {
+    const ServoResult invalid(SERVO_ERR_PARAM);
+    uint8_t error = 0;
+    std::vector<uint8_t>     ids;
+    std::vector<uint8_t>     params_rx;
+    std::vector<ServoResult> results;
+
+    switch (opcode) {
+        case BIN_OP_PING: {
+            uint8_t id = args.u8();
+            if (!args.done()) {
+                return invalid;
+            }
+            // 未定位的舵机依次在各总线上查找
+            return (router.group().route(id) != ServoBusGroup::NO_BUS) ? router.bus_for(id).ping(id, error, params_rx)
+                                                                       : router.group().locate(id);
+        }
+        case BIN_OP_READ: {
+            uint8_t id     = args.u8();
+            uint8_t addr   = args.u8();
+            uint8_t length = args.u8();
+            if (!args.done() || length == 0) {
+                return invalid;
+            }
+            ServoResult result = router.bus_for(id).read(id, addr, length, error, params_rx);
+            out.insert(out.end(), params_rx.begin(), params_rx.end());
+            return result;
+        }
+        case BIN_OP_WRITE: {
+            uint8_t id   = args.u8();
+            uint8_t addr = args.u8();
+            size_t  n    = args.remaining();
+            const uint8_t* data = args.bytes(n);
+            if (!args.done() || n == 0) {
+                return invalid;
+            }
+            return router.bus_for(id).write_data(id, addr, std::vector<uint8_t>(data, data + n), error, params_rx);
+        }
+        case BIN_OP_SYNC_WRITE: {
+            uint8_t addr   = args.u8();
+            uint8_t length = args.u8();
+            bool    ok     = read_ids(args, ids);
+            const uint8_t* data = args.bytes(ids.size() * length);
+            if (!ok || !args.done() || length == 0) {
+                return invalid;
+            }
+            std::vector<std::vector<uint8_t>> data_vec(ids.size());
+            for (size_t i = 0; i < ids.size(); i++) {
+                data_vec[i].assign(data + i * length, data + (i + 1) * length);
+            }
+            return router.group().sync_write(ids, addr, data_vec);
+        }
+        case BIN_OP_SYNC_READ: {
+            uint8_t addr   = args.u8();
+            uint8_t length = args.u8();
+            if (!read_ids(args, ids) || !args.done() || length == 0) {
+                return invalid;
+            }
+            std::vector<std::vector<uint8_t>> data_vec;
+            ServoResult result = router.group().sync_read(ids, addr, length, data_vec, results);
+            if (results.size() != ids.size() || data_vec.size() != ids.size()) {
+                return result;
+            }
+            put_codes(out, results);
+            for (size_t i = 0; i < ids.size(); i++) {
+                bool valid = results[i] && data_vec[i].size() == length;
+                for (size_t b = 0; b < length; b++) {
+                    out.push_back(valid ? data_vec[i][b] : 0);
+                }
+            }
+            return result;
+        }
+        case BIN_OP_SET_TORQUE: {
+            uint8_t id   = args.u8();
+            uint8_t mode = args.u8();
+            if (!args.done() || mode > TORQUE_DAMPED) {
+                return invalid;
+            }
+            return router.bus_for(id).setTorqueMode(id, static_cast<TorqueMode>(mode));
+        }
+        case BIN_OP_SET_ACCELERATION: {
+            bool ok = read_ids(args, ids);
+            const uint8_t* acc = args.bytes(ids.size());
+            if (!ok || !args.done()) {
+                return invalid;
+            }
+            return router.setAcceleration(ids, std::vector<uint8_t>(acc, acc + ids.size()));
+        }
+        case BIN_OP_SET_POSITION: {
+            std::vector<uint16_t> posi, velo;
+            bool ok = read_ids(args, ids);
+            read_u16_array(args, ids.size(), posi);
+            read_u16_array(args, ids.size(), velo);
+            if (!ok || !args.done()) {
+                return invalid;
+            }
+            return router.setPosition(ids, posi, velo);
+        }
+        case BIN_OP_GET_POSITION: {
+            if (!read_ids(args, ids) || !args.done()) {
+                return invalid;
+            }
+            std::vector<int16_t> posi, velo;
+            ServoResult result = router.getPosition(ids, posi, velo, results);
+            if (results.size() != ids.size() || posi.size() != ids.size()) {
+                return result;
+            }
+            put_codes(out, results);
+            for (size_t i = 0; i < ids.size(); i++) {
+                put_u16(out, static_cast<uint16_t>(posi[i]));
+            }
+            for (size_t i = 0; i < ids.size(); i++) {
+                put_u16(out, static_cast<uint16_t>(velo[i]));
+            }
+            return result;
+        }
+        case BIN_OP_GET_STATUS: {
+            if (!read_ids(args, ids) || !args.done()) {
+                return invalid;
+            }
+            std::vector<ServoStatus> status_vec;
+            ServoResult result = router.getStatus(ids, status_vec, results);
+            if (results.size() != ids.size() || status_vec.size() != ids.size()) {
+                return result;
+            }
+            put_codes(out, results);
+            for (size_t i = 0; i < ids.size(); i++) {
+                const ServoStatus& status = status_vec[i];
+                put_u16(out, static_cast<uint16_t>(status.posi));
+                put_u16(out, static_cast<uint16_t>(status.velo));
+                put_u16(out, static_cast<uint16_t>(status.load));
+                out.push_back(status.volt);
+                out.push_back(status.temp);
+                out.push_back(status.asyn);
+                out.push_back(status.stat);
+                out.push_back(status.mvng ? 1 : 0);
+                put_u16(out, static_cast<uint16_t>(status.curr));
+            }
+            return result;
+        }
+        case BIN_OP_MOVE_TIMED: {
+            uint8_t  n        = args.u8();
+            uint16_t duration = args.u16();
+            uint8_t  timing   = args.u8();
+            const uint8_t* p  = args.bytes(n);
+            std::vector<uint16_t> posi, velo;
+            read_u16_array(args, n, posi);
+            if (!args.done() || n == 0 || timing > MOVE_BY_TIME) {
+                return invalid;
+            }
+            ids.assign(p, p + n);
+            uint32_t actual_ms = 0;
+            ServoResult result = router.moveTimed(ids, posi, duration, velo, actual_ms, static_cast<MoveTiming>(timing));
+            if (result) {
+                put_u32(out, actual_ms);
+                for (size_t i = 0; i < velo.size(); i++) {
+                    put_u16(out, velo[i]);
+                }
+            }
+            return result;
+        }
+        case BIN_OP_JSON:
+            return args.done() ? ServoResult(SERVO_OK) : invalid;
+        default:
+            return invalid;
+    }
+}
+
+void BinaryProtocol::begin_response(const uint8_t* request, size_t len, std::vector<uint8_t>& response) {
+    response.assign(2 + RESPONSE_HEADER, 0);
+    response[2] = (len > 0 ? request[0] : 0) | RESPONSE_FLAG;
+    if (len >= REQUEST_HEADER) {
+        response[3] = request[1];
+        response[4] = request[2];
+    }
+}
+
+void BinaryProtocol::end_response(uint8_t code, uint8_t servo_error, std::vector<uint8_t>& response) {
+    response[5] = code;
+    response[6] = servo_error;
+    size_t payload = response.size() - 2;
+    response[0] = payload & 0xFF;
+    response[1] = (payload >> 8) & 0xFF;
+}
+
+void BinaryProtocol::handle(ServoRouter& router, const uint8_t* request, size_t len, std::vector<uint8_t>& response) {
+    begin_response(request, len, response);
+    ServoResult result(SERVO_ERR_PARAM);
+    if (len >= REQUEST_HEADER) {
+        PayloadCursor args(request + REQUEST_HEADER, len - REQUEST_HEADER);
+        result = dispatch(router, request[0], args, response);
+    }
+    end_response(static_cast<uint8_t>(result.code), result.servoError, response);
+}
+
+void BinaryProtocol::reject(const uint8_t* request, size_t len, uint8_t code, std::vector<uint8_t>& response) {
+    begin_response(request, len, response);
+    end_response(code, 0, response);
+}
+
+BusPriority BinaryProtocol::priority(uint8_t opcode) {
+    switch (opcode) {
+        case BIN_OP_WRITE:
+        case BIN_OP_SYNC_WRITE:
+        case BIN_OP_SET_TORQUE:
+        case BIN_OP_SET_ACCELERATION:
+        case BIN_OP_SET_POSITION:
+        case BIN_OP_MOVE_TIMED:
+            return BUS_PRIORITY_MOTION;
+        default:
+            return BUS_PRIORITY_TELEMETRY;
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef STServo_BINARY_PROTOCOL_H
+#define STServo_BINARY_PROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "servo_router.h"
+#include "bus_task.h"
+
+// 二进制控制协议：每帧为u16小端长度 + 载荷，多字节整数均为小端
+// 请求载荷：opcode u8, request_id u16, 参数
+// 应答载荷：opcode|0x80, request_id u16, code u8（ServoError）, servo_error u8, 数据
+// 数组按"先全部ID、再全部值"打包；多舵机读取的应答先给出每个舵机的code，再给出数据
+// 读出的位置、速度、负载和电流是有符号数（i16，补码）
+enum BinaryOpcode {
+    BIN_OP_PING             = 0x01,  // id
+    BIN_OP_READ             = 0x02,  // id, addr, len                         -> data[len]
+    BIN_OP_WRITE            = 0x03,  // id, addr, data[]
+    BIN_OP_SYNC_WRITE       = 0x04,  // addr, len, n, ids[n], data[n*len]
+    BIN_OP_SYNC_READ        = 0x05,  // addr, len, n, ids[n]                  -> codes[n], data[n*len]
+    BIN_OP_SET_TORQUE       = 0x10,  // id, mode
+    BIN_OP_SET_ACCELERATION = 0x11,  // n, ids[n], acc[n]
+    BIN_OP_SET_POSITION     = 0x12,  // n, ids[n], posi u16[n], velo u16[n]
+    BIN_OP_GET_POSITION     = 0x13,  // n, ids[n]                             -> codes[n], posi i16[n], velo i16[n]
+    BIN_OP_GET_STATUS       = 0x14,  // n, ids[n]                             -> codes[n], n个13字节的状态
+    BIN_OP_MOVE_TIMED       = 0x15,  // n, duration_ms u16, timing u8, ids[n], posi u16[n] -> actual_ms u32, velo u16[n]
+    BIN_OP_JSON             = 0x7F   // 应答之后连接切回JSON行协议
+};
+
+// 应答code除ServoError外的取值
+static const uint8_t BIN_STATUS_UNAVAILABLE = 0xFF;  // 舵机未初始化或总线队列满，请求没有执行
+
+// 按长度前缀切分TCP字节流，载荷缓存在内部
+class FrameReader {
+    public:
+        static const size_t MAX_PAYLOAD = 512;
+
+        FrameReader() { reset(); }
+
+        // 输入字节，返回消耗的字节数；一帧完整（ready）或长度非法（invalid）时停止消耗
+        size_t feed(const uint8_t* data, size_t len);
+        bool   ready() const { return _ready; }
+        // 长度为0或超过MAX_PAYLOAD，流已无法同步，需要断开连接
+        bool   invalid() const { return _invalid; }
+
+        const uint8_t* payload() const { return _payload; }
+        size_t         length() const { return _length; }
+
+        // 丢弃当前帧，开始接收下一帧
+        void next();
+        void reset();
+
+    private:
+        uint8_t _header[2];
+        uint8_t _payload[MAX_PAYLOAD];
+        size_t  _length;
+        size_t  _received;  // 含长度前缀
+        bool    _ready;
+        bool    _invalid;
+};
+
+class BinaryProtocol {
+    public:
+        static const uint8_t RESPONSE_FLAG   = 0x80;
+        static const size_t  REQUEST_HEADER  = 3;   // opcode, request_id
+        static const size_t  RESPONSE_HEADER = 5;   // opcode, request_id, code, servo_error
+        static const size_t  STATUS_SIZE     = 13;  // GET_STATUS每个舵机的字节数
+
+        // 执行一个请求载荷，response为带长度前缀的完整应答帧；载荷格式错误时code为SERVO_ERR_PARAM
+        // 每个舵机的命令发到所在的总线，多舵机命令按总线拆分（与JSON命令相同）
+        static void handle(ServoRouter& router, const uint8_t* request, size_t len, std::vector<uint8_t>& response);
+
+        // 不执行请求，直接给出code的应答帧
+        static void reject(const uint8_t* request, size_t len, uint8_t code, std::vector<uint8_t>& response);
+
+        // 写入类请求走运动优先级，其他走遥测优先级
+        static BusPriority priority(uint8_t opcode);
+
+    private:
+        static void begin_response(const uint8_t* request, size_t len, std::vector<uint8_t>& response);
+        static void end_response(uint8_t code, uint8_t servo_error, std::vector<uint8_t>& response);
+};
+
+#endif // STServo_BINARY_PROTOCOL_H
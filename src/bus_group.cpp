@@ -0,0 +1,121 @@
+#include <string.h>
+#include "bus_group.h"
+
+ServoBusGroup::ServoBusGroup() : _busCount(0) {
+    memset(_route, NO_BUS, sizeof(_route));
+}
+
+uint8_t ServoBusGroup::add_bus(STServo& bus) {
+    if (_busCount >= MAX_BUSES) {
+        return NO_BUS;
+    }
+    _buses[_busCount] = &bus;
+    return static_cast<uint8_t>(_busCount++);
+}
+
+void ServoBusGroup::assign(uint8_t dev_id, uint8_t bus_index) {
+    if (dev_id < STProtocol::BROADCAST_ID && (bus_index < _busCount || bus_index == NO_BUS)) {
+        _route[dev_id] = bus_index;
+    }
+}
+
+uint8_t ServoBusGroup::route(uint8_t dev_id) const {
+    return (dev_id < STProtocol::BROADCAST_ID) ? _route[dev_id] : NO_BUS;
+}
+
+STServo& ServoBusGroup::bus_for(uint8_t dev_id) {
+    uint8_t index = route(dev_id);
+    return *_buses[index == NO_BUS ? 0 : index];
+}
+
+ServoResult ServoBusGroup::locate(uint8_t dev_id) {
+    ServoResult result(SERVO_ERR_PARAM);
+    uint8_t error;
+    std::vector<uint8_t> params_rx;
+    for (size_t b = 0; b < _busCount; b++) {
+        result = _buses[b]->ping(dev_id, error, params_rx);
+        if (result) {
+            assign(dev_id, static_cast<uint8_t>(b));
+            return result;
+        }
+    }
+    return result;
+}
+
+void ServoBusGroup::split(const std::vector<uint8_t>& dev_id_vec) {
+    for (size_t b = 0; b < _busCount; b++) {
+        _ids[b].clear();
+        _index[b].clear();
+    }
+    for (size_t i = 0; i < dev_id_vec.size(); i++) {
+        uint8_t b = route(dev_id_vec[i]);
+        if (b == NO_BUS) {
+            b = 0;
+        }
+        _ids[b].push_back(dev_id_vec[i]);
+        _index[b].push_back(i);
+    }
+}
+
+ServoResult ServoBusGroup::sync_write(const std::vector<uint8_t>& dev_id_vec, uint8_t mem_addr,
+                                      const std::vector<std::vector<uint8_t>>& params_tx_vec) {
+    if (_busCount == 0 || dev_id_vec.empty() || dev_id_vec.size() != params_tx_vec.size()) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    split(dev_id_vec);
+
+    ServoResult first_failure(SERVO_OK);
+    std::vector<std::vector<uint8_t>> params;
+    for (size_t b = 0; b < _busCount; b++) {
+        if (_ids[b].empty()) {
+            continue;
+        }
+        params.clear();
+        for (size_t i = 0; i < _index[b].size(); i++) {
+            params.push_back(params_tx_vec[_index[b][i]]);
+        }
+        ServoResult result = _buses[b]->sync_write(_ids[b], mem_addr, params);
+        if (!result && first_failure) {
+            first_failure = result;
+        }
+    }
+    return first_failure;
+}
+
+ServoResult ServoBusGroup::sync_read(const std::vector<uint8_t>& dev_id_vec, uint8_t mem_addr, uint8_t length,
+                                     std::vector<std::vector<uint8_t>>& params_rx_vec,
+                                     std::vector<ServoResult>& result_vec) {
+    const size_t count = dev_id_vec.size();
+    params_rx_vec.assign(count, std::vector<uint8_t>());
+    result_vec.assign(count, ServoResult(SERVO_ERR_PARAM));
+    if (_busCount == 0 || count == 0) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    split(dev_id_vec);
+
+    // 先在所有总线上发出请求，各总线的应答同时在线上传输
+    bool sent[MAX_BUSES];
+    for (size_t b = 0; b < _busCount; b++) {
+        sent[b] = !_ids[b].empty() && _buses[b]->begin_sync_read(_ids[b], mem_addr, length);
+    }
+
+    std::vector<std::vector<uint8_t>> params_rx;
+    std::vector<ServoResult>          results;
+    for (size_t b = 0; b < _busCount; b++) {
+        if (!sent[b]) {
+            continue;
+        }
+        _buses[b]->finish_sync_read(_ids[b], length, params_rx, results);
+        for (size_t i = 0; i < _index[b].size(); i++) {
+            params_rx_vec[_index[b][i]].swap(params_rx[i]);
+            result_vec[_index[b][i]] = results[i];
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (!result_vec[i]) {
+            return result_vec[i];
+        }
+    }
+    return ServoResult(SERVO_OK);
+}
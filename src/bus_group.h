@@ -0,0 +1,48 @@
+#ifndef STServo_BUS_GROUP_H
+#define STServo_BUS_GROUP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "core.h"
+
+// 多条UART总线组成的逻辑总线：每个舵机ID路由到所在的总线，同步读写按总线拆分后并行传输
+// sync_write依次写入各总线的发送缓冲区后同时在线上传输；sync_read先向所有总线发出请求，再依次接收应答
+// 未分配的ID使用第0条总线
+class ServoBusGroup {
+    public:
+        static const size_t  MAX_BUSES = 4;
+        static const uint8_t NO_BUS    = 0xFF;
+
+        ServoBusGroup();
+
+        // 返回总线编号，超过MAX_BUSES时返回NO_BUS
+        uint8_t  add_bus(STServo& bus);
+        size_t   bus_count() const { return _busCount; }
+        STServo& bus(size_t index) { return *_buses[index]; }
+
+        void     assign(uint8_t dev_id, uint8_t bus_index);
+        uint8_t  route(uint8_t dev_id) const;            // 未分配时返回NO_BUS
+        STServo& bus_for(uint8_t dev_id);                // 未分配时返回第0条总线
+        // 依次在各总线上PING，找到后记录路由
+        ServoResult locate(uint8_t dev_id);
+
+        ServoResult sync_write(const std::vector<uint8_t>& dev_id_vec, uint8_t mem_addr,
+                               const std::vector<std::vector<uint8_t>>& params_tx_vec);
+        // result_vec[i]为dev_id_vec[i]的结果，返回按dev_id_vec顺序的第一个失败
+        ServoResult sync_read( const std::vector<uint8_t>& dev_id_vec, uint8_t mem_addr, uint8_t length,
+                               std::vector<std::vector<uint8_t>>& params_rx_vec,
+                               std::vector<ServoResult>& result_vec);
+
+    private:
+        // 按总线拆分：ids[b]为第b条总线上的ID，index[b]为它们在原列表中的位置
+        void split(const std::vector<uint8_t>& dev_id_vec);
+
+        STServo*                 _buses[MAX_BUSES];
+        size_t                   _busCount;
+        uint8_t                  _route[STProtocol::BROADCAST_ID];
+        std::vector<uint8_t>     _ids[MAX_BUSES];
+        std::vector<size_t>      _index[MAX_BUSES];
+};
+
+#endif // STServo_BUS_GROUP_H
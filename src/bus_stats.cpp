@@ -0,0 +1,92 @@
+#include <string.h>
+#include "bus_stats.h"
+#include "core.h"
+
+BusStats::BusStats() {
+    memset(_latency, 0, sizeof(_latency));
+    reset();
+}
+
+BusStats::~BusStats() {
+    for (size_t i = 0; i < STProtocol::BROADCAST_ID; i++) {
+        delete _latency[i];
+    }
+}
+
+StatsInstruction BusStats::classify(uint8_t instruction) {
+    switch (instruction) {
+        case STServo::INST_PING:       return STATS_PING;
+        case STServo::INST_READ:       return STATS_READ;
+        case STServo::INST_WRITE:      return STATS_WRITE;
+        case STServo::INST_REG_WRITE:  return STATS_REG_WRITE;
+        case STServo::INST_ACTION:     return STATS_ACTION;
+        case STServo::INST_SYNC_READ:  return STATS_SYNC_READ;
+        case STServo::INST_SYNC_WRITE: return STATS_SYNC_WRITE;
+        default:                       return STATS_OTHER;
+    }
+}
+
+const char* BusStats::name(StatsInstruction slot) {
+    static const char* const names[STATS_INSTRUCTION_COUNT] = {
+        "ping", "read", "write", "reg_write", "action", "sync_read", "sync_write", "other"
+    };
+    return names[slot];
+}
+
+void BusStats::record_request(uint8_t instruction, size_t tx_bytes) {
+    InstructionStats& stats = _instructions[classify(instruction)];
+    stats.count++;
+    stats.txBytes += tx_bytes;
+}
+
+void BusStats::record_rx(uint8_t instruction, size_t rx_bytes) {
+    _instructions[classify(instruction)].rxBytes += rx_bytes;
+}
+
+void BusStats::record_resyncs(uint8_t instruction, uint32_t resyncs) {
+    _instructions[classify(instruction)].resyncs += resyncs;
+}
+
+void BusStats::record_reply(uint8_t instruction, uint8_t dev_id, int code, uint32_t latency_us) {
+    InstructionStats& stats = _instructions[classify(instruction)];
+    // 长度错误、只收到其他ID的应答等都算作超时（截止时间内没有有效应答）
+    switch (code) {
+        case SERVO_OK:                                   break;
+        case SERVO_ERR_STATUS:   stats.servoErrors++;    break;
+        case SERVO_ERR_CHECKSUM: stats.checksumErrors++; return;
+        default:                 stats.timeouts++;       return;
+    }
+    stats.replies++;
+
+    if (dev_id >= STProtocol::BROADCAST_ID) {
+        return;
+    }
+    if (!_latency[dev_id]) {
+        _latency[dev_id] = new LatencyHistogram();
+        memset(_latency[dev_id], 0, sizeof(LatencyHistogram));
+    }
+    LatencyHistogram& histogram = *_latency[dev_id];
+    size_t bucket = 0;
+    while (bucket + 1 < LatencyHistogram::BUCKETS && latency_us >= LatencyHistogram::upper_bound_us(bucket)) {
+        bucket++;
+    }
+    histogram.buckets[bucket]++;
+    histogram.count++;
+    histogram.totalUs += latency_us;
+    if (latency_us > histogram.maxUs) {
+        histogram.maxUs = latency_us;
+    }
+}
+
+const LatencyHistogram* BusStats::latency(uint8_t dev_id) const {
+    return (dev_id < STProtocol::BROADCAST_ID) ? _latency[dev_id] : NULL;
+}
+
+void BusStats::reset() {
+    memset(_instructions, 0, sizeof(_instructions));
+    for (size_t i = 0; i < STProtocol::BROADCAST_ID; i++) {
+        if (_latency[i]) {
+            memset(_latency[i], 0, sizeof(LatencyHistogram));
+        }
+    }
+}
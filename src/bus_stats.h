@@ -0,0 +1,77 @@
+#ifndef STServo_BUS_STATS_H
+#define STServo_BUS_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "protocol.h"
+
+// 统计按指令类型分组
+enum StatsInstruction {
+    STATS_PING       = 0,
+    STATS_READ       = 1,
+    STATS_WRITE      = 2,
+    STATS_REG_WRITE  = 3,
+    STATS_ACTION     = 4,
+    STATS_SYNC_READ  = 5,
+    STATS_SYNC_WRITE = 6,
+    STATS_OTHER      = 7,
+    STATS_INSTRUCTION_COUNT = 8
+};
+
+struct InstructionStats {
+    uint32_t count;           // 发送的请求数
+    uint32_t txBytes;
+    uint32_t rxBytes;         // 请求发出后串口收到的所有字节
+    uint32_t replies;         // 有效应答（含舵机错误字节非零）
+    uint32_t timeouts;        // 截止时间内没有有效应答
+    uint32_t checksumErrors;
+    uint32_t resyncs;         // 包头重新同步
+    uint32_t servoErrors;     // 错误字节非零的应答
+};
+
+// 单个舵机的应答延时直方图：第i个桶为[BASE_US << (i-1), BASE_US << i)，第0个桶为[0, BASE_US)，最后一个桶不设上限
+// 延时从请求（SYNC_READ为上一个应答）结束计算到应答帧完整接收
+struct LatencyHistogram {
+    static const size_t   BUCKETS = 12;
+    static const uint32_t BASE_US = 64;
+
+    uint32_t buckets[BUCKETS];
+    uint32_t count;
+    uint32_t maxUs;
+    uint64_t totalUs;
+
+    static uint32_t upper_bound_us(size_t bucket) { return BASE_US << bucket; }
+};
+
+// 总线统计：STServo::setStats()设置后记录，未设置时每个记录点只有一次指针判断
+// 多条总线可以共用一个BusStats（舵机ID不重复），但只能在同一个任务中访问
+class BusStats {
+    public:
+        BusStats();
+        ~BusStats();
+
+        static StatsInstruction classify(uint8_t instruction);
+        static const char*      name(StatsInstruction slot);
+
+        void record_request(uint8_t instruction, size_t tx_bytes);
+        void record_rx(uint8_t instruction, size_t rx_bytes);
+        void record_resyncs(uint8_t instruction, uint32_t resyncs);
+        // code为ServoError
+        void record_reply(uint8_t instruction, uint8_t dev_id, int code, uint32_t latency_us);
+
+        const InstructionStats& instruction(StatsInstruction slot) const { return _instructions[slot]; }
+        // 没有记录过应答的舵机返回NULL
+        const LatencyHistogram* latency(uint8_t dev_id) const;
+
+        void reset();
+
+    private:
+        BusStats(const BusStats&);
+        BusStats& operator=(const BusStats&);
+
+        InstructionStats  _instructions[STATS_INSTRUCTION_COUNT];
+        // 按需分配，只为出现过的舵机占用内存
+        LatencyHistogram* _latency[STProtocol::BROADCAST_ID];
+};
+
+#endif // STServo_BUS_STATS_H
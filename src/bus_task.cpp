@@ -0,0 +1,233 @@
+#include <string.h>
+#include "bus_task.h"
+
+BusQueue::BusQueue() {
+    for (size_t i = 0; i < BUS_PRIORITY_COUNT; i++) {
+        _head[i]  = 0;
+        _count[i] = 0;
+    }
+}
+
+bool BusQueue::push(BusPriority priority, const BusJob& job, uint32_t now_us) {
+    if (priority >= BUS_PRIORITY_COUNT || _count[priority] >= CAPACITY) {
+        return false;
+    }
+    Slot& slot = _slots[priority][(_head[priority] + _count[priority]) % CAPACITY];
+    slot.job        = job;
+    slot.enqueuedUs = now_us;
+    _count[priority]++;
+    return true;
+}
+
+bool BusQueue::pop(BusJob& job, BusPriority& priority, uint32_t& enqueued_us) {
+    for (size_t p = 0; p < BUS_PRIORITY_COUNT; p++) {
+        if (_count[p] == 0) {
+            continue;
+        }
+        Slot& slot = _slots[p][_head[p]];
+        job         = slot.job;
+        enqueued_us = slot.enqueuedUs;
+        priority    = static_cast<BusPriority>(p);
+        slot.job    = BusJob();  // 释放捕获的状态
+        _head[p]    = (_head[p] + 1) % CAPACITY;
+        _count[p]--;
+        return true;
+    }
+    return false;
+}
+
+BusPriority BusQueue::top_priority() const {
+    for (size_t p = 0; p < BUS_PRIORITY_COUNT; p++) {
+        if (_count[p] != 0) {
+            return static_cast<BusPriority>(p);
+        }
+    }
+    return BUS_PRIORITY_COUNT;
+}
+
+bool BusQueue::empty() const {
+    for (size_t p = 0; p < BUS_PRIORITY_COUNT; p++) {
+        if (_count[p] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef ARDUINO
+
+BusTask::BusTask(ST3215& servo)
+    : _servo(servo), _lock(xSemaphoreCreateMutex()), _task(NULL) {
+    for (size_t p = 0; p < BUS_PRIORITY_COUNT; p++) {
+        _periodic[p].periodMs = 0;
+        _periodic[p].nextMs   = 0;
+    }
+    reset_stats();
+}
+
+BusTask::~BusTask() {
+    if (_task != NULL) {
+        vTaskDelete(_task);
+    }
+    vSemaphoreDelete(_lock);
+}
+
+bool BusTask::start(BaseType_t core, UBaseType_t priority, uint32_t stack_size) {
+    if (_task != NULL || _lock == NULL) {
+        return false;
+    }
+    return xTaskCreatePinnedToCore(task_entry, "servo_bus", stack_size, this, priority, &_task, core) == pdPASS;
+}
+
+bool BusTask::submit(BusPriority priority, const BusJob& job) {
+    if (_task == NULL) {
+        return false;
+    }
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    bool queued = _queue.push(priority, job, _servo.clock().micros());
+    if (queued) {
+        _stats[priority].submitted++;
+    } else {
+        _stats[priority].rejected++;
+    }
+    xSemaphoreGive(_lock);
+    if (queued) {
+        xTaskNotifyGive(_task);
+    }
+    return queued;
+}
+
+bool BusTask::call(BusPriority priority, const BusJob& job) {
+    // 总线任务内部（例如在请求中再次调用）不能等待自己
+    if (xTaskGetCurrentTaskHandle() == _task) {
+        job(_servo);
+        return true;
+    }
+    SemaphoreHandle_t done = xSemaphoreCreateBinary();
+    if (done == NULL) {
+        return false;
+    }
+    bool queued = submit(priority, [&job, done](ST3215& servo) {
+        job(servo);
+        xSemaphoreGive(done);
+    });
+    if (queued) {
+        xSemaphoreTake(done, portMAX_DELAY);
+    }
+    vSemaphoreDelete(done);
+    return queued;
+}
+
+void BusTask::set_periodic(const BusJob& job, uint32_t period_ms, BusPriority priority) {
+    if (priority >= BUS_PRIORITY_COUNT) {
+        return;
+    }
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    Periodic& periodic = _periodic[priority];
+    periodic.job      = job;
+    periodic.periodMs = job ? period_ms : 0;
+    periodic.nextMs   = _servo.clock().millis();
+    xSemaphoreGive(_lock);
+    if (_task != NULL) {
+        xTaskNotifyGive(_task);
+    }
+}
+
+BusQueueStats BusTask::stats(BusPriority priority) {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    BusQueueStats result = _stats[priority];
+    xSemaphoreGive(_lock);
+    return result;
+}
+
+void BusTask::reset_stats() {
+    if (_lock != NULL) {
+        xSemaphoreTake(_lock, portMAX_DELAY);
+    }
+    memset(_stats, 0, sizeof(_stats));
+    if (_lock != NULL) {
+        xSemaphoreGive(_lock);
+    }
+}
+
+void BusTask::task_entry(void* arg) {
+    static_cast<BusTask*>(arg)->run();
+}
+
+// 选择下一个请求：按优先级，同一优先级中到期的周期请求先于排队的请求（调用时持有_lock）
+bool BusTask::next_job(BusJob& job, BusPriority& priority, uint32_t& scheduled_us) {
+    ServoClock& clock = _servo.clock();
+    uint32_t now = clock.millis();
+    BusPriority top = _queue.top_priority();
+    for (size_t p = 0; p < BUS_PRIORITY_COUNT && p <= static_cast<size_t>(top); p++) {
+        Periodic& periodic = _periodic[p];
+        if (periodic.periodMs == 0 || static_cast<int32_t>(now - periodic.nextMs) < 0) {
+            continue;
+        }
+        job          = periodic.job;
+        priority     = static_cast<BusPriority>(p);
+        scheduled_us = clock.micros() - (now - periodic.nextMs) * 1000;
+        // 固定节拍；落后超过一个周期时不补执行
+        periodic.nextMs += periodic.periodMs;
+        if (static_cast<int32_t>(now - periodic.nextMs) >= 0) {
+            periodic.nextMs = now + periodic.periodMs;
+        }
+        return true;
+    }
+    return _queue.pop(job, priority, scheduled_us);
+}
+
+void BusTask::run() {
+    ServoClock& clock = _servo.clock();
+    for (;;) {
+        // 有周期请求时最多睡到最近的一次到期
+        TickType_t timeout = portMAX_DELAY;
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        uint32_t now = clock.millis();
+        for (size_t p = 0; p < BUS_PRIORITY_COUNT; p++) {
+            if (_periodic[p].periodMs == 0) {
+                continue;
+            }
+            int32_t    remaining = static_cast<int32_t>(_periodic[p].nextMs - now);
+            TickType_t ticks     = remaining > 0 ? pdMS_TO_TICKS(remaining) : 0;
+            if (ticks < timeout) {
+                timeout = ticks;
+            }
+        }
+        xSemaphoreGive(_lock);
+        ulTaskNotifyTake(pdTRUE, timeout);
+
+        // 处理完所有就绪的请求，每次重新选择最高优先级
+        for (;;) {
+            BusJob      job;
+            BusPriority priority;
+            uint32_t    scheduled;
+            xSemaphoreTake(_lock, portMAX_DELAY);
+            bool ok = next_job(job, priority, scheduled);
+            xSemaphoreGive(_lock);
+            if (!ok) {
+                break;
+            }
+
+            uint32_t start = clock.micros();
+            job(_servo);
+            uint32_t stop  = clock.micros();
+
+            xSemaphoreTake(_lock, portMAX_DELAY);
+            BusQueueStats& stats = _stats[priority];
+            uint32_t wait = start - scheduled;
+            uint32_t run  = stop - start;
+            stats.completed++;
+            stats.totalWaitUs += wait;
+            if (wait > stats.maxWaitUs) {
+                stats.maxWaitUs = wait;
+            }
+            if (run > stats.maxRunUs) {
+                stats.maxRunUs = run;
+            }
+            xSemaphoreGive(_lock);
+        }
+    }
+}
+
+#endif // ARDUINO
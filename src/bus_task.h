@@ -0,0 +1,106 @@
+#ifndef STServo_BUS_TASK_H
+#define STServo_BUS_TASK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include "st3215.h"
+
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#endif
+
+// 总线请求优先级，数值越小越先执行
+enum BusPriority {
+    BUS_PRIORITY_MOTION     = 0,  // 运动和其他写入
+    BUS_PRIORITY_TELEMETRY  = 1,  // 状态读取
+    BUS_PRIORITY_BACKGROUND = 2,  // 显示刷新等
+    BUS_PRIORITY_COUNT      = 3
+};
+
+// 在总线任务中执行的请求，完成通知由请求自身完成（回调或信号量）
+typedef std::function<void(ST3215&)> BusJob;
+
+// 每个优先级的调度统计：排队等待时间即调度抖动
+struct BusQueueStats {
+    uint32_t submitted;
+    uint32_t completed;
+    uint32_t rejected;       // 队列满被拒绝
+    uint32_t maxWaitUs;
+    uint64_t totalWaitUs;
+    uint32_t maxRunUs;
+};
+
+// 按优先级分组的定长FIFO，同一优先级内按提交顺序执行（不加锁，由BusTask在临界区内使用）
+class BusQueue {
+    public:
+        static const size_t CAPACITY = 16;  // 每个优先级
+
+        BusQueue();
+
+        bool   push(BusPriority priority, const BusJob& job, uint32_t now_us);
+        // 取出优先级最高的请求
+        bool   pop(BusJob& job, BusPriority& priority, uint32_t& enqueued_us);
+        size_t size(BusPriority priority) const { return _count[priority]; }
+        bool   empty() const;
+        // 队列中最高的优先级，队列为空时返回BUS_PRIORITY_COUNT
+        BusPriority top_priority() const;
+
+    private:
+        struct Slot {
+            BusJob   job;
+            uint32_t enqueuedUs;
+        };
+
+        Slot   _slots[BUS_PRIORITY_COUNT][CAPACITY];
+        size_t _head[BUS_PRIORITY_COUNT];
+        size_t _count[BUS_PRIORITY_COUNT];
+};
+
+#ifdef ARDUINO
+
+// 独占ST3215的FreeRTOS任务：其他任务只通过队列访问总线
+class BusTask {
+    public:
+        explicit BusTask(ST3215& servo);
+        ~BusTask();
+
+        // 创建任务并固定到core
+        bool start(BaseType_t core, UBaseType_t priority, uint32_t stack_size = 8192);
+
+        // 异步提交，队列满时返回false
+        bool submit(BusPriority priority, const BusJob& job);
+        // 提交并等待执行完成；在总线任务内部调用时直接执行
+        bool call(BusPriority priority, const BusJob& job);
+
+        // 周期请求（例如遥测采样、轨迹控制）：按period_ms的固定节拍执行，每个优先级一个，
+        // 到期时排在更高优先级的已排队请求之后、同级和更低优先级的请求之前；等待时间计入该优先级的统计。
+        // period_ms为0时停止
+        void set_periodic(const BusJob& job, uint32_t period_ms, BusPriority priority = BUS_PRIORITY_TELEMETRY);
+
+        BusQueueStats stats(BusPriority priority);
+        void          reset_stats();
+
+    private:
+        static void task_entry(void* arg);
+        void        run();
+        bool        next_job(BusJob& job, BusPriority& priority, uint32_t& scheduled_us);
+
+        ST3215&           _servo;
+        BusQueue          _queue;
+        BusQueueStats     _stats[BUS_PRIORITY_COUNT];
+        SemaphoreHandle_t _lock;
+        TaskHandle_t      _task;
+        struct Periodic {
+            BusJob   job;
+            uint32_t periodMs;
+            uint32_t nextMs;
+        };
+        Periodic          _periodic[BUS_PRIORITY_COUNT];
+};
+
+#endif // ARDUINO
+
+#endif // STServo_BUS_TASK_H
@@ -1,85 +1,69 @@
 
-#include <Arduino.h>
+#include <string.h>
 #include <vector>
 #include "core.h"
 
-// 更新内存地址映射
-void STServo::update_memory_map() {
-    if (_model == STServo::STS_MODEL) {
-        MEM_ADDR_SMS_STS_MODEL       = STSMemoryMap::SMS_STS_MODEL;
-
-        MEM_ADDR_ID                  = STSMemoryMap::ID;
-        MEM_ADDR_BAUD_RATE           = STSMemoryMap::BAUD_RATE;
-        MEM_ADDR_STEP_CORR           = STSMemoryMap::STEP_CORR;
-        MEM_ADDR_MODE                = STSMemoryMap::MODE;
-
-        MEM_ADDR_TORQUE_SWITCH       = STSMemoryMap::TORQUE_SWITCH;
-        MEM_ADDR_ACC                 = STSMemoryMap::ACC;
-        MEM_ADDR_GOAL_POSITION       = STSMemoryMap::GOAL_POSITION;
-        MEM_ADDR_GOAL_TIME           = STSMemoryMap::GOAL_TIME;
-        MEM_ADDR_GOAL_SPEED          = STSMemoryMap::GOAL_SPEED;
-        MEM_ADDR_EPROM_LOCK          = STSMemoryMap::EPROM_LOCK;
-
-        MEM_ADDR_PRESENT_POSITION    = STSMemoryMap::PRESENT_POSITION;
-        MEM_ADDR_PRESENT_SPEED       = STSMemoryMap::PRESENT_SPEED;
-        MEM_ADDR_PRESENT_LOAD        = STSMemoryMap::PRESENT_LOAD;
-        MEM_ADDR_PRESENT_VOLTAGE     = STSMemoryMap::PRESENT_VOLTAGE;
-        MEM_ADDR_PRESENT_TEMPERATURE = STSMemoryMap::PRESENT_TEMPERATURE;
-        MEM_ADDR_SERVO_STATUS        = STSMemoryMap::SERVO_STATUS;
-        MEM_ADDR_ASYNC_ACTION        = STSMemoryMap::ASYNC_ACTION;
-        MEM_ADDR_MOVING              = STSMemoryMap::MOVING;
-        MEM_ADDR_PRESENT_CURRENT     = STSMemoryMap::PRESENT_CURRENT;
-    } else if (_model == STServo::SCS_MODEL) {
-        MEM_ADDR_EPROM_LOCK          = SCSMemoryMap::EPROM_LOCK;
-    }
+// 构造函数
+#ifdef ARDUINO
+STServo::STServo(HardwareSerial& serial, uint32_t baudrate, bool debugEnabled, int rxPin, int txPin) 
+    : _transport(NULL), _clock(&servo_default_clock()), _ownsTransport(true),
+      _model(STServo::STS_MODEL), _debugEnabled(debugEnabled), _timeout(3000),
+      _baudrate(baudrate), _adaptiveTimeout(true), _returnDelayUs(0), _timeoutMarginUs(300),
+      _lastTxMicros(0), _lastTxBytes(0), _replyPending(false), _replyQuietAt(0), _verifier(NULL),
+      _stats(NULL), _replyStartMicros(0),
+      _encoder(_txBuffer, sizeof(_txBuffer)), _rxHead(0), _rxTail(0) {
+    _transport = new HardwareSerialTransport(serial, rxPin, txPin);
+    init(baudrate);
+}
+#endif
+
+STServo::STServo(ServoTransport& transport, uint32_t baudrate, bool debugEnabled, ServoClock* clock)
+    : _transport(&transport), _clock(clock ? clock : &servo_default_clock()), _ownsTransport(false),
+      _model(STServo::STS_MODEL), _debugEnabled(debugEnabled), _timeout(3000),
+      _baudrate(baudrate), _adaptiveTimeout(true), _returnDelayUs(0), _timeoutMarginUs(300),
+      _lastTxMicros(0), _lastTxBytes(0), _replyPending(false), _replyQuietAt(0), _verifier(NULL),
+      _stats(NULL), _replyStartMicros(0),
+      _encoder(_txBuffer, sizeof(_txBuffer)), _rxHead(0), _rxTail(0) {
+    init(baudrate);
 }
 
-// 构造函数
-STServo::STServo(HardwareSerial& serial, uint32_t baudrate, bool debugEnabled) 
-    : _serial(&serial), _model(STServo::STS_MODEL), _debugEnabled(debugEnabled), _timeout(3000) {
-    // GPIO引脚定义（在构造函数中定义，避免头文件依赖）
-    const int SERVO_RX_PIN = 18;
-    const int SERVO_TX_PIN = 19;
-    _serial->begin(baudrate, SERIAL_8N1, SERVO_RX_PIN, SERVO_TX_PIN);
-    
-    // 初始化内存地址映射
-    update_memory_map();
+void STServo::init(uint32_t baudrate) {
+    memset(_responseLevel, RESPONSE_UNKNOWN, sizeof(_responseLevel));
+    resetRxCounters();
+    _transport->begin(baudrate);
 }
 
 // 初始化方法
 bool STServo::begin() {
-    _serial->setTimeout(_timeout); 
     return true;
 }
 
 void STServo::end() {
-    if (_serial) {
-        _serial->end();
+    if (_transport) {
+        _transport->end();
     }
 }
 
 // 析构函数
 STServo::~STServo() {
     end();
-}
-
-// 计算校验和
-uint8_t STServo::calculate_checksum(const std::vector<uint8_t>& data) {
-    int sum = 0;
-    for (size_t i = 2; i < data.size(); i++) {  // 跳过包头的两个0xFF
-        sum += data[i];
+    if (_ownsTransport) {
+        delete _transport;
     }
-    return 255 - (sum & 0xFF);
 }
 
 // 打印数据包（调试用）
 void STServo::printPacket(const std::vector<uint8_t>& packet) { 
-    if (packet.empty()) {
-        Serial.printf("[Func printPacket()] Packet is empty\n");
+    printPacket(packet.data(), packet.size());
+}
+
+void STServo::printPacket(const uint8_t* packet, size_t len) { 
+    if (len == 0) {
+        servo_log("[Func printPacket()] Packet is empty\n");
     } else {
-        Serial.printf("[Func printPacket()] Packet (%d bytes): ", packet.size());
-        for (const uint8_t& byte : packet) Serial.printf("0x%02X ", byte); 
-        Serial.println();
+        servo_log("[Func printPacket()] Packet (%u bytes): ", (unsigned)len);
+        for (size_t i = 0; i < len; i++) servo_log("0x%02X ", packet[i]); 
+        servo_log("\n");
     }
     return ;
 }
@@ -95,215 +79,594 @@ int STServo::bytesToInt(uint8_t lowByte, uint8_t highByte) {
     return lowByte | (highByte << 8); // 小端序：低字节在前，高字节在后
 }
 
-// 生成数据包
-std::vector<uint8_t> STServo::make_a_packet(uint8_t dev_id, uint8_t instruction, const std::vector<uint8_t>& params_tx) { 
-    std::vector<uint8_t> packet;
-    
-    // 包头
-    packet.push_back(0xFF);
-    packet.push_back(0xFF);
-    
-    // ID
-    packet.push_back(dev_id);
-    
-    // 长度
-    uint8_t length = params_tx.size() + 2;
-    packet.push_back(length);
-    
-    // 指令
-    packet.push_back(instruction);
-    
-    // 参数
-    for (uint8_t param : params_tx) {
-        packet.push_back(param);
+// 开始编码一个数据包（写入固定发送缓冲区）
+PacketEncoder& STServo::begin_packet(uint8_t dev_id, uint8_t instruction) {
+    _encoder.begin(dev_id, instruction);
+    return _encoder;
+}
+
+// 完成编码并发送数据包
+bool STServo::send_packet() {
+    size_t size = _encoder.finish();
+    if (size == 0) {
+        servo_log("[Error] [STServo::send_packet()] Packet exceeds %u bytes\n", (unsigned)STProtocol::MAX_PACKET_SIZE);
+        return false;
     }
-    
-    // 校验和
-    uint8_t checksum = calculate_checksum(packet);
-    packet.push_back(checksum);
-    
+
     if (_debugEnabled) {
-        printPacket(packet);
+        printPacket(_txBuffer, size);
+    }
+
+    wait_reply_quiet();
+    drain_rx();
+    _lastTxMicros = _clock->micros();
+    _lastTxBytes  = size;
+    _transport->write(_txBuffer, size);
+    if (_stats) {
+        _stats->record_request(_txBuffer[4], size);
+        _replyStartMicros = _lastTxMicros + wire_time_us(size);
     }
+    return true;
+}
 
-    return packet;
+// 上一次无应答写入的舵机可能仍在应答，等到应答的截止时间再发送
+void STServo::wait_reply_quiet() {
+    if (!_replyPending) {
+        return;
+    }
+    _replyPending = false;
+    while (static_cast<int32_t>(_clock->micros() - _replyQuietAt) < 0) {
+        _clock->idle();
+    }
 }
 
-// 串口读取函数 - 封装完整的等待+超时+读取逻辑
-uint8_t STServo::serial_read_a_byte(const std::string& errMsg) { 
-    unsigned long startTime = millis();
-    int byte = -1;
-    while (millis() - startTime < _timeout) {
-        byte = _serial->read();
-        if (byte != -1) {
-            return byte;
-        }
-        delay(1); // 短暂等待
+// 把串口中已到达的字节成批读入接收缓冲区（不等待），返回读取的字节数
+size_t STServo::fill_rx_buffer() {
+    int available = _transport->available();
+    if (available <= 0) {
+        return 0;
     }
-    throw SerialTimeoutException(errMsg.c_str());
+    size_t count = (static_cast<size_t>(available) < RX_CHUNK_SIZE) ? available : RX_CHUNK_SIZE;
+    _rxHead = 0;
+    _rxTail = _transport->read(_rxBuffer, count);
+    return _rxTail;
 }
 
-// 接收数据包 - 按照标准舵机应答包格式: header(2) + ID(1) + length(1) + error(1) + params(length-2) + checksum(1)
-bool STServo::receive_packet(uint8_t dev_id, uint8_t& error, std::vector<uint8_t>& params_rx) {
-    params_rx.clear();
+// 丢弃上一次通信残留的字节，确保新请求的应答从帧头开始
+void STServo::drain_rx() {
+    size_t stale = _rxTail - _rxHead;
+    while (fill_rx_buffer() > 0) {
+        stale += _rxTail;
+    }
+    _rxHead = _rxTail = 0;
 
-    // 读取包头 (2字节，应为0xFF 0xFF)
-    uint8_t header1 = serial_read_a_byte("[Timeout] Reading packet header byte 1");
-    uint8_t header2 = serial_read_a_byte("[Timeout] Reading packet header byte 2");
-    if (header1 != 0xFF || header2 != 0xFF) { 
-        Serial.printf("[Error] [STServo::receive_packet()] Header mismatch: got 0x%02X 0x%02X, expected 0xFF 0xFF\n", header1, header2); 
-        return false;
+    if (stale > 0) {
+        _rxCounters.staleBytes     += stale;
+        _rxCounters.discardedBytes += stale;
+        if (_debugEnabled) {
+            servo_log("[Debug] [STServo::drain_rx()] Discarded %u stale bytes\n", (unsigned)stale);
+        }
     }
+}
 
-    // 读取ID (1字节)
-    uint8_t receivedId = serial_read_a_byte("[Timeout] Reading packet ID");
-    if (receivedId != dev_id) {
-        Serial.printf("[Error] [STServo::receive_packet()] ID mismatch: expected %d, got %d\n", dev_id, receivedId); 
-        return false;
+// 累加解析器统计后复位，准备解析下一帧
+void STServo::reset_parser() {
+    if (_stats && _parser.resyncs() > 0) {
+        _stats->record_resyncs(_txBuffer[4], _parser.resyncs());
     }
+    _rxCounters.discardedBytes += _parser.skipped();
+    _rxCounters.resyncs        += _parser.resyncs();
+    _rxCounters.lengthErrors   += _parser.lengthErrors();
+    _parser.reset();
+}
 
-    // 读取长度 (1字节)
-    uint8_t length = serial_read_a_byte("[Timeout] Reading packet length");
-    int paramsLength = length - 2;  // 减去error(1字节)和checksum(1字节)
+// 按8N1（每字节10位）计算bytes字节在线上的传输时间
+uint32_t STServo::wire_time_us(size_t bytes) const {
+    return static_cast<uint32_t>((static_cast<uint64_t>(bytes) * 10 * 1000000UL) / _baudrate);
+}
+
+// 计算最近一次请求的应答截止时间（micros()时间点）
+// reply_count个应答、每个应答params_len字节参数；关闭自适应时退回固定的_timeout
+uint32_t STServo::reply_deadline(size_t reply_count, size_t params_len) const {
+    if (!_adaptiveTimeout) {
+        return _clock->micros() + _timeout * 1000UL;
+    }
+    size_t reply_bytes = reply_count * (params_len + STProtocol::FRAME_OVERHEAD);
+    return _lastTxMicros + wire_time_us(_lastTxBytes + reply_bytes)
+                         + reply_count * _returnDelayUs + _timeoutMarginUs;
+}
 
-    // 读取状态 (1字节)
-    error = serial_read_a_byte("[Timeout] Reading packet error");
+// 接收下一个完整的应答帧（任意ID），帧内容保留在_parser中，调用者处理后需reset_parser()
+// 整帧共用一个截止时间，而不是每个字节单独计时
+ServoResult STServo::receive_frame(uint32_t deadline) {
+    while (true) {
+        if (_rxHead == _rxTail) {
+            if (fill_rx_buffer() == 0) {
+                if (static_cast<int32_t>(_clock->micros() - deadline) >= 0) {
+                    reset_parser();
+                    return ServoResult(SERVO_ERR_TIMEOUT);
+                }
+                _clock->idle(); // 不睡眠整毫秒，字节一到即可继续解析
+                continue;
+            }
+            if (_stats) {
+                _stats->record_rx(_txBuffer[4], _rxTail);
+            }
+        }
 
-    // 读取参数数据 (length-2字节，因为length包含error和checksum)
-    if (_debugEnabled) {
-        Serial.printf("[Debug] [STServo::receive_packet()] Reading param byte: "); 
+        ParseResult result = PARSE_NEED_MORE;
+        _rxHead += _parser.feed(_rxBuffer + _rxHead, _rxTail - _rxHead, result);
+        if (result == PARSE_FRAME_OK) {
+            return ServoResult(SERVO_OK);
+        }
+        if (result == PARSE_CHECKSUM_ERROR) {
+            return ServoResult(SERVO_ERR_CHECKSUM);
+        }
     }
-    for (int i = 0; i < paramsLength; i++) { 
-        uint8_t byte = serial_read_a_byte("[Timeout] Reading param byte"); 
-        params_rx.push_back(byte);
+}
+
+// 丢弃_parser中不需要的整帧（其他ID的应答或校验失败的帧）
+void STServo::skip_frame() {
+    _rxCounters.discardedBytes += _parser.frameSize();
+    reset_parser();
+}
+
+// 根据等待期间统计的变化区分超时原因
+ServoError STServo::classify_timeout(const RxCounters& before) const {
+    if (_rxCounters.lengthErrors > before.lengthErrors) {
+        return SERVO_ERR_LENGTH;
+    }
+    if (_rxCounters.foreignFrames > before.foreignFrames) {
+        return SERVO_ERR_ID_MISMATCH;
+    }
+    if (_rxCounters.discardedBytes > before.discardedBytes) {
+        return SERVO_ERR_HEADER;
     }
+    return SERVO_ERR_TIMEOUT;
+}
 
-    // 读取校验和 (1字节)
-    uint8_t receivedChecksum = serial_read_a_byte("[Timeout] Reading packet checksum");
+// 接收dev_id的应答帧 - 按照标准舵机应答包格式: header(2) + ID(1) + length(1) + error(1) + params(length-2) + checksum(1)
+// 向后扫描有效包头，跳过发往其他ID的应答帧；expected_len >= 0 时校验参数长度
+// 成功时帧内容保留在_parser中，调用者取出数据后需reset_parser()
+ServoResult STServo::receive_reply(uint8_t dev_id, int expected_len, uint32_t deadline) {
+    _parser.reset();
+    _parser.expect(dev_id, expected_len);
+
+    // 记录等待前的统计，超时后据此区分失败原因
+    RxCounters before = _rxCounters;
+    while (true) {
+        ServoResult result = receive_frame(deadline);
+        if (result.code == SERVO_ERR_TIMEOUT) {
+            if (_debugEnabled) {
+                servo_log("[Debug] [STServo::receive_reply()] No reply from ID %d within %u us\n", dev_id, deadline - _lastTxMicros);
+            }
+            return record_reply(dev_id, ServoResult(classify_timeout(before)));
+        }
 
-    // 验证校验和
-    std::vector<uint8_t> checksumData = {0xFF, 0xFF, receivedId, length, error};
-    checksumData.insert(checksumData.end(), params_rx.begin(), params_rx.end());
-    uint8_t expectedChecksum = calculate_checksum(checksumData);
-    if (expectedChecksum != receivedChecksum) {
-        Serial.printf("[Error] [STServo::receive_packet()] Checksum error: expected 0x%02X, got 0x%02X\n", expectedChecksum, receivedChecksum); 
-        return false;
+        if (_parser.id() != dev_id) {
+            // 其他舵机的应答（例如上一次sync_read的迟到帧），整帧跳过继续扫描
+            if (_debugEnabled) {
+                servo_log("[Debug] [STServo::receive_reply()] Skipping frame from ID %d while waiting for %d\n", _parser.id(), dev_id);
+            }
+            _rxCounters.foreignFrames++;
+            skip_frame();
+            continue;
+        }
+
+        if (result.code == SERVO_ERR_CHECKSUM) {
+            servo_log("[Error] [STServo::receive_reply()] Checksum error: ID=%d, length=%d\n", _parser.id(), _parser.length()); 
+            _rxCounters.checksumErrors++;
+            skip_frame();
+            return record_reply(dev_id, result);
+        }
+
+        break;
     }
-    
+
+    uint8_t error = _parser.error();
     if (_debugEnabled) {
-        Serial.printf("[Debug] [STServo::receive_packet()] Packet received: ID=%d, length=%d, error=0x%02X, paramsLength=%d\n",
-                     receivedId, length, error, paramsLength);
+        servo_log("[Debug] [STServo::receive_reply()] Packet received: ID=%d, length=%d, error=0x%02X, paramsLength=%u, skipped=%u\n",
+                  _parser.id(), _parser.length(), error, (unsigned)_parser.paramsLength(), (unsigned)_parser.skipped());
+    }
+    return record_reply(dev_id, ServoResult(error == 0 ? SERVO_OK : SERVO_ERR_STATUS, error));
+}
+
+// 记录应答结果和延时，返回result
+ServoResult STServo::record_reply(uint8_t dev_id, ServoResult result) {
+    if (_stats) {
+        uint32_t now = _clock->micros();
+        _stats->record_reply(_txBuffer[4], dev_id, result.code, now - _replyStartMicros);
+        _replyStartMicros = now;
+    }
+    return result;
+}
+
+// 接收数据包，参数复制到params_rx
+ServoResult STServo::receive_packet(uint8_t dev_id, uint8_t& error, std::vector<uint8_t>& params_rx, int expected_len, uint32_t deadline) {
+    params_rx.clear();
+    ServoResult result = receive_reply(dev_id, expected_len, deadline);
+    if (!result) {
+        return result;
     }
+
+    error = _parser.error();
+    params_rx.assign(_parser.params(), _parser.params() + _parser.paramsLength());
+    reset_parser();
     
-    return true;
+    return result;
 }
 
 // Ping指令
-bool STServo::ping(uint8_t dev_id, uint8_t& error, std::vector<uint8_t>& params_rx) {
-    std::vector<uint8_t> params_tx = {};
-    std::vector<uint8_t> packet = make_a_packet(dev_id, STServo::INST_PING, params_tx);
-    _serial->write(packet.data(), packet.size());
+ServoResult STServo::ping(uint8_t dev_id, uint8_t& error, std::vector<uint8_t>& params_rx) {
+    begin_packet(dev_id, STServo::INST_PING);
+    if (!send_packet()) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
     
-    return receive_packet(dev_id, error, params_rx);
+    return receive_packet(dev_id, error, params_rx, 0, reply_deadline(1, 0));
 }
 
 // 读取指令
-bool STServo::read(uint8_t dev_id, uint8_t mem_addr, uint8_t length, uint8_t& error, std::vector<uint8_t>& params_rx) {
-    std::vector<uint8_t> params_tx = {mem_addr, length};
-    std::vector<uint8_t> packet = make_a_packet(dev_id, STServo::INST_READ, params_tx);
-    _serial->write(packet.data(), packet.size());
+ServoResult STServo::read(uint8_t dev_id, uint8_t mem_addr, uint8_t length, uint8_t& error, std::vector<uint8_t>& params_rx) {
+    PacketEncoder& packet = begin_packet(dev_id, STServo::INST_READ);
+    packet.put(mem_addr);
+    packet.put(length);
+    if (!send_packet()) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
     
-    return receive_packet(dev_id, error, params_rx);
+    return receive_packet(dev_id, error, params_rx, length, reply_deadline(1, length));
 }
 
-// 写入指令（字节数组版本）
-bool STServo::write_data(uint8_t dev_id, uint8_t mem_addr, const std::vector<uint8_t>& data, uint8_t& error, std::vector<uint8_t>& params_rx) {
-    std::vector<uint8_t> params_tx = {mem_addr};
-    params_tx.insert(params_tx.end(), data.begin(), data.end());
-    std::vector<uint8_t> packet = make_a_packet(dev_id, STServo::INST_WRITE, params_tx);
-    _serial->write(packet.data(), packet.size());
+// 读取len字节到data（不使用vector）
+ServoResult STServo::read_bytes(uint8_t dev_id, uint8_t mem_addr, uint8_t* data, size_t len) {
+    PacketEncoder& packet = begin_packet(dev_id, STServo::INST_READ);
+    packet.put(mem_addr);
+    packet.put(len);
+    if (len > STProtocol::MAX_PARAMS || !send_packet()) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+
+    ServoResult result = receive_reply(dev_id, len, reply_deadline(1, len));
+    if (result) {
+        memcpy(data, _parser.params(), len);
+        reset_parser();
+    }
+    return result;
+}
+
+// 写入类指令的公共实现：mem_addr + data
+ServoResult STServo::write_bytes(uint8_t dev_id, uint8_t instruction, uint8_t mem_addr, const uint8_t* data, size_t len) {
+    PacketEncoder& packet = begin_packet(dev_id, instruction);
+    packet.put(mem_addr);
+    packet.put(data, len);
+    if (!send_packet()) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    after_write(dev_id, mem_addr, data, len);
+    if (!replies_to_writes(dev_id)) {
+        on_register_write(dev_id, instruction, mem_addr, data, len, true);
+        return ServoResult(SERVO_OK);
+    }
+
+    ServoResult result = receive_reply(dev_id, 0, reply_deadline(1, 0));
+    if (result) {
+        reset_parser();
+    }
+    on_register_write(dev_id, instruction, mem_addr, data, len, result);
+    return result;
+}
+
+// 无应答写入：不等待应答；舵机仍会应答时记下应答的截止时间，下一次发送前等待
+ServoResult STServo::write_bytes_noack(uint8_t dev_id, uint8_t instruction, uint8_t mem_addr, const uint8_t* data, size_t len) {
+    PacketEncoder& packet = begin_packet(dev_id, instruction);
+    packet.put(mem_addr);
+    packet.put(data, len);
+    if (!send_packet()) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    after_write(dev_id, mem_addr, data, len);
+    on_register_write(dev_id, instruction, mem_addr, data, len, true);
+    if (replies_to_writes(dev_id)) {
+        _replyPending = true;
+        _replyQuietAt = reply_deadline(1, 0);
+    }
+    if (_verifier) {
+        _verifier->record(dev_id, mem_addr, data, len);
+    }
+    return ServoResult(SERVO_OK);
+}
 
-    return receive_packet(dev_id, error, params_rx);
+// 写指令发出后（等待应答之前）：跟踪RESPONSE_LEVEL和ID的变化
+void STServo::after_write(uint8_t dev_id, uint8_t mem_addr, const uint8_t* data, size_t len) {
+    const uint8_t level_addr = STSRegisters::RESPONSE_LEVEL::ADDRESS;
+    const uint8_t id_addr    = STSRegisters::ID::ADDRESS;
+    if (mem_addr <= level_addr && level_addr < mem_addr + len) {
+        uint8_t level = data[level_addr - mem_addr] ? 1 : 0;
+        if (dev_id == STProtocol::BROADCAST_ID) {
+            memset(_responseLevel, level, sizeof(_responseLevel));
+        } else {
+            _responseLevel[dev_id] = level;
+        }
+    }
+    if (dev_id < STProtocol::BROADCAST_ID && mem_addr <= id_addr && id_addr < mem_addr + len) {
+        uint8_t new_id = data[id_addr - mem_addr];
+        if (new_id < STProtocol::BROADCAST_ID && new_id != dev_id) {
+            _responseLevel[new_id] = _responseLevel[dev_id];
+            _responseLevel[dev_id] = RESPONSE_UNKNOWN;
+        }
+    }
+}
+
+// 广播写入不应答；应答级别未知时按会应答处理
+bool STServo::replies_to_writes(uint8_t dev_id) const {
+    return dev_id < STProtocol::BROADCAST_ID && _responseLevel[dev_id] != 0;
+}
+
+ServoResult STServo::write_bytes(uint8_t dev_id, uint8_t instruction, uint8_t mem_addr, const uint8_t* data, size_t len,
+                                 uint8_t& error, std::vector<uint8_t>& params_rx) {
+    params_rx.clear();
+    ServoResult result = write_bytes(dev_id, instruction, mem_addr, data, len);
+    if (result) {
+        error = result.servoError;
+    }
+    return result;
+}
+
+// 写入指令（字节数组版本）
+ServoResult STServo::write_data(uint8_t dev_id, uint8_t mem_addr, const std::vector<uint8_t>& data, uint8_t& error, std::vector<uint8_t>& params_rx) {
+    return write_bytes(dev_id, STServo::INST_WRITE, mem_addr, data.data(), data.size(), error, params_rx);
 }
 
 // 写入指令（整数版本）
-bool STServo::write_int(uint8_t dev_id, uint8_t mem_addr, int value, uint8_t& error, std::vector<uint8_t>& params_rx) {
-    std::vector<uint8_t> data;
-    data.push_back(value & 0xFF);
+ServoResult STServo::write_int(uint8_t dev_id, uint8_t mem_addr, int value, uint8_t& error, std::vector<uint8_t>& params_rx) {
+    uint8_t data[2];
+    size_t  len = 1;
+    data[0] = value & 0xFF;
     if (value > 255) {
-        data.push_back((value >> 8) & 0xFF);
+        data[1] = (value >> 8) & 0xFF;
+        len = 2;
     }
 
-    return write_data(dev_id, mem_addr, data, error, params_rx);
+    return write_bytes(dev_id, STServo::INST_WRITE, mem_addr, data, len, error, params_rx);
 }
 
 // 寄存器写入指令
-bool STServo::reg_write(uint8_t dev_id, uint8_t mem_addr, const std::vector<uint8_t>& data, uint8_t& error, std::vector<uint8_t>& params_rx) {
-    std::vector<uint8_t> params_tx = {mem_addr};
-    params_tx.insert(params_tx.end(), data.begin(), data.end());
-    std::vector<uint8_t> packet = make_a_packet(dev_id, STServo::INST_REG_WRITE, params_tx);
-    _serial->write(packet.data(), packet.size());
-    
-    return receive_packet(dev_id, error, params_rx);
+ServoResult STServo::reg_write(uint8_t dev_id, uint8_t mem_addr, const std::vector<uint8_t>& data, uint8_t& error, std::vector<uint8_t>& params_rx) {
+    return write_bytes(dev_id, STServo::INST_REG_WRITE, mem_addr, data.data(), data.size(), error, params_rx);
+}
+
+ServoResult STServo::write_data_noack(uint8_t dev_id, uint8_t mem_addr, const std::vector<uint8_t>& data) {
+    return write_bytes_noack(dev_id, STServo::INST_WRITE, mem_addr, data.data(), data.size());
+}
+
+ServoResult STServo::write_int_noack(uint8_t dev_id, uint8_t mem_addr, int value) {
+    uint8_t data[2];
+    size_t  len = 1;
+    data[0] = value & 0xFF;
+    if (value > 255) {
+        data[1] = (value >> 8) & 0xFF;
+        len = 2;
+    }
+
+    return write_bytes_noack(dev_id, STServo::INST_WRITE, mem_addr, data, len);
+}
+
+ServoResult STServo::reg_write_noack(uint8_t dev_id, uint8_t mem_addr, const std::vector<uint8_t>& data) {
+    return write_bytes_noack(dev_id, STServo::INST_REG_WRITE, mem_addr, data.data(), data.size());
 }
 
 // 动作指令
-bool STServo::action() {
+ServoResult STServo::action() {
     // 广播动作指令，无返回 
-    std::vector<uint8_t> params_tx = {};
-    std::vector<uint8_t> packet = make_a_packet(0xFE, STServo::INST_ACTION, params_tx);
-    _serial->write(packet.data(), packet.size()); 
-
-    return true;
+    begin_packet(STProtocol::BROADCAST_ID, STServo::INST_ACTION);
+    if (!send_packet()) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    on_action();
+    return ServoResult(SERVO_OK);
 }
 
 // 同步写入
-bool STServo::sync_write(const std::vector<uint8_t>& dev_id_vec, uint8_t mem_addr, 
-                         const std::vector<std::vector<uint8_t>>& params_tx_vec) {
+ServoResult STServo::sync_write(const std::vector<uint8_t>& dev_id_vec, uint8_t mem_addr, 
+                                const std::vector<std::vector<uint8_t>>& params_tx_vec) {
     // 广播动作指令，无返回
     // 传入dev_id_vec和params_tx_vec，params_tx_vec的每个vector元素都是要写入的舵机的数据。
     if (dev_id_vec.empty() || params_tx_vec.empty()) {
-        return false;
+        return ServoResult(SERVO_ERR_PARAM);
     }
     if (dev_id_vec.size() != params_tx_vec.size()) {
-        return false;
+        return ServoResult(SERVO_ERR_PARAM);
     }
     
-    std::vector<uint8_t> params_tx;
-    params_tx.push_back(mem_addr); 
-    params_tx.push_back(params_tx_vec[0].size());
+    PacketEncoder& packet = begin_packet(STProtocol::BROADCAST_ID, STServo::INST_SYNC_WRITE);
+    packet.put(mem_addr); 
+    packet.put(params_tx_vec[0].size());
     for (size_t i = 0; i < dev_id_vec.size(); i++) {
-        params_tx.push_back(dev_id_vec[i]);
-        params_tx.insert(params_tx.end(), params_tx_vec[i].begin(), params_tx_vec[i].end());
+        packet.put(dev_id_vec[i]);
+        packet.put(params_tx_vec[i].data(), params_tx_vec[i].size());
     }
-    std::vector<uint8_t> packet = make_a_packet(0xFE, STServo::INST_SYNC_WRITE, params_tx);
-    _serial->write(packet.data(), packet.size());
-    return true;
+    if (!send_packet()) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    for (size_t i = 0; i < dev_id_vec.size(); i++) {
+        after_write(dev_id_vec[i], mem_addr, params_tx_vec[i].data(), params_tx_vec[i].size());
+        on_register_write(dev_id_vec[i], STServo::INST_SYNC_WRITE, mem_addr, params_tx_vec[i].data(), params_tx_vec[i].size(), true);
+    }
+    return ServoResult(SERVO_OK);
 }
 
 // 同步读取
-bool STServo::sync_read(const std::vector<uint8_t>& dev_id_vec, uint8_t mem_addr, uint8_t length,
-                              std::vector<std::vector<uint8_t>>& params_rx_vec) {
-    // 每个舵机要读的地址mem_addr和从每个舵机读取的数据的长度length，这里的length不是广播数据（0xFE）的长度，广播长度由make_a_packet计算。
+ServoResult STServo::sync_read(const std::vector<uint8_t>& dev_id_vec, uint8_t mem_addr, uint8_t length,
+                                     std::vector<std::vector<uint8_t>>& params_rx_vec) {
+    std::vector<ServoResult> result_vec;
+    return sync_read(dev_id_vec, mem_addr, length, params_rx_vec, result_vec);
+}
+
+// 同步读取（每个舵机单独给出结果）
+ServoResult STServo::sync_read(const std::vector<uint8_t>& dev_id_vec, uint8_t mem_addr, uint8_t length,
+                                     std::vector<std::vector<uint8_t>>& params_rx_vec,
+                                     std::vector<ServoResult>& result_vec) {
+    ServoResult result = begin_sync_read(dev_id_vec, mem_addr, length);
+    if (!result) {
+        params_rx_vec.assign(dev_id_vec.size(), std::vector<uint8_t>());
+        result_vec.assign(dev_id_vec.size(), result);
+        return result;
+    }
+    return finish_sync_read(dev_id_vec, length, params_rx_vec, result_vec);
+}
+
+// 发出同步读取请求，不等待应答
+ServoResult STServo::begin_sync_read(const std::vector<uint8_t>& dev_id_vec, uint8_t mem_addr, uint8_t length) {
+    // 每个舵机要读的地址mem_addr和从每个舵机读取的数据的长度length，这里的length不是广播数据（0xFE）的长度，广播长度由send_packet计算。
+    PacketEncoder& packet = begin_packet(STProtocol::BROADCAST_ID, STServo::INST_SYNC_READ); //制作一个广播packet
+    packet.put(mem_addr);
+    packet.put(length);
+    packet.put(dev_id_vec.data(), dev_id_vec.size());
+    if (dev_id_vec.empty() || !send_packet()) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    return ServoResult(SERVO_OK);
+}
 
-    params_rx_vec.clear();
+// 接收begin_sync_read()请求的应答；截止时间从请求发出时计算，已缓冲的应答不受调用延后的影响
+ServoResult STServo::finish_sync_read(const std::vector<uint8_t>& dev_id_vec, uint8_t length,
+                                      std::vector<std::vector<uint8_t>>& params_rx_vec,
+                                      std::vector<ServoResult>& result_vec, bool log_failures) {
+    const size_t count = dev_id_vec.size();
+    params_rx_vec.assign(count, std::vector<uint8_t>());
+    result_vec.assign(count, ServoResult(SERVO_ERR_TIMEOUT));
     
-    std::vector<uint8_t> params_tx = {mem_addr, length};
-    params_tx.insert(params_tx.end(), dev_id_vec.begin(), dev_id_vec.end());
-    std::vector<uint8_t> packet = make_a_packet(0xFE, STServo::INST_SYNC_READ, params_tx); //制作一个广播packet
-    _serial->write(packet.data(), packet.size());
+    // 舵机按dev_id_vec的顺序依次应答。第slot个应答的截止时间为前slot+1个应答的线上时间，
+    // 超时即认为该舵机缺失并转向下一个；收到后面舵机的应答时，之前未应答的槽位同样判为缺失
+    _parser.reset();
+    _parser.expect(STProtocol::BROADCAST_ID, length);
+    RxCounters before = _rxCounters;
+    size_t slot = 0;
+    while (slot < count) {
+        ServoResult result = receive_frame(reply_deadline(slot + 1, length));
+        if (result.code == SERVO_ERR_TIMEOUT) {
+            result_vec[slot] = record_reply(dev_id_vec[slot], ServoResult(classify_timeout(before)));
+            slot++;
+            before = _rxCounters;
+            continue;
+        }
+
+        size_t match = slot;
+        while (match < count && dev_id_vec[match] != _parser.id()) {
+            match++;
+        }
+        if (match == count) {
+            // 不在剩余列表中的ID，跳过
+            _rxCounters.foreignFrames++;
+            skip_frame();
+            continue;
+        }
+
+        if (result.code == SERVO_ERR_CHECKSUM) {
+            _rxCounters.checksumErrors++;
+            result_vec[match] = result;
+            skip_frame();
+        } else {
+            uint8_t error = _parser.error();
+            params_rx_vec[match].assign(_parser.params(), _parser.params() + _parser.paramsLength());
+            result_vec[match] = ServoResult(error == 0 ? SERVO_OK : SERVO_ERR_STATUS, error);
+            reset_parser();
+        }
+        record_reply(dev_id_vec[match], result_vec[match]);
+        // 被跳过的槽位同样记为没有应答
+        for (; slot < match; slot++) {
+            record_reply(dev_id_vec[slot], result_vec[slot]);
+        }
+        slot = match + 1;
+        before = _rxCounters;
+    }
     
-    // 接收每个舵机的响应
-    for (const uint8_t& dev_id : dev_id_vec) {
-        std::vector<uint8_t> params_rx = {};
-        uint8_t error;
-        if (!receive_packet(dev_id, error, params_rx)) {
-            Serial.printf("[Func] [STServo::sync_read()] Failed to receive params_rx from servo %d\n", dev_id);
+    // 返回第一个失败舵机的结果，全部成功时返回SERVO_OK
+    ServoResult first_failure;
+    for (size_t i = 0; i < count; i++) {
+        if (!result_vec[i]) {
+            if (log_failures) {
+                servo_log("[Func] [STServo::sync_read()] Failed to receive params_rx from servo %d: %s\n", dev_id_vec[i], result_vec[i].name());
+            }
+            if (first_failure.code == SERVO_OK) {
+                first_failure = result_vec[i];
+            }
         }
-        params_rx_vec.push_back(params_rx);
     }
     
-    return !params_rx_vec.empty();
+    return first_failure;
+}
+
+// 按计划读取单个舵机
+ServoResult STServo::read(uint8_t dev_id, ReadPlan& plan) {
+    plan.prepare(_baudrate, _returnDelayUs, 1);
+    for (size_t i = 0; i < plan.span_count(); i++) {
+        const ReadSpan& span = plan.span(i);
+        ServoResult result = read_bytes(dev_id, span.address, plan.span_data(0, i), span.length);
+        if (!result) {
+            plan.set_valid(0, false);
+            return result;
+        }
+    }
+    plan.set_valid(0, true);
+    return ServoResult(SERVO_OK);
+}
+
+// 按计划同步读取多个舵机，result_vec[i]为第i个舵机所有区间中第一个失败的结果
+ServoResult STServo::sync_read(const std::vector<uint8_t>& dev_id_vec, ReadPlan& plan, std::vector<ServoResult>& result_vec) {
+    const size_t count = dev_id_vec.size();
+    result_vec.assign(count, ServoResult(SERVO_OK));
+    if (count == 0) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+
+    plan.prepare(_baudrate, _returnDelayUs, count);
+    ServoResult first_failure;
+    std::vector<std::vector<uint8_t>> params_rx_vec;
+    std::vector<ServoResult> span_results;
+    for (size_t i = 0; i < plan.span_count(); i++) {
+        const ReadSpan& span = plan.span(i);
+        ServoResult result = sync_read(dev_id_vec, span.address, span.length, params_rx_vec, span_results);
+        if (result.code == SERVO_ERR_PARAM) {
+            result_vec.assign(count, result);
+            for (size_t j = 0; j < count; j++) {
+                plan.set_valid(j, false);
+            }
+            return result;
+        }
+        for (size_t j = 0; j < count; j++) {
+            if (span_results[j]) {
+                memcpy(plan.span_data(j, i), params_rx_vec[j].data(), span.length);
+            }
+            if (result_vec[j].code == SERVO_OK && span_results[j].code != SERVO_OK) {
+                result_vec[j] = span_results[j];
+            }
+        }
+        if (!result && first_failure.code == SERVO_OK) {
+            first_failure = result;
+        }
+    }
+    // 有区间失败的舵机整行清零，不留下上一次读取的值
+    for (size_t j = 0; j < count; j++) {
+        plan.set_valid(j, result_vec[j]);
+    }
+    return first_failure;
+}
+
+// 结果码名称（用于日志和JSON应答）
+const char* ServoResult::name() const {
+    switch (code) {
+        case SERVO_OK:              return "ok";
+        case SERVO_ERR_TIMEOUT:     return "timeout";
+        case SERVO_ERR_HEADER:      return "header_error";
+        case SERVO_ERR_ID_MISMATCH: return "id_mismatch";
+        case SERVO_ERR_CHECKSUM:    return "checksum_error";
+        case SERVO_ERR_LENGTH:      return "length_error";
+        case SERVO_ERR_STATUS:      return "servo_error";
+        case SERVO_ERR_PARAM:       return "param_error";
+    }
+    return "unknown";
 }
 
 // 配置方法实现
@@ -313,12 +676,68 @@ void STServo::setDebug(bool enabled) {
 
 void STServo::setTimeout(uint32_t timeout) {
     _timeout = timeout;
-    if (_serial) {
-        _serial->setTimeout(_timeout);
-    }
+}
+
+// 启用时按波特率和应答长度计算每次通信的截止时间，禁用时使用setTimeout()的固定值
+void STServo::setAdaptiveTimeout(bool enabled) {
+    _adaptiveTimeout = enabled;
+}
+
+// 舵机的应答延时（RETURN_DELAY寄存器值 x 2us）
+void STServo::setReturnDelay(uint32_t delay_us) {
+    _returnDelayUs = delay_us;
+}
+
+// 截止时间的额外余量，覆盖UART接收FIFO超时和任务调度延迟
+void STServo::setTimeoutMargin(uint32_t margin_us) {
+    _timeoutMarginUs = margin_us;
 }
 
 void STServo::setModel(uint8_t model) {
     _model = model;
-    update_memory_map();
-}
\ No newline at end of file
+}
+
+// 设置应答级别并回读确认
+// 关闭应答时舵机可能按旧的级别应答这条写指令，也可能不应答，因此不等待应答，只在下一次发送前等总线空闲
+ServoResult STServo::setResponseLevel(uint8_t dev_id, uint8_t level) {
+    uint8_t value     = level ? 1 : 0;
+    bool    may_reply = replies_to_writes(dev_id);
+    PacketEncoder& packet = begin_packet(dev_id, STServo::INST_WRITE);
+    packet.put(STSRegisters::RESPONSE_LEVEL::ADDRESS);
+    packet.put(value);
+    if (!send_packet()) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    after_write(dev_id, STSRegisters::RESPONSE_LEVEL::ADDRESS, &value, 1);
+    on_register_write(dev_id, STServo::INST_WRITE, STSRegisters::RESPONSE_LEVEL::ADDRESS, &value, 1, true);
+    if (may_reply) {
+        _replyPending = true;
+        _replyQuietAt = reply_deadline(1, 0);
+    }
+    if (dev_id == STProtocol::BROADCAST_ID) {
+        return ServoResult(SERVO_OK);
+    }
+
+    uint8_t actual = 0;
+    ServoResult result = read<STSRegisters::RESPONSE_LEVEL>(dev_id, actual);
+    if (!result) {
+        _responseLevel[dev_id] = RESPONSE_UNKNOWN;
+        return result;
+    }
+    _responseLevel[dev_id] = actual ? 1 : 0;
+    // 回读到的级别与写入的不同（写入未生效）
+    return (_responseLevel[dev_id] == value) ? result : ServoResult(SERVO_ERR_PARAM);
+}
+
+uint8_t STServo::getResponseLevel(uint8_t dev_id) const {
+    return (dev_id < STProtocol::BROADCAST_ID) ? _responseLevel[dev_id] : RESPONSE_UNKNOWN;
+}
+
+// 接收统计
+const RxCounters& STServo::getRxCounters() const {
+    return _rxCounters;
+}
+
+void STServo::resetRxCounters() {
+    memset(&_rxCounters, 0, sizeof(_rxCounters));
+}
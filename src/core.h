@@ -2,48 +2,84 @@
 #ifndef STServo_H
 #define STServo_H
 
-#include <Arduino.h>
-#include <HardwareSerial.h>
-#include <stdexcept>
 #include <vector>
+#include "protocol.h"
+#include "registers.h"
+#include "read_plan.h"
+#include "write_verifier.h"
+#include "bus_stats.h"
+#include "hal.h"
+#ifdef ARDUINO
+#include "hal_arduino.h"
+#endif
 
-// 自定义异常类
-class SerialTimeoutException : public std::runtime_error {
-    public:
-        SerialTimeoutException(const std::string& message) : std::runtime_error(message) {}
+// 通信结果码（协议层不抛出异常，失败代价恒定）
+enum ServoError {
+    SERVO_OK              = 0,  // 成功
+    SERVO_ERR_TIMEOUT     = 1,  // 截止时间内未收到任何应答字节
+    SERVO_ERR_HEADER      = 2,  // 收到的字节中找不到有效包头
+    SERVO_ERR_ID_MISMATCH = 3,  // 只收到其他ID的应答
+    SERVO_ERR_CHECKSUM    = 4,  // 应答校验和错误
+    SERVO_ERR_LENGTH      = 5,  // 应答长度与请求不符
+    SERVO_ERR_STATUS      = 6,  // 应答有效，但舵机错误字节非零
+    SERVO_ERR_PARAM       = 7   // 调用参数错误（数组长度不匹配、数据包过长等）
+};
+
+// 通信结果：code为结果码，servoError为应答包中的舵机错误字节
+// 转换为bool时表示"收到了有效应答"，即SERVO_OK或SERVO_ERR_STATUS（数据仍然有效）
+struct ServoResult {
+    ServoError code;
+    uint8_t    servoError;
+
+    ServoResult(ServoError c = SERVO_OK, uint8_t e = 0) : code(c), servoError(e) {}
+
+    operator bool() const { return code == SERVO_OK || code == SERVO_ERR_STATUS; }
+    const char* name() const;
 };
 
 // 舵机协议指令定义（移至类内部作为静态常量）
 // 舵机模型定义（移至类内部作为静态常量）
 
-// STS系列内存地址映射
+// STS系列内存地址映射（地址由registers.h中的寄存器描述符给出）
 namespace STSMemoryMap {
     // EPROM (只读)
-    const uint8_t SMS_STS_MODEL       = 0x03;
+    const uint8_t SMS_STS_MODEL       = STSRegisters::SMS_STS_MODEL::ADDRESS;
     // EPROM (读写)
-    const uint8_t ID                  = 0x05;
-    const uint8_t BAUD_RATE           = 0x06;
-    const uint8_t STEP_CORR           = 0x1F;
-    const uint8_t MODE                = 0x21;
+    const uint8_t ID                  = STSRegisters::ID::ADDRESS;
+    const uint8_t BAUD_RATE           = STSRegisters::BAUD_RATE::ADDRESS;
+    const uint8_t RETURN_DELAY        = STSRegisters::RETURN_DELAY::ADDRESS;  // 应答延时，单位2us
+    const uint8_t RESPONSE_LEVEL      = STSRegisters::RESPONSE_LEVEL::ADDRESS;  // 应答级别，0时只应答PING和READ
+    const uint8_t STEP_CORR           = STSRegisters::STEP_CORR::ADDRESS;
+    const uint8_t MODE                = STSRegisters::MODE::ADDRESS;
     // SRAM (读写)
-    const uint8_t TORQUE_SWITCH       = 0x28;
-    const uint8_t ACC                 = 0x29;
-    const uint8_t GOAL_POSITION       = 0x2A;
-    const uint8_t GOAL_TIME           = 0x2C;
-    const uint8_t GOAL_SPEED          = 0x2E;
-    const uint8_t EPROM_LOCK          = 0x37;
+    const uint8_t TORQUE_SWITCH       = STSRegisters::TORQUE_SWITCH::ADDRESS;
+    const uint8_t ACC                 = STSRegisters::ACC::ADDRESS;
+    const uint8_t GOAL_POSITION       = STSRegisters::GOAL_POSITION::ADDRESS;
+    const uint8_t GOAL_TIME           = STSRegisters::GOAL_TIME::ADDRESS;
+    const uint8_t GOAL_SPEED          = STSRegisters::GOAL_SPEED::ADDRESS;
+    const uint8_t EPROM_LOCK          = STSRegisters::EPROM_LOCK::ADDRESS;
     // SRAM (只读)
-    const uint8_t PRESENT_POSITION    = 0x38;
-    const uint8_t PRESENT_SPEED       = 0x3A;
-    const uint8_t PRESENT_LOAD        = 0x3C;
-    const uint8_t PRESENT_VOLTAGE     = 0x3E;
-    const uint8_t PRESENT_TEMPERATURE = 0x3F;
-    const uint8_t ASYNC_ACTION        = 0x40;
-    const uint8_t SERVO_STATUS        = 0x41;
-    const uint8_t MOVING              = 0x42;
-    const uint8_t PRESENT_CURRENT     = 0x45;
+    const uint8_t PRESENT_POSITION    = STSRegisters::PRESENT_POSITION::ADDRESS;
+    const uint8_t PRESENT_SPEED       = STSRegisters::PRESENT_SPEED::ADDRESS;
+    const uint8_t PRESENT_LOAD        = STSRegisters::PRESENT_LOAD::ADDRESS;
+    const uint8_t PRESENT_VOLTAGE     = STSRegisters::PRESENT_VOLTAGE::ADDRESS;
+    const uint8_t PRESENT_TEMPERATURE = STSRegisters::PRESENT_TEMPERATURE::ADDRESS;
+    const uint8_t ASYNC_ACTION        = STSRegisters::ASYNC_ACTION::ADDRESS;
+    const uint8_t SERVO_STATUS        = STSRegisters::SERVO_STATUS::ADDRESS;
+    const uint8_t MOVING              = STSRegisters::MOVING::ADDRESS;
+    const uint8_t PRESENT_CURRENT     = STSRegisters::PRESENT_CURRENT::ADDRESS;
 }
 
+// 接收统计（用于诊断总线噪声和错位）
+struct RxCounters {
+    uint32_t discardedBytes;   // 丢弃的字节总数（含以下各项）
+    uint32_t staleBytes;       // 发送新请求前清除的残留字节
+    uint32_t resyncs;          // 包头重新同步次数
+    uint32_t foreignFrames;    // 跳过的其他ID应答帧
+    uint32_t lengthErrors;     // 长度字节与期望应答不符
+    uint32_t checksumErrors;   // 校验和错误
+};
+
 // SCS系列内存地址映射
 namespace SCSMemoryMap {
     const uint8_t EPROM_LOCK          = 0x37;
@@ -64,64 +100,182 @@ class STServo {
         static const uint8_t STS_MODEL       = 1;
         static const uint8_t SCS_MODEL       = 2;
         
-        // STS系列内存地址映射（动态成员变量）
-        uint8_t MEM_ADDR_SMS_STS_MODEL;
-        uint8_t MEM_ADDR_ID;
-        uint8_t MEM_ADDR_BAUD_RATE;
-        uint8_t MEM_ADDR_STEP_CORR;
-        uint8_t MEM_ADDR_MODE;
-        uint8_t MEM_ADDR_TORQUE_SWITCH;
-        uint8_t MEM_ADDR_ACC;
-        uint8_t MEM_ADDR_GOAL_POSITION;
-        uint8_t MEM_ADDR_GOAL_TIME;
-        uint8_t MEM_ADDR_GOAL_SPEED;
-        uint8_t MEM_ADDR_EPROM_LOCK;
-        uint8_t MEM_ADDR_PRESENT_POSITION;
-        uint8_t MEM_ADDR_PRESENT_SPEED;
-        uint8_t MEM_ADDR_PRESENT_LOAD;
-        uint8_t MEM_ADDR_PRESENT_VOLTAGE;
-        uint8_t MEM_ADDR_PRESENT_TEMPERATURE;
-        uint8_t MEM_ADDR_SERVO_STATUS;
-        uint8_t MEM_ADDR_ASYNC_ACTION;
-        uint8_t MEM_ADDR_MOVING;
-        uint8_t MEM_ADDR_PRESENT_CURRENT;
+        // 内存地址（兼容旧代码，新代码使用read<Reg>()/write<Reg>()）
+        static const uint8_t MEM_ADDR_SMS_STS_MODEL       = STSMemoryMap::SMS_STS_MODEL;
+        static const uint8_t MEM_ADDR_ID                  = STSMemoryMap::ID;
+        static const uint8_t MEM_ADDR_BAUD_RATE           = STSMemoryMap::BAUD_RATE;
+        static const uint8_t MEM_ADDR_STEP_CORR           = STSMemoryMap::STEP_CORR;
+        static const uint8_t MEM_ADDR_MODE                = STSMemoryMap::MODE;
+        static const uint8_t MEM_ADDR_TORQUE_SWITCH       = STSMemoryMap::TORQUE_SWITCH;
+        static const uint8_t MEM_ADDR_ACC                 = STSMemoryMap::ACC;
+        static const uint8_t MEM_ADDR_GOAL_POSITION       = STSMemoryMap::GOAL_POSITION;
+        static const uint8_t MEM_ADDR_GOAL_TIME           = STSMemoryMap::GOAL_TIME;
+        static const uint8_t MEM_ADDR_GOAL_SPEED          = STSMemoryMap::GOAL_SPEED;
+        static const uint8_t MEM_ADDR_EPROM_LOCK          = STSMemoryMap::EPROM_LOCK;
+        static const uint8_t MEM_ADDR_PRESENT_POSITION    = STSMemoryMap::PRESENT_POSITION;
+        static const uint8_t MEM_ADDR_PRESENT_SPEED       = STSMemoryMap::PRESENT_SPEED;
+        static const uint8_t MEM_ADDR_PRESENT_LOAD        = STSMemoryMap::PRESENT_LOAD;
+        static const uint8_t MEM_ADDR_PRESENT_VOLTAGE     = STSMemoryMap::PRESENT_VOLTAGE;
+        static const uint8_t MEM_ADDR_PRESENT_TEMPERATURE = STSMemoryMap::PRESENT_TEMPERATURE;
+        static const uint8_t MEM_ADDR_SERVO_STATUS        = STSMemoryMap::SERVO_STATUS;
+        static const uint8_t MEM_ADDR_ASYNC_ACTION        = STSMemoryMap::ASYNC_ACTION;
+        static const uint8_t MEM_ADDR_MOVING              = STSMemoryMap::MOVING;
+        static const uint8_t MEM_ADDR_PRESENT_CURRENT     = STSMemoryMap::PRESENT_CURRENT;
         
     protected:
-        HardwareSerial* _serial;
+        ServoTransport* _transport;
+        ServoClock*     _clock;
+        bool            _ownsTransport;    // 由HardwareSerial构造时自行创建的传输对象
         uint8_t         _model;
         bool            _debugEnabled;
-        uint32_t        _timeout;
+        uint32_t        _timeout;          // 固定超时（毫秒），关闭自适应超时时使用
+
+        // 自适应超时：截止时间 = 请求和应答的线上时间 + 舵机应答延时 + 余量
+        uint32_t        _baudrate;
+        bool            _adaptiveTimeout;
+        uint32_t        _returnDelayUs;
+        uint32_t        _timeoutMarginUs;
+        uint32_t        _lastTxMicros;     // 最近一次请求开始发送的时间
+        size_t          _lastTxBytes;      // 最近一次请求的字节数
+
+        // 应答级别：每个ID最近一次写入的RESPONSE_LEVEL，RESPONSE_UNKNOWN表示未知（按会应答处理）
+        uint8_t         _responseLevel[STProtocol::BROADCAST_ID];
+        // 无应答写入后舵机仍可能应答，下一次发送前等总线空闲，避免与应答冲突
+        bool            _replyPending;
+        uint32_t        _replyQuietAt;
+        WriteVerifier*  _verifier;
+        BusStats*       _stats;
+        uint32_t        _replyStartMicros; // 统计应答延时的起点：请求发送完毕或上一个应答接收完毕
+
+        // 发送缓冲区（固定大小，避免每次通信分配堆内存）
+        uint8_t         _txBuffer[STProtocol::MAX_PACKET_SIZE];
+        PacketEncoder   _encoder;
+
+        // 接收缓冲区（按块从串口读取）和增量帧解析器
+        static const size_t RX_CHUNK_SIZE = 64;
+        uint8_t         _rxBuffer[RX_CHUNK_SIZE];
+        size_t          _rxHead;
+        size_t          _rxTail;
+        FrameParser     _parser;
+        RxCounters      _rxCounters;
 
         // 私有辅助方法
-        uint8_t               calculate_checksum(const std::vector<uint8_t>& data);
-        bool                  receive_packet(uint8_t dev_id, uint8_t& error,            std::vector<uint8_t>& params_rx);
-        std::vector<uint8_t>  make_a_packet( uint8_t dev_id, uint8_t instruction, const std::vector<uint8_t>& params_tx);
-        uint8_t               serial_read_a_byte(const std::string& errMsg);
-        void                  update_memory_map();
+        ServoResult           receive_packet(uint8_t dev_id, uint8_t& error,            std::vector<uint8_t>& params_rx, int expected_len, uint32_t deadline);
+        ServoResult           receive_reply( uint8_t dev_id, int expected_len, uint32_t deadline);
+        ServoResult           receive_frame(uint32_t deadline);
+        ServoResult           record_reply(  uint8_t dev_id, ServoResult result);
+        void                  skip_frame();
+        ServoError            classify_timeout(const RxCounters& before) const;
+        PacketEncoder&        begin_packet(  uint8_t dev_id, uint8_t instruction);
+        bool                  send_packet();
+        ServoResult           write_bytes(   uint8_t dev_id, uint8_t instruction, uint8_t mem_addr, const uint8_t* data, size_t len,
+                                                   uint8_t& error, std::vector<uint8_t>& params_rx);
+        ServoResult           write_bytes(   uint8_t dev_id, uint8_t instruction, uint8_t mem_addr, const uint8_t* data, size_t len);
+        ServoResult           write_bytes_noack(uint8_t dev_id, uint8_t instruction, uint8_t mem_addr, const uint8_t* data, size_t len);
+        void                  after_write(   uint8_t dev_id, uint8_t mem_addr, const uint8_t* data, size_t len);
+        bool                  replies_to_writes(uint8_t dev_id) const;
+        void                  wait_reply_quiet();
+        ServoResult           read_bytes(    uint8_t dev_id, uint8_t mem_addr, uint8_t* data, size_t len);
+        size_t                fill_rx_buffer();
+        void                  drain_rx();
+        void                  reset_parser();
+        uint32_t              wire_time_us(size_t bytes) const;
+        uint32_t              reply_deadline(size_t reply_count, size_t params_len) const;
+        void                  init(uint32_t baudrate);
+        // 写指令结束后调用，派生类用于维护寄存器缓存；dev_id可能是广播ID
+        // instruction为WRITE、REG_WRITE或SYNC_WRITE，REG_WRITE的数据要等ACTION才生效
+        // delivered为true表示舵机已确认或不会应答（无应答写入、广播），为false时写入可能没有到达舵机
+        virtual void          on_register_write(uint8_t dev_id, uint8_t instruction, uint8_t mem_addr,
+                                                const uint8_t* data, size_t len, bool delivered) {}
+        // 广播ACTION发出后调用，暂存的REG_WRITE此时生效
+        virtual void          on_action() {}
 
     public:
         // 构造函数和析构函数
-        STServo(HardwareSerial& serial, uint32_t baudrate = 1000000, bool debugEnabled = false);
-        ~STServo();
+#ifdef ARDUINO
+        STServo(HardwareSerial& serial, uint32_t baudrate = 1000000, bool debugEnabled = false, int rxPin = 18, int txPin = 19);
+#endif
+        // 通过任意传输接口通信（主机测试、模拟器等），clock为NULL时使用平台默认时钟
+        STServo(ServoTransport& transport, uint32_t baudrate = 1000000, bool debugEnabled = false, ServoClock* clock = NULL);
+        virtual ~STServo();
         
         // 初始化和清理方法
         bool begin();
         void end();
         
         // 核心通信方法
-        bool ping(      uint8_t dev_id,                                                     uint8_t& error, std::vector<uint8_t>& params_rx);
-        bool read(      uint8_t dev_id, uint8_t mem_addr, uint8_t length,                   uint8_t& error, std::vector<uint8_t>& params_rx);
-        bool write_data(uint8_t dev_id, uint8_t mem_addr, const std::vector<uint8_t>& data, uint8_t& error, std::vector<uint8_t>& params_rx);
-        bool write_int( uint8_t dev_id, uint8_t mem_addr, int value,                        uint8_t& error, std::vector<uint8_t>& params_rx);
-        bool reg_write( uint8_t dev_id, uint8_t mem_addr, const std::vector<uint8_t>& data, uint8_t& error, std::vector<uint8_t>& params_rx);
-        bool action();
-        bool sync_write(const std::vector<uint8_t>& dev_id_vec, uint8_t mem_addr, 
-                        const std::vector<std::vector<uint8_t>>& params_tx_vec);
-        bool sync_read( const std::vector<uint8_t>& dev_id_vec, uint8_t mem_addr, uint8_t length,
-                              std::vector<std::vector<uint8_t>>& params_rx_vec);
+        ServoResult ping(      uint8_t dev_id,                                                     uint8_t& error, std::vector<uint8_t>& params_rx);
+        ServoResult read(      uint8_t dev_id, uint8_t mem_addr, uint8_t length,                   uint8_t& error, std::vector<uint8_t>& params_rx);
+        ServoResult write_data(uint8_t dev_id, uint8_t mem_addr, const std::vector<uint8_t>& data, uint8_t& error, std::vector<uint8_t>& params_rx);
+        ServoResult write_int( uint8_t dev_id, uint8_t mem_addr, int value,                        uint8_t& error, std::vector<uint8_t>& params_rx);
+        ServoResult reg_write( uint8_t dev_id, uint8_t mem_addr, const std::vector<uint8_t>& data, uint8_t& error, std::vector<uint8_t>& params_rx);
+        ServoResult action();
+        
+        // 无应答写入：发送后立即返回，不等待应答包（舵机不应答写指令时不占用应答的线上时间）
+        // 返回SERVO_OK只表示已发送；设置了WriteVerifier时记录写入，之后用verify()批量回读确认
+        ServoResult write_data_noack(uint8_t dev_id, uint8_t mem_addr, const std::vector<uint8_t>& data);
+        ServoResult write_int_noack( uint8_t dev_id, uint8_t mem_addr, int value);
+        ServoResult reg_write_noack( uint8_t dev_id, uint8_t mem_addr, const std::vector<uint8_t>& data);
+        ServoResult sync_write(const std::vector<uint8_t>& dev_id_vec, uint8_t mem_addr, 
+                               const std::vector<std::vector<uint8_t>>& params_tx_vec);
+        ServoResult sync_read( const std::vector<uint8_t>& dev_id_vec, uint8_t mem_addr, uint8_t length,
+                                     std::vector<std::vector<uint8_t>>& params_rx_vec);
+        // 带每个舵机结果的同步读取：缺失的舵机不影响其他舵机的数据，result_vec[i]对应dev_id_vec[i]
+        ServoResult sync_read( const std::vector<uint8_t>& dev_id_vec, uint8_t mem_addr, uint8_t length,
+                                     std::vector<std::vector<uint8_t>>& params_rx_vec,
+                                     std::vector<ServoResult>& result_vec);
+        
+        // 同步读取拆成发送和接收两步，多条总线可以先全部发送再依次接收（见ServoBusGroup）
+        ServoResult begin_sync_read( const std::vector<uint8_t>& dev_id_vec, uint8_t mem_addr, uint8_t length);
+        // log_failures为false时不记录未应答的舵机（例如扫描时大部分ID不存在）
+        ServoResult finish_sync_read(const std::vector<uint8_t>& dev_id_vec, uint8_t length,
+                                     std::vector<std::vector<uint8_t>>& params_rx_vec,
+                                     std::vector<ServoResult>& result_vec, bool log_failures = true);
         
+        // 按读取计划读取多个寄存器：区间按当前波特率和应答延时合并，结果用plan.get<Reg>(i)取出
+        // 有区间没有读到的舵机plan.valid(i)为false，字段都为0
+        ServoResult read(      uint8_t dev_id, ReadPlan& plan);
+        ServoResult sync_read( const std::vector<uint8_t>& dev_id_vec, ReadPlan& plan, std::vector<ServoResult>& result_vec);
+        
+        // 按寄存器描述符读写（例如 read<STSRegisters::PRESENT_POSITION>(id, posi)）
+        // 定长编解码，按符号位解析负数，不使用vector；舵机的错误状态在ServoResult::servoError中
+        template<typename Reg>
+        ServoResult read(uint8_t dev_id, typename Reg::value_type& value) {
+            uint8_t data[Reg::WIDTH];
+            ServoResult result = read_bytes(dev_id, Reg::ADDRESS, data, Reg::WIDTH);
+            if (result) {
+                value = Reg::decode(data);
+            }
+            return result;
+        }
+
+        template<typename Reg>
+        ServoResult write(uint8_t dev_id, typename Reg::value_type value) {
+            static_assert(Reg::ACCESS == ACCESS_RW, "register is read-only");
+            uint8_t data[Reg::WIDTH];
+            Reg::encode(value, data);
+            return write_bytes(dev_id, INST_WRITE, Reg::ADDRESS, data, Reg::WIDTH);
+        }
+
+        template<typename Reg>
+        ServoResult write_noack(uint8_t dev_id, typename Reg::value_type value) {
+            static_assert(Reg::ACCESS == ACCESS_RW, "register is read-only");
+            uint8_t data[Reg::WIDTH];
+            Reg::encode(value, data);
+            return write_bytes_noack(dev_id, INST_WRITE, Reg::ADDRESS, data, Reg::WIDTH);
+        }
+
+        template<typename Reg>
+        ServoResult reg_write(uint8_t dev_id, typename Reg::value_type value) {
+            static_assert(Reg::ACCESS == ACCESS_RW, "register is read-only");
+            uint8_t data[Reg::WIDTH];
+            Reg::encode(value, data);
+            return write_bytes(dev_id, INST_REG_WRITE, Reg::ADDRESS, data, Reg::WIDTH);
+        }
+
         // 调试和工具方法
         void printPacket(const std::vector<uint8_t>& packet);
+        void printPacket(const uint8_t* packet, size_t len);
         
         // 字节序转换工具方法
         void intToBytes(int value, uint8_t& lowByte, uint8_t& highByte);
@@ -130,8 +284,28 @@ class STServo {
         // 配置方法
         void setDebug(bool enabled);
         void setTimeout(uint32_t timeout);
+        void setAdaptiveTimeout(bool enabled);
+        void setReturnDelay(uint32_t delay_us);
+        void setTimeoutMargin(uint32_t margin_us);
         void setModel(uint8_t model);
         
+        // 应答级别：0时舵机只应答PING和READ，写指令不再等待应答；1时应答所有指令
+        // 写入后回读确认；RESPONSE_LEVEL在EPROM区，EPROM锁定时掉电后恢复原值
+        static const uint8_t RESPONSE_UNKNOWN = 0xFF;
+        ServoResult setResponseLevel(uint8_t dev_id, uint8_t level);
+        uint8_t     getResponseLevel(uint8_t dev_id) const;  // 未设置或未知时返回RESPONSE_UNKNOWN
+        // 无应答写入的延迟校验，NULL时不记录
+        void        setWriteVerifier(WriteVerifier* verifier) { _verifier = verifier; }
+        
+        // 按指令和舵机统计通信情况，NULL时不统计
+        void        setStats(BusStats* stats) { _stats = stats; }
+        BusStats*   getStats() const { return _stats; }
+        ServoClock& clock() { return *_clock; }
+        
+        // 接收统计
+        const RxCounters& getRxCounters() const;
+        void              resetRxCounters();
+        
 };
 
 #endif // STServo_H
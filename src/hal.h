@@ -0,0 +1,42 @@
+#ifndef STServo_HAL_H
+#define STServo_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 硬件抽象层：STServo只通过以下接口访问串口、时钟和日志
+// ESP32上由hal_arduino.cpp实现，主机（Linux）上由host/目录下的POSIX后端实现
+
+// 串口传输接口（半双工舵机总线）
+class ServoTransport {
+    public:
+        virtual ~ServoTransport() {}
+
+        virtual bool   begin(uint32_t baudrate) = 0;
+        virtual void   end() = 0;
+        // 当前可立即读取的字节数
+        virtual int    available() = 0;
+        // 非阻塞读取，最多len字节，返回实际读取的字节数
+        virtual size_t read(uint8_t* buf, size_t len) = 0;
+        virtual size_t write(const uint8_t* buf, size_t len) = 0;
+};
+
+// 时钟接口
+class ServoClock {
+    public:
+        virtual ~ServoClock() {}
+
+        virtual uint32_t micros() = 0;
+        virtual uint32_t millis() = 0;
+        // 等待应答字节时调用，让出CPU
+        virtual void     idle() = 0;
+        virtual void     delay(uint32_t ms) = 0;
+};
+
+// 平台默认时钟（Arduino: micros()/yield()，主机: CLOCK_MONOTONIC）
+ServoClock& servo_default_clock();
+
+// 日志输出（Arduino: Serial，主机: stderr）
+void servo_log(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+#endif // STServo_HAL_H
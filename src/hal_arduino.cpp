@@ -0,0 +1,53 @@
+#ifdef ARDUINO
+
+#include <stdarg.h>
+#include <stdio.h>
+#include "hal_arduino.h"
+
+bool HardwareSerialTransport::begin(uint32_t baudrate) {
+    _serial->setRxBufferSize(RX_BUFFER_SIZE);  // 必须在begin()之前设置
+    _serial->begin(baudrate, SERIAL_8N1, _rxPin, _txPin);
+    return true;
+}
+
+void HardwareSerialTransport::end() {
+    _serial->end();
+}
+
+int HardwareSerialTransport::available() {
+    return _serial->available();
+}
+
+size_t HardwareSerialTransport::read(uint8_t* buf, size_t len) {
+    // 调用者只读取available()范围内的字节，readBytes不会阻塞
+    return _serial->readBytes(buf, len);
+}
+
+size_t HardwareSerialTransport::write(const uint8_t* buf, size_t len) {
+    return _serial->write(buf, len);
+}
+
+// Arduino时钟
+class ArduinoClock : public ServoClock {
+    public:
+        uint32_t micros()            { return ::micros(); }
+        uint32_t millis()            { return ::millis(); }
+        void     idle()              { yield(); }   // 不睡眠整毫秒，字节一到即可继续解析；只让给优先级不低于当前任务的任务
+        void     delay(uint32_t ms)  { ::delay(ms); }
+};
+
+ServoClock& servo_default_clock() {
+    static ArduinoClock clock;
+    return clock;
+}
+
+void servo_log(const char* format, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    Serial.print(buf);
+}
+
+#endif // ARDUINO
@@ -0,0 +1,33 @@
+#ifndef STServo_HAL_ARDUINO_H
+#define STServo_HAL_ARDUINO_H
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+#include <HardwareSerial.h>
+#include "hal.h"
+
+// HardwareSerial上的舵机总线
+class HardwareSerialTransport : public ServoTransport {
+    public:
+        // 多条总线依次接收时，其他总线的应答先在接收缓冲区中等待
+        static const size_t RX_BUFFER_SIZE = 1024;
+
+        HardwareSerialTransport(HardwareSerial& serial, int rxPin, int txPin)
+            : _serial(&serial), _rxPin(rxPin), _txPin(txPin) {}
+
+        bool   begin(uint32_t baudrate);
+        void   end();
+        int    available();
+        size_t read(uint8_t* buf, size_t len);
+        size_t write(const uint8_t* buf, size_t len);
+
+    private:
+        HardwareSerial* _serial;
+        int             _rxPin;
+        int             _txPin;
+};
+
+#endif // ARDUINO
+
+#endif // STServo_HAL_ARDUINO_H
@@ -5,6 +5,15 @@
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
 #include "st3215.h"
+#include "bus_task.h"
+#include "telemetry.h"
+#include "bus_group.h"
+#include "servo_router.h"
+#include "servo_scanner.h"
+#include "trajectory.h"
+#include "servo_transaction.h"
+#include "subscription.h"
+#include "binary_protocol.h"
 #include "board.h"
 #include <vector>
 #include <set>
@@ -18,9 +27,46 @@ const char* password = WIFI_PASSWORD;
 const int TCP_PORT = 8888;
 WiFiServer server(TCP_PORT);
 WiFiClient client;
+FrameReader frameReader;     // 二进制和MessagePack模式下按长度前缀切分请求帧
+// 每次loop()最多执行的请求帧数，连续到达的请求不会推迟订阅推送和显示刷新；其余字节留在frameBuffer中
+const size_t FRAMES_PER_LOOP = 4;
+uint8_t frameBuffer[256];    // 已从连接读出、还没有切分的字节
+size_t frameBuffered = 0;
+size_t frameConsumed = 0;
+
+// 连接协议，由protocol命令协商，新连接从JSON行开始
+enum ConnectionMode {
+    CONN_JSON    = 0,  // 换行分隔的JSON
+    CONN_MSGPACK = 1,  // 长度前缀 + MessagePack，命令格式与JSON相同
+    CONN_BINARY  = 2   // 长度前缀 + 二进制操作码（binary_protocol.h）
+};
+ConnectionMode connectionMode = CONN_JSON;
+
+// 每种编码的请求解析和应答序列化耗时，由codecStats命令返回
+struct CodecStats {
+    uint32_t requests;
+    uint64_t parseTotalUs;
+    uint32_t parseMaxUs;
+    uint64_t serializeTotalUs;
+    uint32_t serializeMaxUs;
+    uint32_t bytesIn;
+    uint32_t bytesOut;
+};
+CodecStats codecStats[2];    // 按CONN_JSON、CONN_MSGPACK索引
 
 // 全局对象
 ST3215* servo = nullptr;
+BusTask* busTask = nullptr;  // 独占舵机总线，TCP和显示只通过队列访问
+TelemetrySampler telemetry;  // 总线任务周期采样，JSON和显示从快照读取
+ST3215* servo2 = nullptr;    // 第二条总线（board.h中定义SERVO2_RXD_PIN时启用）
+class TestBus;
+TestBus* testBus = nullptr;  // 设备测试用的模拟总线接口，固件中没有
+ServoBusGroup busGroup;      // sync_read/sync_write按舵机所在总线拆分并行传输
+ServoRouter servoRouter(busGroup);  // 其他命令按舵机所在总线分发，多舵机命令按总线拆分
+WriteVerifier writeVerifier; // "noack"写入的记录，由verifyWrites批量回读确认
+BusStats servoBusStats;      // 各总线共用的通信统计，由stats命令返回
+TrajectoryPlayer trajectory; // 轨迹播放，由总线任务按控制周期调用
+Subscription subscription;   // 推送订阅：总线任务采样入队，loop()发送给客户端
 Adafruit_SSD1306 display(SSD1306_SCREEN_WIDTH, SSD1306_SCREEN_HEIGHT, &Wire, SSD1306_OLED_RESET);
 
 // 舵机ID管理
@@ -36,14 +82,56 @@ unsigned long lastServoQuery = 0;
 const unsigned long DISPLAY_UPDATE_INTERVAL = 1000;  // 1秒更新一次显示
 const unsigned long SERVO_QUERY_INTERVAL = 1000;     // 1秒查询一次舵机
 
+// 总线任务配置：与loop()同在core 1，优先级高于loopTask（1），有总线事务时抢占loop()
+// core 0上的WiFi任务和lwIP tcpip任务优先级更高，放在那里会被TCP负载抢占，等待应答时的yield()还会占住IDLE0
+// 总线任务只在事务进行中占用CPU（等待以应答截止时间为界），其余时间阻塞在队列上，loop()照常运行
+const BaseType_t  BUS_TASK_CORE = ARDUINO_RUNNING_CORE;
+const UBaseType_t BUS_TASK_PRIORITY = 2;
+
+// 轨迹控制频率范围（控制周期按整毫秒执行）
+const uint32_t TRAJECTORY_MIN_RATE_HZ = 10;
+const uint32_t TRAJECTORY_MAX_RATE_HZ = 500;
+
+// 遥测采样：默认20Hz，快照超过TELEMETRY_MAX_AGE_MS时回退到直接读取
+const uint32_t TELEMETRY_INTERVAL_MS = 50;
+const uint32_t TELEMETRY_MAX_AGE_MS = 200;
+
+// 每次loop()最多推送的订阅样本数，发送慢时多出的样本在队列中被覆盖，不影响命令处理
+const int SUBSCRIPTION_MAX_BURST = 4;
+
+// 显示用的舵机位置，由总线任务写入；位置是有符号数，读取失败用int16范围外的值表示
+const int32_t    DISPLAY_POSITION_NONE = INT32_MIN;
+volatile uint8_t displayServoId = 0;
+volatile int32_t displayPosition = DISPLAY_POSITION_NONE;
+
 // 函数声明
 void setupHardware();
 void setupWiFi();
 void handleTCPClient();
+void stopSubscription();
+void sendSubscriptionSamples();
+size_t sendDocument(const JsonDocument& doc);
+size_t encodeMsgPackFrame(const JsonDocument& doc, std::vector<uint8_t>& frame);
+void handleFramedClient();
+void runBinaryCommand(const uint8_t* payload, size_t len, std::vector<uint8_t>& response);
+void runMsgPackCommand(const uint8_t* payload, size_t len, std::vector<uint8_t>& response);
+void recordCodec(ConnectionMode mode, uint32_t parseUs, uint32_t serializeUs, size_t bytesIn, size_t bytesOut);
+void addCodecStats(JsonObject entry, const CodecStats& stats);
+JsonDocument negotiateProtocol(const JsonDocument& request);
 void updateDisplay();
 void queryServoPosition();
 void addServoToList(uint8_t servoId);
+void trackServo(uint8_t servoId);
+ServoResult scanServos(ScanMethod method, std::vector<ServoInfo>& found, uint32_t& transactions);
+void stopTrajectory();
+void addTrajectoryStats(JsonDocument& response);
+BusPriority commandPriority(const String& func);
+bool latestStatus(uint8_t servoId, ServoStatus& status, uint32_t& ageMs);
+JsonDocument runCommand(const JsonDocument& request);
 JsonDocument processCommand(const JsonDocument& request);
+void setServoFailure(JsonDocument& response, const ServoResult& result, const char* msg);
+bool hasValidResult(const std::vector<ServoResult>& results);
+void addPartialResults(JsonDocument& response, const std::vector<ServoResult>& results);
 JsonDocument validateParameters(const JsonDocument& request);
 bool isValidInteger(const JsonVariantConst& value, int minVal = INT_MIN, int maxVal = INT_MAX);
 bool isValidUint8(const JsonVariantConst& value);
@@ -117,18 +205,43 @@ void setupHardware() {
     }
     
     // 初始化舵机驱动
-    try {
-        servo = new ST3215(Serial1, 1000000, false);  // 不启用调试以避免干扰TCP通信
-        if (servo && servo->begin()) {
-            Serial.println("ST3215 servo driver initialized successfully");
-            servo->setTimeout(1000);  // 设置1秒超时
+    servo = new ST3215(Serial1, 1000000, false, SERVO_RXD_PIN, SERVO_TXD_PIN);  // 不启用调试以避免干扰TCP通信
+    if (servo && servo->begin()) {
+        Serial.println("ST3215 servo driver initialized successfully");
+        servo->setTimeout(1000);  // 关闭自适应超时时使用的固定超时（1秒）
+        servo->setWriteVerifier(&writeVerifier);
+        servo->setStats(&servoBusStats);
+        servoRouter.add_bus(*servo);
+        
+#ifdef SERVO2_RXD_PIN
+        // 第二条总线上的舵机由ping或扫描定位
+        servo2 = new ST3215(Serial2, 1000000, false, SERVO2_RXD_PIN, SERVO2_TXD_PIN);
+        servo2->setTimeout(1000);
+        servo2->setWriteVerifier(&writeVerifier);
+        servo2->setStats(&servoBusStats);
+        servoRouter.add_bus(*servo2);
+        Serial.println("Second servo bus initialized on Serial2");
+#endif
+        
+        // 启动时扫描所有总线，总线任务尚未启动，直接访问总线
+        std::vector<ServoInfo> found;
+        uint32_t transactions = 0;
+        unsigned long scanStart = micros();
+        scanServos(SCAN_SYNC_READ, found, transactions);
+        Serial.printf("Bus scan found %d servos in %lu us\n", (int)found.size(), micros() - scanStart);
+        
+        busTask = new BusTask(*servo);
+        if (busTask->start(BUS_TASK_CORE, BUS_TASK_PRIORITY)) {
+            Serial.printf("Servo bus task started on core %d\n", (int)BUS_TASK_CORE);
+            busTask->set_periodic([](ST3215&) { telemetry.sample(servoRouter); }, TELEMETRY_INTERVAL_MS);
         } else {
-            Serial.println("Failed to initialize ST3215 servo driver");
-            delete servo;
-            servo = nullptr;
+            Serial.println("Failed to start servo bus task, using loop() directly");
+            delete busTask;
+            busTask = nullptr;
         }
-    } catch (const std::exception& e) {
-        Serial.printf("Exception creating ST3215: %s\n", e.what());
+    } else {
+        Serial.println("Failed to initialize ST3215 servo driver");
+        delete servo;
         servo = nullptr;
     }
 }
@@ -166,6 +279,14 @@ void handleTCPClient() {
             clientConnected = true;
             Serial.println("New client connected");
             
+            // 新连接不继承上一个客户端的订阅和协议
+            stopSubscription();
+            subscription.queue().clear();
+            connectionMode = CONN_JSON;
+            frameReader.reset();
+            frameBuffered = 0;
+            frameConsumed = 0;
+            
             // 发送欢迎消息
             JsonDocument welcome;
             welcome["status"] = "connected";
@@ -173,6 +294,11 @@ void handleTCPClient() {
             welcome["version"] = "2.0";
             welcome["ip"] = WiFi.localIP().toString();
             welcome["port"] = TCP_PORT;
+            // 可用{"func":"protocol","mode":...}切换的编码
+            JsonArray contentTypes = welcome["content_types"].to<JsonArray>();
+            contentTypes.add("json");
+            contentTypes.add("msgpack");
+            contentTypes.add("binary");
             
             String welcomeStr;
             serializeJson(welcome, welcomeStr);
@@ -184,7 +310,9 @@ void handleTCPClient() {
     }
     
     // 处理客户端数据
-    if (client.available()) {
+    if (connectionMode != CONN_JSON) {
+        handleFramedClient();
+    } else if (client.available()) {
         String jsonString = client.readStringUntil('\n');
         jsonString.trim();
         
@@ -193,7 +321,9 @@ void handleTCPClient() {
             
             // 解析JSON
             JsonDocument request;
+            uint32_t parseStart = micros();
             DeserializationError error = deserializeJson(request, jsonString);
+            uint32_t parseUs = micros() - parseStart;
             
             if (error) {
                 // JSON解析错误
@@ -207,22 +337,33 @@ void handleTCPClient() {
                 return;
             }
             
-            // 处理命令
-            JsonDocument response = processCommand(request);
+            // 协议协商只改变连接状态，不经过总线任务
+            String func = request["func"] | "";
+            
+            // 处理命令（在总线任务中执行）
+            JsonDocument response = (func == "protocol") ? negotiateProtocol(request) : runCommand(request);
             
             // 发送响应
             String responseStr;
+            uint32_t serializeStart = micros();
             serializeJson(response, responseStr);
+            recordCodec(CONN_JSON, parseUs, micros() - serializeStart, jsonString.length(), responseStr.length());
             client.println(responseStr);
             
             Serial.printf("Sent response: %s\n", responseStr.c_str());
         }
     }
     
+    // 推送订阅样本（二进制模式不推送）
+    if (client.connected() && connectionMode != CONN_BINARY) {
+        sendSubscriptionSamples();
+    }
+    
     // 检查客户端是否断开连接
     if (!client.connected()) {
         if (clientConnected) {
             Serial.println("Client disconnected");
+            stopSubscription();
             clientConnected = false;
         }
     }
@@ -253,13 +394,34 @@ void updateDisplay() {
     display.setCursor(0, 20);
     if (!displayQueue.empty() && currentDisplayIndex < displayQueue.size()) {
         uint8_t servoId = displayQueue[currentDisplayIndex];
-        uint16_t position = 0;
+        ServoStatus status;
+        uint32_t ageMs = 0;
         
-        // 尝试读取舵机位置
-        if (servo && servo->getPosition(servoId, position)) {
-            display.printf("Servo %d: %d", servoId, position);
+        if (latestStatus(servoId, status, ageMs)) {
+            // 遥测快照，不访问总线
+            display.printf("Servo %d: %d", servoId, status.posi);
+        } else if (busTask) {
+            // 显示上一次的结果，并以最低优先级请求下一次读取，不等待总线
+            if (displayServoId == servoId && displayPosition != DISPLAY_POSITION_NONE) {
+                display.printf("Servo %d: %d", servoId, (int)displayPosition);
+            } else {
+                display.printf("Servo %d: ...", servoId);
+            }
+            busTask->submit(BUS_PRIORITY_BACKGROUND, [servoId](ST3215&) {
+                int16_t position = 0;
+                bool ok = servoRouter.bus_for(servoId).getPosition(servoId, position);
+                displayPosition = ok ? position : DISPLAY_POSITION_NONE;
+                displayServoId = servoId;
+            });
         } else {
-            display.printf("Servo %d: Error", servoId);
+            int16_t position = 0;
+            
+            // 尝试读取舵机位置
+            if (servo && servoRouter.bus_for(servoId).getPosition(servoId, position)) {
+                display.printf("Servo %d: %d", servoId, position);
+            } else {
+                display.printf("Servo %d: Error", servoId);
+            }
         }
     } else {
         display.print("No servo data");
@@ -275,6 +437,40 @@ void queryServoPosition() {
     currentDisplayIndex = (currentDisplayIndex + 1) % displayQueue.size();
 }
 
+// 遥测快照中足够新的舵机状态
+bool latestStatus(uint8_t servoId, ServoStatus& status, uint32_t& ageMs) {
+    return servo && telemetry.latest(servoId, status, ageMs, servo->clock()) && ageMs <= TELEMETRY_MAX_AGE_MS;
+}
+
+// 写入类命令优先于读取和显示刷新
+BusPriority commandPriority(const String& func) {
+    if (func.startsWith("set") || func.startsWith("write") || func == "changeId" ||
+        func == "reg_write" || func == "action" || func == "sync_write" ||
+        func == "trajectory" || func == "stopTrajectory" || func == "transaction" || func == "moveTimed") {
+        return BUS_PRIORITY_MOTION;
+    }
+    return BUS_PRIORITY_TELEMETRY;
+}
+
+// 在总线任务中执行命令并等待结果；总线任务未启动时直接执行
+JsonDocument runCommand(const JsonDocument& request) {
+    if (!busTask) {
+        return processCommand(request);
+    }
+    
+    JsonDocument response;
+    String func = request["func"] | "";
+    bool queued = busTask->call(commandPriority(func), [&](ST3215&) {
+        response = processCommand(request);
+    });
+    if (!queued) {
+        response.clear();
+        response["error"] = 3;
+        response["msg"] = "Servo bus queue full";
+    }
+    return response;
+}
+
 void addServoToList(uint8_t servoId) {
     size_t oldSize = servoIdList.size();
     servoIdList.insert(servoId);
@@ -290,6 +486,246 @@ void addServoToList(uint8_t servoId) {
     }
 }
 
+// 扫描到或读取成功的舵机加入遥测采样（只被命令提到的ID不加入）；采样列表已满时报告
+void trackServo(uint8_t servoId) {
+    size_t overflow = telemetry.overflow().size();
+    if (!telemetry.add_id(servoId) && telemetry.overflow().size() > overflow) {
+        Serial.printf("Telemetry list full (%d servos), servo ID %d not sampled\n",
+                     (int)TelemetrySnapshot::MAX_SERVOS, servoId);
+    }
+}
+
+// 扫描所有总线：记录路由，用扫描到的数据填充EPROM缓存，并加入舵机列表
+ServoResult scanServos(ScanMethod method, std::vector<ServoInfo>& found, uint32_t& transactions) {
+    ServoScanner scanner;
+    scanner.set_method(method);
+    ServoResult result = scanner.scan(busGroup, found);
+    transactions = scanner.transactions();
+    for (const ServoInfo& info : found) {
+        if (info.bus < servoRouter.bus_count()) {
+            servoRouter.bus(info.bus).seedCache(info.id, 0, info.raw, ServoScanner::PROBE_LENGTH);
+        }
+        addServoToList(info.id);
+        trackServo(info.id);
+    }
+    return result;
+}
+
+// 停止轨迹播放和控制周期
+void stopTrajectory() {
+    trajectory.stop();
+    if (busTask) {
+        busTask->set_periodic(BusJob(), 0, BUS_PRIORITY_MOTION);
+    }
+}
+
+// 切换连接协议：{"func":"protocol","mode":"msgpack"}，应答仍使用切换前的编码，之后的请求和应答使用新编码
+// json为换行分隔；msgpack和binary为u16小端长度前缀的帧，最大载荷为max_payload
+// msgpack模式下发送protocol命令切换，binary模式下发送BIN_OP_JSON切回；订阅样本不以二进制推送，切换到binary时停止订阅
+JsonDocument negotiateProtocol(const JsonDocument& request) {
+    JsonDocument response;
+    String mode = request["mode"] | "";
+    if (mode != "json" && mode != "msgpack" && mode != "binary") {
+        response["error"] = 2;
+        response["msg"] = "Datatype check for parameter failed: mode must be json, msgpack or binary";
+        return response;
+    }
+    response["error"] = 0;
+    response["mode"] = mode;
+    if (mode == "json") {
+        connectionMode = CONN_JSON;
+        return response;
+    }
+    if (mode == "binary") {
+        stopSubscription();
+    }
+    response["max_payload"] = static_cast<uint32_t>(FrameReader::MAX_PAYLOAD);
+    connectionMode = (mode == "binary") ? CONN_BINARY : CONN_MSGPACK;
+    frameReader.reset();
+    return response;
+}
+
+// MessagePack帧：u16小端长度 + 载荷，返回帧的字节数（文档过大时为0）
+size_t encodeMsgPackFrame(const JsonDocument& doc, std::vector<uint8_t>& frame) {
+    size_t size = measureMsgPack(doc);
+    if (size > 0xFFFF) {
+        frame.clear();
+        return 0;
+    }
+    frame.resize(size + 2);
+    frame[0] = size & 0xFF;
+    frame[1] = (size >> 8) & 0xFF;
+    serializeMsgPack(doc, frame.data() + 2, size);
+    return frame.size();
+}
+
+// 按当前连接的编码发送一个文档（订阅推送等），返回发送的字节数
+size_t sendDocument(const JsonDocument& doc) {
+    if (connectionMode == CONN_MSGPACK) {
+        static std::vector<uint8_t> frame;
+        size_t size = encodeMsgPackFrame(doc, frame);
+        return size ? client.write(frame.data(), size) : 0;
+    }
+    String line;
+    serializeJson(doc, line);
+    return client.println(line);
+}
+
+// 执行一个MessagePack请求，命令与JSON相同；response为带长度前缀的应答帧
+void runMsgPackCommand(const uint8_t* payload, size_t len, std::vector<uint8_t>& response) {
+    JsonDocument request;
+    uint32_t parseStart = micros();
+    DeserializationError error = deserializeMsgPack(request, payload, len);
+    uint32_t parseUs = micros() - parseStart;
+    
+    JsonDocument result;
+    if (error) {
+        result["error"] = 1;
+        result["msg"] = "MessagePack parse error: " + String(error.c_str());
+    } else {
+        String func = request["func"] | "";
+        result = (func == "protocol") ? negotiateProtocol(request) : runCommand(request);
+    }
+    
+    uint32_t serializeStart = micros();
+    if (encodeMsgPackFrame(result, response) == 0) {
+        JsonDocument tooLarge;
+        tooLarge["error"] = 3;
+        tooLarge["msg"] = "Response too large";
+        encodeMsgPackFrame(tooLarge, response);
+    }
+    recordCodec(CONN_MSGPACK, parseUs, micros() - serializeStart, len, response.size());
+}
+
+void recordCodec(ConnectionMode mode, uint32_t parseUs, uint32_t serializeUs, size_t bytesIn, size_t bytesOut) {
+    CodecStats& stats = codecStats[mode == CONN_MSGPACK ? 1 : 0];
+    stats.requests++;
+    stats.parseTotalUs += parseUs;
+    stats.parseMaxUs = max(stats.parseMaxUs, parseUs);
+    stats.serializeTotalUs += serializeUs;
+    stats.serializeMaxUs = max(stats.serializeMaxUs, serializeUs);
+    stats.bytesIn += bytesIn;
+    stats.bytesOut += bytesOut;
+}
+
+void addCodecStats(JsonObject entry, const CodecStats& stats) {
+    uint32_t requests = stats.requests ? stats.requests : 1;
+    entry["requests"] = stats.requests;
+    entry["parse_us_avg"] = static_cast<uint32_t>(stats.parseTotalUs / requests);
+    entry["parse_us_max"] = stats.parseMaxUs;
+    entry["serialize_us_avg"] = static_cast<uint32_t>(stats.serializeTotalUs / requests);
+    entry["serialize_us_max"] = stats.serializeMaxUs;
+    entry["bytes_in"] = stats.bytesIn;
+    entry["bytes_out"] = stats.bytesOut;
+}
+
+// 在总线任务中执行一个二进制请求；总线任务未启动时直接执行；BIN_OP_JSON成功后切回JSON
+void runBinaryCommand(const uint8_t* payload, size_t len, std::vector<uint8_t>& response) {
+    if (!servo) {
+        BinaryProtocol::reject(payload, len, BIN_STATUS_UNAVAILABLE, response);
+    } else if (!busTask) {
+        BinaryProtocol::handle(servoRouter, payload, len, response);
+    } else if (!busTask->call(BinaryProtocol::priority(payload[0]), [&](ST3215&) {
+                   BinaryProtocol::handle(servoRouter, payload, len, response);
+               })) {
+        BinaryProtocol::reject(payload, len, BIN_STATUS_UNAVAILABLE, response);
+    }
+    if (payload[0] == BIN_OP_JSON && response[5] == SERVO_OK) {
+        connectionMode = CONN_JSON;
+    }
+}
+
+// 二进制和MessagePack模式：读取已到达的字节并按长度前缀切分成帧，每帧执行后立即回写应答
+// 长度非法时流已无法同步，断开连接；切换协议后缓冲区中剩余的字节丢弃（客户端应等待应答）
+void handleFramedClient() {
+    static std::vector<uint8_t> response;
+    const ConnectionMode mode = connectionMode;
+    size_t frames = 0;
+    while (frames < FRAMES_PER_LOOP) {
+        if (frameConsumed == frameBuffered) {
+            int received = (client.available() > 0) ? client.read(frameBuffer, sizeof(frameBuffer)) : 0;
+            if (received <= 0) {
+                return;
+            }
+            frameBuffered = received;
+            frameConsumed = 0;
+        }
+        frameConsumed += frameReader.feed(frameBuffer + frameConsumed, frameBuffered - frameConsumed);
+        if (frameReader.invalid()) {
+            Serial.println("Invalid frame length, closing connection");
+            client.stop();
+            frameBuffered = 0;
+            frameConsumed = 0;
+            return;
+        }
+        if (!frameReader.ready()) {
+            continue;
+        }
+        if (mode == CONN_BINARY) {
+            runBinaryCommand(frameReader.payload(), frameReader.length(), response);
+        } else {
+            runMsgPackCommand(frameReader.payload(), frameReader.length(), response);
+        }
+        client.write(response.data(), response.size());
+        frameReader.next();
+        frames++;
+        if (connectionMode != mode) {
+            // 切回JSON后剩余的字节按行读取，这里已读出的部分丢弃；msgpack和binary之间切换时继续切分
+            if (connectionMode == CONN_JSON) {
+                frameBuffered = 0;
+                frameConsumed = 0;
+            }
+            return;
+        }
+    }
+}
+
+// 停止订阅采样，已入队的样本由读者丢弃或发送
+void stopSubscription() {
+    if (busTask) {
+        busTask->set_periodic(BusJob(), 0, BUS_PRIORITY_BACKGROUND);
+    }
+}
+
+// 推送样本：{"event":"sample","seq":12,"t":34567,"dropped":0,"servos":[{"dev_id":1,"posi":2048,"velo":0}]}
+// 未应答的舵机只有"valid":false；dropped为连接以来被覆盖的样本总数
+void sendSubscriptionSamples() {
+    static StreamSample sample;  // 样本较大，不放在loop()的栈上
+    SampleQueue& queue = subscription.queue();
+    for (int n = 0; n < SUBSCRIPTION_MAX_BURST && queue.pop(sample); n++) {
+        JsonDocument event;
+        event["event"] = "sample";
+        event["seq"] = sample.sequence;
+        event["t"] = sample.timestampMs;
+        event["dropped"] = queue.dropped();
+        JsonArray servos = event["servos"].to<JsonArray>();
+        for (size_t s = 0; s < sample.servoCount; s++) {
+            JsonObject entry = servos.add<JsonObject>();
+            entry["dev_id"] = sample.ids[s];
+            if (!(sample.validMask & (1u << s))) {
+                entry["valid"] = false;
+                continue;
+            }
+            for (size_t f = 0; f < sample.fieldCount; f++) {
+                entry[Subscription::field(sample.fields[f]).name] = sample.values[s][f];
+            }
+        }
+        
+        sendDocument(event);
+    }
+}
+
+void addTrajectoryStats(JsonDocument& response) {
+    const TrajectoryStats& stats = trajectory.stats();
+    response["running"] = trajectory.running();
+    response["ticks"] = stats.ticks;
+    response["failures"] = stats.failures;
+    response["overruns"] = stats.overruns;
+    response["missed_ticks"] = stats.missedTicks;
+    response["max_late_us"] = stats.maxLateUs;
+    response["max_run_us"] = stats.maxRunUs;
+}
+
 JsonDocument processCommand(const JsonDocument& request) {
     JsonDocument response;
     
@@ -314,580 +750,1147 @@ JsonDocument processCommand(const JsonDocument& request) {
         return response;
     }
     
-    try {
-        if (func == "setTorqueMode") {
-            // 设置力矩模式：{"func":"setTorqueMode","dev_id":1,"mode":"free"}
-            if (request["dev_id"].isNull() || request["mode"].isNull()) {
-                response["error"] = 2;
-                response["msg"] = "Missing required parameters: dev_id and mode";
-                return response;
-            }
-            
-            uint8_t devId  = request["dev_id"].as<uint8_t>();
-            String modeStr = request["mode"].as<String>();
-            
-            TorqueMode mode = TORQUE_FREE;
-            if (modeStr == "free") mode = TORQUE_FREE;
-            else if (modeStr == "enable") mode = TORQUE_ENABLE;
-            else if (modeStr == "damped") mode = TORQUE_DAMPED;
-            else {
-                response["error"] = 2;
-                response["msg"] = "Invalid mode. Valid modes: free, enable, damped";
-                return response;
+    if (func == "setTorqueMode") {
+        // 设置力矩模式：{"func":"setTorqueMode","dev_id":1,"mode":"free"}
+        if (request["dev_id"].isNull() || request["mode"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameters: dev_id and mode";
+            return response;
+        }
+        
+        uint8_t devId  = request["dev_id"].as<uint8_t>();
+        String modeStr = request["mode"].as<String>();
+        
+        TorqueMode mode = TORQUE_FREE;
+        if (modeStr == "free") mode = TORQUE_FREE;
+        else if (modeStr == "enable") mode = TORQUE_ENABLE;
+        else if (modeStr == "damped") mode = TORQUE_DAMPED;
+        else {
+            response["error"] = 2;
+            response["msg"] = "Invalid mode. Valid modes: free, enable, damped";
+            return response;
+        }
+        
+        // 添加到舵机列表
+        addServoToList(devId);
+        
+        ServoResult result = servoRouter.bus_for(devId).setTorqueMode(devId, mode);
+        if (result) {
+            response["error"] = 0;
+        } else {
+            setServoFailure(response, result, "Failed to set torque mode");
+        }
+        
+    } else if (func == "setAcceleration") {
+        // 设置加速度：{"func":"setAcceleration","dev_id":[1,2],"acc":[100,150]}
+        if (request["dev_id"].isNull() || request["acc"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameters: dev_id and acc";
+            return response;
+        }
+        
+        std::vector<uint8_t> devIds;
+        std::vector<uint8_t> accelerations;
+        
+        // 处理dev_id参数
+        if (request["dev_id"].is<JsonArray>()) {
+            JsonArrayConst idArray = request["dev_id"].as<JsonArrayConst>();
+            for (JsonVariantConst v : idArray) {
+                devIds.push_back(v.as<uint8_t>());
+                addServoToList(devIds.back());
             }
-            
-            // 添加到舵机列表
+        } else {
+            uint8_t devId = request["dev_id"].as<uint8_t>();
+            devIds.push_back(devId);
             addServoToList(devId);
-            
-            if (servo->setTorqueMode(devId, mode)) {
-                response["error"] = 0;
-            } else {
-                response["error"] = 4;
-                response["msg"] = "Failed to set torque mode";
-            }
-            
-        } else if (func == "setAcceleration") {
-            // 设置加速度：{"func":"setAcceleration","dev_id":[1,2],"acc":[100,150]}
-            if (request["dev_id"].isNull() || request["acc"].isNull()) {
+        }
+        
+        // 处理acc参数
+        if (request["acc"].is<JsonArray>()) {
+            JsonArrayConst accArray = request["acc"].as<JsonArrayConst>();
+            if (accArray.size() != devIds.size()) {
                 response["error"] = 2;
-                response["msg"] = "Missing required parameters: dev_id and acc";
+                response["msg"] = "dev_id and acc arrays size mismatch";
                 return response;
             }
-            
-            std::vector<uint8_t> devIds;
-            std::vector<uint8_t> accelerations;
-            
-            // 处理dev_id参数
-            if (request["dev_id"].is<JsonArray>()) {
-                JsonArrayConst idArray = request["dev_id"].as<JsonArrayConst>();
-                for (JsonVariantConst v : idArray) {
-                    devIds.push_back(v.as<uint8_t>());
-                    addServoToList(devIds.back());
-                }
-            } else {
-                uint8_t devId = request["dev_id"].as<uint8_t>();
-                devIds.push_back(devId);
-                addServoToList(devId);
-            }
-            
-            // 处理acc参数
-            if (request["acc"].is<JsonArray>()) {
-                JsonArrayConst accArray = request["acc"].as<JsonArrayConst>();
-                if (accArray.size() != devIds.size()) {
-                    response["error"] = 2;
-                    response["msg"] = "dev_id and acc arrays size mismatch";
-                    return response;
-                }
-                for (JsonVariantConst v : accArray) {
-                    accelerations.push_back(v.as<uint8_t>());
-                }
-            } else {
-                accelerations.push_back(request["acc"].as<uint8_t>());
+            for (JsonVariantConst v : accArray) {
+                accelerations.push_back(v.as<uint8_t>());
             }
-            
-            if (servo->setAcceleration(devIds, accelerations)) {
-                response["error"] = 0;
-            } else {
-                response["error"] = 4;
-                response["msg"] = "Failed to set acceleration";
+        } else {
+            accelerations.push_back(request["acc"].as<uint8_t>());
+        }
+        
+        ServoResult result = servoRouter.setAcceleration(devIds, accelerations);
+        if (result) {
+            response["error"] = 0;
+        } else {
+            setServoFailure(response, result, "Failed to set acceleration");
+        }
+        
+    } else if (func == "getAcceleration") {
+        // 读取加速度：{"func":"getAcceleration","dev_id":[1,2]}，"fresh":true时不使用缓存
+        if (request["dev_id"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameter: dev_id";
+            return response;
+        }
+        
+        std::vector<uint8_t> devIds;
+        std::vector<uint8_t> accelerations;
+        
+        // 处理dev_id参数
+        if (request["dev_id"].is<JsonArray>()) {
+            JsonArrayConst idArray = request["dev_id"].as<JsonArrayConst>();
+            for (JsonVariantConst v : idArray) {
+                devIds.push_back(v.as<uint8_t>());
+                addServoToList(devIds.back());
             }
-            
-        } else if (func == "getAcceleration") {
-            // 读取加速度：{"func":"getAcceleration","dev_id":[1,2]}
-            if (request["dev_id"].isNull()) {
-                response["error"] = 2;
-                response["msg"] = "Missing required parameter: dev_id";
-                return response;
+        } else {
+            uint8_t devId = request["dev_id"].as<uint8_t>();
+            devIds.push_back(devId);
+            addServoToList(devId);
+        }
+        
+        std::vector<ServoResult> results;
+        bool fresh = request["fresh"] | false;
+        ServoResult result = servoRouter.getAcceleration(devIds, accelerations, results, fresh);
+        for (size_t i = 0; i < results.size(); i++) {
+            if (results[i]) {
+                trackServo(devIds[i]);
             }
-            
-            std::vector<uint8_t> devIds;
-            std::vector<uint8_t> accelerations;
-            
-            // 处理dev_id参数
-            if (request["dev_id"].is<JsonArray>()) {
-                JsonArrayConst idArray = request["dev_id"].as<JsonArrayConst>();
-                for (JsonVariantConst v : idArray) {
-                    devIds.push_back(v.as<uint8_t>());
-                    addServoToList(devIds.back());
-                }
+        }
+        if (result) {
+            response["error"] = 0;
+            if (devIds.size() == 1) {
+                response["acc"] = accelerations[0];
             } else {
-                uint8_t devId = request["dev_id"].as<uint8_t>();
-                devIds.push_back(devId);
-                addServoToList(devId);
+                JsonArray accArray = response["acc"].to<JsonArray>();
+                for (uint8_t acc : accelerations) {
+                    accArray.add(acc);
+                }
             }
-            
-            if (servo->getAcceleration(devIds, accelerations)) {
-                response["error"] = 0;
-                if (devIds.size() == 1) {
-                    response["acc"] = accelerations[0];
+        } else if (devIds.size() > 1 && hasValidResult(results)) {
+            // 部分舵机未应答：保留其他舵机的数据，失败的位置为null
+            response["error"] = 0;
+            JsonArray accArray = response["acc"].to<JsonArray>();
+            for (size_t i = 0; i < accelerations.size(); i++) {
+                if (results[i]) {
+                    accArray.add(accelerations[i]);
                 } else {
-                    JsonArray accArray = response["acc"].to<JsonArray>();
-                    for (uint8_t acc : accelerations) {
-                        accArray.add(acc);
-                    }
+                    accArray.add(nullptr);
                 }
-            } else {
-                response["error"] = 4;
-                response["msg"] = "Failed to read acceleration";
             }
+            addPartialResults(response, results);
+        } else {
+            setServoFailure(response, result, "Failed to read acceleration");
+        }
+        
+    } else if (func == "setPosition") {
+        // 设置舵机位置
+        if (request["dev_id"].isNull() || request["posi"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameters: dev_id and posi";
+            return response;
+        }
+        
+        std::vector<uint8_t> devIds;
+        std::vector<uint16_t> positions;
+        std::vector<uint16_t> velocities;
+        
+        // 处理单个或多个舵机
+        if (request["dev_id"].is<JsonArray>()) {
+            // 多舵机
+            JsonArrayConst idArray = request["dev_id"].as<JsonArrayConst>();
+            JsonArrayConst posiArray = request["posi"].as<JsonArrayConst>();
             
-        } else if (func == "setPosition") {
-            // 设置舵机位置
-            if (request["dev_id"].isNull() || request["posi"].isNull()) {
+            if (idArray.size() != posiArray.size()) {
                 response["error"] = 2;
-                response["msg"] = "Missing required parameters: dev_id and posi";
+                response["msg"] = "dev_id and posi arrays size mismatch";
                 return response;
             }
             
-            std::vector<uint8_t> devIds;
-            std::vector<uint16_t> positions;
-            std::vector<uint16_t> velocities;
-            
-            // 处理单个或多个舵机
-            if (request["dev_id"].is<JsonArray>()) {
-                // 多舵机
-                JsonArrayConst idArray = request["dev_id"].as<JsonArrayConst>();
-                JsonArrayConst posiArray = request["posi"].as<JsonArrayConst>();
-                
-                if (idArray.size() != posiArray.size()) {
-                    response["error"] = 2;
-                    response["msg"] = "dev_id and posi arrays size mismatch";
-                    return response;
-                }
-                
-                for (size_t i = 0; i < idArray.size(); i++) {
-                    devIds.push_back(idArray[i].as<uint8_t>());
-                    positions.push_back(posiArray[i].as<uint16_t>());
-                    velocities.push_back(request["velo"] | 800);  // 默认速度800
-                    
-                    // 添加到舵机列表
-                    addServoToList(devIds.back());
-                }
-            } else {
-                // 单舵机
-                uint8_t devId = request["dev_id"].as<uint8_t>();
-                devIds.push_back(devId);
-                positions.push_back(request["posi"].as<uint16_t>());
-                velocities.push_back(request["velo"] | 800);
+            for (size_t i = 0; i < idArray.size(); i++) {
+                devIds.push_back(idArray[i].as<uint8_t>());
+                positions.push_back(posiArray[i].as<uint16_t>());
+                velocities.push_back(request["velo"] | 800);  // 默认速度800
                 
                 // 添加到舵机列表
-                addServoToList(devId);
-            }
-            
-            if (servo->setPosition(devIds, positions, velocities)) {
-                response["error"] = 0;
-            } else {
-                response["error"] = 4;
-                response["msg"] = "Failed to set servo position";
-            }
-            
-        } else if (func == "getPosition") {
-            // 读取单个舵机位置：{"func":"getPosition","dev_id":1}
-            if (request["dev_id"].isNull()) {
-                response["error"] = 2;
-                response["msg"] = "Missing required parameter: dev_id";
-                return response;
+                addServoToList(devIds.back());
             }
-            
+        } else {
+            // 单舵机
             uint8_t devId = request["dev_id"].as<uint8_t>();
-            uint16_t position = 0;
+            devIds.push_back(devId);
+            positions.push_back(request["posi"].as<uint16_t>());
+            velocities.push_back(request["velo"] | 800);
             
             // 添加到舵机列表
             addServoToList(devId);
-            
-            if (servo->getPosition(devId, position)) {
-                response["error"] = 0;
-                response["posi"] = position;
-            } else {
-                response["error"] = 4;
-                response["msg"] = "Failed to read servo position";
-            }
-            
-        } else if (func == "getStatus") {
-            // 读取舵机完整状态：{"func":"getStatus","dev_id":1}
-            if (request["dev_id"].isNull()) {
+        }
+        
+        ServoResult result = servoRouter.setPosition(devIds, positions, velocities);
+        if (result) {
+            response["error"] = 0;
+        } else {
+            setServoFailure(response, result, "Failed to set servo position");
+        }
+        
+    } else if (func == "moveTimed") {
+        // 定时运动：{"func":"moveTimed","dev_id":[1,2],"posi":[1000,3000],"duration_ms":800,"timing":"speed"}
+        // timing为speed（默认，读取当前位置后按距离计算各舵机速度）或time（写GOAL_TIME）；所有舵机同时到达
+        if (request["dev_id"].isNull() || request["posi"].isNull() || request["duration_ms"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameters: dev_id, posi, duration_ms";
+            return response;
+        }
+        if (!request["dev_id"].is<JsonArray>() || !request["posi"].is<JsonArray>() ||
+            request["dev_id"].size() == 0 || request["dev_id"].size() != request["posi"].size()) {
+            response["error"] = 2;
+            response["msg"] = "Datatype check for parameter failed: dev_id and posi must be arrays of the same size";
+            return response;
+        }
+        if (!isValidInteger(request["duration_ms"], 1, ST3215::MOVE_MAX_TIME_MS)) {
+            response["error"] = 2;
+            response["msg"] = "Datatype check for parameter failed: duration_ms must be an integer 1-65535";
+            return response;
+        }
+        String timingName = request["timing"] | "speed";
+        if (timingName != "speed" && timingName != "time") {
+            response["error"] = 2;
+            response["msg"] = "Datatype check for parameter failed: timing must be speed or time";
+            return response;
+        }
+        
+        std::vector<uint8_t> devIds;
+        std::vector<uint16_t> positions;
+        JsonArrayConst posiArray = request["posi"].as<JsonArrayConst>();
+        for (size_t i = 0; i < posiArray.size(); i++) {
+            JsonVariantConst id = request["dev_id"][i];
+            if (!isValidInteger(id, 0, 253) || !isValidInteger(posiArray[i], 0, 4095)) {
                 response["error"] = 2;
-                response["msg"] = "Missing required parameter: dev_id";
+                response["msg"] = "Datatype check for parameter failed: dev_id must be 0-253 and posi 0-4095";
                 return response;
             }
-            
-            uint8_t devId = request["dev_id"].as<uint8_t>();
-            ServoStatus status;
-            
-            // 添加到舵机列表
-            addServoToList(devId);
-            
-            if (servo->getStatus(devId, status)) {
-                response["error"] = 0;
-                response["posi"] = status.posi;
-                response["velo"] = status.velo;
-                response["load"] = status.load;
-                response["volt"] = status.volt;
-                response["temp"] = status.temp;
-                response["asyn"] = status.asyn;
-                response["stat"] = status.stat;
-                response["mvng"] = status.mvng;
-                response["curr"] = status.curr;
-            } else {
-                response["error"] = 4;
-                response["msg"] = "Failed to read servo status";
+            devIds.push_back(id.as<uint8_t>());
+            positions.push_back(posiArray[i].as<uint16_t>());
+            addServoToList(devIds.back());
+        }
+        
+        std::vector<uint16_t> velocities;
+        uint32_t actualMs = 0;
+        MoveTiming timing = (timingName == "time") ? MOVE_BY_TIME : MOVE_BY_SPEED;
+        ServoResult result = servoRouter.moveTimed(devIds, positions, request["duration_ms"].as<uint32_t>(),
+                                                   velocities, actualMs, timing);
+        if (result) {
+            response["error"] = 0;
+            // 最远的舵机以最大速度也赶不上时，duration_ms大于请求的时长
+            response["duration_ms"] = actualMs;
+            JsonArray veloArray = response["velo"].to<JsonArray>();
+            for (uint16_t velo : velocities) {
+                veloArray.add(velo);
             }
-            
-        } else if (func == "changeId") {
-            // 更改舵机ID
-            if (request["old_id"].isNull() || request["new_id"].isNull()) {
-                response["error"] = 2;
-                response["msg"] = "Missing required parameters: old_id and new_id";
-                return response;
+        } else {
+            setServoFailure(response, result, "Timed move failed");
+        }
+        
+    } else if (func == "getPosition") {
+        // 读取单个舵机位置：{"func":"getPosition","dev_id":1}，默认从遥测快照返回，"fresh":true时读取舵机
+        if (request["dev_id"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameter: dev_id";
+            return response;
+        }
+        
+        uint8_t devId = request["dev_id"].as<uint8_t>();
+        int16_t position = 0;
+        
+        // 添加到舵机列表
+        addServoToList(devId);
+        
+        ServoStatus snapshot;
+        uint32_t ageMs = 0;
+        if (!(request["fresh"] | false) && latestStatus(devId, snapshot, ageMs)) {
+            response["error"] = 0;
+            response["posi"] = snapshot.posi;
+            response["age_ms"] = ageMs;
+            return response;
+        }
+        
+        ServoResult result = servoRouter.bus_for(devId).getPosition(devId, position);
+        if (result) {
+            trackServo(devId);
+            response["error"] = 0;
+            response["posi"] = position;
+        } else {
+            setServoFailure(response, result, "Failed to read servo position");
+        }
+        
+    } else if (func == "getStatus") {
+        // 读取舵机完整状态：{"func":"getStatus","dev_id":1}，默认从遥测快照返回，"fresh":true时读取舵机
+        if (request["dev_id"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameter: dev_id";
+            return response;
+        }
+        
+        uint8_t devId = request["dev_id"].as<uint8_t>();
+        ServoStatus status;
+        uint32_t ageMs = 0;
+        
+        // 添加到舵机列表
+        addServoToList(devId);
+        
+        ServoResult result(SERVO_OK);
+        if (!(request["fresh"] | false) && latestStatus(devId, status, ageMs)) {
+            response["age_ms"] = ageMs;
+        } else {
+            result = servoRouter.bus_for(devId).getStatus(devId, status);
+            if (result) {
+                trackServo(devId);
             }
-            
-            uint8_t oldId = request["old_id"].as<uint8_t>();
-            uint8_t newId = request["new_id"].as<uint8_t>();
-            
-            if (servo->changeId(oldId, newId)) {
-                response["error"] = 0;
-                
-                // 更新舵机列表
-                servoIdList.erase(oldId);
-                addServoToList(newId);
-            } else {
-                response["error"] = 4;
-                response["msg"] = "Failed to change servo ID";
+        }
+        if (result) {
+            response["error"] = 0;
+            response["posi"] = status.posi;
+            response["velo"] = status.velo;
+            response["load"] = status.load;
+            response["volt"] = status.volt;
+            response["temp"] = status.temp;
+            response["asyn"] = status.asyn;
+            response["stat"] = status.stat;
+            response["mvng"] = status.mvng;
+            response["curr"] = status.curr;
+        } else {
+            setServoFailure(response, result, "Failed to read servo status");
+        }
+        
+    } else if (func == "changeId") {
+        // 更改舵机ID
+        if (request["old_id"].isNull() || request["new_id"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameters: old_id and new_id";
+            return response;
+        }
+        
+        uint8_t oldId = request["old_id"].as<uint8_t>();
+        uint8_t newId = request["new_id"].as<uint8_t>();
+        
+        ServoResult result = servoRouter.bus_for(oldId).changeId(oldId, newId);
+        if (result) {
+            response["error"] = 0;
+            
+            // 路由跟随新ID
+            busGroup.assign(newId, busGroup.route(oldId));
+            busGroup.assign(oldId, ServoBusGroup::NO_BUS);
+            
+            // 更新舵机列表
+            servoIdList.erase(oldId);
+            addServoToList(newId);
+            trackServo(newId);
+        } else {
+            setServoFailure(response, result, "Failed to change servo ID");
+        }
+        
+    } else if (func == "setPositionCorrection") {
+        // 设置位置校正：{"func":"setPositionCorrection","dev_id":1,"correction":100,"save":true}
+        if (request["dev_id"].isNull() || request["correction"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameters: dev_id and correction";
+            return response;
+        }
+        
+        uint8_t devId = request["dev_id"].as<uint8_t>();
+        int16_t correction = request["correction"].as<int16_t>();
+        bool save = request["save"] | true;  // 默认保存到EPROM
+        
+        // 添加到舵机列表
+        addServoToList(devId);
+        
+        ServoResult result = servoRouter.bus_for(devId).setPositionCorrection(devId, correction, save);
+        if (result) {
+            response["error"] = 0;
+        } else {
+            setServoFailure(response, result, "Failed to set position correction");
+        }
+        
+    } else if (func == "getPositionCorrection") {
+        // 读取位置校正：{"func":"getPositionCorrection","dev_id":1}，"fresh":true时不使用缓存
+        if (request["dev_id"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameter: dev_id";
+            return response;
+        }
+        
+        uint8_t devId = request["dev_id"].as<uint8_t>();
+        int16_t correction = 0;
+        
+        // 添加到舵机列表
+        addServoToList(devId);
+        
+        bool fresh = request["fresh"] | false;
+        ServoResult result = servoRouter.bus_for(devId).getPositionCorrection(devId, correction, fresh);
+        if (result) {
+            trackServo(devId);
+            response["error"] = 0;
+            response["correction"] = correction;
+        } else {
+            setServoFailure(response, result, "Failed to read position correction");
+        }
+        
+    } else if (func == "ping") {
+        // Ping舵机（基类功能）
+        if (request["dev_id"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameter: dev_id";
+            return response;
+        }
+        
+        uint8_t devId = request["dev_id"].as<uint8_t>();
+        uint8_t error = 0;
+        std::vector<uint8_t> params_rx;
+        
+        // 添加到舵机列表
+        addServoToList(devId);
+        
+        // 已知所在总线时直接PING，否则依次在各总线上查找
+        ServoResult result = (busGroup.route(devId) != ServoBusGroup::NO_BUS)
+                           ? busGroup.bus_for(devId).ping(devId, error, params_rx)
+                           : busGroup.locate(devId);
+        if (result) {
+            trackServo(devId);
+            response["error"] = 0;
+            response["connected"] = true;
+        } else {
+            setServoFailure(response, result, "Servo ping failed");
+            response["connected"] = false;
+        }
+        
+    } else if (func == "scan") {
+        // 扫描总线上的所有舵机：{"func":"scan","method":"sync_read"}，method为"sync_read"（默认）或"read"（逐个READ）
+        // 旧名称"ping"等同于"read"，探测一直使用READ指令
+        String method = request["method"] | "sync_read";
+        if (method != "sync_read" && method != "read" && method != "ping") {
+            response["error"] = 2;
+            response["msg"] = "Datatype check for parameter failed: method must be \"sync_read\" or \"read\"";
+            return response;
+        }
+        
+        std::vector<ServoInfo> found;
+        uint32_t transactions = 0;
+        unsigned long scanStart = micros();
+        ServoResult result = scanServos(method == "sync_read" ? SCAN_SYNC_READ : SCAN_READ, found, transactions);
+        unsigned long durationUs = micros() - scanStart;
+        if (result) {
+            response["error"] = 0;
+            response["duration_us"] = durationUs;
+            response["transactions"] = transactions;
+            JsonArray servos = response["servos"].to<JsonArray>();
+            for (const ServoInfo& info : found) {
+                JsonObject entry = servos.add<JsonObject>();
+                entry["id"] = info.id;
+                entry["bus"] = info.bus;
+                entry["model"] = info.model;
+                entry["firmware"] = String(info.firmwareMajor) + "." + String(info.firmwareMinor);
             }
-            
-        } else if (func == "setPositionCorrection") {
-            // 设置位置校正：{"func":"setPositionCorrection","dev_id":1,"correction":100,"save":true}
-            if (request["dev_id"].isNull() || request["correction"].isNull()) {
-                response["error"] = 2;
-                response["msg"] = "Missing required parameters: dev_id and correction";
-                return response;
+        } else {
+            setServoFailure(response, result, "Servo bus scan failed");
+        }
+        
+    } else if (func == "read") {
+        // 读取内存地址数据：{"func":"read","dev_id":1,"mem_addr":56,"length":2}
+        if (request["dev_id"].isNull() || request["mem_addr"].isNull() || request["length"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameters: dev_id, mem_addr, length";
+            return response;
+        }
+        
+        uint8_t devId = request["dev_id"].as<uint8_t>();
+        uint8_t memAddr = request["mem_addr"].as<uint8_t>();
+        uint8_t length = request["length"].as<uint8_t>();
+        uint8_t error = 0;
+        std::vector<uint8_t> params_rx;
+        
+        // 添加到舵机列表
+        addServoToList(devId);
+        
+        ServoResult result = servoRouter.bus_for(devId).read(devId, memAddr, length, error, params_rx);
+        if (result) {
+            trackServo(devId);
+            response["error"] = 0;
+            response["data"] = JsonArray();
+            JsonArray dataArray = response["data"];
+            for (uint8_t byte : params_rx) {
+                dataArray.add(byte);
             }
-            
-            uint8_t devId = request["dev_id"].as<uint8_t>();
-            int16_t correction = request["correction"].as<int16_t>();
-            bool save = request["save"] | true;  // 默认保存到EPROM
-            
-            // 添加到舵机列表
-            addServoToList(devId);
-            
-            if (servo->setPositionCorrection(devId, correction, save)) {
-                response["error"] = 0;
-            } else {
-                response["error"] = 4;
-                response["msg"] = "Failed to set position correction";
+            response["error_code"] = error;
+        } else {
+            setServoFailure(response, result, "Failed to read from memory address");
+            response["error_code"] = error;
+        }
+        
+    } else if (func == "write_data") {
+        // 写入数据到内存地址：{"func":"write_data","dev_id":1,"mem_addr":56,"data":[100,200]}
+        // "noack":true时不等待应答，之后可用verifyWrites确认（write_int、reg_write相同）
+        if (request["dev_id"].isNull() || request["mem_addr"].isNull() || request["data"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameters: dev_id, mem_addr, data";
+            return response;
+        }
+        
+        uint8_t devId = request["dev_id"].as<uint8_t>();
+        uint8_t memAddr = request["mem_addr"].as<uint8_t>();
+        bool noAck = request["noack"] | false;
+        uint8_t error = 0;
+        std::vector<uint8_t> params_rx;
+        std::vector<uint8_t> data;
+        
+        // 处理data参数
+        if (request["data"].is<JsonArray>()) {
+            JsonArrayConst dataArray = request["data"].as<JsonArrayConst>();
+            for (JsonVariantConst v : dataArray) {
+                data.push_back(v.as<uint8_t>());
             }
-            
-        } else if (func == "getPositionCorrection") {
-            // 读取位置校正：{"func":"getPositionCorrection","dev_id":1}
-            if (request["dev_id"].isNull()) {
-                response["error"] = 2;
-                response["msg"] = "Missing required parameter: dev_id";
-                return response;
+        } else {
+            response["error"] = 2;
+            response["msg"] = "data parameter must be an array";
+            return response;
+        }
+        
+        // 添加到舵机列表
+        addServoToList(devId);
+        
+        ServoResult result = noAck ? servoRouter.bus_for(devId).write_data_noack(devId, memAddr, data)
+                                   : servoRouter.bus_for(devId).write_data(devId, memAddr, data, error, params_rx);
+        if (result) {
+            response["error"] = 0;
+            response["error_code"] = error;
+        } else {
+            setServoFailure(response, result, "Failed to write data to memory address");
+            response["error_code"] = error;
+        }
+        
+    } else if (func == "write_int") {
+        // 写入整数到内存地址：{"func":"write_int","dev_id":1,"mem_addr":56,"value":1000}
+        if (request["dev_id"].isNull() || request["mem_addr"].isNull() || request["value"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameters: dev_id, mem_addr, value";
+            return response;
+        }
+        
+        uint8_t devId = request["dev_id"].as<uint8_t>();
+        uint8_t memAddr = request["mem_addr"].as<uint8_t>();
+        int value = request["value"].as<int>();
+        bool noAck = request["noack"] | false;
+        uint8_t error = 0;
+        std::vector<uint8_t> params_rx;
+        
+        // 添加到舵机列表
+        addServoToList(devId);
+        
+        ServoResult result = noAck ? servoRouter.bus_for(devId).write_int_noack(devId, memAddr, value)
+                                   : servoRouter.bus_for(devId).write_int(devId, memAddr, value, error, params_rx);
+        if (result) {
+            response["error"] = 0;
+            response["error_code"] = error;
+        } else {
+            setServoFailure(response, result, "Failed to write integer to memory address");
+            response["error_code"] = error;
+        }
+        
+    } else if (func == "reg_write") {
+        // 寄存器写入：{"func":"reg_write","dev_id":1,"mem_addr":56,"data":[100,200]}
+        if (request["dev_id"].isNull() || request["mem_addr"].isNull() || request["data"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameters: dev_id, mem_addr, data";
+            return response;
+        }
+        
+        uint8_t devId = request["dev_id"].as<uint8_t>();
+        uint8_t memAddr = request["mem_addr"].as<uint8_t>();
+        bool noAck = request["noack"] | false;
+        uint8_t error = 0;
+        std::vector<uint8_t> params_rx;
+        std::vector<uint8_t> data;
+        
+        // 处理data参数
+        if (request["data"].is<JsonArray>()) {
+            JsonArrayConst dataArray = request["data"].as<JsonArrayConst>();
+            for (JsonVariantConst v : dataArray) {
+                data.push_back(v.as<uint8_t>());
             }
-            
-            uint8_t devId = request["dev_id"].as<uint8_t>();
-            int16_t correction = 0;
-            
-            // 添加到舵机列表
-            addServoToList(devId);
-            
-            if (servo->getPositionCorrection(devId, correction)) {
-                response["error"] = 0;
-                response["correction"] = correction;
-            } else {
-                response["error"] = 4;
-                response["msg"] = "Failed to read position correction";
+        } else {
+            response["error"] = 2;
+            response["msg"] = "data parameter must be an array";
+            return response;
+        }
+        
+        // 添加到舵机列表
+        addServoToList(devId);
+        
+        ServoResult result = noAck ? servoRouter.bus_for(devId).reg_write_noack(devId, memAddr, data)
+                                   : servoRouter.bus_for(devId).reg_write(devId, memAddr, data, error, params_rx);
+        if (result) {
+            response["error"] = 0;
+            response["error_code"] = error;
+        } else {
+            setServoFailure(response, result, "Failed to register write");
+            response["error_code"] = error;
+        }
+        
+    } else if (func == "setResponseLevel") {
+        // 设置应答级别：{"func":"setResponseLevel","dev_id":1,"level":0}，0时舵机不应答写指令
+        if (request["dev_id"].isNull() || request["level"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameters: dev_id, level";
+            return response;
+        }
+        if (!isValidInteger(request["level"], 0, 1)) {
+            response["error"] = 2;
+            response["msg"] = "Datatype check for parameter failed: level must be 0 or 1";
+            return response;
+        }
+        
+        uint8_t devId = request["dev_id"].as<uint8_t>();
+        uint8_t level = request["level"].as<uint8_t>();
+        ServoResult result = servoRouter.bus_for(devId).setResponseLevel(devId, level);
+        if (result) {
+            response["error"] = 0;
+        } else {
+            setServoFailure(response, result, "Failed to set response level");
+        }
+        
+    } else if (func == "verifyWrites") {
+        // 回读确认之前的"noack"写入：{"func":"verifyWrites"}
+        size_t pending = writeVerifier.pending();
+        std::vector<uint8_t> failedIds;
+        bool verified = writeVerifier.verify(busGroup, failedIds);
+        response["error"] = 0;
+        response["checked"] = pending;
+        response["verified"] = verified;
+        JsonArray failedArray = response["failed"].to<JsonArray>();
+        for (uint8_t id : failedIds) {
+            failedArray.add(id);
+        }
+        
+    } else if (func == "action") {
+        // 执行动作：{"func":"action"}，每条总线各发一个广播ACTION
+        ServoResult result(SERVO_OK);
+        for (size_t b = 0; b < servoRouter.bus_count(); b++) {
+            ServoResult busResult = servoRouter.bus(b).action();
+            if (!busResult && result) {
+                result = busResult;
             }
-            
-        } else if (func == "ping") {
-            // Ping舵机（基类功能）
-            if (request["dev_id"].isNull()) {
+        }
+        if (result) {
+            response["error"] = 0;
+        } else {
+            setServoFailure(response, result, "Failed to execute action");
+        }
+        
+    } else if (func == "transaction") {
+        // 原子写入多个舵机：{"func":"transaction","writes":[{"dev_id":1,"mem_addr":42,"data":[220,5]},
+        //                                               {"dev_id":2,"mem_addr":41,"data":[50,160,15]}]}
+        // 每个舵机合并为一个REG_WRITE暂存，全部暂存成功后一个广播ACTION同时生效，任一舵机失败时不提交
+        if (!request["writes"].is<JsonArray>() || request["writes"].size() == 0) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameter: writes (non-empty array)";
+            return response;
+        }
+        
+        ServoTransaction transaction;
+        std::vector<uint8_t> data;
+        for (JsonVariantConst write : request["writes"].as<JsonArrayConst>()) {
+            if (!isValidUint8(write["dev_id"]) || !isValidUint8(write["mem_addr"]) || !write["data"].is<JsonArrayConst>()) {
                 response["error"] = 2;
-                response["msg"] = "Missing required parameter: dev_id";
+                response["msg"] = "Datatype check for parameter failed: each write needs dev_id, mem_addr and data array";
                 return response;
             }
-            
-            uint8_t devId = request["dev_id"].as<uint8_t>();
-            uint8_t error = 0;
-            std::vector<uint8_t> params_rx;
-            
-            // 添加到舵机列表
-            addServoToList(devId);
-            
-            if (servo->ping(devId, error, params_rx)) {
-                response["error"] = 0;
-                response["connected"] = true;
-            } else {
-                response["error"] = 4;
-                response["msg"] = "Servo ping failed";
-                response["connected"] = false;
+            data.clear();
+            for (JsonVariantConst v : write["data"].as<JsonArrayConst>()) {
+                if (!isValidUint8(v)) {
+                    response["error"] = 2;
+                    response["msg"] = "Datatype check for parameter failed: data elements must be integers 0-255";
+                    return response;
+                }
+                data.push_back(v.as<uint8_t>());
             }
-            
-        } else if (func == "read") {
-            // 读取内存地址数据：{"func":"read","dev_id":1,"mem_addr":56,"length":2}
-            if (request["dev_id"].isNull() || request["mem_addr"].isNull() || request["length"].isNull()) {
+            uint8_t devId = write["dev_id"].as<uint8_t>();
+            if (!transaction.add(devId, write["mem_addr"].as<uint8_t>(), data.data(), data.size())) {
                 response["error"] = 2;
-                response["msg"] = "Missing required parameters: dev_id, mem_addr, length";
+                response["msg"] = "Invalid write: dev_id 0-253, non-empty data below address 0x48, at most 32 servos";
                 return response;
             }
-            
-            uint8_t devId = request["dev_id"].as<uint8_t>();
-            uint8_t memAddr = request["mem_addr"].as<uint8_t>();
-            uint8_t length = request["length"].as<uint8_t>();
-            uint8_t error = 0;
-            std::vector<uint8_t> params_rx;
-            
-            // 添加到舵机列表
             addServoToList(devId);
-            
-            if (servo->read(devId, memAddr, length, error, params_rx)) {
-                response["error"] = 0;
-                response["data"] = JsonArray();
-                JsonArray dataArray = response["data"];
-                for (uint8_t byte : params_rx) {
-                    dataArray.add(byte);
+        }
+        
+        std::vector<ServoResult> results;
+        ServoResult result = transaction.execute(busGroup, results);
+        const TransactionStats& stats = transaction.stats();
+        if (result) {
+            response["error"] = 0;
+            response["servos"] = transaction.servo_count();
+            response["frames"] = stats.frames;
+            response["gap_reads"] = stats.gapReads;
+            // 逐个直接写入时各舵机生效的时间差；ACTION使所有舵机在同一帧生效
+            response["stage_us"] = stats.stageUs;
+            response["commit_us"] = stats.commitUs;
+        } else {
+            setServoFailure(response, result, "Transaction not committed");
+            JsonArray failed = response["failed"].to<JsonArray>();
+            for (size_t i = 0; i < results.size(); i++) {
+                if (!results[i]) {
+                    JsonObject entry = failed.add<JsonObject>();
+                    entry["dev_id"] = transaction.servo_id(i);
+                    entry["result"] = results[i].name();
                 }
-                response["error_code"] = error;
-            } else {
-                response["error"] = 4;
-                response["msg"] = "Failed to read from memory address";
-                response["error_code"] = error;
-            }
-            
-        } else if (func == "write_data") {
-            // 写入数据到内存地址：{"func":"write_data","dev_id":1,"mem_addr":56,"data":[100,200]}
-            if (request["dev_id"].isNull() || request["mem_addr"].isNull() || request["data"].isNull()) {
-                response["error"] = 2;
-                response["msg"] = "Missing required parameters: dev_id, mem_addr, data";
-                return response;
             }
-            
-            uint8_t devId = request["dev_id"].as<uint8_t>();
-            uint8_t memAddr = request["mem_addr"].as<uint8_t>();
-            uint8_t error = 0;
-            std::vector<uint8_t> params_rx;
-            std::vector<uint8_t> data;
-            
-            // 处理data参数
-            if (request["data"].is<JsonArray>()) {
-                JsonArrayConst dataArray = request["data"].as<JsonArrayConst>();
-                for (JsonVariantConst v : dataArray) {
-                    data.push_back(v.as<uint8_t>());
-                }
-            } else {
-                response["error"] = 2;
-                response["msg"] = "data parameter must be an array";
-                return response;
+            // 已暂存的舵机在下一个广播ACTION时执行，由调用方决定重新暂存还是发送action
+            JsonArray armed = response["armed"].to<JsonArray>();
+            for (size_t i = 0; i < transaction.armed().size(); i++) {
+                armed.add(transaction.armed()[i]);
             }
-            
-            // 添加到舵机列表
-            addServoToList(devId);
-            
-            if (servo->write_data(devId, memAddr, data, error, params_rx)) {
-                response["error"] = 0;
-                response["error_code"] = error;
-            } else {
-                response["error"] = 4;
-                response["msg"] = "Failed to write data to memory address";
-                response["error_code"] = error;
+        }
+        
+    } else if (func == "sync_write") {
+        // 同步写入：{"func":"sync_write","dev_id":[1,2],"mem_addr":56,"data":[[100,200],[150,250]]}
+        if (request["dev_id"].isNull() || request["mem_addr"].isNull() || request["data"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameters: dev_id, mem_addr, data";
+            return response;
+        }
+        
+        std::vector<uint8_t> devIds;
+        uint8_t memAddr = request["mem_addr"].as<uint8_t>();
+        std::vector<std::vector<uint8_t>> dataArray;
+        
+        // 处理dev_id参数
+        if (request["dev_id"].is<JsonArray>()) {
+            JsonArrayConst idArray = request["dev_id"].as<JsonArrayConst>();
+            for (JsonVariantConst v : idArray) {
+                devIds.push_back(v.as<uint8_t>());
+                addServoToList(devIds.back());
             }
-            
-        } else if (func == "write_int") {
-            // 写入整数到内存地址：{"func":"write_int","dev_id":1,"mem_addr":56,"value":1000}
-            if (request["dev_id"].isNull() || request["mem_addr"].isNull() || request["value"].isNull()) {
+        } else {
+            response["error"] = 2;
+            response["msg"] = "dev_id parameter must be an array for sync_write";
+            return response;
+        }
+        
+        // 处理data参数（二维数组）
+        if (request["data"].is<JsonArray>()) {
+            JsonArrayConst outerArray = request["data"].as<JsonArrayConst>();
+            if (outerArray.size() != devIds.size()) {
                 response["error"] = 2;
-                response["msg"] = "Missing required parameters: dev_id, mem_addr, value";
+                response["msg"] = "dev_id and data arrays size mismatch";
                 return response;
             }
             
-            uint8_t devId = request["dev_id"].as<uint8_t>();
-            uint8_t memAddr = request["mem_addr"].as<uint8_t>();
-            int value = request["value"].as<int>();
-            uint8_t error = 0;
-            std::vector<uint8_t> params_rx;
-            
-            // 添加到舵机列表
-            addServoToList(devId);
-            
-            if (servo->write_int(devId, memAddr, value, error, params_rx)) {
-                response["error"] = 0;
-                response["error_code"] = error;
-            } else {
-                response["error"] = 4;
-                response["msg"] = "Failed to write integer to memory address";
-                response["error_code"] = error;
+            for (JsonVariantConst outerV : outerArray) {
+                if (outerV.is<JsonArray>()) {
+                    std::vector<uint8_t> innerData;
+                    JsonArrayConst innerArray = outerV.as<JsonArrayConst>();
+                    for (JsonVariantConst innerV : innerArray) {
+                        innerData.push_back(innerV.as<uint8_t>());
+                    }
+                    dataArray.push_back(innerData);
+                } else {
+                    response["error"] = 2;
+                    response["msg"] = "data parameter must be a 2D array";
+                    return response;
+                }
             }
-            
-        } else if (func == "reg_write") {
-            // 寄存器写入：{"func":"reg_write","dev_id":1,"mem_addr":56,"data":[100,200]}
-            if (request["dev_id"].isNull() || request["mem_addr"].isNull() || request["data"].isNull()) {
-                response["error"] = 2;
-                response["msg"] = "Missing required parameters: dev_id, mem_addr, data";
-                return response;
+        } else {
+            response["error"] = 2;
+            response["msg"] = "data parameter must be a 2D array";
+            return response;
+        }
+        
+        ServoResult result = busGroup.sync_write(devIds, memAddr, dataArray);
+        if (result) {
+            response["error"] = 0;
+        } else {
+            setServoFailure(response, result, "Failed to sync write");
+        }
+        
+    } else if (func == "sync_read") {
+        // 同步读取：{"func":"sync_read","dev_id":[1,2],"mem_addr":56,"length":2}
+        if (request["dev_id"].isNull() || request["mem_addr"].isNull() || request["length"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameters: dev_id, mem_addr, length";
+            return response;
+        }
+        
+        std::vector<uint8_t> devIds;
+        uint8_t memAddr = request["mem_addr"].as<uint8_t>();
+        uint8_t length = request["length"].as<uint8_t>();
+        std::vector<std::vector<uint8_t>> dataArray;
+        
+        // 处理dev_id参数
+        if (request["dev_id"].is<JsonArray>()) {
+            JsonArrayConst idArray = request["dev_id"].as<JsonArrayConst>();
+            for (JsonVariantConst v : idArray) {
+                devIds.push_back(v.as<uint8_t>());
+                addServoToList(devIds.back());
             }
-            
-            uint8_t devId = request["dev_id"].as<uint8_t>();
-            uint8_t memAddr = request["mem_addr"].as<uint8_t>();
-            uint8_t error = 0;
-            std::vector<uint8_t> params_rx;
-            std::vector<uint8_t> data;
-            
-            // 处理data参数
-            if (request["data"].is<JsonArray>()) {
-                JsonArrayConst dataArray = request["data"].as<JsonArrayConst>();
-                for (JsonVariantConst v : dataArray) {
-                    data.push_back(v.as<uint8_t>());
-                }
-            } else {
-                response["error"] = 2;
-                response["msg"] = "data parameter must be an array";
-                return response;
+        } else {
+            response["error"] = 2;
+            response["msg"] = "dev_id parameter must be an array for sync_read";
+            return response;
+        }
+        
+        std::vector<ServoResult> results;
+        ServoResult result = busGroup.sync_read(devIds, memAddr, length, dataArray, results);
+        for (size_t i = 0; i < results.size(); i++) {
+            if (results[i]) {
+                trackServo(devIds[i]);
             }
-            
-            // 添加到舵机列表
-            addServoToList(devId);
-            
-            if (servo->reg_write(devId, memAddr, data, error, params_rx)) {
-                response["error"] = 0;
-                response["error_code"] = error;
-            } else {
-                response["error"] = 4;
-                response["msg"] = "Failed to register write";
-                response["error_code"] = error;
+        }
+        if (hasValidResult(results)) {
+            // 部分舵机未应答时仍返回其他舵机的数据，失败的位置为null
+            response["error"] = 0;
+            response["data"] = JsonArray();
+            JsonArray outerArray = response["data"];
+            
+            for (size_t i = 0; i < dataArray.size(); i++) {
+                if (!results[i]) {
+                    outerArray.add(nullptr);
+                    continue;
+                }
+                JsonArray innerArray = outerArray.add<JsonArray>();
+                for (uint8_t byte : dataArray[i]) {
+                    innerArray.add(byte);
+                }
             }
-            
-        } else if (func == "action") {
-            // 执行动作：{"func":"action"}
-            if (servo->action()) {
-                response["error"] = 0;
-            } else {
-                response["error"] = 4;
-                response["msg"] = "Failed to execute action";
+            if (!result) {
+                addPartialResults(response, results);
             }
-            
-        } else if (func == "sync_write") {
-            // 同步写入：{"func":"sync_write","dev_id":[1,2],"mem_addr":56,"data":[[100,200],[150,250]]}
-            if (request["dev_id"].isNull() || request["mem_addr"].isNull() || request["data"].isNull()) {
-                response["error"] = 2;
-                response["msg"] = "Missing required parameters: dev_id, mem_addr, data";
-                return response;
+        } else {
+            setServoFailure(response, result, "Failed to sync read");
+        }
+        
+    } else if (func == "trajectory") {
+        // 播放关键帧轨迹：{"func":"trajectory","dev_id":[1,2],"profile":"cubic","rate_hz":200,
+        //                  "keyframes":[{"t":0,"posi":[1000,3000]},{"t":1000,"posi":[3000,1000]}]}
+        // profile为linear、cubic、trapezoid或scurve；每个节拍发送一次GOAL_POSITION的sync_write
+        if (request["dev_id"].isNull() || request["keyframes"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameters: dev_id, keyframes";
+            return response;
+        }
+        if (!request["dev_id"].is<JsonArray>() || request["dev_id"].size() == 0 ||
+            request["dev_id"].size() > TrajectoryPlayer::MAX_SERVOS) {
+            response["error"] = 2;
+            response["msg"] = "Datatype check for parameter failed: dev_id must be an array of 1-16 servo IDs";
+            return response;
+        }
+        if (!request["rate_hz"].isNull() &&
+            !isValidInteger(request["rate_hz"], TRAJECTORY_MIN_RATE_HZ, TRAJECTORY_MAX_RATE_HZ)) {
+            response["error"] = 2;
+            response["msg"] = "Datatype check for parameter failed: rate_hz must be an integer 10-500";
+            return response;
+        }
+        static const char* const profileNames[] = {"linear", "cubic", "trapezoid", "scurve"};
+        String profileName = request["profile"] | "linear";
+        int profile = -1;
+        for (int p = TRAJECTORY_LINEAR; p <= TRAJECTORY_SCURVE; p++) {
+            if (profileName == profileNames[p]) {
+                profile = p;
             }
-            
-            std::vector<uint8_t> devIds;
-            uint8_t memAddr = request["mem_addr"].as<uint8_t>();
-            std::vector<std::vector<uint8_t>> dataArray;
-            
-            // 处理dev_id参数
-            if (request["dev_id"].is<JsonArray>()) {
-                JsonArrayConst idArray = request["dev_id"].as<JsonArrayConst>();
-                for (JsonVariantConst v : idArray) {
-                    devIds.push_back(v.as<uint8_t>());
-                    addServoToList(devIds.back());
-                }
-            } else {
+        }
+        if (profile < 0) {
+            response["error"] = 2;
+            response["msg"] = "Datatype check for parameter failed: profile must be linear, cubic, trapezoid or scurve";
+            return response;
+        }
+        if (!busTask) {
+            response["error"] = 3;
+            response["msg"] = "Servo bus task not running";
+            return response;
+        }
+        
+        std::vector<uint8_t> devIds;
+        for (JsonVariantConst v : request["dev_id"].as<JsonArrayConst>()) {
+            devIds.push_back(v.as<uint8_t>());
+        }
+        stopTrajectory();
+        if (!trajectory.set_servos(devIds)) {
+            response["error"] = 2;
+            response["msg"] = "dev_id must be distinct servo IDs 0-253";
+            return response;
+        }
+        trajectory.set_profile(static_cast<TrajectoryProfile>(profile));
+        
+        JsonArrayConst keyframes = request["keyframes"].as<JsonArrayConst>();
+        if (keyframes.size() == 0 || keyframes.size() > TrajectoryPlayer::MAX_KEYFRAMES) {
+            response["error"] = 2;
+            response["msg"] = "Datatype check for parameter failed: keyframes must be an array of 1-64 keyframes";
+            return response;
+        }
+        std::vector<uint16_t> positions;
+        for (JsonVariantConst keyframe : keyframes) {
+            JsonArrayConst posiArray = keyframe["posi"].as<JsonArrayConst>();
+            if (!isValidInteger(keyframe["t"], 0, INT_MAX) || posiArray.size() != devIds.size()) {
                 response["error"] = 2;
-                response["msg"] = "dev_id parameter must be an array for sync_write";
+                response["msg"] = "Datatype check for parameter failed: each keyframe needs t (ms) and one posi per dev_id";
                 return response;
             }
-            
-            // 处理data参数（二维数组）
-            if (request["data"].is<JsonArray>()) {
-                JsonArrayConst outerArray = request["data"].as<JsonArrayConst>();
-                if (outerArray.size() != devIds.size()) {
+            positions.clear();
+            for (JsonVariantConst v : posiArray) {
+                if (!isValidInteger(v, 0, TrajectoryPlayer::POSITION_MAX)) {
                     response["error"] = 2;
-                    response["msg"] = "dev_id and data arrays size mismatch";
+                    response["msg"] = "Datatype check for parameter failed: posi must be integers 0-4095";
                     return response;
                 }
-                
-                for (JsonVariantConst outerV : outerArray) {
-                    if (outerV.is<JsonArray>()) {
-                        std::vector<uint8_t> innerData;
-                        JsonArrayConst innerArray = outerV.as<JsonArrayConst>();
-                        for (JsonVariantConst innerV : innerArray) {
-                            innerData.push_back(innerV.as<uint8_t>());
-                        }
-                        dataArray.push_back(innerData);
-                    } else {
-                        response["error"] = 2;
-                        response["msg"] = "data parameter must be a 2D array";
-                        return response;
-                    }
-                }
-            } else {
+                positions.push_back(v.as<uint16_t>());
+            }
+            if (!trajectory.add_keyframe(keyframe["t"].as<uint32_t>(), positions)) {
+                trajectory.clear();
                 response["error"] = 2;
-                response["msg"] = "data parameter must be a 2D array";
+                response["msg"] = "Keyframe times must be strictly increasing";
                 return response;
             }
-            
-            if (servo->sync_write(devIds, memAddr, dataArray)) {
-                response["error"] = 0;
-            } else {
-                response["error"] = 4;
-                response["msg"] = "Failed to sync write";
+        }
+        
+        for (uint8_t id : devIds) {
+            addServoToList(id);
+        }
+        uint32_t rateHz = request["rate_hz"] | 100;
+        uint32_t periodMs = 1000 / rateHz;
+        trajectory.reset_stats();
+        trajectory.start(servo->clock().micros(), periodMs * 1000);
+        busTask->set_periodic([](ST3215&) {
+            trajectory.tick(busGroup, servo->clock());
+            if (!trajectory.running()) {
+                busTask->set_periodic(BusJob(), 0, BUS_PRIORITY_MOTION);
             }
-            
-        } else if (func == "sync_read") {
-            // 同步读取：{"func":"sync_read","dev_id":[1,2],"mem_addr":56,"length":2}
-            if (request["dev_id"].isNull() || request["mem_addr"].isNull() || request["length"].isNull()) {
+        }, periodMs, BUS_PRIORITY_MOTION);
+        response["error"] = 0;
+        response["duration_ms"] = trajectory.duration_ms();
+        response["period_ms"] = periodMs;
+        
+    } else if (func == "stopTrajectory") {
+        // 停止轨迹播放：{"func":"stopTrajectory"}，舵机停在最后发送的设定值
+        stopTrajectory();
+        response["error"] = 0;
+        addTrajectoryStats(response);
+        
+    } else if (func == "subscribe") {
+        // 推送订阅：{"func":"subscribe","dev_id":[1,2],"fields":["posi","velo"],"rate_hz":50}
+        // 每个节拍一次sync_read，样本以{"event":"sample",...}行推送，直到unsubscribe或断开连接
+        // fields可选goal、posi、velo、load、volt、temp、asyn、stat、mvng、curr；新的订阅替换旧的
+        if (request["dev_id"].isNull() || request["fields"].isNull()) {
+            response["error"] = 2;
+            response["msg"] = "Missing required parameters: dev_id, fields";
+            return response;
+        }
+        if (!request["dev_id"].is<JsonArray>() || request["dev_id"].size() == 0 ||
+            request["dev_id"].size() > StreamSample::MAX_SERVOS) {
+            response["error"] = 2;
+            response["msg"] = "Datatype check for parameter failed: dev_id must be an array of 1-16 servo IDs";
+            return response;
+        }
+        if (!request["fields"].is<JsonArray>() || request["fields"].size() == 0 ||
+            request["fields"].size() > StreamSample::MAX_FIELDS) {
+            response["error"] = 2;
+            response["msg"] = "Datatype check for parameter failed: fields must be an array of 1-10 field names";
+            return response;
+        }
+        if (!request["rate_hz"].isNull() &&
+            !isValidInteger(request["rate_hz"], Subscription::MIN_RATE_HZ, Subscription::MAX_RATE_HZ)) {
+            response["error"] = 2;
+            response["msg"] = "Datatype check for parameter failed: rate_hz must be an integer 1-200";
+            return response;
+        }
+        if (!busTask) {
+            response["error"] = 3;
+            response["msg"] = "Servo bus task not running";
+            return response;
+        }
+        
+        std::vector<uint8_t> devIds;
+        for (JsonVariantConst v : request["dev_id"].as<JsonArrayConst>()) {
+            if (!isValidInteger(v, 0, 253)) {
                 response["error"] = 2;
-                response["msg"] = "Missing required parameters: dev_id, mem_addr, length";
+                response["msg"] = "Datatype check for parameter failed: dev_id must be integers 0-253";
                 return response;
             }
-            
-            std::vector<uint8_t> devIds;
-            uint8_t memAddr = request["mem_addr"].as<uint8_t>();
-            uint8_t length = request["length"].as<uint8_t>();
-            std::vector<std::vector<uint8_t>> dataArray;
-            
-            // 处理dev_id参数
-            if (request["dev_id"].is<JsonArray>()) {
-                JsonArrayConst idArray = request["dev_id"].as<JsonArrayConst>();
-                for (JsonVariantConst v : idArray) {
-                    devIds.push_back(v.as<uint8_t>());
-                    addServoToList(devIds.back());
-                }
-            } else {
+            devIds.push_back(v.as<uint8_t>());
+        }
+        std::vector<uint8_t> fields;
+        for (JsonVariantConst v : request["fields"].as<JsonArrayConst>()) {
+            int field = v.is<const char*>() ? Subscription::find_field(v.as<const char*>()) : -1;
+            if (field < 0) {
                 response["error"] = 2;
-                response["msg"] = "dev_id parameter must be an array for sync_read";
+                response["msg"] = "Unknown field, expected goal, posi, velo, load, volt, temp, asyn, stat, mvng or curr";
                 return response;
             }
-            
-            if (servo->sync_read(devIds, memAddr, length, dataArray)) {
-                response["error"] = 0;
-                response["data"] = JsonArray();
-                JsonArray outerArray = response["data"];
-                
-                for (const auto& innerData : dataArray) {
-                    JsonArray innerArray = outerArray.add<JsonArray>();
-                    for (uint8_t byte : innerData) {
-                        innerArray.add(byte);
-                    }
-                }
-            } else {
-                response["error"] = 4;
-                response["msg"] = "Failed to sync read";
+            fields.push_back(static_cast<uint8_t>(field));
+        }
+        
+        stopSubscription();
+        subscription.configure(devIds, fields);
+        uint32_t rateHz = request["rate_hz"] | 20;
+        uint32_t periodMs = 1000 / rateHz;
+        // 低于命令和轨迹的优先级，推送不会推迟控制
+        busTask->set_periodic([](ST3215&) {
+            subscription.sample(busGroup, servo->clock());
+        }, periodMs, BUS_PRIORITY_BACKGROUND);
+        response["error"] = 0;
+        response["period_ms"] = periodMs;
+        
+    } else if (func == "unsubscribe") {
+        // 停止推送：{"func":"unsubscribe"}
+        stopSubscription();
+        response["error"] = 0;
+        response["samples"] = subscription.stats().samples;
+        response["failures"] = subscription.stats().failures;
+        
+    } else if (func == "codecStats") {
+        // 各编码的请求解析和应答序列化耗时：{"func":"codecStats","reset":false}
+        response["error"] = 0;
+        addCodecStats(response["json"].to<JsonObject>(), codecStats[0]);
+        addCodecStats(response["msgpack"].to<JsonObject>(), codecStats[1]);
+        if (request["reset"] | false) {
+            memset(codecStats, 0, sizeof(codecStats));
+        }
+        
+    } else if (func == "trajectoryStats") {
+        // 轨迹播放的节拍统计：{"func":"trajectoryStats","reset":false}
+        response["error"] = 0;
+        addTrajectoryStats(response);
+        if (request["reset"] | false) {
+            trajectory.reset_stats();
+        }
+        
+    } else if (func == "setTelemetryRate") {
+        // 设置遥测采样周期：{"func":"setTelemetryRate","interval_ms":50}，0表示停止采样
+        if (!isValidInteger(request["interval_ms"], 0, 60000)) {
+            response["error"] = 2;
+            response["msg"] = "Datatype check for parameter failed: interval_ms must be an integer 0-60000";
+            return response;
+        }
+        if (!busTask) {
+            response["error"] = 3;
+            response["msg"] = "Servo bus task not running";
+            return response;
+        }
+        
+        uint32_t intervalMs = request["interval_ms"].as<uint32_t>();
+        busTask->set_periodic([](ST3215&) { telemetry.sample(servoRouter); }, intervalMs);
+        response["error"] = 0;
+        // 采样列表：扫描到或读取成功的舵机，连续超时后移除；untracked为列表已满没有采样的舵机
+        JsonArray sampled = response["servos"].to<JsonArray>();
+        for (uint8_t id : telemetry.ids()) {
+            sampled.add(id);
+        }
+        JsonArray untracked = response["untracked"].to<JsonArray>();
+        for (uint8_t id : telemetry.overflow()) {
+            untracked.add(id);
+        }
+        response["dropped"] = telemetry.dropped();
+        
+    } else if (func == "busStats") {
+        // 总线任务调度统计：{"func":"busStats","reset":false}
+        if (!busTask) {
+            response["error"] = 3;
+            response["msg"] = "Servo bus task not running";
+            return response;
+        }
+        
+        static const char* const priorityNames[BUS_PRIORITY_COUNT] = {"motion", "telemetry", "background"};
+        response["error"] = 0;
+        JsonObject queues = response["queues"].to<JsonObject>();
+        for (size_t p = 0; p < BUS_PRIORITY_COUNT; p++) {
+            BusQueueStats stats = busTask->stats(static_cast<BusPriority>(p));
+            JsonObject queue = queues[priorityNames[p]].to<JsonObject>();
+            queue["completed"] = stats.completed;
+            queue["rejected"] = stats.rejected;
+            queue["wait_mean_us"] = stats.completed ? (uint32_t)(stats.totalWaitUs / stats.completed) : 0;
+            queue["wait_max_us"] = stats.maxWaitUs;
+            queue["run_max_us"] = stats.maxRunUs;
+        }
+        if (request["reset"] | false) {
+            busTask->reset_stats();
+        }
+        
+    } else if (func == "stats") {
+        // 按指令的通信计数和每个舵机的应答延时直方图：{"func":"stats","reset":false}
+        response["error"] = 0;
+        JsonObject instructions = response["instructions"].to<JsonObject>();
+        for (size_t i = 0; i < STATS_INSTRUCTION_COUNT; i++) {
+            const InstructionStats& stats = servoBusStats.instruction(static_cast<StatsInstruction>(i));
+            JsonObject entry = instructions[BusStats::name(static_cast<StatsInstruction>(i))].to<JsonObject>();
+            entry["count"] = stats.count;
+            entry["tx_bytes"] = stats.txBytes;
+            entry["rx_bytes"] = stats.rxBytes;
+            entry["replies"] = stats.replies;
+            entry["timeouts"] = stats.timeouts;
+            entry["checksum_errors"] = stats.checksumErrors;
+            entry["resyncs"] = stats.resyncs;
+            entry["servo_errors"] = stats.servoErrors;
+        }
+        
+        // 第i个桶的上限，最后一个桶不设上限
+        JsonArray bounds = response["latency_bucket_us"].to<JsonArray>();
+        for (size_t b = 0; b + 1 < LatencyHistogram::BUCKETS; b++) {
+            bounds.add(LatencyHistogram::upper_bound_us(b));
+        }
+        JsonArray servos = response["latency"].to<JsonArray>();
+        for (uint8_t id = 0; id < STProtocol::BROADCAST_ID; id++) {
+            const LatencyHistogram* histogram = servoBusStats.latency(id);
+            if (!histogram || histogram->count == 0) {
+                continue;
             }
-            
-        } else {
-            response["error"] = 1;
-            response["msg"] = "Unknown function: " + func;
-            response["available_functions"] = "[setTorqueMode, setAcceleration, getAcceleration, setPosition, getPosition, getStatus, changeId, setPositionCorrection, getPositionCorrection, ping, read, write_data, write_int, reg_write, action, sync_write, sync_read]";
-        }
-        
-    } catch (const SerialTimeoutException& e) {
-        response["error"] = 5;
-        response["msg"] = "Serial timeout: " + String(e.what());
-    } catch (const std::exception& e) {
-        response["error"] = 6;
-        response["msg"] = "Exception: " + String(e.what());
-    } catch (...) {
-        response["error"] = 7;
-        response["msg"] = "Unknown error occurred";
+            JsonObject entry = servos.add<JsonObject>();
+            entry["id"] = id;
+            entry["count"] = histogram->count;
+            entry["mean_us"] = (uint32_t)(histogram->totalUs / histogram->count);
+            entry["max_us"] = histogram->maxUs;
+            JsonArray buckets = entry["buckets"].to<JsonArray>();
+            for (size_t b = 0; b < LatencyHistogram::BUCKETS; b++) {
+                buckets.add(histogram->buckets[b]);
+            }
+        }
+        if (request["reset"] | false) {
+            servoBusStats.reset();
+        }
+        
+    } else {
+        response["error"] = 1;
+        response["msg"] = "Unknown function: " + func;
+        response["available_functions"] = "[setTorqueMode, setAcceleration, getAcceleration, setPosition, moveTimed, getPosition, getStatus, changeId, setPositionCorrection, getPositionCorrection, ping, read, write_data, write_int, reg_write, action, transaction, setResponseLevel, verifyWrites, sync_write, sync_read, scan, trajectory, stopTrajectory, trajectoryStats, subscribe, unsubscribe, protocol, codecStats, setTelemetryRate, busStats, stats]";
     }
     
     return response;
 }
 
+// 把协议层失败写入应答：超时为5，其余通信/参数失败为4，result给出具体原因
+void setServoFailure(JsonDocument& response, const ServoResult& result, const char* msg) {
+    response["error"] = (result.code == SERVO_ERR_TIMEOUT) ? 5 : 4;
+    response["msg"] = msg;
+    response["result"] = result.name();
+}
+
+// 是否至少有一个舵机应答成功
+bool hasValidResult(const std::vector<ServoResult>& results) {
+    for (const ServoResult& result : results) {
+        if (result) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 部分成功时附加每个舵机的结果：{"valid":[true,false],"result":["ok","timeout"]}
+void addPartialResults(JsonDocument& response, const std::vector<ServoResult>& results) {
+    JsonArray validArray = response["valid"].to<JsonArray>();
+    JsonArray resultArray = response["result"].to<JsonArray>();
+    for (const ServoResult& result : results) {
+        validArray.add(static_cast<bool>(result));
+        resultArray.add(result.name());
+    }
+}
+
 JsonDocument validateParameters(const JsonDocument& request) {
     JsonDocument response;
     
@@ -1029,6 +2032,24 @@ JsonDocument validateParameters(const JsonDocument& request) {
         }
     }
     
+    // 验证fresh参数
+    if (!request["fresh"].isNull()) {
+        if (!request["fresh"].is<bool>()) {
+            response["error"] = 2;
+            response["msg"] = "Datatype check for parameter failed: fresh must be a boolean";
+            return response;
+        }
+    }
+    
+    // 验证noack参数
+    if (!request["noack"].isNull()) {
+        if (!request["noack"].is<bool>()) {
+            response["error"] = 2;
+            response["msg"] = "Datatype check for parameter failed: noack must be a boolean";
+            return response;
+        }
+    }
+    
     // 验证mem_addr参数
     if (!request["mem_addr"].isNull()) {
         if (!isValidUint8(request["mem_addr"])) {
@@ -0,0 +1,249 @@
+#ifndef STServo_PROTOCOL_H
+#define STServo_PROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 协议帧常量（不依赖Arduino，可在主机上编译）
+namespace STProtocol {
+    const uint8_t HEADER          = 0xFF;
+    const uint8_t BROADCAST_ID    = 0xFE;
+    // header(2) + ID(1) + length(1) + instruction/error(1) + checksum(1)
+    const size_t  FRAME_OVERHEAD  = 6;
+    // length字节最大为255，其中包含instruction/error和checksum
+    const size_t  MAX_PARAMS      = 253;
+    const size_t  MAX_PACKET_SIZE = FRAME_OVERHEAD + MAX_PARAMS;
+}
+
+// 数据包编码器：直接写入调用者提供的缓冲区，不使用堆内存
+// 用法：begin() -> put()... -> finish()，校验和在put()时累加
+class PacketEncoder {
+    public:
+        PacketEncoder(uint8_t* buf, size_t capacity)
+            : _buf(buf), _capacity(capacity), _size(0), _sum(0), _overflow(false) {}
+
+        void begin(uint8_t dev_id, uint8_t instruction) {
+            _size     = 0;
+            _sum      = 0;
+            _overflow = (_capacity < STProtocol::FRAME_OVERHEAD);
+            if (_overflow) {
+                return;
+            }
+            _buf[0] = STProtocol::HEADER;
+            _buf[1] = STProtocol::HEADER;
+            _buf[2] = dev_id;
+            _buf[3] = 0;            // 长度在finish()中回填
+            _buf[4] = instruction;
+            _size   = 5;
+            _sum    = dev_id + instruction;
+        }
+
+        bool put(uint8_t byte) {
+            // 预留1字节给校验和
+            if (_overflow || _size + 1 >= _capacity || _size - 5 >= STProtocol::MAX_PARAMS) {
+                _overflow = true;
+                return false;
+            }
+            _buf[_size++] = byte;
+            _sum += byte;
+            return true;
+        }
+
+        bool put(const uint8_t* data, size_t len) {
+            for (size_t i = 0; i < len; i++) {
+                if (!put(data[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // 小端序写入16位数值
+        bool put16(uint16_t value) {
+            return put(value & 0xFF) && put((value >> 8) & 0xFF);
+        }
+
+        // 回填长度并追加校验和，返回整帧字节数；溢出时返回0
+        size_t finish() {
+            if (_overflow) {
+                return 0;
+            }
+            uint8_t length = _size - 3;   // params + instruction + checksum
+            _buf[3] = length;
+            _sum += length;
+            _buf[_size++] = ~_sum;
+            return _size;
+        }
+
+        const uint8_t* data()     const { return _buf; }
+        size_t         size()     const { return _size; }
+        bool           overflow() const { return _overflow; }
+
+    private:
+        uint8_t* _buf;
+        size_t   _capacity;
+        size_t   _size;
+        uint8_t  _sum;
+        bool     _overflow;
+};
+
+// 一次性编码完整数据包，返回整帧字节数；缓冲区不足时返回0
+inline size_t encode_packet(uint8_t* buf, size_t capacity, uint8_t dev_id, uint8_t instruction,
+                            const uint8_t* params_tx, size_t params_len) {
+    PacketEncoder encoder(buf, capacity);
+    encoder.begin(dev_id, instruction);
+    encoder.put(params_tx, params_len);
+    return encoder.finish();
+}
+
+// 帧解析结果
+enum ParseResult {
+    PARSE_NEED_MORE      = 0,  // 帧未完整，需要更多字节
+    PARSE_FRAME_OK       = 1,  // 收到完整且校验通过的帧
+    PARSE_CHECKSUM_ERROR = 2   // 校验和错误
+};
+
+// 增量式应答帧解析器（状态机）
+// 按块送入任意数量的字节，解析到完整帧或出错时立即停止，剩余字节留给下一帧
+// 应答帧格式: header(2) + ID(1) + length(1) + error(1) + params(length-2) + checksum(1)
+// 包头不匹配或长度字节非法时自动向后扫描下一个0xFF 0xFF，被跳过的字节计入skipped()
+class FrameParser {
+    public:
+        FrameParser() : _expectedId(0), _expectedLength(0) { reset(); }
+
+        void reset() {
+            _state        = STATE_HEADER1;
+            _id           = 0;
+            _length       = 0;
+            _error        = 0;
+            _paramsCount  = 0;
+            _sum          = 0;
+            _skipped      = 0;
+            _resyncs      = 0;
+            _lengthErrors = 0;
+        }
+
+        // 设置期望的应答：该ID的帧长度字节必须等于params_len + 2，否则视为损坏并重新同步
+        // dev_id为BROADCAST_ID时对所有ID校验（sync_read），params_len < 0 表示不校验长度
+        void expect(uint8_t dev_id, int params_len) {
+            _expectedId     = dev_id;
+            _expectedLength = (params_len < 0) ? 0 : params_len + 2;
+        }
+
+        // 返回本次消耗的字节数，result为解析状态；返回FRAME_OK或错误后需reset()再解析下一帧
+        size_t feed(const uint8_t* data, size_t len, ParseResult& result) {
+            result = PARSE_NEED_MORE;
+            size_t i = 0;
+            while (i < len) {
+                uint8_t byte = data[i++];
+                switch (_state) {
+                    case STATE_HEADER1:
+                        if (byte == STProtocol::HEADER) {
+                            _state = STATE_HEADER2;
+                        } else {
+                            _skipped++;
+                        }
+                        break;
+                    case STATE_HEADER2:
+                        if (byte == STProtocol::HEADER) {
+                            _state = STATE_ID;
+                        } else {
+                            resync(2);
+                        }
+                        break;
+                    case STATE_ID:
+                        if (byte == STProtocol::HEADER) {
+                            _skipped++;     // 多余的0xFF，ID不可能为0xFF
+                            break;
+                        }
+                        _id     = byte;
+                        _sum    = byte;
+                        _state  = STATE_LENGTH;
+                        break;
+                    case STATE_LENGTH:
+                        if (byte < 2 || byte > STProtocol::MAX_PARAMS + 2 ||
+                            (_expectedLength != 0 && byte != _expectedLength &&
+                             (_id == _expectedId || _expectedId == STProtocol::BROADCAST_ID))) {
+                            _lengthErrors++;
+                            resync(4);
+                            if (byte == STProtocol::HEADER) {
+                                _skipped--;             // 该字节可能是下一帧的包头
+                                _state = STATE_HEADER2;
+                            }
+                            break;
+                        }
+                        _length = byte;
+                        _sum   += byte;
+                        _state  = STATE_ERROR;
+                        break;
+                    case STATE_ERROR:
+                        _error  = byte;
+                        _sum   += byte;
+                        _state  = (paramsLength() > 0) ? STATE_PARAMS : STATE_CHECKSUM;
+                        break;
+                    case STATE_PARAMS:
+                        _params[_paramsCount++] = byte;
+                        _sum += byte;
+                        if (_paramsCount >= paramsLength()) {
+                            _state = STATE_CHECKSUM;
+                        }
+                        break;
+                    case STATE_CHECKSUM:
+                        _state = STATE_DONE;
+                        result = (static_cast<uint8_t>(~_sum) == byte) ? PARSE_FRAME_OK : PARSE_CHECKSUM_ERROR;
+                        return i;
+                    case STATE_DONE:
+                        result = PARSE_FRAME_OK;
+                        return i - 1;
+                }
+            }
+            return i;
+        }
+
+        uint8_t        id()           const { return _id; }
+        size_t         frameSize()    const { return paramsLength() + STProtocol::FRAME_OVERHEAD; }
+        uint8_t        length()       const { return _length; }
+        uint8_t        error()        const { return _error; }
+        const uint8_t* params()       const { return _params; }
+        size_t         paramsLength() const { return _length >= 2 ? _length - 2 : 0; }
+
+        // 自上次reset()以来的统计
+        uint32_t       skipped()      const { return _skipped; }
+        uint32_t       resyncs()      const { return _resyncs; }
+        uint32_t       lengthErrors() const { return _lengthErrors; }
+
+    private:
+        enum State {
+            STATE_HEADER1,
+            STATE_HEADER2,
+            STATE_ID,
+            STATE_LENGTH,
+            STATE_ERROR,
+            STATE_PARAMS,
+            STATE_CHECKSUM,
+            STATE_DONE
+        };
+
+        State   _state;
+        uint8_t _id;
+        uint8_t _length;
+        uint8_t _error;
+        uint8_t _params[STProtocol::MAX_PARAMS + 2];
+        size_t  _paramsCount;
+        uint8_t _sum;
+        uint8_t _expectedId;
+        uint8_t _expectedLength;
+
+        uint32_t _skipped;
+        uint32_t _resyncs;
+        uint32_t _lengthErrors;
+
+        // 丢弃已读入的count字节并回到包头扫描状态
+        void resync(uint32_t count) {
+            _skipped += count;
+            _resyncs++;
+            _state    = STATE_HEADER1;
+        }
+};
+
+#endif // STServo_PROTOCOL_H
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include "read_plan.h"
+
+ReadPlan::ReadPlan() {
+    clear();
+}
+
+// 按地址有序插入，重复或重叠的字段合并
+ReadPlan& ReadPlan::add(uint8_t address, uint8_t width) {
+    size_t i = 0;
+    while (i < _fieldCount && _fields[i].address < address) {
+        i++;
+    }
+    if (i < _fieldCount && _fields[i].address == address) {
+        if (width > _fields[i].width) {
+            _fields[i].width = width;
+        }
+    } else if (_fieldCount < MAX_FIELDS) {
+        for (size_t j = _fieldCount; j > i; j--) {
+            _fields[j] = _fields[j - 1];
+        }
+        _fields[i].address = address;
+        _fields[i].width   = width;
+        _fieldCount++;
+    }
+    _planned = false;
+    return *this;
+}
+
+void ReadPlan::clear() {
+    _fieldCount = 0;
+    _spanCount  = 0;
+    _base       = 0;
+    _stride     = 0;
+    _servoCount = 0;
+    _planned    = false;
+    _data.clear();
+    _valid.clear();
+}
+
+void ReadPlan::set_valid(size_t servo, bool valid) {
+    if (servo >= _servoCount) {
+        return;
+    }
+    _valid[servo] = valid;
+    if (!valid) {
+        // 不保留上一次读取的值
+        std::fill(_data.begin() + servo * _stride, _data.begin() + (servo + 1) * _stride, 0);
+    }
+}
+
+bool ReadPlan::covered(uint8_t address, uint8_t width) const {
+    for (size_t i = 0; i < _spanCount; i++) {
+        if (address >= _spans[i].address && address + width <= _spans[i].address + _spans[i].length) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t ReadPlan::transaction_cost_bytes(uint32_t baudrate, uint32_t return_delay_us, size_t servo_count) {
+    // 应答延时折算为字节时间（8N1每字节10位）
+    uint32_t delay_bytes   = static_cast<uint32_t>((static_cast<uint64_t>(return_delay_us) * baudrate + 9999999) / 10000000);
+    uint32_t request_bytes = STProtocol::FRAME_OVERHEAD + 2 + (servo_count > 1 ? servo_count : 0);
+    return request_bytes + servo_count * (STProtocol::FRAME_OVERHEAD + delay_bytes);
+}
+
+uint32_t ReadPlan::wire_bytes(uint32_t baudrate, uint32_t return_delay_us) const {
+    size_t   servos = _servoCount ? _servoCount : 1;
+    uint32_t bytes  = 0;
+    for (size_t i = 0; i < _spanCount; i++) {
+        bytes += transaction_cost_bytes(baudrate, return_delay_us, servos) + servos * _spans[i].length;
+    }
+    return bytes;
+}
+
+// 相邻字段的合并互不影响：合并增加 间隙 * 舵机数 字节，省去一次事务，逐个间隙比较即为最优
+size_t ReadPlan::prepare(uint32_t baudrate, uint32_t return_delay_us, size_t servo_count) {
+    if (servo_count == 0) {
+        servo_count = 1;
+    }
+    if (_planned && _plannedBaudrate == baudrate && _plannedDelayUs == return_delay_us && _plannedServos == servo_count) {
+        return _spanCount;
+    }
+
+    uint32_t cost = transaction_cost_bytes(baudrate, return_delay_us, servo_count);
+    _spanCount = 0;
+    for (size_t i = 0; i < _fieldCount; i++) {
+        size_t start = _fields[i].address;
+        size_t end   = start + _fields[i].width;
+        if (_spanCount > 0) {
+            ReadSpan& last     = _spans[_spanCount - 1];
+            size_t    last_end = last.address + last.length;
+            size_t    gap      = (start > last_end) ? start - last_end : 0;
+            if (gap * servo_count <= cost && end - last.address <= STProtocol::MAX_PARAMS) {
+                if (end > last_end) {
+                    last.length = end - last.address;
+                }
+                continue;
+            }
+        }
+        _spans[_spanCount].address = start;
+        _spans[_spanCount].length  = end - start;
+        _spanCount++;
+    }
+
+    _base       = _spanCount ? _spans[0].address : 0;
+    _stride     = _spanCount ? _spans[_spanCount - 1].address + _spans[_spanCount - 1].length - _base : 0;
+    _servoCount = servo_count;
+    _data.assign(_servoCount * _stride, 0);
+    _valid.assign(_servoCount, false);
+
+    _planned         = true;
+    _plannedBaudrate = baudrate;
+    _plannedDelayUs  = return_delay_us;
+    _plannedServos   = servo_count;
+    return _spanCount;
+}
@@ -0,0 +1,90 @@
+#ifndef STServo_READ_PLAN_H
+#define STServo_READ_PLAN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "protocol.h"
+
+// 一次READ/SYNC_READ读取的连续地址区间
+struct ReadSpan {
+    uint8_t address;
+    uint8_t length;
+};
+
+// 寄存器读取计划：把需要的寄存器合并成最少的连续区间，读取后按寄存器描述符取出字段
+// 用法：plan.add<STSRegisters::PRESENT_POSITION>().add<STSRegisters::PRESENT_TEMPERATURE>();
+//       servo.sync_read(ids, plan, result_vec);  plan.get<STSRegisters::PRESENT_POSITION>(i);
+// 两个字段之间的间隙字节数 * 舵机数 不超过一次额外事务的线上字节数时合并为一个区间
+class ReadPlan {
+    public:
+        static const size_t MAX_FIELDS = 32;
+
+        ReadPlan();
+
+        template<typename Reg>
+        ReadPlan& add() {
+            return add(Reg::ADDRESS, Reg::WIDTH);
+        }
+        ReadPlan& add(uint8_t address, uint8_t width);
+        void      clear();
+
+        // 按总线参数生成区间；参数与上次相同时不重新计算。返回区间数
+        size_t prepare(uint32_t baudrate, uint32_t return_delay_us, size_t servo_count);
+
+        // 一次额外READ（servo_count为1）或SYNC_READ事务的线上字节数（请求 + 每个应答的帧开销和应答延时）
+        static uint32_t transaction_cost_bytes(uint32_t baudrate, uint32_t return_delay_us, size_t servo_count);
+        // 执行当前计划的线上字节数估算
+        uint32_t        wire_bytes(uint32_t baudrate, uint32_t return_delay_us) const;
+
+        size_t          span_count()          const { return _spanCount; }
+        const ReadSpan& span(size_t index)    const { return _spans[index]; }
+        size_t          servo_count()         const { return _servoCount; }
+
+        // 第servo个舵机第index个区间的数据缓冲区（由STServo写入）
+        uint8_t* span_data(size_t servo, size_t index) {
+            return &_data[servo * _stride + _spans[index].address - _base];
+        }
+        // 记录第servo个舵机本次读取的结果（由STServo调用），失败时清零该舵机的数据
+        void     set_valid(size_t servo, bool valid);
+        // 第servo个舵机的所有区间在最近一次读取中都读到了
+        bool     valid(size_t servo) const { return servo < _servoCount && _valid[servo]; }
+
+        // 按寄存器描述符取出字段；不在读取区间内的寄存器和本次读取失败的舵机返回0
+        template<typename Reg>
+        typename Reg::value_type get(size_t servo = 0) const {
+            if (servo >= _servoCount || !covered(Reg::ADDRESS, Reg::WIDTH)) {
+                return 0;
+            }
+            return Reg::decode(&_data[servo * _stride + Reg::ADDRESS - _base]);
+        }
+
+    private:
+        // [address, address + width)完整地落在某个区间内（区间之间的间隙不会被读取）
+        bool covered(uint8_t address, uint8_t width) const;
+
+        struct Field {
+            uint8_t address;
+            uint8_t width;
+        };
+
+        Field                _fields[MAX_FIELDS];
+        size_t               _fieldCount;
+        ReadSpan             _spans[MAX_FIELDS];
+        size_t               _spanCount;
+
+        // 结果：每个舵机一段[_base, _base + _stride)的内存映像
+        std::vector<uint8_t> _data;
+        std::vector<bool>    _valid;
+        uint8_t              _base;
+        size_t               _stride;
+        size_t               _servoCount;
+
+        // 上次prepare()的参数
+        bool                 _planned;
+        uint32_t             _plannedBaudrate;
+        uint32_t             _plannedDelayUs;
+        size_t               _plannedServos;
+};
+
+#endif // STServo_READ_PLAN_H
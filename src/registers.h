@@ -0,0 +1,93 @@
+#ifndef STServo_REGISTERS_H
+#define STServo_REGISTERS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <type_traits>
+
+// 寄存器所在区域
+enum RegisterArea {
+    AREA_EPROM = 0,  // 掉电保存，写入前需解锁EPROM_LOCK
+    AREA_SRAM  = 1
+};
+
+// 寄存器访问权限
+enum RegisterAccess {
+    ACCESS_RO = 0,
+    ACCESS_RW = 1
+};
+
+// 编译期寄存器描述符：地址、宽度（1或2字节，小端）、符号位、区域和访问权限
+// 舵机用"符号位+绝对值"表示负数，SignBit为符号位的位置，0表示无符号
+template<uint8_t Addr, uint8_t Width, uint8_t SignBit, RegisterArea Area, RegisterAccess Access>
+struct Register {
+    static_assert(Width == 1 || Width == 2, "register width must be 1 or 2 bytes");
+    static_assert(SignBit < Width * 8, "sign bit outside register");
+
+    enum {
+        ADDRESS  = Addr,
+        WIDTH    = Width,
+        SIGN_BIT = SignBit
+    };
+    static const RegisterArea   AREA   = Area;
+    static const RegisterAccess ACCESS = Access;
+
+    // 有符号寄存器解码为int16_t，无符号按宽度解码为uint8_t/uint16_t
+    typedef typename std::conditional<SignBit != 0, int16_t,
+            typename std::conditional<Width == 1, uint8_t, uint16_t>::type>::type value_type;
+
+    static value_type decode(const uint8_t* data) {
+        uint16_t raw = (Width == 1) ? data[0] : static_cast<uint16_t>(data[0] | (data[1] << 8));
+        if (SignBit != 0 && (raw & (1u << SignBit))) {
+            return static_cast<value_type>(-static_cast<int16_t>(raw & ((1u << SignBit) - 1)));
+        }
+        return static_cast<value_type>(raw);
+    }
+
+    static void encode(value_type value, uint8_t* data) {
+        uint16_t raw;
+        if (SignBit != 0 && static_cast<int32_t>(value) < 0) {
+            raw = static_cast<uint16_t>((-static_cast<int32_t>(value) & ((1u << SignBit) - 1)) | (1u << SignBit));
+        } else {
+            raw = static_cast<uint16_t>(value);
+        }
+        data[0] = raw & 0xFF;
+        if (Width == 2) {
+            data[1] = (raw >> 8) & 0xFF;
+        }
+    }
+};
+
+// STS/ST3215寄存器表
+namespace STSRegisters {
+    // EPROM (只读)
+    typedef Register<0x00, 1,  0, AREA_EPROM, ACCESS_RO> FIRMWARE_MAJOR;
+    typedef Register<0x01, 1,  0, AREA_EPROM, ACCESS_RO> FIRMWARE_MINOR;
+    typedef Register<0x03, 2,  0, AREA_EPROM, ACCESS_RO> SMS_STS_MODEL;
+    // EPROM (读写)
+    typedef Register<0x05, 1,  0, AREA_EPROM, ACCESS_RW> ID;
+    typedef Register<0x06, 1,  0, AREA_EPROM, ACCESS_RW> BAUD_RATE;
+    typedef Register<0x07, 1,  0, AREA_EPROM, ACCESS_RW> RETURN_DELAY;          // 单位2us
+    typedef Register<0x08, 1,  0, AREA_EPROM, ACCESS_RW> RESPONSE_LEVEL;        // 0时只应答PING和READ
+    typedef Register<0x1F, 2, 11, AREA_EPROM, ACCESS_RW> STEP_CORR;
+    typedef Register<0x21, 1,  0, AREA_EPROM, ACCESS_RW> MODE;
+    // SRAM (读写)
+    typedef Register<0x28, 1,  0, AREA_SRAM,  ACCESS_RW> TORQUE_SWITCH;
+    typedef Register<0x29, 1,  0, AREA_SRAM,  ACCESS_RW> ACC;
+    typedef Register<0x2A, 2, 15, AREA_SRAM,  ACCESS_RW> GOAL_POSITION;
+    typedef Register<0x2C, 2,  0, AREA_SRAM,  ACCESS_RW> GOAL_TIME;
+    typedef Register<0x2E, 2, 15, AREA_SRAM,  ACCESS_RW> GOAL_SPEED;
+    typedef Register<0x37, 1,  0, AREA_SRAM,  ACCESS_RW> EPROM_LOCK;
+    // SRAM (只读)
+    typedef Register<0x38, 2, 15, AREA_SRAM,  ACCESS_RO> PRESENT_POSITION;
+    typedef Register<0x3A, 2, 15, AREA_SRAM,  ACCESS_RO> PRESENT_SPEED;
+    typedef Register<0x3C, 2, 10, AREA_SRAM,  ACCESS_RO> PRESENT_LOAD;
+    typedef Register<0x3E, 1,  0, AREA_SRAM,  ACCESS_RO> PRESENT_VOLTAGE;
+    typedef Register<0x3F, 1,  0, AREA_SRAM,  ACCESS_RO> PRESENT_TEMPERATURE;
+    typedef Register<0x40, 1,  0, AREA_SRAM,  ACCESS_RO> ASYNC_ACTION;
+    typedef Register<0x41, 1,  0, AREA_SRAM,  ACCESS_RO> SERVO_STATUS;
+    typedef Register<0x42, 1,  0, AREA_SRAM,  ACCESS_RO> MOVING;
+    typedef Register<0x45, 2, 15, AREA_SRAM,  ACCESS_RO> PRESENT_CURRENT;
+}
+
+#endif // STServo_REGISTERS_H
@@ -0,0 +1,307 @@
+#include <string.h>
+#include <algorithm>
+#include <iterator>
+#include "servo_mirror.h"
+#include "core.h"
+
+// TORQUE_SWITCH和GOAL_POSITION会被舵机改写（过载保护、使能力矩时同步位置），EPROM区需要解锁，都不能顺带重写
+uint64_t ServoMirror::fillable_mask() {
+    using namespace STSRegisters;
+    uint64_t mask = 0;
+    mask |= 1ULL << ACC::ADDRESS;
+    mask |= 3ULL << GOAL_TIME::ADDRESS;
+    mask |= 3ULL << GOAL_SPEED::ADDRESS;
+    return mask;
+}
+
+ServoMirror::ServoMirror() {
+    for (size_t i = 0; i < STProtocol::BROADCAST_ID; i++) {
+        _entries[i] = NULL;
+    }
+    reset_counters();
+}
+
+ServoMirror::~ServoMirror() {
+    for (size_t i = 0; i < STProtocol::BROADCAST_ID; i++) {
+        delete _entries[i];
+    }
+}
+
+uint64_t ServoMirror::span_mask(uint8_t address, size_t length) {
+    return ((1ULL << length) - 1) << address;
+}
+
+ServoMirror::Entry* ServoMirror::entry(uint8_t dev_id) {
+    if (_entries[dev_id] == NULL) {
+        _entries[dev_id] = new Entry();
+    }
+    return _entries[dev_id];
+}
+
+bool ServoMirror::set_bytes(uint8_t dev_id, uint8_t mem_addr, const uint8_t* data, size_t len, bool force) {
+    if (dev_id >= STProtocol::BROADCAST_ID || len == 0 || mem_addr < FIRST || mem_addr + len > SIZE) {
+        return false;
+    }
+    Entry* e = entry(dev_id);
+    uint64_t mask = span_mask(mem_addr, len);
+
+    // 整个寄存器一起判断，避免只写出16位寄存器的一半
+    bool changed = force || (e->sentMask & mask) != mask || memcmp(e->sent + mem_addr, data, len) != 0;
+    memcpy(e->value + mem_addr, data, len);
+    e->known |= mask;
+    if (changed) {
+        e->dirty |= mask;
+    } else {
+        e->dirty &= ~mask;
+        _counters.skippedBytes += len;
+    }
+    return true;
+}
+
+bool ServoMirror::get_bytes(uint8_t dev_id, uint8_t mem_addr, uint8_t* data, size_t len) const {
+    if (dev_id >= STProtocol::BROADCAST_ID || len == 0 || mem_addr + len > SIZE || _entries[dev_id] == NULL) {
+        return false;
+    }
+    const Entry* e = _entries[dev_id];
+    uint64_t mask = span_mask(mem_addr, len);
+    if ((e->known & mask) != mask) {
+        return false;
+    }
+    memcpy(data, e->value + mem_addr, len);
+    return true;
+}
+
+void ServoMirror::note_write(uint8_t dev_id, uint8_t mem_addr, const uint8_t* data, size_t len) {
+    if (dev_id == STProtocol::BROADCAST_ID) {
+        // 广播写入只更新已有镜像的舵机
+        for (size_t i = 0; i < STProtocol::BROADCAST_ID; i++) {
+            if (_entries[i] != NULL) {
+                note_write(static_cast<uint8_t>(i), mem_addr, data, len);
+            }
+        }
+        return;
+    }
+    if (dev_id > STProtocol::BROADCAST_ID || mem_addr >= SIZE) {
+        return;
+    }
+    len = std::min(len, static_cast<size_t>(SIZE - mem_addr));
+    Entry* e = entry(dev_id);
+    uint64_t mask = span_mask(mem_addr, len);
+    memcpy(e->value + mem_addr, data, len);
+    memcpy(e->sent  + mem_addr, data, len);
+    e->known    |= mask;
+    e->sentMask |= mask;
+    e->dirty    &= ~mask;
+}
+
+void ServoMirror::invalidate(uint8_t dev_id, uint8_t mem_addr, size_t len) {
+    if (dev_id == STProtocol::BROADCAST_ID) {
+        for (size_t i = 0; i < STProtocol::BROADCAST_ID; i++) {
+            if (_entries[i] != NULL) {
+                invalidate(static_cast<uint8_t>(i), mem_addr, len);
+            }
+        }
+        return;
+    }
+    if (dev_id > STProtocol::BROADCAST_ID || mem_addr >= SIZE || _entries[dev_id] == NULL) {
+        return;
+    }
+    len = std::min(len, static_cast<size_t>(SIZE - mem_addr));
+    Entry* e = _entries[dev_id];
+    uint64_t mask = span_mask(mem_addr, len);
+    e->sentMask &= ~mask;
+    e->known    &= ~(mask & ~e->dirty);
+}
+
+// 写入失败：舵机上的值未知，不再记为已发送，也不保留为脏，
+// 否则以后每次flush()都会重发（舵机恢复后写入过时的目标位置）；下次set()相同的值时仍会写出
+void ServoMirror::drop(uint8_t dev_id, uint8_t mem_addr, size_t len) {
+    Entry* e = _entries[dev_id];
+    e->dirty &= ~span_mask(mem_addr, len);
+    invalidate(dev_id, mem_addr, len);
+}
+
+void ServoMirror::forget(uint8_t dev_id) {
+    if (dev_id < STProtocol::BROADCAST_ID) {
+        delete _entries[dev_id];
+        _entries[dev_id] = NULL;
+    }
+}
+
+void ServoMirror::forget() {
+    for (size_t i = 0; i < STProtocol::BROADCAST_ID; i++) {
+        forget(static_cast<uint8_t>(i));
+    }
+}
+
+bool ServoMirror::dirty() const {
+    for (size_t i = 0; i < STProtocol::BROADCAST_ID; i++) {
+        if (_entries[i] != NULL && _entries[i]->dirty != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t ServoMirror::dirty_bytes(uint8_t dev_id) const {
+    if (dev_id >= STProtocol::BROADCAST_ID || _entries[dev_id] == NULL) {
+        return 0;
+    }
+    size_t count = 0;
+    for (uint64_t bits = _entries[dev_id]->dirty; bits != 0; bits &= bits - 1) {
+        count++;
+    }
+    return count;
+}
+
+void ServoMirror::reset_counters() {
+    _counters.skippedBytes = 0;
+    _counters.flushedBytes = 0;
+    _counters.frames       = 0;
+}
+
+// 单个舵机用WRITE（请求 + 应答帧），多个舵机用SYNC_WRITE，超过单帧参数上限时分批
+uint32_t ServoMirror::group_cost(uint8_t length, size_t servo_count) {
+    if (servo_count == 1) {
+        return 2 * STProtocol::FRAME_OVERHEAD + 1 + length;
+    }
+    size_t per_frame = (STProtocol::MAX_PARAMS - 2) / (1 + length);
+    size_t frames    = (servo_count + per_frame - 1) / per_frame;
+    return frames * (STProtocol::FRAME_OVERHEAD + 2) + servo_count * (1 + length);
+}
+
+// 舵机能否写出[address, address + length)：脏字节之外的字节必须已知且可以安全重写
+bool ServoMirror::can_cover(uint8_t dev_id, uint8_t address, uint8_t length) const {
+    const Entry* e = _entries[dev_id];
+    uint64_t mask  = span_mask(address, length);
+    uint64_t extra = mask & ~e->dirty;
+    return (extra & ~(e->known & fillable_mask())) == 0;
+}
+
+bool ServoMirror::try_merge(const Group& a, const Group& b, Group& merged) const {
+    uint8_t first = std::min(a.address, b.address);
+    uint8_t last  = std::max(a.address + a.length, b.address + b.length);
+    merged.address = first;
+    merged.length  = last - first;
+    merged.ids.clear();
+    std::set_union(a.ids.begin(), a.ids.end(), b.ids.begin(), b.ids.end(), std::back_inserter(merged.ids));
+    for (size_t i = 0; i < merged.ids.size(); i++) {
+        if (!can_cover(merged.ids[i], merged.address, merged.length)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ServoResult ServoMirror::flush(STServo& servo) {
+    // 每个舵机的连续脏字节为一个区间，区间相同的舵机归为一组
+    std::vector<Group> groups;
+    for (size_t id = 0; id < STProtocol::BROADCAST_ID; id++) {
+        const Entry* e = _entries[id];
+        if (e == NULL || e->dirty == 0) {
+            continue;
+        }
+        uint8_t addr = FIRST;
+        while (addr < SIZE) {
+            if (!(e->dirty & (1ULL << addr))) {
+                addr++;
+                continue;
+            }
+            uint8_t start = addr;
+            while (addr < SIZE && (e->dirty & (1ULL << addr))) {
+                addr++;
+            }
+            size_t g = 0;
+            while (g < groups.size() && (groups[g].address != start || groups[g].length != addr - start)) {
+                g++;
+            }
+            if (g == groups.size()) {
+                Group group;
+                group.address = start;
+                group.length  = addr - start;
+                groups.push_back(group);
+            }
+            groups[g].ids.push_back(static_cast<uint8_t>(id));
+        }
+    }
+
+    // 贪心合并：每次合并节省线上字节最多的一对（节省为0时也合并，减少帧数）
+    Group merged;
+    for (;;) {
+        int    best_saving = -1;
+        size_t best_i = 0, best_j = 0;
+        Group  best;
+        for (size_t i = 0; i < groups.size(); i++) {
+            for (size_t j = i + 1; j < groups.size(); j++) {
+                if (!try_merge(groups[i], groups[j], merged)) {
+                    continue;
+                }
+                int saving = static_cast<int>(group_cost(groups[i].length, groups[i].ids.size()) +
+                                              group_cost(groups[j].length, groups[j].ids.size())) -
+                             static_cast<int>(group_cost(merged.length, merged.ids.size()));
+                if (saving > best_saving) {
+                    best_saving = saving;
+                    best_i = i;
+                    best_j = j;
+                    best   = merged;
+                }
+            }
+        }
+        if (best_saving < 0) {
+            break;
+        }
+        groups[best_i] = best;
+        groups.erase(groups.begin() + best_j);
+    }
+
+    ServoResult first_failure(SERVO_OK);
+    for (size_t g = 0; g < groups.size(); g++) {
+        const Group& group = groups[g];
+
+        if (group.ids.size() == 1) {
+            uint8_t id = group.ids[0];
+            const Entry* e = _entries[id];
+            std::vector<uint8_t> data(e->value + group.address, e->value + group.address + group.length);
+            uint8_t error = 0;
+            std::vector<uint8_t> params_rx;
+            ServoResult result = servo.write_data(id, group.address, data, error, params_rx);
+            if (result) {
+                note_write(id, group.address, data.data(), data.size());
+            } else {
+                drop(id, group.address, group.length);
+                if (first_failure) {
+                    first_failure = result;
+                }
+            }
+            _counters.frames++;
+            _counters.flushedBytes += group.length;
+            continue;
+        }
+
+        size_t per_frame = (STProtocol::MAX_PARAMS - 2) / (1 + group.length);
+        for (size_t first = 0; first < group.ids.size(); first += per_frame) {
+            size_t last = std::min(first + per_frame, group.ids.size());
+            std::vector<uint8_t> ids(group.ids.begin() + first, group.ids.begin() + last);
+            std::vector<std::vector<uint8_t>> data;
+            for (size_t i = 0; i < ids.size(); i++) {
+                const Entry* e = _entries[ids[i]];
+                data.push_back(std::vector<uint8_t>(e->value + group.address, e->value + group.address + group.length));
+            }
+            // SYNC_WRITE没有应答，发出即视为已写入
+            ServoResult result = servo.sync_write(ids, group.address, data);
+            for (size_t i = 0; i < ids.size(); i++) {
+                if (result) {
+                    note_write(ids[i], group.address, data[i].data(), data[i].size());
+                } else {
+                    drop(ids[i], group.address, group.length);
+                }
+            }
+            if (!result && first_failure) {
+                first_failure = result;
+            }
+            _counters.frames++;
+            _counters.flushedBytes += ids.size() * group.length;
+        }
+    }
+    return first_failure;
+}
@@ -0,0 +1,102 @@
+#ifndef STServo_SERVO_MIRROR_H
+#define STServo_SERVO_MIRROR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "protocol.h"
+#include "registers.h"
+
+class STServo;
+struct ServoResult;
+
+// 写回镜像统计
+struct MirrorCounters {
+    uint32_t skippedBytes;   // 与上次发送相同而跳过的字节
+    uint32_t flushedBytes;   // flush()发送的数据字节（不含帧开销）
+    uint32_t frames;         // flush()发送的WRITE/SYNC_WRITE帧数
+};
+
+// 舵机可写控制表（ID到EPROM_LOCK）的本地镜像，按字节记录脏位
+// set<Reg>()只修改镜像，值与上次发送的相同时不标记为脏；flush()把脏字节合并成最少的帧发出：
+// 脏区间相同的舵机合并为一条SYNC_WRITE，单个舵机用带应答的WRITE，合并后线上字节更少时区间会跨过间隙
+// 舵机掉电后SRAM恢复默认值，镜像不再可信，需要调用forget()
+class ServoMirror {
+    public:
+        static const uint8_t FIRST = STSRegisters::ID::ADDRESS;
+        static const uint8_t SIZE  = STSRegisters::EPROM_LOCK::ADDRESS + 1;
+
+        ServoMirror();
+        ~ServoMirror();
+
+        // 暂存寄存器值；force为true时即使与上次发送的相同也会写出（例如GOAL_POSITION）
+        template<typename Reg>
+        void set(uint8_t dev_id, typename Reg::value_type value, bool force = false) {
+            static_assert(Reg::ACCESS == ACCESS_RW, "register is read-only");
+            uint8_t data[Reg::WIDTH];
+            Reg::encode(value, data);
+            set_bytes(dev_id, Reg::ADDRESS, data, Reg::WIDTH, force);
+        }
+
+        // 镜像中的值（暂存或已发送）；未知时返回false
+        template<typename Reg>
+        bool get(uint8_t dev_id, typename Reg::value_type& value) const {
+            uint8_t data[Reg::WIDTH];
+            if (!get_bytes(dev_id, Reg::ADDRESS, data, Reg::WIDTH)) {
+                return false;
+            }
+            value = Reg::decode(data);
+            return true;
+        }
+
+        bool set_bytes(uint8_t dev_id, uint8_t mem_addr, const uint8_t* data, size_t len, bool force = false);
+        bool get_bytes(uint8_t dev_id, uint8_t mem_addr, uint8_t* data, size_t len) const;
+
+        // 已发到总线上的写入（包括不经过镜像的写入），更新"上次发送"的值并清除对应脏位
+        void note_write(uint8_t dev_id, uint8_t mem_addr, const uint8_t* data, size_t len);
+        // 舵机上的值未知（写入失败等）：清除"上次发送"的记录，暂存中的脏字节保留
+        void invalidate(uint8_t dev_id, uint8_t mem_addr, size_t len);
+        // 丢弃舵机的全部镜像（掉电、更换舵机等）
+        void forget(uint8_t dev_id);
+        void forget();
+
+        // 可以顺带重写的字节（第n位对应地址n）：只由主机写入、舵机不会自行修改的寄存器
+        static uint64_t fillable_mask();
+
+        bool   dirty() const;
+        size_t dirty_bytes(uint8_t dev_id) const;
+
+        // 发送所有脏字节，返回第一个失败的结果；失败的区间不再记为已发送，也不保留为脏
+        ServoResult flush(STServo& servo);
+
+        const MirrorCounters& counters() const { return _counters; }
+        void                  reset_counters();
+
+    private:
+        struct Entry {
+            uint8_t  value[SIZE];   // 最新值（暂存或已发送）
+            uint8_t  sent[SIZE];    // 上次发送的值
+            uint64_t known;         // value有效
+            uint64_t sentMask;      // sent有效
+            uint64_t dirty;         // 待发送
+        };
+
+        // 一帧要写的区间和舵机
+        struct Group {
+            uint8_t              address;
+            uint8_t              length;
+            std::vector<uint8_t> ids;
+        };
+
+        Entry*         entry(uint8_t dev_id);
+        void           drop(uint8_t dev_id, uint8_t mem_addr, size_t len);
+        bool           can_cover(uint8_t dev_id, uint8_t address, uint8_t length) const;
+        bool           try_merge(const Group& a, const Group& b, Group& merged) const;
+        static uint32_t group_cost(uint8_t length, size_t servo_count);
+        static uint64_t span_mask(uint8_t address, size_t length);
+
+        Entry*         _entries[STProtocol::BROADCAST_ID];  // 按ID懒分配
+        MirrorCounters _counters;
+};
+
+#endif // STServo_SERVO_MIRROR_H
@@ -0,0 +1,231 @@
+#include "servo_router.h"
+
+ServoRouter::ServoRouter(ServoBusGroup& group) : _group(group), _busCount(0) {
+}
+
+uint8_t ServoRouter::add_bus(ST3215& servo) {
+    uint8_t index = _group.add_bus(servo);
+    if (index != ServoBusGroup::NO_BUS) {
+        _servos[index] = &servo;
+        _busCount = index + 1;
+    }
+    return index;
+}
+
+ST3215& ServoRouter::bus_for(uint8_t dev_id) {
+    uint8_t index = _group.route(dev_id);
+    return *_servos[(index == ServoBusGroup::NO_BUS || index >= _busCount) ? 0 : index];
+}
+
+size_t ServoRouter::split(const std::vector<uint8_t>& dev_id_vec) {
+    for (size_t b = 0; b < _busCount; b++) {
+        _ids[b].clear();
+        _index[b].clear();
+    }
+    size_t used = 0;
+    for (size_t i = 0; i < dev_id_vec.size(); i++) {
+        uint8_t b = _group.route(dev_id_vec[i]);
+        if (b == ServoBusGroup::NO_BUS || b >= _busCount) {
+            b = 0;
+        }
+        used += _ids[b].empty() ? 1 : 0;
+        _ids[b].push_back(dev_id_vec[i]);
+        _index[b].push_back(i);
+    }
+    return used;
+}
+
+ServoResult ServoRouter::first_failure(const std::vector<ServoResult>& result_vec) {
+    for (size_t i = 0; i < result_vec.size(); i++) {
+        if (!result_vec[i]) {
+            return result_vec[i];
+        }
+    }
+    return ServoResult(SERVO_OK);
+}
+
+ServoResult ServoRouter::setAcceleration(const std::vector<uint8_t>& dev_id_vec, const std::vector<uint8_t>& acc_vec) {
+    if (_busCount == 0 || dev_id_vec.size() != acc_vec.size()) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    split(dev_id_vec);
+    ServoResult failure(SERVO_OK);
+    std::vector<uint8_t> acc;
+    for (size_t b = 0; b < _busCount; b++) {
+        if (_ids[b].empty()) {
+            continue;
+        }
+        select(b, acc_vec, acc);
+        ServoResult result = _servos[b]->setAcceleration(_ids[b], acc);
+        if (!result && failure) {
+            failure = result;
+        }
+    }
+    return failure;
+}
+
+// 缓存命中的舵机不上总线，未命中的舵机在所有总线上同时读取
+ServoResult ServoRouter::getAcceleration(const std::vector<uint8_t>& dev_id_vec, std::vector<uint8_t>& acc_vec,
+                                         std::vector<ServoResult>& result_vec, bool fresh) {
+    acc_vec.assign(dev_id_vec.size(), 0);
+    result_vec.assign(dev_id_vec.size(), ServoResult(SERVO_ERR_PARAM));
+    if (_busCount == 0 || dev_id_vec.empty()) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    std::vector<uint8_t> miss_ids;
+    std::vector<size_t>  miss_index;
+    for (size_t i = 0; i < dev_id_vec.size(); i++) {
+        if (bus_for(dev_id_vec[i]).lookupCache(dev_id_vec[i], STSRegisters::ACC::ADDRESS, &acc_vec[i], 1, fresh)) {
+            result_vec[i] = ServoResult(SERVO_OK);
+        } else {
+            miss_ids.push_back(dev_id_vec[i]);
+            miss_index.push_back(i);
+        }
+    }
+    if (miss_ids.empty()) {
+        return ServoResult(SERVO_OK);
+    }
+    std::vector<std::vector<uint8_t>> raw;
+    std::vector<ServoResult>          results;
+    _group.sync_read(miss_ids, STSRegisters::ACC::ADDRESS, STSRegisters::ACC::WIDTH, raw, results);
+    for (size_t i = 0; i < miss_ids.size(); i++) {
+        result_vec[miss_index[i]] = results[i];
+        if (results[i]) {
+            acc_vec[miss_index[i]] = raw[i][0];
+            bus_for(miss_ids[i]).seedCache(miss_ids[i], STSRegisters::ACC::ADDRESS, raw[i].data(), 1);
+        }
+    }
+    return first_failure(result_vec);
+}
+
+ServoResult ServoRouter::setPosition(const std::vector<uint8_t>& dev_id_vec, const std::vector<uint16_t>& posi_vec,
+                                     const std::vector<uint16_t>& velo_vec) {
+    if (_busCount == 0 || dev_id_vec.size() != posi_vec.size() || dev_id_vec.size() != velo_vec.size()) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    split(dev_id_vec);
+    ServoResult failure(SERVO_OK);
+    std::vector<uint16_t> posi, velo;
+    for (size_t b = 0; b < _busCount; b++) {
+        if (_ids[b].empty()) {
+            continue;
+        }
+        select(b, posi_vec, posi);
+        select(b, velo_vec, velo);
+        ServoResult result = _servos[b]->setPosition(_ids[b], posi, velo);
+        if (!result && failure) {
+            failure = result;
+        }
+    }
+    return failure;
+}
+
+// 读取经ServoBusGroup::sync_read()在所有总线上同时进行，全部应答到达后再解码
+ServoResult ServoRouter::getPosition(const std::vector<uint8_t>& dev_id_vec, std::vector<int16_t>& posi_vec,
+                                     std::vector<int16_t>& velo_vec, std::vector<ServoResult>& result_vec) {
+    using namespace STSRegisters;
+    posi_vec.assign(dev_id_vec.size(), 0);
+    velo_vec.assign(dev_id_vec.size(), 0);
+    result_vec.assign(dev_id_vec.size(), ServoResult(SERVO_ERR_PARAM));
+    if (_busCount == 0 || dev_id_vec.empty()) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    std::vector<std::vector<uint8_t>> raw;
+    _group.sync_read(dev_id_vec, PRESENT_POSITION::ADDRESS, PRESENT_POSITION::WIDTH + PRESENT_SPEED::WIDTH, raw, result_vec);
+    for (size_t i = 0; i < dev_id_vec.size(); i++) {
+        if (result_vec[i]) {
+            posi_vec[i] = PRESENT_POSITION::decode(raw[i].data());
+            velo_vec[i] = PRESENT_SPEED::decode(raw[i].data() + PRESENT_POSITION::WIDTH);
+        }
+    }
+    return first_failure(result_vec);
+}
+
+ServoResult ServoRouter::getStatus(const std::vector<uint8_t>& dev_id_vec, std::vector<ServoStatus>& status_vec,
+                                   std::vector<ServoResult>& result_vec) {
+    ServoStatus empty = {};
+    status_vec.assign(dev_id_vec.size(), empty);
+    result_vec.assign(dev_id_vec.size(), ServoResult(SERVO_ERR_PARAM));
+    if (_busCount == 0 || dev_id_vec.empty()) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    std::vector<std::vector<uint8_t>> raw;
+    _group.sync_read(dev_id_vec, STSRegisters::PRESENT_POSITION::ADDRESS, ST3215::STATUS_LENGTH, raw, result_vec);
+    for (size_t i = 0; i < dev_id_vec.size(); i++) {
+        if (result_vec[i]) {
+            ST3215::decodeStatus(raw[i].data(), status_vec[i]);
+        }
+    }
+    return first_failure(result_vec);
+}
+
+ServoResult ServoRouter::moveTimed(const std::vector<uint8_t>& dev_id_vec, const std::vector<uint16_t>& posi_vec,
+                                   uint32_t duration_ms, std::vector<uint16_t>& velo_vec, uint32_t& actual_ms,
+                                   MoveTiming timing) {
+    velo_vec.assign(dev_id_vec.size(), 0);
+    actual_ms = duration_ms;
+    if (_busCount == 0 || dev_id_vec.empty() || dev_id_vec.size() != posi_vec.size()) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    size_t used = split(dev_id_vec);
+    std::vector<uint16_t> posi[ServoBusGroup::MAX_BUSES];
+    std::vector<uint16_t> velo[ServoBusGroup::MAX_BUSES];
+    for (size_t b = 0; b < _busCount; b++) {
+        select(b, posi_vec, posi[b]);
+    }
+
+    // 单条总线或只写GOAL_TIME时各总线互不影响
+    if (used <= 1 || timing == MOVE_BY_TIME) {
+        ServoResult failure(SERVO_OK);
+        for (size_t b = 0; b < _busCount; b++) {
+            if (_ids[b].empty()) {
+                continue;
+            }
+            uint32_t bus_ms = duration_ms;
+            ServoResult result = _servos[b]->moveTimed(_ids[b], posi[b], duration_ms, velo[b], bus_ms, timing);
+            scatter(b, velo[b], velo_vec);
+            actual_ms = (bus_ms > actual_ms) ? bus_ms : actual_ms;
+            if (!result && failure) {
+                failure = result;
+            }
+        }
+        return failure;
+    }
+
+    // 先规划所有总线，任何总线失败都不写入
+    uint32_t plan_ms[ServoBusGroup::MAX_BUSES];
+    for (size_t b = 0; b < _busCount; b++) {
+        if (_ids[b].empty()) {
+            continue;
+        }
+        ServoResult result = _servos[b]->planMove(_ids[b], posi[b], duration_ms, velo[b], plan_ms[b]);
+        if (!result) {
+            return result;
+        }
+        actual_ms = (plan_ms[b] > actual_ms) ? plan_ms[b] : actual_ms;
+    }
+    for (size_t b = 0; b < _busCount; b++) {
+        if (_ids[b].empty()) {
+            continue;
+        }
+        // 有总线需要延长时其他总线按相同时长重新计算速度
+        if (plan_ms[b] != actual_ms) {
+            ServoResult result = _servos[b]->planMove(_ids[b], posi[b], actual_ms, velo[b], plan_ms[b]);
+            if (!result) {
+                return result;
+            }
+        }
+    }
+    ServoResult failure(SERVO_OK);
+    for (size_t b = 0; b < _busCount; b++) {
+        if (_ids[b].empty()) {
+            continue;
+        }
+        ServoResult result = _servos[b]->setPosition(_ids[b], posi[b], velo[b]);
+        scatter(b, velo[b], velo_vec);
+        if (!result && failure) {
+            failure = result;
+        }
+    }
+    return failure;
+}
@@ -0,0 +1,71 @@
+#ifndef STServo_SERVO_ROUTER_H
+#define STServo_SERVO_ROUTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "st3215.h"
+#include "bus_group.h"
+
+// ST3215的多总线版本：按ServoBusGroup的路由把每个舵机的命令发到所在的总线
+// 多舵机写入按总线拆分，每条总线调用一次；多舵机读取先在所有总线上发出SYNC_READ再依次接收，各总线的应答同时在线上传输
+// 结果按dev_id_vec的顺序合并；只有一条总线上有舵机时等同于直接调用
+// 总线必须通过add_bus()加入，两者的总线编号保持一致
+class ServoRouter {
+    public:
+        explicit ServoRouter(ServoBusGroup& group);
+
+        // 同时加入ServoBusGroup，返回总线编号，超过MAX_BUSES时返回NO_BUS
+        uint8_t        add_bus(ST3215& servo);
+        size_t         bus_count() const { return _busCount; }
+        ST3215&        bus(size_t index) { return *_servos[index]; }
+        ST3215&        bus_for(uint8_t dev_id);  // 未分配时返回第0条总线
+        ServoBusGroup& group() { return _group; }
+        ServoClock&    clock() { return _servos[0]->clock(); }
+
+        // 与ST3215同名方法相同；setter返回按总线顺序的第一个失败，带result_vec的读取返回按dev_id_vec顺序的第一个失败
+        ServoResult setAcceleration(const std::vector<uint8_t>& dev_id_vec, const std::vector<uint8_t>& acc_vec);
+        ServoResult getAcceleration(const std::vector<uint8_t>& dev_id_vec, std::vector<uint8_t>& acc_vec,
+                                    std::vector<ServoResult>& result_vec, bool fresh = false);
+        ServoResult setPosition(const std::vector<uint8_t>& dev_id_vec, const std::vector<uint16_t>& posi_vec,
+                                const std::vector<uint16_t>& velo_vec);
+        ServoResult getPosition(const std::vector<uint8_t>& dev_id_vec, std::vector<int16_t>& posi_vec,
+                                std::vector<int16_t>& velo_vec, std::vector<ServoResult>& result_vec);
+        ServoResult getStatus(const std::vector<uint8_t>& dev_id_vec, std::vector<ServoStatus>& status_vec,
+                              std::vector<ServoResult>& result_vec);
+        // MOVE_BY_SPEED跨总线时先在每条总线上规划，取最长的时长重新规划，再各自写入，所有舵机仍同时到达
+        ServoResult moveTimed(const std::vector<uint8_t>& dev_id_vec, const std::vector<uint16_t>& posi_vec,
+                              uint32_t duration_ms, std::vector<uint16_t>& velo_vec, uint32_t& actual_ms,
+                              MoveTiming timing = MOVE_BY_SPEED);
+
+    private:
+        // 按总线拆分：ids[b]为第b条总线上的ID，index[b]为它们在原列表中的位置，返回有舵机的总线数
+        size_t split(const std::vector<uint8_t>& dev_id_vec);
+
+        // 取出第b条总线对应的元素
+        template<typename T>
+        void select(size_t b, const std::vector<T>& values, std::vector<T>& out) const {
+            out.clear();
+            for (size_t i = 0; i < _index[b].size(); i++) {
+                out.push_back(values[_index[b][i]]);
+            }
+        }
+
+        // 把第b条总线的结果放回原位置
+        template<typename T>
+        void scatter(size_t b, const std::vector<T>& values, std::vector<T>& out) const {
+            for (size_t i = 0; i < _index[b].size() && i < values.size(); i++) {
+                out[_index[b][i]] = values[i];
+            }
+        }
+
+        static ServoResult first_failure(const std::vector<ServoResult>& result_vec);
+
+        ServoBusGroup&       _group;
+        ST3215*              _servos[ServoBusGroup::MAX_BUSES];
+        size_t               _busCount;
+        std::vector<uint8_t> _ids[ServoBusGroup::MAX_BUSES];
+        std::vector<size_t>  _index[ServoBusGroup::MAX_BUSES];
+};
+
+#endif // STServo_SERVO_ROUTER_H
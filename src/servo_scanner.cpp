@@ -0,0 +1,146 @@
+#include <string.h>
+#include <algorithm>
+#include "servo_scanner.h"
+
+ServoScanner::ServoScanner()
+    : _first(0), _last(STProtocol::BROADCAST_ID - 1), _method(SCAN_SYNC_READ), _chunk(32), _transactions(0) {}
+
+void ServoScanner::set_range(uint8_t first, uint8_t last) {
+    _first = first;
+    _last  = std::min(last, static_cast<uint8_t>(STProtocol::BROADCAST_ID - 1));
+}
+
+// 每个ID在SYNC_READ请求中占1字节参数
+void ServoScanner::set_chunk(size_t chunk) {
+    _chunk = std::max(static_cast<size_t>(1), std::min(chunk, STProtocol::MAX_PARAMS - 2));
+}
+
+size_t ServoScanner::chunk_count() const {
+    if (_first > _last) {
+        return 0;
+    }
+    return (_last - _first + _chunk) / _chunk;
+}
+
+void ServoScanner::chunk_ids(size_t chunk_index, std::vector<uint8_t>& ids) const {
+    ids.clear();
+    size_t first = _first + chunk_index * _chunk;
+    for (size_t id = first; id < first + _chunk && id <= _last; id++) {
+        ids.push_back(static_cast<uint8_t>(id));
+    }
+}
+
+void ServoScanner::add_info(uint8_t dev_id, uint8_t bus_index, const uint8_t* data, std::vector<ServoInfo>& found) {
+    ServoInfo info;
+    info.id            = dev_id;
+    info.bus           = bus_index;
+    info.firmwareMajor = data[STSRegisters::FIRMWARE_MAJOR::ADDRESS];
+    info.firmwareMinor = data[STSRegisters::FIRMWARE_MINOR::ADDRESS];
+    info.model         = STSRegisters::SMS_STS_MODEL::decode(data + STSRegisters::SMS_STS_MODEL::ADDRESS);
+    memcpy(info.raw, data, PROBE_LENGTH);
+    found.push_back(info);
+}
+
+// 单独READ一个ID
+bool ServoScanner::probe(STServo& bus, uint8_t bus_index, uint8_t dev_id, std::vector<ServoInfo>& found) {
+    uint8_t error = 0;
+    std::vector<uint8_t> params_rx;
+    _transactions++;
+    ServoResult result = bus.read(dev_id, 0, PROBE_LENGTH, error, params_rx);
+    if (!result || params_rx.size() != PROBE_LENGTH) {
+        return false;
+    }
+    add_info(dev_id, bus_index, params_rx.data(), found);
+    return true;
+}
+
+// 超时的ID视为不存在；收到了但损坏的应答（校验和错误等）说明有舵机，单独重读一次
+void ServoScanner::collect(STServo& bus, uint8_t bus_index, const std::vector<uint8_t>& ids,
+                           std::vector<std::vector<uint8_t>>& params_rx_vec, std::vector<ServoResult>& result_vec,
+                           std::vector<ServoInfo>& found) {
+    for (size_t i = 0; i < ids.size(); i++) {
+        if (result_vec[i] && params_rx_vec[i].size() == PROBE_LENGTH) {
+            add_info(ids[i], bus_index, params_rx_vec[i].data(), found);
+        } else if (result_vec[i].code != SERVO_ERR_TIMEOUT) {
+            probe(bus, bus_index, ids[i], found);
+        }
+    }
+}
+
+static bool info_less(const ServoInfo& a, const ServoInfo& b) {
+    return (a.id != b.id) ? (a.id < b.id) : (a.bus < b.bus);
+}
+
+ServoResult ServoScanner::scan(STServo& bus, std::vector<ServoInfo>& found) {
+    found.clear();
+    _transactions = 0;
+
+    if (_method == SCAN_READ) {
+        for (size_t id = _first; id <= _last; id++) {
+            probe(bus, 0, static_cast<uint8_t>(id), found);
+        }
+        return ServoResult(SERVO_OK);
+    }
+
+    std::vector<uint8_t> ids;
+    std::vector<std::vector<uint8_t>> params_rx_vec;
+    std::vector<ServoResult> result_vec;
+    for (size_t c = 0; c < chunk_count(); c++) {
+        chunk_ids(c, ids);
+        _transactions++;
+        ServoResult result = bus.begin_sync_read(ids, 0, PROBE_LENGTH);
+        if (!result) {
+            return result;
+        }
+        bus.finish_sync_read(ids, PROBE_LENGTH, params_rx_vec, result_vec, false);
+        collect(bus, 0, ids, params_rx_vec, result_vec, found);
+    }
+    std::sort(found.begin(), found.end(), info_less);
+    return ServoResult(SERVO_OK);
+}
+
+ServoResult ServoScanner::scan(ServoBusGroup& group, std::vector<ServoInfo>& found) {
+    found.clear();
+    uint32_t transactions = 0;
+
+    if (_method == SCAN_READ) {
+        std::vector<ServoInfo> bus_found;
+        for (size_t b = 0; b < group.bus_count(); b++) {
+            scan(group.bus(b), bus_found);
+            transactions += _transactions;
+            for (size_t i = 0; i < bus_found.size(); i++) {
+                bus_found[i].bus = static_cast<uint8_t>(b);
+                found.push_back(bus_found[i]);
+            }
+        }
+        _transactions = transactions;
+    } else {
+        // 每个分段在所有总线上同时发出，再依次接收
+        _transactions = 0;
+        std::vector<uint8_t> ids;
+        std::vector<std::vector<uint8_t>> params_rx_vec;
+        std::vector<ServoResult> result_vec;
+        for (size_t c = 0; c < chunk_count(); c++) {
+            chunk_ids(c, ids);
+            bool sent[ServoBusGroup::MAX_BUSES];
+            for (size_t b = 0; b < group.bus_count(); b++) {
+                sent[b] = group.bus(b).begin_sync_read(ids, 0, PROBE_LENGTH);
+                _transactions++;
+            }
+            for (size_t b = 0; b < group.bus_count(); b++) {
+                if (!sent[b]) {
+                    return ServoResult(SERVO_ERR_PARAM);
+                }
+                group.bus(b).finish_sync_read(ids, PROBE_LENGTH, params_rx_vec, result_vec, false);
+                collect(group.bus(b), static_cast<uint8_t>(b), ids, params_rx_vec, result_vec, found);
+            }
+        }
+    }
+
+    std::sort(found.begin(), found.end(), info_less);
+    // 同一ID出现在多条总线上时路由到编号较小的总线
+    for (size_t i = found.size(); i-- > 0; ) {
+        group.assign(found[i].id, found[i].bus);
+    }
+    return ServoResult(SERVO_OK);
+}
@@ -0,0 +1,63 @@
+#ifndef STServo_SERVO_SCANNER_H
+#define STServo_SERVO_SCANNER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "core.h"
+#include "bus_group.h"
+
+// 扫描到的舵机
+struct ServoInfo {
+    uint8_t  id;
+    uint8_t  bus;             // ServoBusGroup中的总线编号，单总线扫描时为0
+    uint8_t  firmwareMajor;
+    uint8_t  firmwareMinor;
+    uint16_t model;
+    uint8_t  raw[5];          // 地址0起的原始数据，可用于填充EPROM缓存
+};
+
+// 扫描方式
+enum ScanMethod {
+    SCAN_SYNC_READ = 0,  // 每次SYNC_READ探测chunk个ID（STS系列）
+    SCAN_READ      = 1   // 逐个READ同样的5个字节（SCS等不支持SYNC_READ的舵机），每个ID一个事务
+};
+
+// 总线扫描：未应答的ID只占用一个应答的线上时间，截止时间由波特率和应答延时计算（需开启自适应超时）
+// 飞特舵机的广播PING会让所有舵机同时应答并冲突，因此不使用广播PING
+class ServoScanner {
+    public:
+        // SYNC_READ读取地址0起的5个字节：固件主/次版本和型号
+        static const uint8_t PROBE_LENGTH = 5;
+
+        ServoScanner();
+
+        void set_range(uint8_t first, uint8_t last);
+        void set_method(ScanMethod method) { _method = method; }
+        void set_chunk(size_t chunk);
+
+        // 返回SERVO_OK表示扫描完成（没有舵机也算完成），found按ID排序
+        ServoResult scan(STServo& bus, std::vector<ServoInfo>& found);
+        // 所有总线同时扫描，并记录每个舵机的路由
+        ServoResult scan(ServoBusGroup& group, std::vector<ServoInfo>& found);
+
+        // 上次扫描的事务数
+        uint32_t transactions() const { return _transactions; }
+
+    private:
+        void        chunk_ids(size_t chunk_index, std::vector<uint8_t>& ids) const;
+        size_t      chunk_count() const;
+        void        collect(STServo& bus, uint8_t bus_index, const std::vector<uint8_t>& ids,
+                            std::vector<std::vector<uint8_t>>& params_rx_vec, std::vector<ServoResult>& result_vec,
+                            std::vector<ServoInfo>& found);
+        bool        probe(STServo& bus, uint8_t bus_index, uint8_t dev_id, std::vector<ServoInfo>& found);
+        static void add_info(uint8_t dev_id, uint8_t bus_index, const uint8_t* data, std::vector<ServoInfo>& found);
+
+        uint8_t    _first;
+        uint8_t    _last;
+        ScanMethod _method;
+        size_t     _chunk;
+        uint32_t   _transactions;
+};
+
+#endif // STServo_SERVO_SCANNER_H
@@ -0,0 +1,235 @@
+#include <string.h>
+#include "servo_transaction.h"
+#include "servo_mirror.h"
+
+ServoTransaction::ServoTransaction() {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+ServoTransaction::Entry* ServoTransaction::find(uint8_t dev_id) {
+    for (size_t i = 0; i < _entries.size(); i++) {
+        if (_entries[i].id == dev_id) {
+            return &_entries[i];
+        }
+    }
+    return NULL;
+}
+
+bool ServoTransaction::add(uint8_t dev_id, uint8_t mem_addr, const uint8_t* data, size_t len) {
+    if (dev_id >= STProtocol::BROADCAST_ID || len == 0 || mem_addr + len > ADDRESS_LIMIT) {
+        return false;
+    }
+    Entry* entry = find(dev_id);
+    if (!entry) {
+        if (_entries.size() >= MAX_SERVOS) {
+            return false;
+        }
+        Entry fresh;
+        memset(&fresh, 0, sizeof(fresh));
+        fresh.id    = dev_id;
+        fresh.first = mem_addr;
+        fresh.last  = mem_addr;
+        _entries.push_back(fresh);
+        entry = &_entries.back();
+    }
+    for (size_t i = 0; i < len; i++) {
+        entry->data[mem_addr + i]    = data[i];
+        entry->written[mem_addr + i] = true;
+    }
+    entry->first = (mem_addr < entry->first) ? mem_addr : entry->first;
+    entry->last  = (mem_addr + len - 1 > entry->last) ? mem_addr + len - 1 : entry->last;
+    return true;
+}
+
+// 区间中有未写入的字节时读取整个区间，用当前值填充
+// 读到的值在ACTION时才写回，舵机会自行修改的寄存器（TORQUE_SWITCH、GOAL_POSITION等）可能已经过时，不能填充
+ServoResult ServoTransaction::fill_gaps(STServo& bus, Entry& entry) {
+    const uint64_t fillable = ServoMirror::fillable_mask();
+    bool gap = false;
+    for (size_t a = entry.first; a <= entry.last; a++) {
+        if (entry.written[a]) {
+            continue;
+        }
+        if (a >= 64 || !(fillable & (1ULL << a))) {
+            return ServoResult(SERVO_ERR_PARAM);
+        }
+        gap = true;
+    }
+    if (!gap) {
+        return ServoResult(SERVO_OK);
+    }
+
+    uint8_t error = 0;
+    std::vector<uint8_t> current;
+    size_t length = entry.last - entry.first + 1;
+    _stats.gapReads++;
+    _stats.frames++;
+    ServoResult result = bus.read(entry.id, entry.first, length, error, current);
+    if (!result) {
+        return result;
+    }
+    for (size_t a = entry.first; a <= entry.last; a++) {
+        if (!entry.written[a]) {
+            entry.data[a]    = current[a - entry.first];
+            entry.written[a] = true;
+        }
+    }
+    return result;
+}
+
+ServoResult ServoTransaction::stage(STServo& bus, std::vector<ServoResult>& result_vec) {
+    std::vector<size_t> index(_entries.size());
+    for (size_t i = 0; i < index.size(); i++) {
+        index[i] = i;
+    }
+    begin_stage(result_vec);
+    if (_entries.empty()) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    stage_bus(bus, index, result_vec);
+    return end_stage(result_vec);
+}
+
+ServoResult ServoTransaction::stage(ServoBusGroup& group, std::vector<ServoResult>& result_vec) {
+    begin_stage(result_vec);
+    if (_entries.empty() || group.bus_count() == 0) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    std::vector<size_t> index;
+    for (size_t b = 0; b < group.bus_count(); b++) {
+        index.clear();
+        for (size_t i = 0; i < _entries.size(); i++) {
+            uint8_t route = group.route(_entries[i].id);
+            if ((route == ServoBusGroup::NO_BUS ? 0 : route) == b) {
+                index.push_back(i);
+            }
+        }
+        if (!index.empty()) {
+            stage_bus(group.bus(b), index, result_vec);
+        }
+    }
+    return end_stage(result_vec);
+}
+
+void ServoTransaction::begin_stage(std::vector<ServoResult>& result_vec) {
+    result_vec.assign(_entries.size(), ServoResult(SERVO_ERR_PARAM));
+    memset(&_stats, 0, sizeof(_stats));
+    _armed.clear();
+}
+
+// 暂存index中的舵机，暂存耗时累加到stageUs
+void ServoTransaction::stage_bus(STServo& bus, const std::vector<size_t>& index, std::vector<ServoResult>& result_vec) {
+    // 先填充地址间隔，读取不会打断已暂存的写入
+    for (size_t k = 0; k < index.size(); k++) {
+        result_vec[index[k]] = fill_gaps(bus, _entries[index[k]]);
+    }
+
+    // 逐个发送不要求应答的REG_WRITE，不等待每个舵机的应答
+    uint32_t start = bus.clock().micros();
+    std::vector<uint8_t> staged;
+    std::vector<size_t>  staged_index;
+    std::vector<uint8_t> data;
+    for (size_t k = 0; k < index.size(); k++) {
+        size_t i = index[k];
+        if (!result_vec[i]) {
+            continue;
+        }
+        Entry& entry = _entries[i];
+        data.assign(entry.data + entry.first, entry.data + entry.last + 1);
+        _stats.frames++;
+        result_vec[i] = bus.reg_write_noack(entry.id, entry.first, data);
+        if (result_vec[i]) {
+            staged.push_back(entry.id);
+            staged_index.push_back(i);
+        }
+    }
+
+    // 一次SYNC_READ读取ASYNC_ACTION确认所有舵机：为1表示已有待执行的REG_WRITE
+    if (!staged.empty()) {
+        std::vector<std::vector<uint8_t>> params_rx_vec;
+        std::vector<ServoResult>          confirm_vec;
+        _stats.frames++;
+        bus.sync_read(staged, STSRegisters::ASYNC_ACTION::ADDRESS, STSRegisters::ASYNC_ACTION::WIDTH,
+                      params_rx_vec, confirm_vec);
+        for (size_t k = 0; k < staged.size(); k++) {
+            ServoResult& result = result_vec[staged_index[k]];
+            result = confirm_vec[k];
+            if (result && (params_rx_vec[k].empty() || params_rx_vec[k][0] == 0)) {
+                result = ServoResult(SERVO_ERR_TIMEOUT);  // REG_WRITE没有到达舵机
+            }
+        }
+    }
+    _stats.stageUs += bus.clock().micros() - start;
+}
+
+ServoResult ServoTransaction::end_stage(const std::vector<ServoResult>& result_vec) {
+    for (size_t i = 0; i < result_vec.size(); i++) {
+        if (result_vec[i]) {
+            _armed.push_back(_entries[i].id);
+        }
+    }
+    for (size_t i = 0; i < result_vec.size(); i++) {
+        if (!result_vec[i]) {
+            return result_vec[i];
+        }
+    }
+    return ServoResult(SERVO_OK);
+}
+
+ServoResult ServoTransaction::commit(STServo& bus) {
+    uint32_t start = bus.clock().micros();
+    ServoResult result = bus.action();
+    _stats.commitUs = bus.clock().micros() - start;
+    if (result) {
+        _armed.clear();
+    }
+    return result;
+}
+
+// 每条有暂存舵机的总线各发一个ACTION；失败的总线上的舵机留在armed()中
+ServoResult ServoTransaction::commit(ServoBusGroup& group) {
+    if (group.bus_count() == 0) {
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    uint32_t start = group.bus(0).clock().micros();
+    ServoResult first_failure(SERVO_OK);
+    std::vector<uint8_t> still_armed;
+    for (size_t b = 0; b < group.bus_count(); b++) {
+        std::vector<uint8_t> ids;
+        for (size_t i = 0; i < _armed.size(); i++) {
+            uint8_t route = group.route(_armed[i]);
+            if ((route == ServoBusGroup::NO_BUS ? 0 : route) == b) {
+                ids.push_back(_armed[i]);
+            }
+        }
+        if (ids.empty()) {
+            continue;
+        }
+        ServoResult result = group.bus(b).action();
+        if (!result) {
+            still_armed.insert(still_armed.end(), ids.begin(), ids.end());
+            if (first_failure) {
+                first_failure = result;
+            }
+        }
+    }
+    _stats.commitUs = group.bus(0).clock().micros() - start;
+    _armed.swap(still_armed);
+    return first_failure;
+}
+
+ServoResult ServoTransaction::execute(STServo& bus, std::vector<ServoResult>& result_vec) {
+    ServoResult result = stage(bus, result_vec);
+    if (!result) {
+        return result;
+    }
+    return commit(bus);
+}
+
+ServoResult ServoTransaction::execute(ServoBusGroup& group, std::vector<ServoResult>& result_vec) {
+    ServoResult result = stage(group, result_vec);
+    if (!result) {
+        return result;
+    }
+    return commit(group);
+}
@@ -0,0 +1,81 @@
+#ifndef STServo_SERVO_TRANSACTION_H
+#define STServo_SERVO_TRANSACTION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "core.h"
+#include "bus_group.h"
+
+struct TransactionStats {
+    uint32_t frames;      // 暂存和确认用的帧数（不含ACTION）
+    uint32_t gapReads;    // 为填充地址间隔读取的次数
+    uint32_t stageUs;     // 暂存耗时，即逐个直接写入时第一个和最后一个舵机生效的时间差
+    uint32_t commitUs;    // 发送ACTION的耗时
+};
+
+// 多舵机原子写入：收集任意舵机、地址和宽度的写入，每个舵机合并成一个REG_WRITE暂存，再用一个广播ACTION同时生效
+// 舵机只保存最后一个REG_WRITE，因此同一舵机的写入合并为一个连续区间，区间中未写入的字节先读取当前值填充；
+// 只有舵机不会自行修改的寄存器（ServoMirror::fillable_mask()）可以这样填充，间隔中有TORQUE_SWITCH等寄存器时暂存失败
+// REG_WRITE不要求应答，全部发出后用一次SYNC_READ读取ASYNC_ACTION标志确认，不逐个等待应答
+// STS协议没有延迟生效的SYNC_WRITE，暂存只能逐个舵机发送REG_WRITE
+class ServoTransaction {
+    public:
+        static const size_t  MAX_SERVOS    = 32;
+        static const uint8_t ADDRESS_LIMIT = 0x48;  // 可写入的地址上限（不含）
+
+        ServoTransaction();
+
+        // 后写入的字节覆盖先写入的；超出ADDRESS_LIMIT、广播ID或舵机数超过MAX_SERVOS时返回false
+        bool add(uint8_t dev_id, uint8_t mem_addr, const uint8_t* data, size_t len);
+
+        template<typename Reg>
+        bool add(uint8_t dev_id, typename Reg::value_type value) {
+            static_assert(Reg::ACCESS == ACCESS_RW, "register is read-only");
+            uint8_t data[Reg::WIDTH];
+            Reg::encode(value, data);
+            return add(dev_id, Reg::ADDRESS, data, Reg::WIDTH);
+        }
+
+        void   clear() { _entries.clear(); }
+        bool   empty() const { return _entries.empty(); }
+        size_t servo_count() const { return _entries.size(); }
+        // 第i个舵机的ID，result_vec[i]与之对应
+        uint8_t servo_id(size_t index) const { return _entries[index].id; }
+
+        // 暂存所有舵机，result_vec[i]为第i个舵机的结果，返回第一个失败；间隔不能填充的舵机为SERVO_ERR_PARAM
+        ServoResult stage(STServo& bus, std::vector<ServoResult>& result_vec);
+        // 广播ACTION
+        ServoResult commit(STServo& bus);
+        // 暂存并提交；任何舵机暂存失败时不提交（已暂存的舵机保留待执行的写入，直到下一次ACTION）
+        ServoResult execute(STServo& bus, std::vector<ServoResult>& result_vec);
+        // 多条总线：每个舵机在所在的总线上暂存，每条总线各发一个ACTION
+        ServoResult stage(ServoBusGroup& group, std::vector<ServoResult>& result_vec);
+        ServoResult commit(ServoBusGroup& group);
+        ServoResult execute(ServoBusGroup& group, std::vector<ServoResult>& result_vec);
+        // 已暂存、还没有ACTION的舵机：暂存失败时这些舵机会在下一个广播ACTION（包括其他代码发出的）时执行
+        const std::vector<uint8_t>& armed() const { return _armed; }
+
+        const TransactionStats& stats() const { return _stats; }
+
+    private:
+        struct Entry {
+            uint8_t id;
+            uint8_t first;
+            uint8_t last;
+            uint8_t data[ADDRESS_LIMIT];
+            bool    written[ADDRESS_LIMIT];
+        };
+
+        Entry* find(uint8_t dev_id);
+        ServoResult fill_gaps(STServo& bus, Entry& entry);
+        void        begin_stage(std::vector<ServoResult>& result_vec);
+        void        stage_bus(STServo& bus, const std::vector<size_t>& index, std::vector<ServoResult>& result_vec);
+        ServoResult end_stage(const std::vector<ServoResult>& result_vec);
+
+        std::vector<Entry>   _entries;
+        std::vector<uint8_t> _armed;
+        TransactionStats     _stats;
+};
+
+#endif // STServo_SERVO_TRANSACTION_H
@@ -1,272 +1,588 @@
+#include <string.h>
+#include <math.h>
 #include "st3215.h"
 
 // ST3215构造函数
-ST3215::ST3215(HardwareSerial& serial, uint32_t baudrate, bool debugEnabled) 
-    : STServo(serial, baudrate, debugEnabled) {
+#ifdef ARDUINO
+ST3215::ST3215(HardwareSerial& serial, uint32_t baudrate, bool debugEnabled, int rxPin, int txPin) 
+    : STServo(serial, baudrate, debugEnabled, rxPin, txPin) {
     // 设置为STS模型
     setModel(STServo::STS_MODEL);
+    init_cache();
+}
+#endif
+
+ST3215::ST3215(ServoTransport& transport, uint32_t baudrate, bool debugEnabled, ServoClock* clock)
+    : STServo(transport, baudrate, debugEnabled, clock) {
+    setModel(STServo::STS_MODEL);
+    init_cache();
 }
 
 // ST3215析构函数
 ST3215::~ST3215() {
-    // 基类析构函数会自动调用
+    for (size_t i = 0; i < STProtocol::BROADCAST_ID; i++) {
+        delete _cache[i];
+    }
+}
+
+void ST3215::init_cache() {
+    for (size_t i = 0; i < STProtocol::BROADCAST_ID; i++) {
+        _cache[i] = NULL;
+    }
+    _cacheBypass = false;
+    resetCacheCounters();
 }
 
 // 设置力矩模式
-bool ST3215::setTorqueMode(uint8_t dev_id, TorqueMode mode) {
-    uint8_t error = 0;
-    std::vector<uint8_t> params_rx;
-    return write_int(dev_id, MEM_ADDR_TORQUE_SWITCH, static_cast<int>(mode), error, params_rx);
+ServoResult ST3215::setTorqueMode(uint8_t dev_id, TorqueMode mode) {
+    return write<STSRegisters::TORQUE_SWITCH>(dev_id, static_cast<uint8_t>(mode));
 }
 
 // 设置加速度（多个舵机）
-bool ST3215::setAcceleration(const std::vector<uint8_t>& dev_id_vec, 
+ServoResult ST3215::setAcceleration(const std::vector<uint8_t>& dev_id_vec, 
                              const std::vector<uint8_t>& acc_vec) {
     if (dev_id_vec.size() != acc_vec.size()) {
         if (_debugEnabled) {
-            Serial.println("ID count and acceleration count mismatch");
+            servo_log("ID count and acceleration count mismatch\n");
         }
-        return false;
+        return ServoResult(SERVO_ERR_PARAM);
     }
     
-    std::vector<std::vector<uint8_t>> dataArray;
-    
-    for (const uint8_t& acc : acc_vec) {
-        std::vector<uint8_t> data = {acc};
-        dataArray.push_back(data);
+    for (size_t i = 0; i < dev_id_vec.size(); i++) {
+        _mirror.set<STSRegisters::ACC>(dev_id_vec[i], acc_vec[i]);
     }
     
-    return sync_write(dev_id_vec, MEM_ADDR_ACC, dataArray);
+    // 缓存由写入触发的on_register_write失效
+    return flush();
 }
 
 // 读取加速度（多个舵机）
-bool ST3215::getAcceleration(const std::vector<uint8_t>& dev_id_vec, 
+ServoResult ST3215::getAcceleration(const std::vector<uint8_t>& dev_id_vec, 
                                    std::vector<uint8_t>& acc_vec) {
-    acc_vec.clear();
+    std::vector<ServoResult> result_vec;
+    return getAcceleration(dev_id_vec, acc_vec, result_vec);
+}
+
+// 读取加速度（多个舵机，每个舵机单独给出结果，失败的舵机对应值为0）
+// 缓存命中的舵机不上总线，只对未命中的舵机发送同步读取
+ServoResult ST3215::getAcceleration(const std::vector<uint8_t>& dev_id_vec, 
+                                   std::vector<uint8_t>& acc_vec,
+                                   std::vector<ServoResult>& result_vec,
+                                   bool fresh) {
+    if (dev_id_vec.empty()) {
+        acc_vec.clear();
+        result_vec.clear();
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    
+    acc_vec.assign(dev_id_vec.size(), 0);
+    result_vec.assign(dev_id_vec.size(), ServoResult(SERVO_OK));
+    
+    std::vector<uint8_t> miss_ids;
+    std::vector<size_t>  miss_index;
+    for (size_t i = 0; i < dev_id_vec.size(); i++) {
+        if (!cache_lookup(dev_id_vec[i], MEM_ADDR_ACC, &acc_vec[i], 1, fresh)) {
+            miss_ids.push_back(dev_id_vec[i]);
+            miss_index.push_back(i);
+        }
+    }
+    if (miss_ids.empty()) {
+        return ServoResult(SERVO_OK);
+    }
+    
     std::vector<std::vector<uint8_t>> rawData;
-    if (sync_read(dev_id_vec, MEM_ADDR_ACC, 1, rawData)) {
-        acc_vec.resize(rawData.size());
-        for (size_t i = 0; i < rawData.size(); i++) {
-            const std::vector<uint8_t>& params_rx = rawData[i];
-            if (params_rx.size() >= 1) {
-                acc_vec[i] = params_rx[0];
-            }
+    std::vector<ServoResult>          miss_results;
+    ServoResult result = sync_read(miss_ids, MEM_ADDR_ACC, 1, rawData, miss_results);
+    for (size_t i = 0; i < miss_ids.size(); i++) {
+        result_vec[miss_index[i]] = miss_results[i];
+        if (miss_results[i]) {
+            acc_vec[miss_index[i]] = rawData[i][0];
+            cache_store(miss_ids[i], MEM_ADDR_ACC, rawData[i].data(), 1);
         }
-        return !acc_vec.empty();
     }
-    return false;
+    return result;
 }
 
 // 设置位置（多个舵机）
-bool ST3215::setPosition(const std::vector<uint8_t >& dev_id_vec, 
+ServoResult ST3215::setPosition(const std::vector<uint8_t >& dev_id_vec, 
                          const std::vector<uint16_t>& posi_vec, 
                          const std::vector<uint16_t>& velo_vec) {
     if (dev_id_vec.size() != posi_vec.size() || dev_id_vec.size() != velo_vec.size()) {
         if (_debugEnabled) {
-            Serial.println("ID count, position count and velocity count mismatch");
+            servo_log("ID count, position count and velocity count mismatch\n");
         }
-        return false;
+        return ServoResult(SERVO_ERR_PARAM);
     }
     
-    std::vector<std::vector<uint8_t>> dataArray;
-    
     for (size_t i = 0; i < posi_vec.size(); i++) {
-        uint16_t posi = posi_vec[i];
-        uint16_t velo = velo_vec[i];
-        
-        if (posi > 0x0FFF) {
+        if (posi_vec[i] > 0x0FFF) {
             if (_debugEnabled) {
-                Serial.printf("Position value %d too large\n", posi);
+                servo_log("Position value %d too large\n", posi_vec[i]);
             }
-            return false;
+            return ServoResult(SERVO_ERR_PARAM);
         }
+    }
+    
+    for (size_t i = 0; i < posi_vec.size(); i++) {
+        uint8_t velo[2];
+        intToBytes(velo_vec[i], velo[0], velo[1]);
         
-        uint8_t posL, posH;
-        uint8_t velL, velH;
-        intToBytes(posi, posL, posH);
-        intToBytes(velo, velL, velH);
-        
-        std::vector<uint8_t> data = {
-            posL, posH,      // 目标位置
-            0x00, 0x00,      // 目标时间
-            velL, velH       // 目标速度
-        };
-        
-        dataArray.push_back(data);
+        // 舵机会自行改写目标位置（例如使能力矩时），因此总是发送
+        _mirror.set<STSRegisters::GOAL_POSITION>(dev_id_vec[i], static_cast<int16_t>(posi_vec[i]), true);
+        _mirror.set<STSRegisters::GOAL_TIME>(dev_id_vec[i], 0);
+        _mirror.set_bytes(dev_id_vec[i], MEM_ADDR_GOAL_SPEED, velo, sizeof(velo));
     }
     
-    return sync_write(dev_id_vec, MEM_ADDR_GOAL_POSITION, dataArray);
+    return flush();
 }
 
 // 读取位置信息（单个舵机）
-bool ST3215::getPosition(uint8_t dev_id, uint16_t& posi) {
-    uint8_t error = 0;
-    std::vector<uint8_t> params_rx;
-    if (read(dev_id, MEM_ADDR_PRESENT_POSITION, 2, error, params_rx) && params_rx.size() == 2) {
-        posi = bytesToInt(params_rx[0], params_rx[1]); 
-        return true;
-    }
-    
-    return false;
+ServoResult ST3215::getPosition(uint8_t dev_id, int16_t& posi) {
+    return read<STSRegisters::PRESENT_POSITION>(dev_id, posi);
 }
 
 // 读取位置和速度信息（多个舵机）
-bool ST3215::getPosition(const std::vector<uint8_t >& dev_id_vec, 
-                               std::vector<uint16_t>& posi_vec, 
-                               std::vector<uint16_t>& velo_vec) {
-    posi_vec.clear();
-    velo_vec.clear();
+ServoResult ST3215::getPosition(const std::vector<uint8_t >& dev_id_vec, 
+                               std::vector<int16_t>& posi_vec, 
+                               std::vector<int16_t>& velo_vec) {
+    std::vector<ServoResult> result_vec;
+    return getPosition(dev_id_vec, posi_vec, velo_vec, result_vec);
+}
 
+// 读取位置和速度信息（多个舵机，每个舵机单独给出结果，失败的舵机对应值为0）
+ServoResult ST3215::getPosition(const std::vector<uint8_t >& dev_id_vec, 
+                               std::vector<int16_t>& posi_vec, 
+                               std::vector<int16_t>& velo_vec,
+                               std::vector<ServoResult>& result_vec) {
     std::vector<std::vector<uint8_t>> rawData;
-    if (sync_read(dev_id_vec, MEM_ADDR_PRESENT_POSITION, 4, rawData)) {
-        // posi_vec.clear()清空了posi_vec，所以需要重新设置大小
-        posi_vec.resize(rawData.size()); 
-        // velo_vec.clear()清空了velo_vec，所以需要重新设置大小
-        velo_vec.resize(rawData.size()); 
-        
-        for (size_t i = 0; i < rawData.size(); i++) {
-            const std::vector<uint8_t>& params_rx = rawData[i];
-            if (params_rx.size() == 4) {   
-                uint16_t posi = bytesToInt(params_rx[0], params_rx[1]);
-                uint16_t velo = bytesToInt(params_rx[2], params_rx[3]);
-                posi_vec[i] = posi;
-                velo_vec[i] = velo;
-            }else{
-                if (_debugEnabled) {
-                    Serial.printf("GetPosition:❌ dev_id:%d params_rx.size() != 4\n", dev_id_vec[i]);
-                }
-                return false;
+    ServoResult result = sync_read(dev_id_vec, MEM_ADDR_PRESENT_POSITION, 4, rawData, result_vec);
+    posi_vec.assign(rawData.size(), 0);
+    velo_vec.assign(rawData.size(), 0);
+    
+    for (size_t i = 0; i < rawData.size(); i++) {
+        if (!result_vec[i]) {
+            if (_debugEnabled) {
+                servo_log("GetPosition:❌ dev_id:%d %s\n", dev_id_vec[i], result_vec[i].name());
+            }
+            continue;
+        }
+        const std::vector<uint8_t>& params_rx = rawData[i];
+        posi_vec[i] = STSRegisters::PRESENT_POSITION::decode(params_rx.data());
+        velo_vec[i] = STSRegisters::PRESENT_SPEED::decode(params_rx.data() + STSRegisters::PRESENT_POSITION::WIDTH);
+    }
+    
+    return result;
+}
+
+// 以最大速度走完distance步的最短时间（秒）；acc为ACC寄存器值（100步/秒²），0表示不限加速度
+static float min_move_time(float distance, float acc, float vmax) {
+    if (acc <= 0.0f) {
+        return distance / vmax;
+    }
+    float a = acc * 100.0f;
+    if (vmax * vmax / a <= distance) {
+        return distance / vmax + vmax / a;  // 梯形：加速、匀速、减速
+    }
+    return 2.0f * sqrtf(distance / a);     // 三角形：达不到最大速度
+}
+
+// 在seconds秒内走完distance步所需的匀速段速度：d = v*T - v²/a，取较小的根
+static float move_speed(float distance, float acc, float seconds) {
+    if (acc <= 0.0f) {
+        return distance / seconds;
+    }
+    float a    = acc * 100.0f;
+    float disc = a * a * seconds * seconds - 4.0f * a * distance;
+    return 0.5f * (a * seconds - sqrtf(disc > 0.0f ? disc : 0.0f));
+}
+
+// 定时运动的参数检查
+static bool valid_move(const std::vector<uint8_t>& dev_id_vec, const std::vector<uint16_t>& posi_vec,
+                       uint32_t duration_ms) {
+    if (dev_id_vec.empty() || dev_id_vec.size() != posi_vec.size() ||
+        duration_ms == 0 || duration_ms > ST3215::MOVE_MAX_TIME_MS) {
+        return false;
+    }
+    for (size_t i = 0; i < posi_vec.size(); i++) {
+        if (posi_vec[i] > 0x0FFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 定时运动（多个舵机）
+ServoResult ST3215::moveTimed(const std::vector<uint8_t>& dev_id_vec, const std::vector<uint16_t>& posi_vec,
+                              uint32_t duration_ms, std::vector<uint16_t>& velo_vec, uint32_t& actual_ms,
+                              MoveTiming timing) {
+    if (timing == MOVE_BY_TIME) {
+        velo_vec.assign(dev_id_vec.size(), 0);
+        actual_ms = duration_ms;
+        if (!valid_move(dev_id_vec, posi_vec, duration_ms)) {
+            if (_debugEnabled) {
+                servo_log("MoveTimed: invalid servo list, position or duration %u ms\n", (unsigned)duration_ms);
             }
+            return ServoResult(SERVO_ERR_PARAM);
+        }
+        // 速度为0表示不限速，由GOAL_TIME决定运行时间
+        for (size_t i = 0; i < dev_id_vec.size(); i++) {
+            _mirror.set<STSRegisters::GOAL_POSITION>(dev_id_vec[i], static_cast<int16_t>(posi_vec[i]), true);
+            _mirror.set<STSRegisters::GOAL_TIME>(dev_id_vec[i], static_cast<uint16_t>(duration_ms), true);
+            _mirror.set<STSRegisters::GOAL_SPEED>(dev_id_vec[i], 0, true);
         }
-        return !posi_vec.empty();
+        return flush();
     }
     
-    return false;
+    ServoResult result = planMove(dev_id_vec, posi_vec, duration_ms, velo_vec, actual_ms);
+    if (!result) {
+        return result;
+    }
+    for (size_t i = 0; i < dev_id_vec.size(); i++) {
+        // 三个寄存器都强制写出，所有舵机的区间相同，合并成一条SYNC_WRITE
+        _mirror.set<STSRegisters::GOAL_POSITION>(dev_id_vec[i], static_cast<int16_t>(posi_vec[i]), true);
+        _mirror.set<STSRegisters::GOAL_TIME>(dev_id_vec[i], 0, true);
+        _mirror.set<STSRegisters::GOAL_SPEED>(dev_id_vec[i], static_cast<int16_t>(velo_vec[i]), true);
+    }
+    return flush();
+}
+
+// 规划MOVE_BY_SPEED的定时运动：只读取加速度和当前位置，不写入
+ServoResult ST3215::planMove(const std::vector<uint8_t>& dev_id_vec, const std::vector<uint16_t>& posi_vec,
+                             uint32_t duration_ms, std::vector<uint16_t>& velo_vec, uint32_t& actual_ms) {
+    velo_vec.assign(dev_id_vec.size(), 0);
+    actual_ms = duration_ms;
+    if (!valid_move(dev_id_vec, posi_vec, duration_ms)) {
+        if (_debugEnabled) {
+            servo_log("MoveTimed: invalid servo list, position or duration %u ms\n", (unsigned)duration_ms);
+        }
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    
+    // 加速度优先取镜像中的值，其次是EPROM缓存，都没有时才读取
+    std::vector<uint8_t> acc_vec(dev_id_vec.size(), 0);
+    std::vector<uint8_t> miss_ids;
+    std::vector<size_t>  miss_index;
+    for (size_t i = 0; i < dev_id_vec.size(); i++) {
+        if (!_mirror.get<STSRegisters::ACC>(dev_id_vec[i], acc_vec[i])) {
+            miss_ids.push_back(dev_id_vec[i]);
+            miss_index.push_back(i);
+        }
+    }
+    if (!miss_ids.empty()) {
+        std::vector<uint8_t> miss_acc;
+        ServoResult result = getAcceleration(miss_ids, miss_acc);
+        if (!result) {
+            return result;
+        }
+        for (size_t i = 0; i < miss_ids.size(); i++) {
+            acc_vec[miss_index[i]] = miss_acc[i];
+        }
+    }
+    
+    std::vector<int16_t> present_vec;
+    std::vector<int16_t> speed_vec;
+    ServoResult result = getPosition(dev_id_vec, present_vec, speed_vec);
+    if (!result) {
+        return result;
+    }
+    
+    // 所有舵机共用最长的可行时长，保证同时到达
+    std::vector<float> distance(dev_id_vec.size());
+    float seconds = duration_ms * 0.001f;
+    for (size_t i = 0; i < dev_id_vec.size(); i++) {
+        distance[i] = fabsf(static_cast<float>(posi_vec[i]) - static_cast<float>(present_vec[i]));
+        float shortest = min_move_time(distance[i], acc_vec[i], MOVE_MAX_SPEED);
+        seconds = (shortest > seconds) ? shortest : seconds;
+    }
+    actual_ms = static_cast<uint32_t>(ceilf(seconds * 1000.0f));
+    
+    for (size_t i = 0; i < dev_id_vec.size(); i++) {
+        // 速度0表示最大速度，至少发送1
+        float speed = ceilf(move_speed(distance[i], acc_vec[i], seconds));
+        speed = (speed < 1.0f) ? 1.0f : (speed > MOVE_MAX_SPEED ? MOVE_MAX_SPEED : speed);
+        velo_vec[i] = static_cast<uint16_t>(speed);
+    }
+    return result;
 }
 
 // 读取舵机完整状态
-bool ST3215::getStatus(uint8_t dev_id, ServoStatus& status) {
-    uint8_t error = 0;
-    std::vector<uint8_t> params_rx;
-    if (read(dev_id, MEM_ADDR_PRESENT_POSITION, 15, error, params_rx) && !params_rx.empty()) {
-        status.posi = bytesToInt(params_rx[0], params_rx[1]);
-        status.velo = bytesToInt(params_rx[2], params_rx[3]);
-        status.load = bytesToInt(params_rx[4], params_rx[5]);
-        status.volt = params_rx[6];
-        status.temp = params_rx[7];
-        status.asyn = params_rx[8];
-        status.stat = params_rx[9];
-        status.mvng = (params_rx[10] != 0);
-        status.curr = bytesToInt(params_rx[13], params_rx[14]);
-        return true;
-    }
-    return false;
+// 从PRESENT_POSITION开始的连续区域中按寄存器偏移解码
+template<typename Reg>
+static typename Reg::value_type decode_status(const uint8_t* data) {
+    return Reg::decode(data + Reg::ADDRESS - STSRegisters::PRESENT_POSITION::ADDRESS);
+}
+
+const uint8_t ST3215::STATUS_LENGTH;
+
+void ST3215::decodeStatus(const uint8_t* data, ServoStatus& status) {
+    using namespace STSRegisters;
+    status.posi = decode_status<PRESENT_POSITION>(data);
+    status.velo = decode_status<PRESENT_SPEED>(data);
+    status.load = decode_status<PRESENT_LOAD>(data);
+    status.volt = decode_status<PRESENT_VOLTAGE>(data);
+    status.temp = decode_status<PRESENT_TEMPERATURE>(data);
+    status.asyn = decode_status<ASYNC_ACTION>(data);
+    status.stat = decode_status<SERVO_STATUS>(data);
+    status.mvng = (decode_status<MOVING>(data) != 0);
+    status.curr = decode_status<PRESENT_CURRENT>(data);
+}
+
+ServoResult ST3215::getStatus(uint8_t dev_id, ServoStatus& status) {
+    uint8_t data[STATUS_LENGTH];
+    ServoResult result = read_bytes(dev_id, STSRegisters::PRESENT_POSITION::ADDRESS, data, STATUS_LENGTH);
+    if (result) {
+        decodeStatus(data, status);
+    }
+    return result;
+}
+
+// 读取多个舵机状态（失败的舵机对应状态清零）
+ServoResult ST3215::getStatus(const std::vector<uint8_t>& dev_id_vec, std::vector<ServoStatus>& status_vec,
+                              std::vector<ServoResult>& result_vec) {
+    std::vector<std::vector<uint8_t>> rawData;
+    ServoResult result = sync_read(dev_id_vec, STSRegisters::PRESENT_POSITION::ADDRESS, STATUS_LENGTH, rawData, result_vec);
+    ServoStatus empty = {};
+    status_vec.assign(rawData.size(), empty);
+    for (size_t i = 0; i < rawData.size(); i++) {
+        if (result_vec[i]) {
+            decodeStatus(rawData[i].data(), status_vec[i]);
+        }
+    }
+    return result;
 }
 
 // 更改舵机ID
-bool ST3215::changeId(uint8_t old_dev_id, uint8_t new_dev_id) {
-    uint8_t error = 0;
-    std::vector<uint8_t> params_rx;
-    
+ServoResult ST3215::changeId(uint8_t old_dev_id, uint8_t new_dev_id) {
     // 解锁EPROM
-    if (!write_int(old_dev_id, MEM_ADDR_EPROM_LOCK, 0, error, params_rx)) {
+    ServoResult result = write<STSRegisters::EPROM_LOCK>(old_dev_id, 0);
+    if (!result) {
         if (_debugEnabled) {
-            Serial.printf("ChangeId:❌ dev_id:%d write_int(MEM_ADDR_EPROM_LOCK, 0) failed\n", old_dev_id);
+            servo_log("ChangeId:❌ dev_id:%d write<EPROM_LOCK>(0) failed\n", old_dev_id);
         }
-        return false;
+        return result;
     }
     
     // 设置新ID
-    error = 0;
-    params_rx.clear();
-    if (!write_int(old_dev_id, MEM_ADDR_ID, new_dev_id, error, params_rx)) {
+    result = write<STSRegisters::ID>(old_dev_id, new_dev_id);
+    if (!result) {
         if (_debugEnabled) {
-            Serial.printf("ChangeId:❌ dev_id:%d write_int(MEM_ADDR_ID, %d) failed\n", old_dev_id, new_dev_id);
+            servo_log("ChangeId:❌ dev_id:%d write<ID>(%d) failed\n", old_dev_id, new_dev_id);
         }
-        return false;
+        return result;
     }
     
     // 锁定EPROM
-    error = 0;
-    params_rx.clear();
-    return write_int(new_dev_id, MEM_ADDR_EPROM_LOCK, 1, error, params_rx);
+    return write<STSRegisters::EPROM_LOCK>(new_dev_id, 1);
 }
 
 // 设置位置校正
-bool ST3215::setPositionCorrection(uint8_t dev_id, int16_t correction, bool save) {
+ServoResult ST3215::setPositionCorrection(uint8_t dev_id, int16_t correction, bool save) {
     if (_model == SCS_MODEL) {
         if (_debugEnabled) {
-            Serial.println("Position correction not available for SCS servos");
+            servo_log("Position correction not available for SCS servos\n");
         }
-        return false;
+        return ServoResult(SERVO_ERR_PARAM);
     }
     
     if (correction > 2047 || correction < -2047) {
         if (_debugEnabled) {
-            Serial.println("Correction value out of range");
+            servo_log("Correction value out of range\n");
         }
-        return false;
-    }
-    
-    uint16_t correctionValue;
-    if (correction >= 0) {
-        correctionValue = correction;
-    } else {
-        correctionValue = (-correction) + 0x800;
+        return ServoResult(SERVO_ERR_PARAM);
     }
     
-    uint8_t corrL, corrH;
-    intToBytes(correctionValue, corrL, corrH);
-    std::vector<uint8_t> data = {corrL, corrH};
-    
-    uint8_t error = 0;
-    std::vector<uint8_t> params_rx;
-    
     if (save) {
         // 解锁EPROM
-        if (!write_int(dev_id, MEM_ADDR_EPROM_LOCK, 0, error, params_rx)) { 
-            return false;
+        ServoResult unlock = write<STSRegisters::EPROM_LOCK>(dev_id, 0);
+        if (!unlock) { 
+            return unlock;
         }
     }
     
-    error = 0;
-    params_rx.clear();
-    bool result = write_data(dev_id, MEM_ADDR_STEP_CORR, data, error, params_rx);
+    // 符号位（bit 11）由寄存器描述符编码
+    ServoResult result = write<STSRegisters::STEP_CORR>(dev_id, correction);
     
-    error = 0;
-    params_rx.clear();
     if (save) {
         // 锁定EPROM
-        write_int(dev_id, MEM_ADDR_EPROM_LOCK, 1, error, params_rx);
+        write<STSRegisters::EPROM_LOCK>(dev_id, 1);
     }
     
     return result;
 }
 
 // 获取位置校正
-bool ST3215::getPositionCorrection(uint8_t dev_id, int16_t& correction) {
+ServoResult ST3215::getPositionCorrection(uint8_t dev_id, int16_t& correction, bool fresh) {
     if (_model == SCS_MODEL) {
         if (_debugEnabled) {
-            Serial.println("Position correction not available for SCS servos");
+            servo_log("Position correction not available for SCS servos\n");
+        }
+        return ServoResult(SERVO_ERR_PARAM);
+    }
+    
+    return cached_read<STSRegisters::STEP_CORR>(dev_id, correction, fresh);
+}
+
+// 读取工作模式
+ServoResult ST3215::getMode(uint8_t dev_id, uint8_t& mode, bool fresh) {
+    return cached_read<STSRegisters::MODE>(dev_id, mode, fresh);
+}
+
+// 读取型号
+ServoResult ST3215::getModelNumber(uint8_t dev_id, uint16_t& model, bool fresh) {
+    return cached_read<STSRegisters::SMS_STS_MODEL>(dev_id, model, fresh);
+}
+
+// EPROM缓存
+void ST3215::setCacheBypass(bool bypass) {
+    _cacheBypass = bypass;
+}
+
+void ST3215::invalidateCache() {
+    for (size_t i = 0; i < STProtocol::BROADCAST_ID; i++) {
+        invalidateCache(static_cast<uint8_t>(i));
+    }
+}
+
+void ST3215::invalidateCache(uint8_t dev_id) {
+    if (dev_id < STProtocol::BROADCAST_ID && _cache[dev_id] != NULL && _cache[dev_id]->valid != 0) {
+        _cache[dev_id]->valid = 0;
+        _cacheCounters.invalidations++;
+    }
+}
+
+void ST3215::seedCache(uint8_t dev_id, uint8_t mem_addr, const uint8_t* data, size_t len) {
+    // 只保留可缓存范围内的部分
+    for (size_t i = 0; i < len && mem_addr + i < CACHE_SIZE; i++) {
+        if (is_cacheable(mem_addr + i, 1)) {
+            cache_store(dev_id, mem_addr + i, data + i, 1);
+        }
+    }
+}
+
+bool ST3215::lookupCache(uint8_t dev_id, uint8_t mem_addr, uint8_t* data, size_t len, bool fresh) {
+    return cache_lookup(dev_id, mem_addr, data, len, fresh);
+}
+
+const CacheCounters& ST3215::getCacheCounters() const {
+    return _cacheCounters;
+}
+
+void ST3215::resetCacheCounters() {
+    _cacheCounters.hits          = 0;
+    _cacheCounters.misses        = 0;
+    _cacheCounters.invalidations = 0;
+}
+
+// EPROM区（TORQUE_SWITCH之前）和ACC可缓存，其余SRAM由舵机自己更新
+bool ST3215::is_cacheable(uint8_t mem_addr, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        size_t addr = mem_addr + i;
+        if (addr >= CACHE_SIZE || addr == STSRegisters::TORQUE_SWITCH::ADDRESS) {
+            return false;
         }
+    }
+    return len > 0;
+}
+
+bool ST3215::cache_lookup(uint8_t dev_id, uint8_t mem_addr, uint8_t* data, size_t len, bool fresh) {
+    if (dev_id >= STProtocol::BROADCAST_ID || !is_cacheable(mem_addr, len)) {
         return false;
     }
+    const CacheEntry* entry = _cache[dev_id];
+    uint64_t mask = ((1ULL << len) - 1) << mem_addr;
+    if (fresh || _cacheBypass || entry == NULL || (entry->valid & mask) != mask) {
+        _cacheCounters.misses++;
+        return false;
+    }
+    memcpy(data, entry->mem + mem_addr, len);
+    _cacheCounters.hits++;
+    return true;
+}
+
+void ST3215::cache_store(uint8_t dev_id, uint8_t mem_addr, const uint8_t* data, size_t len) {
+    if (dev_id >= STProtocol::BROADCAST_ID || !is_cacheable(mem_addr, len)) {
+        return;
+    }
+    if (_cache[dev_id] == NULL) {
+        _cache[dev_id] = new CacheEntry();
+    }
+    memcpy(_cache[dev_id]->mem + mem_addr, data, len);
+    _cache[dev_id]->valid |= ((1ULL << len) - 1) << mem_addr;
+}
+
+void ST3215::cache_clear(uint8_t dev_id, uint8_t mem_addr, size_t len) {
+    CacheEntry* entry = _cache[dev_id];
+    if (entry == NULL) {
+        return;
+    }
+    uint64_t mask = 0;
+    for (size_t i = 0; i < len && mem_addr + i < CACHE_SIZE; i++) {
+        mask |= 1ULL << (mem_addr + i);
+    }
+    if (entry->valid & mask) {
+        entry->valid &= ~mask;
+        _cacheCounters.invalidations++;
+    }
+}
+
+// 发出镜像中所有变化的字节
+ServoResult ST3215::flush() {
+    return _mirror.flush(*this);
+}
+
+// 本库发出的写入使对应字节失效（不直接写入缓存：舵机可能拒绝写入或EPROM仍处于锁定状态）
+// 写入失败时舵机上的值未知，镜像不再记为已发送，下一次set()即使值相同也会重新写出
+// REG_WRITE暂存的值可能永远不会执行（事务中止），也不记为已发送
+void ST3215::on_register_write(uint8_t dev_id, uint8_t instruction, uint8_t mem_addr, const uint8_t* data, size_t len,
+                               bool delivered) {
+    if (delivered && instruction != INST_REG_WRITE) {
+        _mirror.note_write(dev_id, mem_addr, data, len);
+    } else {
+        _mirror.invalidate(dev_id, mem_addr, len);
+    }
+    if (instruction == INST_REG_WRITE) {
+        // ACTION之前读到的仍是旧值，记下区间，ACTION时再次失效
+        for (size_t i = 0; i < _pendingWrites.size(); i++) {
+            if (_pendingWrites[i].dev_id == dev_id) {
+                _pendingWrites.erase(_pendingWrites.begin() + i);
+                break;
+            }
+        }
+        PendingWrite pending = { dev_id, mem_addr, static_cast<uint8_t>(len) };
+        _pendingWrites.push_back(pending);
+    }
     
-    uint8_t error = 0;
-    std::vector<uint8_t> params_rx;
-    if (read(dev_id, MEM_ADDR_STEP_CORR, 2, error, params_rx) && params_rx.size() >= 2) {
-        uint16_t correctionValue = bytesToInt(params_rx[0], params_rx[1]);
-        
-        if (correctionValue > 0x800) {
-            correction = -(correctionValue - 0x800);
+    // 修改ID后旧ID和新ID的缓存都不再可信
+    if (mem_addr <= STSRegisters::ID::ADDRESS && mem_addr + len > STSRegisters::ID::ADDRESS) {
+        if (dev_id == STProtocol::BROADCAST_ID) {
+            invalidateCache();
         } else {
-            correction = correctionValue;
+            invalidateCache(dev_id);
+            invalidateCache(data[STSRegisters::ID::ADDRESS - mem_addr]);
         }
-        
-        return true;
+        return;
     }
-    
-    return false;
+    if (dev_id == STProtocol::BROADCAST_ID) {
+        for (size_t i = 0; i < STProtocol::BROADCAST_ID; i++) {
+            cache_clear(static_cast<uint8_t>(i), mem_addr, len);
+        }
+    } else if (dev_id < STProtocol::BROADCAST_ID) {
+        cache_clear(dev_id, mem_addr, len);
+    }
+}
+
+// ACTION使暂存的写入生效：ACTION之前的读取和WRITE可能已把旧值放进缓存和镜像
+void ST3215::on_action() {
+    for (size_t i = 0; i < _pendingWrites.size(); i++) {
+        const PendingWrite& pending = _pendingWrites[i];
+        _mirror.invalidate(pending.dev_id, pending.mem_addr, pending.len);
+        if (pending.dev_id == STProtocol::BROADCAST_ID) {
+            invalidateCache();
+        } else {
+            invalidateCache(pending.dev_id);
+        }
+    }
+    _pendingWrites.clear();
 }
 
 // 启用/禁用调试
@@ -2,6 +2,7 @@
 #define ST3215_H
 
 #include "core.h"
+#include "servo_mirror.h"
 
 // 力矩模式枚举
 enum TorqueMode {
@@ -12,52 +13,160 @@ enum TorqueMode {
 
 // 舵机状态结构
 struct ServoStatus {
-    uint16_t posi;  // 位置
-    uint16_t velo;  // 速度
-    uint16_t load;  // 负载
+    int16_t  posi;  // 位置（bit15为方向位，按有符号数解码）
+    int16_t  velo;  // 速度（负数表示反转）
+    int16_t  load;  // 负载（负数表示反向）
     uint8_t  volt;  // 电压
     uint8_t  temp;  // 温度
     uint8_t  asyn;  // 异步状态
     uint8_t  stat;  // 状态
     bool     mvng;  // 运动状态
-    uint16_t curr;  // 电流
+    int16_t  curr;  // 电流
+};
+
+// 定时运动的实现方式
+enum MoveTiming {
+    MOVE_BY_SPEED = 0,  // 读取当前位置，按距离和加速度计算每个舵机的GOAL_SPEED（STS系列忽略GOAL_TIME）
+    MOVE_BY_TIME  = 1   // 只写GOAL_TIME，由舵机规划速度（支持运行时间的固件），不读取位置
+};
+
+// EPROM缓存统计
+struct CacheCounters {
+    uint32_t hits;           // 由缓存直接应答的读取
+    uint32_t misses;         // 需要访问总线的读取（含强制刷新）
+    uint32_t invalidations;  // 因写入而失效的次数
 };
 
 // ST3215类继承STServo基类
 class ST3215 : public STServo {
 public:
     // 构造函数
-    ST3215(HardwareSerial& serial, uint32_t baudrate = 1000000, bool debugEnabled = false);
+#ifdef ARDUINO
+    ST3215(HardwareSerial& serial, uint32_t baudrate = 1000000, bool debugEnabled = false, int rxPin = 18, int txPin = 19);
+#endif
+    ST3215(ServoTransport& transport, uint32_t baudrate = 1000000, bool debugEnabled = false, ServoClock* clock = NULL);
     
     // 析构函数
     virtual ~ST3215();
     
     // 扩展功能方法
-    bool setTorqueMode(uint8_t dev_id, TorqueMode mode);
+    ServoResult setTorqueMode(uint8_t dev_id, TorqueMode mode);
     
-    // 加速度控制
-    bool setAcceleration(const std::vector<uint8_t>& dev_id_vec, const std::vector<uint8_t>& acc_vec);
-    bool getAcceleration(const std::vector<uint8_t>& dev_id_vec, std::vector<uint8_t>& acc_vec);
+    // 加速度控制（经过写回镜像，与上次发送相同的值不再发送）
+    ServoResult setAcceleration(const std::vector<uint8_t>& dev_id_vec, const std::vector<uint8_t>& acc_vec);
+    ServoResult getAcceleration(const std::vector<uint8_t>& dev_id_vec, std::vector<uint8_t>& acc_vec);
+    // fresh为true时忽略缓存，从舵机重新读取
+    ServoResult getAcceleration(const std::vector<uint8_t>& dev_id_vec, std::vector<uint8_t>& acc_vec,
+                                std::vector<ServoResult>& result_vec, bool fresh = false);
     
-    // 位置和速度控制
-    bool setPosition(const std::vector<uint8_t>& dev_id_vec, const std::vector<uint16_t>& posi_vec, 
-                     const std::vector<uint16_t>& velo_vec);
+    // 位置和速度控制：目标位置每次都发送，目标时间和速度未变化时跳过
+    ServoResult setPosition(const std::vector<uint8_t>& dev_id_vec, const std::vector<uint16_t>& posi_vec, 
+                            const std::vector<uint16_t>& velo_vec);
     
-    // 单个舵机位置读取
-    bool getPosition(uint8_t dev_id, uint16_t& posi);
+    // 定时运动：一组舵机同时到达目标，一次同步读取当前位置，一次SYNC_WRITE发出目标位置、时间和速度
+    // 最远的舵机以MOVE_MAX_SPEED也赶不上时整体延长，actual_ms为实际时长，velo_vec为各舵机的速度
+    ServoResult moveTimed(const std::vector<uint8_t>& dev_id_vec, const std::vector<uint16_t>& posi_vec,
+                          uint32_t duration_ms, std::vector<uint16_t>& velo_vec, uint32_t& actual_ms,
+                          MoveTiming timing = MOVE_BY_SPEED);
+    // 只计算MOVE_BY_SPEED的速度和实际时长（读取加速度和当前位置），不写入；
+    // 舵机分布在多条总线上时先在每条总线上规划，按最长的时长重新规划后再各自写入
+    ServoResult planMove(const std::vector<uint8_t>& dev_id_vec, const std::vector<uint16_t>& posi_vec,
+                         uint32_t duration_ms, std::vector<uint16_t>& velo_vec, uint32_t& actual_ms);
+    
+    // 单个舵机位置读取；PRESENT_POSITION和PRESENT_SPEED的bit15为方向位，位置和速度都是有符号数
+    ServoResult getPosition(uint8_t dev_id, int16_t& posi);
     // 多个舵机位置和速度读取
-    bool getPosition(const std::vector<uint8_t>& dev_id_vec, std::vector<uint16_t>& posi_vec, 
-                     std::vector<uint16_t>& velo_vec);
+    ServoResult getPosition(const std::vector<uint8_t>& dev_id_vec, std::vector<int16_t>& posi_vec, 
+                            std::vector<int16_t>& velo_vec);
+    // 部分结果版本：result_vec[i]为dev_id_vec[i]的结果，缺失的舵机不影响其他舵机
+    ServoResult getPosition(const std::vector<uint8_t>& dev_id_vec, std::vector<int16_t>& posi_vec, 
+                            std::vector<int16_t>& velo_vec, std::vector<ServoResult>& result_vec);
     
     // 状态读取
-    bool getStatus(uint8_t dev_id, ServoStatus& status);
+    ServoResult getStatus(uint8_t dev_id, ServoStatus& status);
+    // 多个舵机状态（一次同步读取），result_vec[i]为dev_id_vec[i]的结果
+    ServoResult getStatus(const std::vector<uint8_t>& dev_id_vec, std::vector<ServoStatus>& status_vec,
+                          std::vector<ServoResult>& result_vec);
+    // 状态区（PRESENT_POSITION到PRESENT_CURRENT）的长度和解码，ServoRouter在所有总线的应答到达后解码
+    static const uint8_t STATUS_LENGTH = STSRegisters::PRESENT_CURRENT::ADDRESS + STSRegisters::PRESENT_CURRENT::WIDTH
+                                       - STSRegisters::PRESENT_POSITION::ADDRESS;
+    static void decodeStatus(const uint8_t* data, ServoStatus& status);
+    
+    ServoResult changeId(uint8_t old_dev_id, uint8_t new_dev_id);
+    
+    ServoResult setPositionCorrection(uint8_t dev_id, int16_t correction, bool save = true);
+    ServoResult getPositionCorrection(uint8_t dev_id, int16_t& correction, bool fresh = false);
     
-    bool changeId(uint8_t old_dev_id, uint8_t new_dev_id);
+    // 配置读取（经过缓存）
+    ServoResult getMode(uint8_t dev_id, uint8_t& mode, bool fresh = false);
+    ServoResult getModelNumber(uint8_t dev_id, uint16_t& model, bool fresh = false);
     
-    bool setPositionCorrection(uint8_t dev_id, int16_t correction, bool save = true);
-    bool getPositionCorrection(uint8_t dev_id, int16_t& correction);
+    // EPROM缓存：EPROM区和ACC只会被本库的写入修改，读取一次后由缓存应答
+    // 其他主机或上位机修改了配置时，调用invalidateCache()或用fresh读取
+    void setCacheBypass(bool bypass);
+    void invalidateCache();
+    void invalidateCache(uint8_t dev_id);
+    // 用已读到的数据（例如扫描结果）填充缓存，超出可缓存范围的字节被忽略
+    void seedCache(uint8_t dev_id, uint8_t mem_addr, const uint8_t* data, size_t len);
+    // 缓存命中时填充data并返回true（计入命中和未命中统计）
+    bool lookupCache(uint8_t dev_id, uint8_t mem_addr, uint8_t* data, size_t len, bool fresh = false);
+    const CacheCounters& getCacheCounters() const;
+    void                 resetCacheCounters();
+    
+    // 写回镜像：mirror().set<Reg>()暂存，flush()一次发出所有变化
+    ServoMirror& mirror() { return _mirror; }
+    ServoResult  flush();
     
     void enableDebug(bool enable);
+
+    static const uint16_t MOVE_MAX_SPEED   = 3400;    // 步/秒
+    static const uint32_t MOVE_MAX_TIME_MS = 0xFFFF;  // GOAL_TIME的上限
+    
+protected:
+    // 缓存地址范围[0, CACHE_SIZE)，每字节一个有效位
+    static const uint8_t CACHE_SIZE = STSRegisters::ACC::ADDRESS + 1;
+    struct CacheEntry {
+        uint8_t  mem[CACHE_SIZE];
+        uint64_t valid;
+    };
+    
+    // 已暂存、等待ACTION的REG_WRITE（舵机只保留最后一个），dev_id可能是广播ID
+    struct PendingWrite {
+        uint8_t dev_id;
+        uint8_t mem_addr;
+        uint8_t len;
+    };
+    
+    CacheEntry*   _cache[STProtocol::BROADCAST_ID];  // 按ID懒分配
+    bool          _cacheBypass;
+    CacheCounters _cacheCounters;
+    ServoMirror   _mirror;
+    std::vector<PendingWrite> _pendingWrites;
+    
+    static bool is_cacheable(uint8_t mem_addr, size_t len);
+    bool        cache_lookup(uint8_t dev_id, uint8_t mem_addr, uint8_t* data, size_t len, bool fresh);
+    void        cache_store( uint8_t dev_id, uint8_t mem_addr, const uint8_t* data, size_t len);
+    void        cache_clear( uint8_t dev_id, uint8_t mem_addr, size_t len);
+    void        init_cache();
+    virtual void on_register_write(uint8_t dev_id, uint8_t instruction, uint8_t mem_addr, const uint8_t* data, size_t len,
+                                   bool delivered);
+    virtual void on_action();
+    
+    // 先查缓存，未命中时读取舵机并写入缓存
+    template<typename Reg>
+    ServoResult cached_read(uint8_t dev_id, typename Reg::value_type& value, bool fresh) {
+        uint8_t data[Reg::WIDTH];
+        if (cache_lookup(dev_id, Reg::ADDRESS, data, Reg::WIDTH, fresh)) {
+            value = Reg::decode(data);
+            return ServoResult(SERVO_OK);
+        }
+        ServoResult result = read_bytes(dev_id, Reg::ADDRESS, data, Reg::WIDTH);
+        if (result) {
+            cache_store(dev_id, Reg::ADDRESS, data, Reg::WIDTH);
+            value = Reg::decode(data);
+        }
+        return result;
+    }
 };
 
 #endif // ST3215_H
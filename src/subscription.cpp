@@ -0,0 +1,157 @@
+#include <string.h>
+#include <algorithm>
+#include "subscription.h"
+
+template<typename Reg>
+static int16_t decode_field(const uint8_t* data) {
+    return static_cast<int16_t>(Reg::decode(data));
+}
+
+#define STREAM_FIELD(name, Reg) { name, Reg::ADDRESS, Reg::WIDTH, &decode_field<Reg> }
+
+static const StreamField STREAM_FIELDS[] = {
+    STREAM_FIELD("goal", STSRegisters::GOAL_POSITION),
+    STREAM_FIELD("posi", STSRegisters::PRESENT_POSITION),
+    STREAM_FIELD("velo", STSRegisters::PRESENT_SPEED),
+    STREAM_FIELD("load", STSRegisters::PRESENT_LOAD),
+    STREAM_FIELD("volt", STSRegisters::PRESENT_VOLTAGE),
+    STREAM_FIELD("temp", STSRegisters::PRESENT_TEMPERATURE),
+    STREAM_FIELD("asyn", STSRegisters::ASYNC_ACTION),
+    STREAM_FIELD("stat", STSRegisters::SERVO_STATUS),
+    STREAM_FIELD("mvng", STSRegisters::MOVING),
+    STREAM_FIELD("curr", STSRegisters::PRESENT_CURRENT),
+};
+
+#undef STREAM_FIELD
+
+static const size_t STREAM_FIELD_COUNT = sizeof(STREAM_FIELDS) / sizeof(STREAM_FIELDS[0]);
+
+SampleQueue::SampleQueue() : _head(0), _tail(0), _dropped(0) {
+    for (size_t i = 0; i < CAPACITY; i++) {
+        _slots[i].stamp.store(0, std::memory_order_relaxed);
+    }
+}
+
+void SampleQueue::push(const StreamSample& sample) {
+    uint32_t n = _head.load(std::memory_order_relaxed);
+    Slot& slot = _slots[n % CAPACITY];
+    slot.stamp.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.sample = sample;
+    slot.stamp.store(2 * n + 2, std::memory_order_release);
+    _head.store(n + 1, std::memory_order_release);
+}
+
+bool SampleQueue::pop(StreamSample& sample) {
+    for (;;) {
+        uint32_t head = _head.load(std::memory_order_acquire);
+        if (_tail == head) {
+            return false;
+        }
+        // 落后超过一圈：最旧的样本已被覆盖
+        if (head - _tail > CAPACITY) {
+            _dropped += head - CAPACITY - _tail;
+            _tail     = head - CAPACITY;
+        }
+        Slot& slot = _slots[_tail % CAPACITY];
+        uint32_t s1 = slot.stamp.load(std::memory_order_acquire);
+        if (s1 == 2 * _tail + 2) {
+            sample = slot.sample;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.stamp.load(std::memory_order_relaxed) == s1) {
+                _tail++;
+                return true;
+            }
+        }
+        // 复制期间写者开始覆盖这个槽
+        _dropped++;
+        _tail++;
+    }
+}
+
+void SampleQueue::clear() {
+    _tail = _head.load(std::memory_order_acquire);
+}
+
+size_t SampleQueue::size() const {
+    uint32_t pending = _head.load(std::memory_order_acquire) - _tail;
+    return (pending > CAPACITY) ? CAPACITY : pending;
+}
+
+Subscription::Subscription() : _address(0), _length(0), _sequence(0) {
+    memset(&_pending, 0, sizeof(_pending));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+size_t Subscription::field_count() {
+    return STREAM_FIELD_COUNT;
+}
+
+const StreamField& Subscription::field(size_t index) {
+    return STREAM_FIELDS[index];
+}
+
+int Subscription::find_field(const char* name) {
+    for (size_t i = 0; i < STREAM_FIELD_COUNT; i++) {
+        if (strcmp(STREAM_FIELDS[i].name, name) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+bool Subscription::configure(const std::vector<uint8_t>& dev_id_vec, const std::vector<uint8_t>& fields) {
+    if (dev_id_vec.empty() || dev_id_vec.size() > StreamSample::MAX_SERVOS ||
+        fields.empty() || fields.size() > StreamSample::MAX_FIELDS) {
+        return false;
+    }
+    for (size_t i = 0; i < dev_id_vec.size(); i++) {
+        if (dev_id_vec[i] >= STProtocol::BROADCAST_ID) {
+            return false;
+        }
+    }
+
+    // 读取区间覆盖所有字段，字段之间的寄存器一并读取，一帧比多帧便宜
+    uint8_t first = 0xFF;
+    uint8_t end   = 0;
+    for (size_t i = 0; i < fields.size(); i++) {
+        if (fields[i] >= STREAM_FIELD_COUNT) {
+            return false;
+        }
+        const StreamField& f = STREAM_FIELDS[fields[i]];
+        first = std::min(first, f.address);
+        end   = std::max(end, static_cast<uint8_t>(f.address + f.width));
+    }
+    _ids      = dev_id_vec;
+    _fields   = fields;
+    _address  = first;
+    _length   = end - first;
+    _sequence = 0;
+    return true;
+}
+
+void Subscription::publish(uint32_t now_ms, const ServoResult& result) {
+    StreamSample& sample = _pending;
+    sample.timestampMs = now_ms;
+    sample.sequence    = ++_sequence;
+    sample.servoCount  = static_cast<uint8_t>(_ids.size());
+    sample.fieldCount  = static_cast<uint8_t>(_fields.size());
+    sample.validMask   = 0;
+    memcpy(sample.fields, _fields.data(), _fields.size());
+    for (size_t s = 0; s < _ids.size(); s++) {
+        sample.ids[s] = _ids[s];
+        bool valid = s < _results.size() && _results[s] && _rawData[s].size() >= _length;
+        for (size_t f = 0; f < _fields.size(); f++) {
+            const StreamField& field = STREAM_FIELDS[_fields[f]];
+            sample.values[s][f] = valid ? field.decode(_rawData[s].data() + field.address - _address) : 0;
+        }
+        if (valid) {
+            sample.validMask |= static_cast<uint16_t>(1u << s);
+        }
+    }
+    _queue.push(sample);
+    _stats.samples++;
+    if (!result) {
+        _stats.failures++;
+    }
+}
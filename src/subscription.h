@@ -0,0 +1,116 @@
+#ifndef STServo_SUBSCRIPTION_H
+#define STServo_SUBSCRIPTION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+#include "core.h"
+
+// 可订阅的寄存器，名称与getStatus应答中的字段一致
+struct StreamField {
+    const char* name;
+    uint8_t     address;
+    uint8_t     width;
+    int16_t   (*decode)(const uint8_t* data);
+};
+
+// 一次采样：自带舵机和字段列表，读者不需要访问订阅的配置
+struct StreamSample {
+    static const size_t MAX_SERVOS = 16;
+    static const size_t MAX_FIELDS = 10;
+
+    uint32_t timestampMs;                       // 采样完成时间（舵机时钟）
+    uint32_t sequence;                          // 第几次采样，从1开始
+    uint8_t  servoCount;
+    uint8_t  fieldCount;
+    uint8_t  ids[MAX_SERVOS];
+    uint8_t  fields[MAX_FIELDS];                // 字段表中的序号
+    uint16_t validMask;                         // 第i位为1表示ids[i]应答
+    int16_t  values[MAX_SERVOS][MAX_FIELDS];
+};
+
+// 定长样本队列：一个写者（总线任务）一个读者（TCP发送），不加锁
+// 队列满时写者覆盖最旧的样本，读者慢不会阻塞总线；每个槽用序号标记，读者发现被覆盖时跳过并计入dropped
+class SampleQueue {
+    public:
+        static const size_t CAPACITY = 16;  // 必须是2的幂
+
+        SampleQueue();
+
+        // 写者
+        void push(const StreamSample& sample);
+
+        // 读者：没有新样本时返回false
+        bool     pop(StreamSample& sample);
+        void     clear();
+        size_t   size() const;
+        uint32_t dropped() const { return _dropped; }
+
+    private:
+        // 第n个样本在_slots[n % CAPACITY]，写入时stamp为2n+1，写完为2n+2
+        struct Slot {
+            std::atomic<uint32_t> stamp;
+            StreamSample          sample;
+        };
+
+        Slot                  _slots[CAPACITY];
+        std::atomic<uint32_t> _head;     // 已写入的样本数
+        uint32_t              _tail;     // 读者下一个要读的样本序号
+        uint32_t              _dropped;  // 被覆盖而没有读到的样本
+};
+
+struct SubscriptionStats {
+    uint32_t samples;   // 发布的样本数
+    uint32_t failures;  // sync_read失败（有舵机未应答）的次数
+};
+
+// 推送订阅：每个节拍一次sync_read读取覆盖所有字段的连续区间，解码后放入样本队列
+// configure()和sample()必须在拥有总线的任务中调用，queue()的读取在发送任务中进行
+class Subscription {
+    public:
+        static const uint32_t MIN_RATE_HZ = 1;
+        static const uint32_t MAX_RATE_HZ = 200;
+
+        Subscription();
+
+        // 字段表
+        static size_t             field_count();
+        static const StreamField& field(size_t index);
+        // 未知名称返回-1
+        static int                find_field(const char* name);
+
+        // fields为字段表中的序号；舵机超过MAX_SERVOS、字段超过MAX_FIELDS或为空时返回false
+        bool   configure(const std::vector<uint8_t>& dev_id_vec, const std::vector<uint8_t>& fields);
+        size_t servo_count() const { return _ids.size(); }
+
+        // Bus为STServo或ServoBusGroup；未配置时返回SERVO_ERR_PARAM
+        template<typename Bus>
+        ServoResult sample(Bus& bus, ServoClock& clock) {
+            if (_ids.empty()) {
+                return ServoResult(SERVO_ERR_PARAM);
+            }
+            ServoResult result = bus.sync_read(_ids, _address, _length, _rawData, _results);
+            publish(clock.millis(), result);
+            return result;
+        }
+
+        SampleQueue&             queue() { return _queue; }
+        const SubscriptionStats& stats() const { return _stats; }
+
+    private:
+        void publish(uint32_t now_ms, const ServoResult& result);
+
+        std::vector<uint8_t>              _ids;
+        std::vector<uint8_t>              _fields;
+        uint8_t                           _address;  // 读取区间
+        uint8_t                           _length;
+        std::vector<std::vector<uint8_t>> _rawData;
+        std::vector<ServoResult>          _results;
+        uint32_t                          _sequence;
+        StreamSample                      _pending;  // 正在组装的样本，避免大对象放在栈上
+        SampleQueue                       _queue;
+        SubscriptionStats                 _stats;
+};
+
+#endif // STServo_SUBSCRIPTION_H
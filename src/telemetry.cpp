@@ -0,0 +1,142 @@
+#include <algorithm>
+#include "telemetry.h"
+
+const TelemetrySample* TelemetrySnapshot::find(uint8_t id) const {
+    for (size_t i = 0; i < count; i++) {
+        if (samples[i].id == id) {
+            return &samples[i];
+        }
+    }
+    return NULL;
+}
+
+TelemetryBuffer::TelemetryBuffer() : _sequence(0) {
+    for (size_t i = 0; i < 2; i++) {
+        _buffers[i].timestampMs = 0;
+        _buffers[i].sequence    = 0;
+        _buffers[i].count       = 0;
+    }
+}
+
+// 已发布n = _sequence / 2个快照，第n个在_buffers[n & 1]，下一个写入另一个缓冲区
+TelemetrySnapshot& TelemetryBuffer::begin_write() {
+    uint32_t seq = _sequence.load(std::memory_order_relaxed) & ~1u;
+    _sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    TelemetrySnapshot& snapshot = _buffers[(seq / 2 + 1) & 1];
+    snapshot.sequence = seq / 2 + 1;
+    return snapshot;
+}
+
+void TelemetryBuffer::publish() {
+    uint32_t seq = _sequence.load(std::memory_order_relaxed) | 1u;
+    _sequence.store(seq + 1, std::memory_order_release);
+}
+
+// 读者读取的缓冲区在写者开始写再下一个快照时才会被覆盖，即_sequence到达(s1 & ~1) + 3
+template<typename F>
+bool TelemetryBuffer::read_consistent(F copy) const {
+    for (;;) {
+        uint32_t s1 = _sequence.load(std::memory_order_acquire);
+        if (s1 < 2) {
+            return false;
+        }
+        copy(_buffers[(s1 / 2) & 1]);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t s2 = _sequence.load(std::memory_order_relaxed);
+        if (s2 - (s1 & ~1u) < 3) {
+            return true;
+        }
+    }
+}
+
+bool TelemetryBuffer::read(TelemetrySnapshot& snapshot) const {
+    return read_consistent([&](const TelemetrySnapshot& published) {
+        snapshot.timestampMs = published.timestampMs;
+        snapshot.sequence    = published.sequence;
+        snapshot.count       = published.count;
+        for (size_t i = 0; i < published.count && i < TelemetrySnapshot::MAX_SERVOS; i++) {
+            snapshot.samples[i] = published.samples[i];
+        }
+    });
+}
+
+bool TelemetryBuffer::read(uint8_t id, TelemetrySample& sample, uint32_t& timestamp_ms) const {
+    bool found = false;
+    bool published = read_consistent([&](const TelemetrySnapshot& snapshot) {
+        const TelemetrySample* entry = snapshot.find(id);
+        found = (entry != NULL);
+        if (found) {
+            sample       = *entry;
+            timestamp_ms = snapshot.timestampMs;
+        }
+    });
+    return published && found;
+}
+
+bool TelemetrySampler::set_ids(const std::vector<uint8_t>& ids) {
+    _ids.clear();
+    _misses.clear();
+    _overflow.clear();
+    bool all = true;
+    for (size_t i = 0; i < ids.size(); i++) {
+        all &= add_id(ids[i]);
+    }
+    return all;
+}
+
+bool TelemetrySampler::add_id(uint8_t id) {
+    if (std::find(_ids.begin(), _ids.end(), id) != _ids.end()) {
+        return true;
+    }
+    std::vector<uint8_t>::iterator waiting = std::find(_overflow.begin(), _overflow.end(), id);
+    if (_ids.size() >= TelemetrySnapshot::MAX_SERVOS) {
+        if (waiting == _overflow.end()) {
+            _overflow.push_back(id);
+        }
+        return false;
+    }
+    if (waiting != _overflow.end()) {
+        _overflow.erase(waiting);
+    }
+    _ids.push_back(id);
+    _misses.push_back(0);
+    return true;
+}
+
+// 只有超时计入连续未应答，校验和错误等说明舵机还在总线上
+void TelemetrySampler::drop_missing() {
+    for (size_t i = _ids.size(); i-- > 0;) {
+        bool timeout = (i < _results.size()) && _results[i].code == SERVO_ERR_TIMEOUT;
+        _misses[i] = timeout ? _misses[i] + 1 : 0;
+        if (_misses[i] >= MAX_MISSES) {
+            _ids.erase(_ids.begin() + i);
+            _misses.erase(_misses.begin() + i);
+            _dropped++;
+        }
+    }
+}
+
+void TelemetrySampler::publish(uint32_t now_ms) {
+    TelemetrySnapshot& snapshot = _buffer.begin_write();
+    snapshot.timestampMs = now_ms;
+    snapshot.count       = _ids.size();
+    for (size_t i = 0; i < _ids.size(); i++) {
+        TelemetrySample& entry = snapshot.samples[i];
+        entry.id     = _ids[i];
+        entry.valid  = (i < _results.size()) && _results[i];
+        entry.status = entry.valid ? _status[i] : ServoStatus();
+    }
+    _buffer.publish();
+}
+
+bool TelemetrySampler::latest(uint8_t id, ServoStatus& status, uint32_t& age_ms, ServoClock& clock) const {
+    TelemetrySample sample;
+    uint32_t timestamp = 0;
+    if (!_buffer.read(id, sample, timestamp) || !sample.valid) {
+        return false;
+    }
+    status = sample.status;
+    age_ms = clock.millis() - timestamp;
+    return true;
+}
@@ -0,0 +1,100 @@
+#ifndef STServo_TELEMETRY_H
+#define STServo_TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+#include "st3215.h"
+
+// 一个舵机的采样结果
+struct TelemetrySample {
+    uint8_t     id;
+    bool        valid;   // 本次采样中舵机是否应答
+    ServoStatus status;
+};
+
+// 一次采样的全部舵机
+struct TelemetrySnapshot {
+    static const size_t MAX_SERVOS = 32;
+
+    uint32_t        timestampMs;  // 采样完成时间（舵机时钟）
+    uint32_t        sequence;     // 第几次采样，从1开始
+    size_t          count;
+    TelemetrySample samples[MAX_SERVOS];
+
+    const TelemetrySample* find(uint8_t id) const;
+};
+
+// 双缓冲快照：单个写者交替写两个缓冲区，读者不加锁
+// _sequence为奇数表示正在写另一个缓冲区；读者复制后检查期间写者没有开始覆盖同一个缓冲区，否则重试
+class TelemetryBuffer {
+    public:
+        TelemetryBuffer();
+
+        // 写者：取得后台缓冲区，填好后publish()
+        TelemetrySnapshot& begin_write();
+        void               publish();
+
+        // 读者：还没有发布过快照时返回false
+        bool     read(TelemetrySnapshot& snapshot) const;
+        bool     read(uint8_t id, TelemetrySample& sample, uint32_t& timestamp_ms) const;
+        uint32_t published() const { return _sequence.load(std::memory_order_acquire) / 2; }
+
+    private:
+        template<typename F>
+        bool read_consistent(F copy) const;
+
+        TelemetrySnapshot     _buffers[2];
+        std::atomic<uint32_t> _sequence;
+};
+
+// 周期采样器：一次同步读取所有已知舵机的状态区，发布为快照
+// 连续MAX_MISSES次超时的舵机移出采样列表；列表最多MAX_SERVOS个舵机，放不下的ID记入overflow()
+// sample()和修改列表的方法必须在拥有总线的任务中调用，读取快照可以在任意任务中进行
+class TelemetrySampler {
+    public:
+        static const uint8_t MAX_MISSES = 5;
+
+        TelemetrySampler() : _dropped(0) {}
+
+        // 替换采样列表，有ID放不下时返回false
+        bool        set_ids(const std::vector<uint8_t>& ids);
+        // 加入一个舵机（已在列表中也返回true），列表已满时返回false
+        bool        add_id(uint8_t id);
+        const std::vector<uint8_t>& ids() const { return _ids; }
+        // 因列表已满没有采样的舵机，加入成功后移除
+        const std::vector<uint8_t>& overflow() const { return _overflow; }
+        // 因连续超时移出列表的次数
+        uint32_t    dropped() const { return _dropped; }
+        // Bus为ST3215或ServoRouter（多条总线各读取一次后合并为一个快照）
+        template<typename Bus>
+        ServoResult sample(Bus& bus) {
+            if (_ids.empty()) {
+                return ServoResult(SERVO_OK);
+            }
+            ServoResult result = bus.getStatus(_ids, _status, _results);
+            publish(bus.clock().millis());
+            drop_missing();
+            return result;
+        }
+
+        // 快照中舵机的最新有效状态，age_ms为距今时间
+        bool latest(uint8_t id, ServoStatus& status, uint32_t& age_ms, ServoClock& clock) const;
+
+        const TelemetryBuffer& buffer() const { return _buffer; }
+
+    private:
+        void publish(uint32_t now_ms);
+        void drop_missing();
+
+        TelemetryBuffer          _buffer;
+        std::vector<uint8_t>     _ids;
+        std::vector<uint8_t>     _misses;    // 每个舵机的连续超时次数
+        std::vector<uint8_t>     _overflow;
+        uint32_t                 _dropped;
+        std::vector<ServoStatus> _status;
+        std::vector<ServoResult> _results;
+};
+
+#endif // STServo_TELEMETRY_H
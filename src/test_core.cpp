@@ -22,6 +22,10 @@ void runAllTests() {
     Serial.printf("=====================================\n"); delay(5000); testSyncReadFunction();
     Serial.printf("=====================================\n"); delay(5000); testSyncWriteFunction();
     Serial.printf("=====================================\n"); delay(5000); testSyncReadFunction();
+    Serial.printf("=====================================\n"); delay(5000); testNoAckWriteFunction();
+    Serial.printf("=====================================\n"); delay(5000); testBusStatsFunction();
+    Serial.printf("=====================================\n"); delay(5000); testReadPlanFunction();
+    Serial.printf("=====================================\n"); delay(5000); testFaultInjectionFunction();
 
     Serial.printf("🏁 All tests completed!\n");
 }
@@ -38,15 +42,11 @@ void testPingFunction() {
 
     error = 0;
     params_rx.clear();
-    try {
-        bool result2 = servo->ping(99, error, params_rx);
-        if (!result2) {
-            Serial.printf("Ping:✅ dev_id:%d\n", 99);
-        } else {
-            Serial.printf("Ping:❌ dev_id:%d\n", 99);
-        }
-    } catch (const SerialTimeoutException& e) {
-        Serial.printf("Ping:❌ dev_id:%d \nException -> %s\n", 99, e.what());
+    ServoResult result2 = servo->ping(99, error, params_rx);
+    if (result2.code == SERVO_ERR_TIMEOUT) {
+        Serial.printf("Ping:✅ dev_id:%d\n", 99);
+    } else {
+        Serial.printf("Ping:❌ dev_id:%d result:%s\n", 99, result2.name());
     }
 }
 
@@ -175,3 +175,193 @@ void testSyncWriteFunction() {
         Serial.printf("SyncWrite:❌\n");
     }
 }
+
+void testNoAckWriteFunction() {
+    uint8_t error = 0;
+    std::vector<uint8_t> params_rx;
+    std::vector<uint8_t> accData = {100};
+
+    // 有应答的写入作为对照
+    uint32_t start = servo->clock().micros();
+    servo->write_data(TEST_SERVO_ID_1, servo->MEM_ADDR_ACC, accData, error, params_rx);
+    uint32_t ackUs = servo->clock().micros() - start;
+
+    // 关闭应答后普通写入也不再等待应答
+    bool result1 = servo->setResponseLevel(TEST_SERVO_ID_1, 0);
+    start = servo->clock().micros();
+    bool result2 = servo->write_data(TEST_SERVO_ID_1, servo->MEM_ADDR_ACC, accData, error, params_rx);
+    uint32_t noAckUs = servo->clock().micros() - start;
+    if (result1 && result2 && servo->getResponseLevel(TEST_SERVO_ID_1) == 0 && noAckUs < ackUs) {
+        Serial.printf("ResponseLevel:✅ dev_id:%d ack:%uus no_ack:%uus\n", TEST_SERVO_ID_1, (unsigned)ackUs, (unsigned)noAckUs);
+    } else {
+        Serial.printf("ResponseLevel:❌ dev_id:%d level:%d ack:%uus no_ack:%uus\n", TEST_SERVO_ID_1,
+                      servo->getResponseLevel(TEST_SERVO_ID_1), (unsigned)ackUs, (unsigned)noAckUs);
+    }
+
+    // 无应答写入后批量回读确认；仍会应答的舵机(ID_2)和不存在的舵机(99)也可以无应答写入
+    WriteVerifier verifier;
+    servo->setWriteVerifier(&verifier);
+    servo->write_int_noack(TEST_SERVO_ID_1, servo->MEM_ADDR_ACC, 120);
+    servo->write_int_noack(TEST_SERVO_ID_2, servo->MEM_ADDR_ACC, 130);
+    servo->write_int_noack(TEST_SERVO_ID_1, servo->MEM_ADDR_ACC, 140);
+    std::vector<uint8_t> failedIds;
+    bool result3 = verifier.verify(*servo, failedIds);
+    if (result3 && verifier.counters().confirmed == 2) {
+        Serial.printf("NoAckVerify:✅ confirmed:%u\n", (unsigned)verifier.counters().confirmed);
+    } else {
+        Serial.printf("NoAckVerify:❌ confirmed:%u failed:%u\n", (unsigned)verifier.counters().confirmed, (unsigned)failedIds.size());
+    }
+
+    servo->write_int_noack(99, servo->MEM_ADDR_ACC, 120);
+    bool result4 = verifier.verify(*servo, failedIds);
+    if (!result4 && failedIds.size() == 1 && failedIds[0] == 99) {
+        Serial.printf("NoAckVerifyMissing:✅ dev_id:99 unreachable\n");
+    } else {
+        Serial.printf("NoAckVerifyMissing:❌ failed:%u\n", (unsigned)failedIds.size());
+    }
+    servo->setWriteVerifier(NULL);
+
+    // 恢复应答
+    bool result5 = servo->setResponseLevel(TEST_SERVO_ID_1, 1);
+    bool result6 = servo->write_data(TEST_SERVO_ID_1, servo->MEM_ADDR_ACC, accData, error, params_rx);
+    if (result5 && result6 && servo->getResponseLevel(TEST_SERVO_ID_1) == 1) {
+        Serial.printf("ResponseLevelRestore:✅ dev_id:%d\n", TEST_SERVO_ID_1);
+    } else {
+        Serial.printf("ResponseLevelRestore:❌ dev_id:%d\n", TEST_SERVO_ID_1);
+    }
+}
+
+void testBusStatsFunction() {
+    BusStats stats;
+    servo->setStats(&stats);
+
+    uint8_t error = 0;
+    std::vector<uint8_t> params_rx;
+    for (int i = 0; i < 4; i++) {
+        servo->ping(TEST_SERVO_ID_1, error, params_rx);
+    }
+    servo->ping(99, error, params_rx);
+    std::vector<uint8_t> servoIds = {TEST_SERVO_ID_1, TEST_SERVO_ID_2};
+    std::vector<std::vector<uint8_t>> params_rx_vec;
+    servo->sync_read(servoIds, servo->MEM_ADDR_PRESENT_POSITION, 2, params_rx_vec);
+    servo->setStats(NULL);
+
+    // 4次成功的PING和1次超时，每个应答6字节
+    const InstructionStats& ping = stats.instruction(STATS_PING);
+    if (ping.count == 5 && ping.replies == 4 && ping.timeouts == 1 && ping.txBytes == 5 * 6 && ping.rxBytes == 4 * 6) {
+        Serial.printf("StatsPing:✅ count:%u replies:%u timeouts:%u\n", (unsigned)ping.count, (unsigned)ping.replies, (unsigned)ping.timeouts);
+    } else {
+        Serial.printf("StatsPing:❌ count:%u replies:%u timeouts:%u tx:%u rx:%u\n", (unsigned)ping.count, (unsigned)ping.replies,
+                      (unsigned)ping.timeouts, (unsigned)ping.txBytes, (unsigned)ping.rxBytes);
+    }
+
+    // 每个应答的舵机都有延时直方图，不存在的舵机没有
+    const LatencyHistogram* latency1 = stats.latency(TEST_SERVO_ID_1);
+    const LatencyHistogram* latency2 = stats.latency(TEST_SERVO_ID_2);
+    const InstructionStats& syncRead = stats.instruction(STATS_SYNC_READ);
+    if (latency1 && latency1->count == 5 && latency2 && latency2->count == 1 && !stats.latency(99) && syncRead.replies == 2) {
+        Serial.printf("StatsLatency:✅ dev_id:%d mean:%uus max:%uus\n", TEST_SERVO_ID_1,
+                      (unsigned)(latency1->totalUs / latency1->count), (unsigned)latency1->maxUs);
+    } else {
+        Serial.printf("StatsLatency:❌ dev_id:%d count:%u\n", TEST_SERVO_ID_1, latency1 ? (unsigned)latency1->count : 0);
+    }
+
+    stats.reset();
+    if (stats.instruction(STATS_PING).count == 0 && stats.latency(TEST_SERVO_ID_1)->count == 0) {
+        Serial.printf("StatsReset:✅\n");
+    } else {
+        Serial.printf("StatsReset:❌\n");
+    }
+}
+
+void testReadPlanFunction() {
+    if (testBus == nullptr) {
+        Serial.printf("ReadPlan: skipped, needs simulated bus\n");
+        return;
+    }
+    using namespace STSRegisters;
+    
+    // 位置、负载和温度之间的间隙小，合并为一个区间；ID在EPROM区，间隙太大单独读取
+    ReadPlan plan;
+    plan.add<PRESENT_POSITION>().add<PRESENT_LOAD>().add<PRESENT_TEMPERATURE>().add<ID>();
+    std::vector<uint8_t> servoIds = {TEST_SERVO_ID_1, TEST_SERVO_ID_2};
+    std::vector<ServoResult> results;
+    bool result1 = servo->sync_read(servoIds, plan, results);
+    bool match = result1 && plan.span_count() == 2;
+    for (size_t i = 0; i < servoIds.size(); i++) {
+        const uint8_t* mem = testBus->memory(servoIds[i]);
+        match = match && mem && plan.valid(i) &&
+                plan.get<PRESENT_POSITION>(i) == PRESENT_POSITION::decode(mem + PRESENT_POSITION::ADDRESS) &&
+                plan.get<PRESENT_LOAD>(i) == PRESENT_LOAD::decode(mem + PRESENT_LOAD::ADDRESS) &&
+                plan.get<PRESENT_TEMPERATURE>(i) == PRESENT_TEMPERATURE::decode(mem + PRESENT_TEMPERATURE::ADDRESS) &&
+                plan.get<ID>(i) == servoIds[i];
+    }
+    // 两个区间之间没有读取的寄存器返回0
+    bool gap = plan.get<GOAL_POSITION>(0) == 0 && plan.get<MODE>(0) == 0;
+    if (match && gap) {
+        Serial.printf("ReadPlanDecode:✅ spans:%u posi:%d/%d\n", (unsigned)plan.span_count(),
+                      plan.get<PRESENT_POSITION>(0), plan.get<PRESENT_POSITION>(1));
+    } else {
+        Serial.printf("ReadPlanDecode:❌ read:%d spans:%u match:%d gap:%d\n", result1, (unsigned)plan.span_count(), match, gap);
+    }
+    
+    // 参数不变时不重新规划，没有应答的舵机也不保留上一次的值
+    testBus->set_dead(TEST_SERVO_ID_2, true);
+    bool result2 = servo->sync_read(servoIds, plan, results);
+    testBus->set_dead(TEST_SERVO_ID_2, false);
+    if (!result2 && results[0] && !results[1] && plan.valid(0) && !plan.valid(1) &&
+        plan.get<PRESENT_POSITION>(1) == 0 && plan.get<ID>(1) == 0 && plan.get<ID>(0) == TEST_SERVO_ID_1) {
+        Serial.printf("ReadPlanMissing:✅ dev_id:%d cleared\n", TEST_SERVO_ID_2);
+    } else {
+        Serial.printf("ReadPlanMissing:❌ dev_id:%d valid:%d posi:%d\n", TEST_SERVO_ID_2, plan.valid(1),
+                      plan.get<PRESENT_POSITION>(1));
+    }
+}
+
+void testFaultInjectionFunction() {
+    if (testBus == nullptr) {
+        Serial.printf("FaultInjection: skipped, needs simulated bus\n");
+        return;
+    }
+    using namespace STSRegisters;
+    
+    // 应答前先到达噪声字节和ID 7的完整应答帧（长度与期望的应答相同）：重新同步、跳过该帧后仍收到ID 3的应答
+    const uint8_t noise[] = {0x00, 0xFF, 0x55, 0xA5, 0xFF};
+    const uint8_t stray[] = {0x00, 0x08};
+    uint8_t frame[STProtocol::MAX_PACKET_SIZE];
+    size_t frameSize = encode_packet(frame, sizeof(frame), 7, 0, stray, sizeof(stray));
+    testBus->inject_before_reply(noise, sizeof(noise));
+    testBus->inject_before_reply(frame, frameSize);
+    servo->resetRxCounters();
+    int16_t position = 0;
+    bool result1 = servo->read<PRESENT_POSITION>(TEST_SERVO_ID_1, position);
+    const RxCounters& rx = servo->getRxCounters();
+    const uint8_t* mem = testBus->memory(TEST_SERVO_ID_1);
+    if (result1 && position == PRESENT_POSITION::decode(mem + PRESENT_POSITION::ADDRESS) && rx.resyncs > 0 &&
+        rx.foreignFrames == 1 && rx.discardedBytes >= sizeof(noise) + frameSize) {
+        Serial.printf("RxResync:✅ dev_id:%d pos:%d discarded:%u resyncs:%u foreign:%u\n", TEST_SERVO_ID_1, position,
+                      (unsigned)rx.discardedBytes, (unsigned)rx.resyncs, (unsigned)rx.foreignFrames);
+    } else {
+        Serial.printf("RxResync:❌ read:%d discarded:%u resyncs:%u foreign:%u\n", result1,
+                      (unsigned)rx.discardedBytes, (unsigned)rx.resyncs, (unsigned)rx.foreignFrames);
+    }
+    
+    // sync_read中间的舵机不应答：按槽位超时后转向下一个，前后舵机的数据都不受影响
+    const uint8_t SPARE_ID = 5;
+    testBus->add_servo(SPARE_ID);
+    testBus->set_dead(TEST_SERVO_ID_2, true);
+    std::vector<uint8_t> servoIds = {TEST_SERVO_ID_1, TEST_SERVO_ID_2, SPARE_ID};
+    std::vector<std::vector<uint8_t>> params_rx_vec;
+    std::vector<ServoResult> results;
+    bool result2 = servo->sync_read(servoIds, PRESENT_POSITION::ADDRESS, PRESENT_POSITION::WIDTH, params_rx_vec, results);
+    testBus->set_dead(TEST_SERVO_ID_2, false);
+    testBus->set_dead(SPARE_ID, true);
+    bool partial = !result2 && results.size() == 3 && results[0] && results[1].code == SERVO_ERR_TIMEOUT && results[2] &&
+                   params_rx_vec[0].size() == PRESENT_POSITION::WIDTH && params_rx_vec[2].size() == PRESENT_POSITION::WIDTH;
+    if (partial && PRESENT_POSITION::decode(params_rx_vec[0].data()) == position) {
+        Serial.printf("SyncReadPartial:✅ dev_id:%d missing, dev_id:%d/%d read\n", TEST_SERVO_ID_2, TEST_SERVO_ID_1, SPARE_ID);
+    } else {
+        Serial.printf("SyncReadPartial:❌ codes:%d/%d/%d\n", results.size() > 0 ? results[0].code : -1,
+                      results.size() > 1 ? results[1].code : -1, results.size() > 2 ? results[2].code : -1);
+    }
+}
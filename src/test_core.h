@@ -11,6 +11,17 @@ extern const uint8_t TEST_SERVO_ID_2;
 // 全局STServo对象指针
 extern ST3215* servo;
 
+// 模拟总线的控制接口（run_device_tests提供；真实总线上为nullptr，依赖它的测试跳过）
+class TestBus {
+    public:
+        virtual ~TestBus() {}
+        virtual uint8_t* memory(uint8_t id) = 0;             // 舵机内存表，不存在时返回NULL
+        virtual bool     add_servo(uint8_t id) = 0;           // 已存在时返回false
+        virtual void     set_dead(uint8_t id, bool dead) = 0; // 舵机不再应答
+        virtual void     inject_before_reply(const uint8_t* data, size_t len) = 0;  // 下一个应答之前插入原始字节
+};
+extern TestBus* testBus;
+
 // 主要测试函数声明
 void runAllTests();
 
@@ -22,5 +33,9 @@ void testRegWriteFunction();
 void testActionFunction();
 void testSyncReadFunction();
 void testSyncWriteFunction();
+void testNoAckWriteFunction();     // 无应答写入和延迟校验
+void testBusStatsFunction();       // 按指令和舵机的通信统计
+void testReadPlanFunction();       // 读取计划的区间合并和字段解码
+void testFaultInjectionFunction(); // 噪声和其他ID的帧、同步读取中不应答的舵机
 
 #endif // TEST_CORE_FUNCTION_H
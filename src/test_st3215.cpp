@@ -19,6 +19,16 @@ void runAllExtTests() {
     testPositionFunction()          ; Serial.printf("-------------------------------------\n\n"); delay(2000); 
     testStatusAndIdFunction()       ; Serial.printf("-------------------------------------\n\n"); delay(2000); 
     testPositionCorrectionFunction(); Serial.printf("-------------------------------------\n\n"); delay(2000);
+    testEpromCacheFunction()        ; Serial.printf("-------------------------------------\n\n"); delay(2000);
+    testWriteMirrorFunction()       ; Serial.printf("-------------------------------------\n\n"); delay(2000);
+    testTelemetryFunction()         ; Serial.printf("-------------------------------------\n\n"); delay(2000);
+    testScanFunction()              ; Serial.printf("-------------------------------------\n\n"); delay(2000);
+    testTrajectoryFunction()        ; Serial.printf("-------------------------------------\n\n"); delay(2000);
+    testTransactionFunction()       ; Serial.printf("-------------------------------------\n\n"); delay(2000);
+    testMoveTimedFunction()         ; Serial.printf("-------------------------------------\n\n"); delay(2000);
+    testRouterReadFunction()        ; Serial.printf("-------------------------------------\n\n"); delay(2000);
+    testSubscriptionFunction()      ; Serial.printf("-------------------------------------\n\n"); delay(2000);
+    testBinaryProtocolFunction()    ; Serial.printf("-------------------------------------\n\n"); delay(2000);
     
     Serial.printf("🏁 All extended tests completed!\n");
 }
@@ -141,7 +151,7 @@ void testPositionFunction() {
     delay(5000);
 
     // 步骤1：读取当前位置
-    std::vector<uint16_t> currentPositions, currentVelocities;
+    std::vector<int16_t> currentPositions, currentVelocities;
     
     Serial.printf("Step 1: Reading current positions...\n");
     bool getCurrentResult = servo->getPosition(servoIds, currentPositions, currentVelocities);
@@ -173,7 +183,7 @@ void testPositionFunction() {
     delay(6000);  // 等待运动完成 
     
     // 步骤4：测试单个舵机位置读取
-    uint16_t singlePosition;
+    int16_t singlePosition;
     Serial.printf("Step 4: Testing single servo position read...\n");
     bool singleResult = servo->getPosition(TEST_SERVO_ID_2, singlePosition);
     if (singleResult) {
@@ -340,9 +350,633 @@ void testPositionCorrectionFunction() {
     }
 }
 
+void testEpromCacheFunction() {
+    Serial.printf("🗂️ [Test] EPROM register cache\n"); 
+    
+    int16_t correction = 0;
+    servo->invalidateCache();
+    servo->resetCacheCounters();
+    
+    // 第一次读取访问总线，第二次由缓存应答
+    servo->getPositionCorrection(TEST_SERVO_ID_1, correction);
+    bool result1 = servo->getPositionCorrection(TEST_SERVO_ID_1, correction);
+    const CacheCounters& counters = servo->getCacheCounters();
+    if (result1 && counters.hits == 1 && counters.misses == 1) {
+        Serial.printf("CacheHit:✅ dev_id:%d hits:%u misses:%u\n", TEST_SERVO_ID_1, (unsigned)counters.hits, (unsigned)counters.misses);
+    } else {
+        Serial.printf("CacheHit:❌ dev_id:%d hits:%u misses:%u\n", TEST_SERVO_ID_1, (unsigned)counters.hits, (unsigned)counters.misses);
+    }
+    
+    // 本库的写入使缓存失效，之后读到的是新值
+    int16_t newCorrection = (correction == 20) ? 30 : 20;
+    servo->setPositionCorrection(TEST_SERVO_ID_1, newCorrection, false);
+    int16_t verifyCorrection = 0;
+    bool result2 = servo->getPositionCorrection(TEST_SERVO_ID_1, verifyCorrection);
+    if (result2 && verifyCorrection == newCorrection && counters.misses == 2) {
+        Serial.printf("CacheInvalidate:✅ dev_id:%d value:%d\n", TEST_SERVO_ID_1, verifyCorrection);
+    } else {
+        Serial.printf("CacheInvalidate:❌ dev_id:%d expected:%d got:%d\n", TEST_SERVO_ID_1, newCorrection, verifyCorrection);
+    }
+    
+    // fresh读取绕过缓存
+    bool result3 = servo->getPositionCorrection(TEST_SERVO_ID_1, verifyCorrection, true);
+    if (result3 && counters.misses == 3) {
+        Serial.printf("CacheBypass:✅ dev_id:%d value:%d\n", TEST_SERVO_ID_1, verifyCorrection);
+    } else {
+        Serial.printf("CacheBypass:❌ dev_id:%d\n", TEST_SERVO_ID_1);
+    }
+    
+    // 加速度：命中的舵机不进入同步读取
+    std::vector<uint8_t> servoIds = {TEST_SERVO_ID_1, TEST_SERVO_ID_2};
+    std::vector<uint8_t> accelerations;
+    std::vector<ServoResult> results;
+    servo->getAcceleration(servoIds, accelerations, results);
+    uint32_t hitsBefore = counters.hits;
+    bool result4 = servo->getAcceleration(servoIds, accelerations, results);
+    if (result4 && counters.hits == hitsBefore + servoIds.size()) {
+        Serial.printf("CacheAcceleration:✅ acc:[%d, %d] from cache\n", accelerations[0], accelerations[1]);
+    } else {
+        Serial.printf("CacheAcceleration:❌ hits:%u\n", (unsigned)(counters.hits - hitsBefore));
+    }
+
+    // REG_WRITE和ACTION之间的读取缓存了旧值，ACTION之后不能再由缓存应答
+    std::vector<uint8_t> singleId = {TEST_SERVO_ID_1};
+    servo->setAcceleration(singleId, {10});
+    servo->reg_write<STSRegisters::ACC>(TEST_SERVO_ID_1, 70);
+    servo->getAcceleration(singleId, accelerations);
+    uint8_t staged = accelerations[0];
+    servo->action();
+    servo->getAcceleration(singleId, accelerations);
+    if (staged == 10 && accelerations[0] == 70) {
+        Serial.printf("CacheAction:✅ dev_id:%d acc:%d -> %d\n", TEST_SERVO_ID_1, staged, accelerations[0]);
+    } else {
+        Serial.printf("CacheAction:❌ dev_id:%d before:%d after:%d expected:70\n", TEST_SERVO_ID_1, staged, accelerations[0]);
+    }
+
+    servo->setPositionCorrection(TEST_SERVO_ID_1, 0, false);
+}
+
+void testWriteMirrorFunction() {
+    Serial.printf("🪞 [Test] Write-back mirror\n"); 
+    
+    std::vector<uint8_t>  servoIds   = {TEST_SERVO_ID_1, TEST_SERVO_ID_2};
+    std::vector<uint16_t> velocities = {1000, 1000};
+    servo->setPosition(servoIds, {2000, 2100}, velocities);
+    delay(1000);
+    
+    // 速度未变化：只发送目标位置，两个舵机合并为一条SYNC_WRITE
+    ServoMirror& mirror = servo->mirror();
+    mirror.reset_counters();
+    bool result1 = servo->setPosition(servoIds, {2048, 2148}, velocities);
+    const MirrorCounters& counters = mirror.counters();
+    if (result1 && counters.frames == 1 && counters.flushedBytes == 4) {
+        Serial.printf("MirrorSkip:✅ frames:%u bytes:%u skipped:%u\n",
+                      (unsigned)counters.frames, (unsigned)counters.flushedBytes, (unsigned)counters.skippedBytes);
+    } else {
+        Serial.printf("MirrorSkip:❌ frames:%u bytes:%u skipped:%u\n",
+                      (unsigned)counters.frames, (unsigned)counters.flushedBytes, (unsigned)counters.skippedBytes);
+    }
+    delay(1000);
+    
+    // 加速度未变化时不产生总线写入
+    std::vector<uint8_t> accelerations;
+    std::vector<ServoResult> results;
+    servo->getAcceleration(servoIds, accelerations, results, true);
+    servo->setAcceleration(servoIds, accelerations);
+    mirror.reset_counters();
+    bool result2 = servo->setAcceleration(servoIds, accelerations);
+    if (result2 && counters.frames == 0) {
+        Serial.printf("MirrorUnchanged:✅ acc:[%d, %d] not resent\n", accelerations[0], accelerations[1]);
+    } else {
+        Serial.printf("MirrorUnchanged:❌ frames:%u\n", (unsigned)counters.frames);
+    }
+    
+    // 暂存后flush，读回验证
+    mirror.set<STSRegisters::ACC>(TEST_SERVO_ID_1, accelerations[0] == 40 ? 60 : 40);
+    bool result3 = servo->flush();
+    servo->getAcceleration(servoIds, accelerations, results, true);
+    uint8_t expected = 0;
+    mirror.get<STSRegisters::ACC>(TEST_SERVO_ID_1, expected);
+    if (result3 && !mirror.dirty() && accelerations[0] == expected) {
+        Serial.printf("MirrorFlush:✅ dev_id:%d acc:%d\n", TEST_SERVO_ID_1, accelerations[0]);
+    } else {
+        Serial.printf("MirrorFlush:❌ dev_id:%d acc:%d expected:%d\n", TEST_SERVO_ID_1, accelerations[0], expected);
+    }
+
+    // 写入失败后不保留为脏：其他舵机的写入不受影响，也不会把过时的值发给ID 99
+    bool result4 = servo->setPosition({99}, {2000}, {900});
+    BusStats stats;
+    BusStats* previous = servo->getStats();
+    servo->setStats(&stats);
+    bool result5 = servo->setPosition({TEST_SERVO_ID_1}, {2048}, {1000});
+    servo->setStats(previous);
+    bool isolated = !result4 && result5 && mirror.dirty_bytes(99) == 0 &&
+                    stats.instruction(STATS_WRITE).count == 1 && stats.instruction(STATS_SYNC_WRITE).count == 0;
+    
+    // 失败的写入也不记为已发送：相同的值重试时仍然写出目标位置、时间和速度
+    mirror.reset_counters();
+    bool result6 = servo->setPosition({99}, {2000}, {900});
+    if (isolated && !result6 && counters.flushedBytes == 6) {
+        Serial.printf("MirrorRetry:✅ dev_id:99 bytes:%u resent\n", (unsigned)counters.flushedBytes);
+    } else {
+        Serial.printf("MirrorRetry:❌ dev_id:99 isolated:%d writes:%u sync_writes:%u bytes:%u\n", isolated,
+                      (unsigned)stats.instruction(STATS_WRITE).count,
+                      (unsigned)stats.instruction(STATS_SYNC_WRITE).count, (unsigned)counters.flushedBytes);
+    }
+}
+
+void testTelemetryFunction() {
+    Serial.printf("📡 [Test] Telemetry sampler and snapshot\n"); 
+    
+    // 静止后采样，快照与直接读取一致
+    static TelemetrySampler sampler;
+    sampler.set_ids({TEST_SERVO_ID_1, TEST_SERVO_ID_2});
+    delay(2000);
+    bool result1 = sampler.sample(*servo);
+    
+    TelemetrySnapshot snapshot;
+    bool published = sampler.buffer().read(snapshot);
+    if (result1 && published && snapshot.count == 2 && snapshot.samples[0].valid && snapshot.samples[1].valid) {
+        Serial.printf("TelemetrySample:✅ seq:%u servos:%u\n", (unsigned)snapshot.sequence, (unsigned)snapshot.count);
+    } else {
+        Serial.printf("TelemetrySample:❌ published:%d count:%u\n", published, (unsigned)snapshot.count);
+    }
+    
+    ServoStatus status;
+    uint32_t ageMs = 0;
+    int16_t position = 0;
+    bool result2 = sampler.latest(TEST_SERVO_ID_1, status, ageMs, servo->clock());
+    bool result3 = servo->getPosition(TEST_SERVO_ID_1, position);
+    if (result2 && result3 && status.posi == position) {
+        Serial.printf("TelemetrySnapshot:✅ dev_id:%d posi:%d age:%ums\n", TEST_SERVO_ID_1, status.posi, (unsigned)ageMs);
+    } else {
+        Serial.printf("TelemetrySnapshot:❌ dev_id:%d snapshot:%d bus:%d\n", TEST_SERVO_ID_1, status.posi, position);
+    }
+    
+    // 不存在的舵机标记为无效，其他舵机不受影响
+    sampler.set_ids({TEST_SERVO_ID_1, 99});
+    sampler.sample(*servo);
+    bool result4 = sampler.latest(TEST_SERVO_ID_1, status, ageMs, servo->clock());
+    bool result5 = sampler.latest(99, status, ageMs, servo->clock());
+    if (result4 && !result5 && sampler.buffer().published() == 2) {
+        Serial.printf("TelemetryPartial:✅ missing servo 99 marked invalid\n");
+    } else {
+        Serial.printf("TelemetryPartial:❌ dev_id:%d valid:%d dev_id:99 valid:%d\n", TEST_SERVO_ID_1, result4, result5);
+    }
+    
+    // 连续超时的舵机移出采样列表，应答的舵机保留
+    for (uint8_t i = 1; i < TelemetrySampler::MAX_MISSES; i++) {
+        sampler.sample(*servo);
+    }
+    if (sampler.ids().size() == 1 && sampler.ids()[0] == TEST_SERVO_ID_1 && sampler.dropped() == 1) {
+        Serial.printf("TelemetryDrop:✅ dev_id:99 dropped after %d timeouts\n", TelemetrySampler::MAX_MISSES);
+    } else {
+        Serial.printf("TelemetryDrop:❌ servos:%u dropped:%u\n", (unsigned)sampler.ids().size(), (unsigned)sampler.dropped());
+    }
+    
+    // 超过MAX_SERVOS的ID记入overflow()而不是静默丢弃，有空位后可以加入
+    std::vector<uint8_t> many;
+    for (uint8_t id = 100; id < 100 + TelemetrySnapshot::MAX_SERVOS + 1; id++) {
+        many.push_back(id);
+    }
+    bool result6 = sampler.set_ids(many);
+    bool result7 = sampler.add_id(TEST_SERVO_ID_1);
+    size_t overflow = sampler.overflow().size();
+    many.pop_back();
+    many.pop_back();
+    sampler.set_ids(many);
+    bool result8 = sampler.add_id(TEST_SERVO_ID_1);
+    if (!result6 && !result7 && overflow == 2 && result8 && sampler.overflow().empty()) {
+        Serial.printf("TelemetryOverflow:✅ max:%u\n", (unsigned)TelemetrySnapshot::MAX_SERVOS);
+    } else {
+        Serial.printf("TelemetryOverflow:❌ set:%d add:%d overflow:%u re-add:%d\n", result6, result7, (unsigned)overflow, result8);
+    }
+}
+
+void testScanFunction() {
+    Serial.printf("🔎 [Test] Bus discovery scan\n"); 
+    
+    // 全范围SYNC_READ扫描，应在1秒内完成并读出型号和固件版本
+    ServoScanner scanner;
+    std::vector<ServoInfo> found;
+    uint32_t start = servo->clock().micros();
+    bool result1 = scanner.scan(*servo, found);
+    uint32_t elapsedUs = servo->clock().micros() - start;
+    bool found1 = false, found2 = false, infoOk = true;
+    for (size_t i = 0; i < found.size(); i++) {
+        found1 |= (found[i].id == TEST_SERVO_ID_1);
+        found2 |= (found[i].id == TEST_SERVO_ID_2);
+        infoOk &= (found[i].model != 0 && (found[i].firmwareMajor != 0 || found[i].firmwareMinor != 0));
+    }
+    if (result1 && found1 && found2 && infoOk && elapsedUs < 1000000) {
+        Serial.printf("ScanSyncRead:✅ servos:%u transactions:%u elapsed:%uus\n",
+                      (unsigned)found.size(), (unsigned)scanner.transactions(), (unsigned)elapsedUs);
+    } else {
+        Serial.printf("ScanSyncRead:❌ servos:%u found:%d/%d info:%d elapsed:%uus\n",
+                      (unsigned)found.size(), found1, found2, infoOk, (unsigned)elapsedUs);
+    }
+    
+    // 逐个探测的结果与SYNC_READ扫描一致
+    std::vector<ServoInfo> probed;
+    scanner.set_method(SCAN_READ);
+    scanner.set_range(0, TEST_SERVO_ID_2 + 10);
+    bool result2 = scanner.scan(*servo, probed);
+    if (result2 && probed.size() >= 2 && probed[0].id == found[0].id && probed[0].model == found[0].model) {
+        Serial.printf("ScanRead:✅ servos:%u model:%u firmware:%u.%u\n", (unsigned)probed.size(),
+                      probed[0].model, probed[0].firmwareMajor, probed[0].firmwareMinor);
+    } else {
+        Serial.printf("ScanRead:❌ servos:%u\n", (unsigned)probed.size());
+    }
+}
+
+void testTrajectoryFunction() {
+    Serial.printf("🎞️ [Test] Trajectory player\n"); 
+    
+    // 各种插值方式都经过两端关键帧，对称的方式在中点取平均值
+    bool kernelOk = true;
+    for (int p = TRAJECTORY_LINEAR; p <= TRAJECTORY_SCURVE; p++) {
+        TrajectoryProfile profile = static_cast<TrajectoryProfile>(p);
+        kernelOk &= TrajectoryPlayer::interpolate(profile, 1000, 3000, 0, 0, 0.0f) == 1000;
+        kernelOk &= TrajectoryPlayer::interpolate(profile, 1000, 3000, 0, 0, 1.0f) == 3000;
+        float mid = TrajectoryPlayer::interpolate(profile, 1000, 3000, 0, 0, 0.5f);
+        kernelOk &= (mid > 1999.0f && mid < 2001.0f);
+    }
+    if (kernelOk) {
+        Serial.printf("TrajectoryKernel:✅\n");
+    } else {
+        Serial.printf("TrajectoryKernel:❌\n");
+    }
+    
+    // 100Hz播放1秒的三次样条，最后一个节拍发送最后一帧
+    static TrajectoryPlayer player;
+    player.set_servos({TEST_SERVO_ID_1, TEST_SERVO_ID_2});
+    player.set_profile(TRAJECTORY_CUBIC);
+    player.add_keyframe(0,    {1000, 3000});
+    player.add_keyframe(400,  {2000, 2500});
+    player.add_keyframe(1000, {3000, 1000});
+    ServoClock& clock = servo->clock();
+    player.start(clock.micros(), 10000);
+    while (player.running()) {
+        player.tick(*servo, clock);
+        clock.delay(10);
+    }
+    int16_t goal1 = 0, goal2 = 0;
+    servo->read<STSRegisters::GOAL_POSITION>(TEST_SERVO_ID_1, goal1);
+    servo->read<STSRegisters::GOAL_POSITION>(TEST_SERVO_ID_2, goal2);
+    const TrajectoryStats& stats = player.stats();
+    if (goal1 == 3000 && goal2 == 1000 && stats.ticks >= 100 && stats.ticks <= 102 && stats.failures == 0 && stats.overruns == 0) {
+        Serial.printf("TrajectoryPlay:✅ ticks:%u max_late:%uus max_run:%uus\n",
+                      (unsigned)stats.ticks, (unsigned)stats.maxLateUs, (unsigned)stats.maxRunUs);
+    } else {
+        Serial.printf("TrajectoryPlay:❌ goal:%d/%d ticks:%u overruns:%u\n", goal1, goal2, (unsigned)stats.ticks, (unsigned)stats.overruns);
+    }
+    
+    // 节拍落后时跳过错过的节拍并记为超时
+    player.reset_stats();
+    player.start(clock.micros(), 10000);
+    player.tick(*servo, clock);
+    clock.delay(35);
+    player.tick(*servo, clock);
+    player.stop();
+    if (player.stats().overruns == 1 && player.stats().missedTicks == 2) {
+        Serial.printf("TrajectoryOverrun:✅ missed:%u late:%uus\n", (unsigned)player.stats().missedTicks, (unsigned)player.stats().maxLateUs);
+    } else {
+        Serial.printf("TrajectoryOverrun:❌ overruns:%u missed:%u\n", (unsigned)player.stats().overruns, (unsigned)player.stats().missedTicks);
+    }
+}
+
+void testTransactionFunction() {
+    Serial.printf("🔗 [Test] REG_WRITE + ACTION transaction\n"); 
+    
+    // 舵机1写入ACC和目标位置（连续区间），舵机2写入目标位置和速度（中间的GOAL_TIME需要读取填充）
+    ServoTransaction transaction;
+    transaction.add<STSRegisters::ACC>(TEST_SERVO_ID_1, 50);
+    transaction.add<STSRegisters::GOAL_POSITION>(TEST_SERVO_ID_1, 1500);
+    transaction.add<STSRegisters::GOAL_POSITION>(TEST_SERVO_ID_2, 2500);
+    transaction.add<STSRegisters::GOAL_SPEED>(TEST_SERVO_ID_2, 1000);
+    
+    std::vector<ServoResult> results;
+    bool result1 = transaction.stage(*servo, results);
+    int16_t goal1 = 0, goal2 = 0;
+    uint8_t pending = 0;
+    servo->read<STSRegisters::GOAL_POSITION>(TEST_SERVO_ID_1, goal1);
+    servo->read<STSRegisters::ASYNC_ACTION>(TEST_SERVO_ID_1, pending);
+    // 一次间隔读取、两个不等待应答的REG_WRITE和一次确认用的SYNC_READ
+    if (result1 && goal1 != 1500 && pending == 1 && transaction.stats().gapReads == 1 &&
+        transaction.stats().frames == 4) {
+        Serial.printf("TransactionStage:✅ servos:%u frames:%u stage:%uus\n", (unsigned)transaction.servo_count(),
+                      (unsigned)transaction.stats().frames, (unsigned)transaction.stats().stageUs);
+    } else {
+        Serial.printf("TransactionStage:❌ staged:%d goal:%d pending:%d gap_reads:%u frames:%u\n", result1, goal1,
+                      pending, (unsigned)transaction.stats().gapReads, (unsigned)transaction.stats().frames);
+    }
+    
+    bool result2 = transaction.commit(*servo);
+    servo->read<STSRegisters::GOAL_POSITION>(TEST_SERVO_ID_1, goal1);
+    servo->read<STSRegisters::GOAL_POSITION>(TEST_SERVO_ID_2, goal2);
+    if (result2 && goal1 == 1500 && goal2 == 2500) {
+        Serial.printf("TransactionCommit:✅ goal:%d/%d\n", goal1, goal2);
+    } else {
+        Serial.printf("TransactionCommit:❌ goal:%d/%d\n", goal1, goal2);
+    }
+    
+    // 不应答的舵机用ASYNC_ACTION确认暂存；不存在的舵机使整个事务不提交
+    servo->setResponseLevel(TEST_SERVO_ID_2, 0);
+    transaction.clear();
+    transaction.add<STSRegisters::GOAL_POSITION>(TEST_SERVO_ID_2, 2000);
+    transaction.add<STSRegisters::GOAL_POSITION>(99, 2000);
+    bool result3 = transaction.execute(*servo, results);
+    servo->read<STSRegisters::GOAL_POSITION>(TEST_SERVO_ID_2, goal2);
+    servo->setResponseLevel(TEST_SERVO_ID_2, 1);
+    bool armed = transaction.armed().size() == 1 && transaction.armed()[0] == TEST_SERVO_ID_2;
+    servo->action();
+    if (!result3 && results[0] && !results[1] && goal2 == 2500 && armed) {
+        Serial.printf("TransactionAbort:✅ dev_id:99 %s, dev_id:%d armed\n", results[1].name(), TEST_SERVO_ID_2);
+    } else {
+        Serial.printf("TransactionAbort:❌ executed:%d goal:%d armed:%d\n", result3, goal2, armed);
+    }
+    
+    // 中止的事务暂存的值没有生效，之后用镜像写入相同的值不能被跳过
+    servo->setAcceleration({TEST_SERVO_ID_1}, {10});
+    transaction.clear();
+    transaction.add<STSRegisters::ACC>(TEST_SERVO_ID_1, 50);
+    transaction.add<STSRegisters::GOAL_POSITION>(99, 2000);
+    transaction.execute(*servo, results);
+    servo->setAcceleration({TEST_SERVO_ID_1}, {50});
+    uint8_t acc = 0;
+    servo->read<STSRegisters::ACC>(TEST_SERVO_ID_1, acc);
+    servo->action();
+    if (acc == 50) {
+        Serial.printf("TransactionMirror:✅ dev_id:%d acc:%d\n", TEST_SERVO_ID_1, acc);
+    } else {
+        Serial.printf("TransactionMirror:❌ dev_id:%d acc:%d expected:50\n", TEST_SERVO_ID_1, acc);
+    }
+    
+    // 间隔中有舵机会自行修改的寄存器时不读取填充，直接拒绝
+    transaction.clear();
+    transaction.add<STSRegisters::ACC>(TEST_SERVO_ID_1, 20);
+    transaction.add<STSRegisters::EPROM_LOCK>(TEST_SERVO_ID_1, 1);
+    bool result4 = transaction.stage(*servo, results);
+    if (!result4 && results[0].code == SERVO_ERR_PARAM && transaction.stats().gapReads == 0 && transaction.armed().empty()) {
+        Serial.printf("TransactionGap:✅ dev_id:%d rejected\n", TEST_SERVO_ID_1);
+    } else {
+        Serial.printf("TransactionGap:❌ dev_id:%d staged:%d gap_reads:%u\n", TEST_SERVO_ID_1, result4,
+                      (unsigned)transaction.stats().gapReads);
+    }
+}
+
+void testMoveTimedFunction() {
+    Serial.printf("⏱️ [Test] Timed move with synchronized arrival\n"); 
+    
+    // 不限加速度，先以最大速度回到起点
+    std::vector<uint8_t> servoIds = {TEST_SERVO_ID_1, TEST_SERVO_ID_2};
+    servo->setAcceleration(servoIds, {0, 0});
+    servo->setPosition(servoIds, {1000, 1000}, {0, 0});
+    delay(1000);
+    
+    // 距离2000和500，800ms内同时到达；一次同步读取和一次SYNC_WRITE
+    BusStats stats;
+    BusStats* previous = servo->getStats();
+    servo->setStats(&stats);
+    std::vector<uint16_t> targets = {3000, 1500};
+    std::vector<uint16_t> velocities;
+    uint32_t actualMs = 0;
+    ServoClock& clock = servo->clock();
+    uint32_t start = clock.millis();
+    bool result1 = servo->moveTimed(servoIds, targets, 800, velocities, actualMs);
+    servo->setStats(previous);
+    uint32_t transactions = 0;
+    for (int i = 0; i < STATS_INSTRUCTION_COUNT; i++) {
+        transactions += stats.instruction(static_cast<StatsInstruction>(i)).count;
+    }
+    if (result1 && actualMs == 800 && transactions == 2 && stats.instruction(STATS_SYNC_WRITE).count == 1) {
+        Serial.printf("MoveTimedFrames:✅ velo:%u/%u transactions:%u\n", velocities[0], velocities[1], (unsigned)transactions);
+    } else {
+        Serial.printf("MoveTimedFrames:❌ moved:%d duration:%u transactions:%u\n", result1, (unsigned)actualMs, (unsigned)transactions);
+    }
+    
+    uint32_t arrival[2] = {0, 0};
+    std::vector<int16_t> positions;
+    std::vector<int16_t> speeds;
+    while ((arrival[0] == 0 || arrival[1] == 0) && clock.millis() - start < 2000) {
+        servo->getPosition(servoIds, positions, speeds);
+        for (size_t i = 0; i < servoIds.size(); i++) {
+            if (arrival[i] == 0 && positions.size() == servoIds.size() && positions[i] == targets[i]) {
+                arrival[i] = clock.millis() - start;
+            }
+        }
+        delay(5);
+    }
+    uint32_t spread = (arrival[0] > arrival[1]) ? arrival[0] - arrival[1] : arrival[1] - arrival[0];
+    if (arrival[0] && arrival[1] && spread <= 30 && arrival[0] >= 750 && arrival[0] <= 900) {
+        Serial.printf("MoveTimedArrival:✅ arrival:%u/%ums\n", (unsigned)arrival[0], (unsigned)arrival[1]);
+    } else {
+        Serial.printf("MoveTimedArrival:❌ arrival:%u/%ums\n", (unsigned)arrival[0], (unsigned)arrival[1]);
+    }
+    
+    // 最大速度也赶不上时整体延长
+    servo->setPosition(servoIds, {1000, 1000}, {0, 0});
+    delay(1000);
+    bool result2 = servo->moveTimed(servoIds, {4000, 1000}, 100, velocities, actualMs);
+    if (result2 && actualMs > 100 && velocities[0] == ST3215::MOVE_MAX_SPEED) {
+        Serial.printf("MoveTimedStretch:✅ duration:%ums\n", (unsigned)actualMs);
+    } else {
+        Serial.printf("MoveTimedStretch:❌ moved:%d duration:%ums\n", result2, (unsigned)actualMs);
+    }
+    delay(1000);
+    
+    // 同一条总线作为两条加入ServoRouter，两个舵机分在两边：分别规划后写入，速度与单总线相同
+    std::vector<uint16_t> single = {0, 0};
+    servo->setPosition(servoIds, {1000, 1000}, {0, 0});
+    delay(1000);
+    servo->planMove(servoIds, targets, 800, single, actualMs);
+    ServoBusGroup group;
+    ServoRouter router(group);
+    router.add_bus(*servo);
+    router.add_bus(*servo);
+    group.assign(TEST_SERVO_ID_2, 1);
+    bool result3 = router.moveTimed(servoIds, targets, 800, velocities, actualMs);
+    delay(1000);
+    
+    std::vector<ServoStatus> statusVec;
+    std::vector<ServoResult> resultVec;
+    servo->getStatus(servoIds, statusVec, resultVec);
+    bool arrived = resultVec.size() == 2 && resultVec[0] && resultVec[1] &&
+                   statusVec[0].posi == targets[0] && statusVec[1].posi == targets[1];
+    if (result3 && actualMs == 800 && velocities == single && arrived) {
+        Serial.printf("MoveTimedRouted:✅ velo:%u/%u\n", velocities[0], velocities[1]);
+    } else {
+        Serial.printf("MoveTimedRouted:❌ moved:%d duration:%ums velo:%u/%u expected:%u/%u arrived:%d\n", result3,
+                      (unsigned)actualMs, velocities[0], velocities[1], single[0], single[1], arrived);
+    }
+}
+
+void testRouterReadFunction() {
+    Serial.printf("🔀 [Test] ServoRouter reads on two buses\n"); 
+    
+    if (servo2 == nullptr) {
+        Serial.printf("RouterParallelRead: skipped, no second bus\n");
+        return;
+    }
+    
+    // 基准：两个舵机都在第一条总线上
+    std::vector<uint8_t> servoIds = {TEST_SERVO_ID_1, TEST_SERVO_ID_2};
+    std::vector<ServoStatus> statusVec;
+    std::vector<ServoResult> resultVec;
+    ServoBusGroup singleGroup;
+    ServoRouter single(singleGroup);
+    single.add_bus(*servo);
+    ServoClock& clock = servo->clock();
+    uint32_t start = clock.micros();
+    bool result1 = single.getStatus(servoIds, statusVec, resultVec);
+    uint32_t singleUs = clock.micros() - start;
+    
+    // 每条总线一个舵机：两条总线的请求先全部发出，应答同时在线上传输；请求帧本身不减少，耗时略多于一半
+    ServoBusGroup group;
+    ServoRouter router(group);
+    router.add_bus(*servo);
+    router.add_bus(*servo2);
+    group.assign(TEST_SERVO_ID_2, 1);
+    start = clock.micros();
+    bool result2 = router.getStatus(servoIds, statusVec, resultVec);
+    uint32_t routedUs = clock.micros() - start;
+    if (result1 && result2 && routedUs * 10 <= singleUs * 6) {
+        Serial.printf("RouterParallelRead:✅ single:%uus two buses:%uus\n", (unsigned)singleUs, (unsigned)routedUs);
+    } else {
+        Serial.printf("RouterParallelRead:❌ read:%d/%d single:%uus two buses:%uus\n", result1, result2,
+                      (unsigned)singleUs, (unsigned)routedUs);
+    }
+    
+    // 结果按原顺序合并，每个舵机的数据来自所在的总线，缺失的舵机不影响其他舵机
+    int16_t posi1 = 0, posi2 = 0;
+    servo->getPosition(TEST_SERVO_ID_1, posi1);
+    servo2->getPosition(TEST_SERVO_ID_2, posi2);
+    router.getStatus({TEST_SERVO_ID_2, 99, TEST_SERVO_ID_1}, statusVec, resultVec);
+    bool merged = resultVec.size() == 3 && resultVec[0] && !resultVec[1] && resultVec[2] &&
+                  statusVec[0].posi == posi2 && statusVec[2].posi == posi1;
+    
+    std::vector<int16_t> positions, speeds;
+    router.getPosition(servoIds, positions, speeds, resultVec);
+    bool position = resultVec.size() == 2 && resultVec[0] && resultVec[1] &&
+                    positions[0] == posi1 && positions[1] == posi2;
+    if (merged && position) {
+        Serial.printf("RouterMerge:✅ posi:%d/%d\n", posi1, posi2);
+    } else {
+        Serial.printf("RouterMerge:❌ status:%d position:%d posi:%d/%d\n", merged, position, posi1, posi2);
+    }
+}
+
+void testSubscriptionFunction() {
+    Serial.printf("📡 [Test] Telemetry subscription\n"); 
+    
+    // 位置和电压相隔较远，仍然一次sync_read读取整个区间；不存在的舵机只清除有效位
+    static Subscription subscription;
+    std::vector<uint8_t> fields = {(uint8_t)Subscription::find_field("posi"), (uint8_t)Subscription::find_field("volt")};
+    bool configured = subscription.configure({TEST_SERVO_ID_1, TEST_SERVO_ID_2, 99}, fields);
+    BusStats stats;
+    BusStats* previous = servo->getStats();
+    servo->setStats(&stats);
+    for (int i = 0; i < 4; i++) {
+        subscription.sample(*servo, servo->clock());
+    }
+    servo->setStats(previous);
+    
+    int16_t posi1 = 0;
+    servo->getPosition(TEST_SERVO_ID_1, posi1);
+    static StreamSample sample;
+    bool popped = subscription.queue().pop(sample);
+    if (configured && Subscription::find_field("bogus") < 0 && popped && sample.sequence == 1 &&
+        sample.validMask == 0x3 && sample.values[0][0] == (int16_t)posi1 && sample.values[0][1] > 0 &&
+        stats.instruction(STATS_SYNC_READ).count == 4) {
+        Serial.printf("SubscriptionSample:✅ posi:%d volt:%d sync_reads:%u\n", sample.values[0][0], sample.values[0][1],
+                      (unsigned)stats.instruction(STATS_SYNC_READ).count);
+    } else {
+        Serial.printf("SubscriptionSample:❌ configured:%d popped:%d seq:%u valid:0x%x\n", configured, popped,
+                      (unsigned)sample.sequence, (unsigned)sample.validMask);
+    }
+    
+    // 读者跟不上时覆盖最旧的样本，写者不等待
+    subscription.queue().clear();
+    size_t extra = 5;
+    for (size_t i = 0; i < SampleQueue::CAPACITY + extra; i++) {
+        subscription.sample(*servo, servo->clock());
+    }
+    uint32_t droppedBefore = subscription.queue().dropped();
+    size_t count = 0;
+    uint32_t first = 0, last = 0;
+    while (subscription.queue().pop(sample)) {
+        first = count++ ? first : sample.sequence;
+        last  = sample.sequence;
+    }
+    uint32_t dropped = subscription.queue().dropped() - droppedBefore;
+    if (count == SampleQueue::CAPACITY && dropped == extra && last - first + 1 == SampleQueue::CAPACITY &&
+        last == subscription.stats().samples) {
+        Serial.printf("SubscriptionDropOldest:✅ kept:%u dropped:%u\n", (unsigned)count, (unsigned)dropped);
+    } else {
+        Serial.printf("SubscriptionDropOldest:❌ kept:%u dropped:%u first:%u last:%u\n", (unsigned)count, (unsigned)dropped,
+                      (unsigned)first, (unsigned)last);
+    }
+}
+
+void testBinaryProtocolFunction() {
+    Serial.printf("📦 [Test] Binary framing\n"); 
+    
+    // SET_POSITION和GET_POSITION两帧连在一起，从第一帧中间切开分两次输入
+    const uint8_t stream[] = {
+        14, 0, BIN_OP_SET_POSITION, 0x34, 0x12, 2, TEST_SERVO_ID_1, TEST_SERVO_ID_2, 0xD0, 0x07, 0x34, 0x08, 0, 0, 0, 0,
+        6,  0, BIN_OP_GET_POSITION, 0x35, 0x12, 2, TEST_SERVO_ID_1, TEST_SERVO_ID_2,
+    };
+    ServoBusGroup group;
+    ServoRouter router(group);
+    router.add_bus(*servo);
+    FrameReader reader;
+    std::vector<uint8_t> responses[2];
+    size_t frames = 0;
+    size_t splits[] = {7, sizeof(stream) - 7};
+    size_t offset = 0;
+    for (size_t chunk = 0; chunk < 2; chunk++) {
+        size_t end = offset + splits[chunk];
+        while (offset < end && !reader.invalid()) {
+            offset += reader.feed(stream + offset, end - offset);
+            if (reader.ready()) {
+                if (frames == 1) {
+                    delay(1000);  // 等待运动完成再读取位置
+                }
+                BinaryProtocol::handle(router, reader.payload(), reader.length(), responses[frames++ & 1]);
+                reader.next();
+            }
+        }
+    }
+    const std::vector<uint8_t>& set = responses[0];
+    const std::vector<uint8_t>& get = responses[1];
+    bool setOk = frames == 2 && set.size() == 7 && set[0] == 5 && set[2] == (BIN_OP_SET_POSITION | 0x80) &&
+                 set[3] == 0x34 && set[4] == 0x12 && set[5] == SERVO_OK;
+    // 应答：头部5字节，2个code，2个位置，2个速度
+    bool getOk = get.size() == 2 + 5 + 2 + 8 && get[3] == 0x35 && get[5] == SERVO_OK && get[7] == SERVO_OK &&
+                 (get[9] | (get[10] << 8)) == 2000 && (get[11] | (get[12] << 8)) == 2100;
+    if (setOk && getOk) {
+        Serial.printf("BinaryFrames:✅ frames:%u response:%u bytes\n", (unsigned)frames, (unsigned)get.size());
+    } else {
+        Serial.printf("BinaryFrames:❌ frames:%u set:%u get:%u\n", (unsigned)frames, (unsigned)set.size(), (unsigned)get.size());
+    }
+    
+    // 参数不完整的请求不上总线；长度为0的帧使流失去同步
+    const uint8_t truncated[] = {BIN_OP_SET_POSITION, 1, 0, 2, TEST_SERVO_ID_1};
+    std::vector<uint8_t> response;
+    BinaryProtocol::handle(router, truncated, sizeof(truncated), response);
+    const uint8_t empty[] = {0, 0, 1};
+    reader.reset();
+    size_t used = reader.feed(empty, sizeof(empty));
+    if (response[5] == SERVO_ERR_PARAM && reader.invalid() && used == 2) {
+        Serial.printf("BinaryInvalid:✅\n");
+    } else {
+        Serial.printf("BinaryInvalid:❌ code:%d invalid:%d\n", response[5], reader.invalid());
+    }
+}
+
 void testGetPositionFunction() {
     // 测试读取当前位置
-    uint16_t currentPosition = 0;
+    int16_t currentPosition = 0;
     bool result0 = servo->getPosition(TEST_SERVO_ID_1, currentPosition);
     if (result0) {
         Serial.printf("GetPosition:✅ dev_id:%d current:%d\n", TEST_SERVO_ID_1, currentPosition);
@@ -2,9 +2,19 @@
 #define TEST_EXT_FUNC_H
 
 #include "st3215.h" 
+#include "telemetry.h"
+#include "servo_scanner.h"
+#include "trajectory.h"
+#include "servo_transaction.h"
+#include "bus_stats.h"
+#include "subscription.h"
+#include "binary_protocol.h"
+#include "servo_router.h"
 
 // 外部舵机对象引用（在main.cpp中定义）
 extern ST3215* servo;
+// 第二条总线（没有时为nullptr），多总线测试使用；上面的舵机与第一条总线使用相同的测试ID
+extern ST3215* servo2;
 
 // 扩展功能测试函数声明
 void runAllExtTests();
@@ -13,6 +23,16 @@ void testAccelerationFunction();         // 合并：set & get acceleration
 void testPositionFunction();             // 合并：set & get position  
 void testStatusAndIdFunction();          // 合并：getStatus & changeId
 void testPositionCorrectionFunction();
+void testEpromCacheFunction();           // EPROM缓存命中与写入失效
+void testWriteMirrorFunction();          // 写回镜像跳过未变化的字节
+void testTelemetryFunction();            // 遥测采样和快照读取
+void testScanFunction();                 // 总线扫描
+void testTrajectoryFunction();           // 轨迹插值和播放
+void testTransactionFunction();          // REG_WRITE暂存、ACTION提交
+void testMoveTimedFunction();            // 定时运动同时到达
+void testRouterReadFunction();           // 多总线读取并行传输
+void testSubscriptionFunction();         // 推送订阅和样本队列丢弃最旧
+void testBinaryProtocolFunction();       // 二进制帧切分和命令执行
 void testGetPositionFunction();
 
 #endif // TEST_EXT_FUNC_H
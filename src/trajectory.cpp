@@ -0,0 +1,192 @@
+#include <string.h>
+#include <algorithm>
+#include "trajectory.h"
+
+// 梯形速度中加速段（和减速段）占每段时长的比例
+static const float TRAPEZOID_ACCEL_FRACTION = 0.25f;
+
+TrajectoryPlayer::TrajectoryPlayer()
+    : _profile(TRAJECTORY_LINEAR), _keyframes(0), _segment(0),
+      _running(false), _startUs(0), _periodUs(0), _tickIndex(0), _tickStartUs(0), _finalTick(false) {
+    reset_stats();
+}
+
+bool TrajectoryPlayer::set_servos(const std::vector<uint8_t>& dev_id_vec) {
+    if (dev_id_vec.empty() || dev_id_vec.size() > MAX_SERVOS) {
+        return false;
+    }
+    for (size_t i = 0; i < dev_id_vec.size(); i++) {
+        if (dev_id_vec[i] >= STProtocol::BROADCAST_ID ||
+            std::find(dev_id_vec.begin(), dev_id_vec.begin() + i, dev_id_vec[i]) != dev_id_vec.begin() + i) {
+            return false;
+        }
+    }
+    _running = false;
+    _ids     = dev_id_vec;
+    _params.assign(_ids.size(), std::vector<uint8_t>(STSRegisters::GOAL_POSITION::WIDTH, 0));
+    clear();
+    return true;
+}
+
+bool TrajectoryPlayer::add_keyframe(uint32_t time_ms, const std::vector<uint16_t>& positions) {
+    if (_ids.empty() || positions.size() != _ids.size() || _keyframes >= MAX_KEYFRAMES) {
+        return false;
+    }
+    if (_keyframes > 0 && time_ms <= _timeMs[_keyframes - 1]) {
+        return false;
+    }
+    _timeMs[_keyframes] = time_ms;
+    for (size_t s = 0; s < positions.size(); s++) {
+        _positions[_keyframes][s] = std::min(positions[s], POSITION_MAX);
+    }
+    _keyframes++;
+    return true;
+}
+
+void TrajectoryPlayer::clear() {
+    _running   = false;
+    _keyframes = 0;
+    _segment   = 0;
+}
+
+bool TrajectoryPlayer::start(uint32_t now_us, uint32_t period_us) {
+    if (_keyframes == 0 || period_us == 0) {
+        return false;
+    }
+    _startUs   = now_us;
+    _periodUs  = period_us;
+    _tickIndex = 0;
+    _segment   = 0;
+    _finalTick = false;
+    _running   = true;
+    return true;
+}
+
+void TrajectoryPlayer::reset_stats() {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+float TrajectoryPlayer::interpolate(TrajectoryProfile profile, float p0, float p1, float m0, float m1, float u) {
+    switch (profile) {
+        case TRAJECTORY_CUBIC: {
+            float u2 = u * u;
+            float u3 = u2 * u;
+            return (2 * u3 - 3 * u2 + 1) * p0 + (u3 - 2 * u2 + u) * m0
+                 + (-2 * u3 + 3 * u2) * p1 + (u3 - u2) * m1;
+        }
+        case TRAJECTORY_TRAPEZOID: {
+            const float ta   = TRAPEZOID_ACCEL_FRACTION;
+            const float vmax = 1.0f / (1.0f - ta);
+            float s;
+            if (u < ta) {
+                s = 0.5f * vmax * u * u / ta;
+            } else if (u <= 1.0f - ta) {
+                s = vmax * (u - 0.5f * ta);
+            } else {
+                float d = 1.0f - u;
+                s = 1.0f - 0.5f * vmax * d * d / ta;
+            }
+            return p0 + (p1 - p0) * s;
+        }
+        case TRAJECTORY_SCURVE: {
+            float s = u * u * u * (10.0f + u * (-15.0f + 6.0f * u));
+            return p0 + (p1 - p0) * s;
+        }
+        case TRAJECTORY_LINEAR:
+        default:
+            return p0 + (p1 - p0) * u;
+    }
+}
+
+// Catmull-Rom切线（位置/毫秒），首尾关键帧为0
+float TrajectoryPlayer::tangent(size_t keyframe, size_t servo) const {
+    if (keyframe == 0 || keyframe + 1 >= _keyframes) {
+        return 0.0f;
+    }
+    float dp = static_cast<float>(_positions[keyframe + 1][servo]) - _positions[keyframe - 1][servo];
+    return dp / static_cast<float>(_timeMs[keyframe + 1] - _timeMs[keyframe - 1]);
+}
+
+void TrajectoryPlayer::sample(uint32_t elapsed_us, uint16_t* positions) {
+    const size_t servos = _ids.size();
+    if (_keyframes == 0) {
+        return;
+    }
+    // 第一帧之前保持第一帧，最后一帧之后保持最后一帧
+    const uint64_t t_us = elapsed_us;
+    if (_keyframes == 1 || t_us <= static_cast<uint64_t>(_timeMs[0]) * 1000) {
+        memcpy(positions, _positions[0], servos * sizeof(uint16_t));
+        return;
+    }
+    if (t_us >= static_cast<uint64_t>(_timeMs[_keyframes - 1]) * 1000) {
+        memcpy(positions, _positions[_keyframes - 1], servos * sizeof(uint16_t));
+        return;
+    }
+
+    // 播放时时间单调增加，从上次的段继续查找
+    if (_segment + 1 >= _keyframes || t_us < static_cast<uint64_t>(_timeMs[_segment]) * 1000) {
+        _segment = 0;
+    }
+    while (t_us >= static_cast<uint64_t>(_timeMs[_segment + 1]) * 1000) {
+        _segment++;
+    }
+
+    const size_t k   = _segment;
+    const float  dt  = static_cast<float>(_timeMs[k + 1] - _timeMs[k]);
+    const float  u   = (static_cast<float>(t_us) * 0.001f - _timeMs[k]) / dt;
+    for (size_t s = 0; s < servos; s++) {
+        float m0 = 0.0f;
+        float m1 = 0.0f;
+        if (_profile == TRAJECTORY_CUBIC) {
+            m0 = tangent(k, s) * dt;
+            m1 = tangent(k + 1, s) * dt;
+        }
+        float p = interpolate(_profile, _positions[k][s], _positions[k + 1][s], m0, m1, u);
+        // 三次样条可能超出关键帧范围，限制在舵机的位置范围内
+        p = std::max(0.0f, std::min(p + 0.5f, static_cast<float>(POSITION_MAX)));
+        positions[s] = static_cast<uint16_t>(p);
+    }
+}
+
+// 计算本节拍的设定值；落后一个周期以上时跳过错过的节拍，按当前时间计算
+bool TrajectoryPlayer::begin_tick(uint32_t now_us) {
+    if (!_running) {
+        return false;
+    }
+    uint32_t elapsed   = now_us - _startUs;
+    uint32_t scheduled = _tickIndex * _periodUs;
+    uint32_t late      = (elapsed > scheduled) ? elapsed - scheduled : 0;
+    _stats.maxLateUs   = std::max(_stats.maxLateUs, late);
+    if (late >= _periodUs) {
+        uint32_t missed = late / _periodUs;
+        _stats.overruns++;
+        _stats.missedTicks += missed;
+        _tickIndex += missed;
+    }
+    _tickIndex++;
+    _tickStartUs = now_us;
+
+    uint16_t positions[MAX_SERVOS];
+    sample(elapsed, positions);
+    for (size_t s = 0; s < _ids.size(); s++) {
+        STSRegisters::GOAL_POSITION::encode(positions[s], _params[s].data());
+    }
+    _finalTick = (static_cast<uint64_t>(elapsed) >= static_cast<uint64_t>(duration_ms()) * 1000);
+    return true;
+}
+
+void TrajectoryPlayer::end_tick(uint32_t now_us, const ServoResult& result) {
+    uint32_t run = now_us - _tickStartUs;
+    _stats.ticks++;
+    _stats.maxRunUs = std::max(_stats.maxRunUs, run);
+    if (run > _periodUs) {
+        _stats.overruns++;
+    }
+    if (!result) {
+        _stats.failures++;
+    }
+    // 最后一帧已发送
+    if (_finalTick) {
+        _running = false;
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef STServo_TRAJECTORY_H
+#define STServo_TRAJECTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "core.h"
+
+// 关键帧之间的插值方式
+enum TrajectoryProfile {
+    TRAJECTORY_LINEAR    = 0,  // 匀速，关键帧处速度突变
+    TRAJECTORY_CUBIC     = 1,  // 三次Hermite样条（Catmull-Rom切线），经过关键帧时速度连续
+    TRAJECTORY_TRAPEZOID = 2,  // 每段梯形速度（加速、匀速、减速各占1/4、1/2、1/4），在关键帧处停下
+    TRAJECTORY_SCURVE    = 3   // 每段五次多项式（最小加加速度），在关键帧处速度和加速度为0
+};
+
+struct TrajectoryStats {
+    uint32_t ticks;          // 发送的sync_write次数
+    uint32_t failures;       // sync_write失败次数
+    uint32_t overruns;       // 晚于节拍一个周期以上或发送耗时超过一个周期的节拍
+    uint32_t missedTicks;    // 因落后而跳过的节拍
+    uint32_t maxLateUs;      // 节拍开始时间相对计划时间的最大延迟
+    uint32_t maxRunUs;       // 单次计算和发送的最长耗时
+};
+
+// 轨迹播放器：一组舵机的关键帧，按固定控制频率插值，每个节拍发送一次GOAL_POSITION的sync_write
+// 设定值按实际时间计算，节拍延迟不会累积成轨迹误差
+class TrajectoryPlayer {
+    public:
+        static const size_t   MAX_SERVOS    = 16;
+        static const size_t   MAX_KEYFRAMES = 64;
+        static const uint16_t POSITION_MAX  = 4095;
+
+        TrajectoryPlayer();
+
+        // 设置舵机组并清空关键帧，超过MAX_SERVOS或有重复ID时返回false
+        bool   set_servos(const std::vector<uint8_t>& dev_id_vec);
+        void   set_profile(TrajectoryProfile profile) { _profile = profile; }
+        // positions按set_servos的顺序；time_ms必须递增，第一帧通常为0ms（起始位置）
+        bool   add_keyframe(uint32_t time_ms, const std::vector<uint16_t>& positions);
+        void   clear();
+
+        size_t   servo_count() const { return _ids.size(); }
+        size_t   keyframe_count() const { return _keyframes; }
+        uint32_t duration_ms() const { return _keyframes ? _timeMs[_keyframes - 1] : 0; }
+
+        // 开始播放，period_us为控制周期；没有关键帧时返回false
+        bool start(uint32_t now_us, uint32_t period_us);
+        void stop() { _running = false; }
+        bool running() const { return _running; }
+
+        // 计算起点之后elapsed_us时刻的设定值，positions至少servo_count()个
+        void sample(uint32_t elapsed_us, uint16_t* positions);
+
+        // 周期调用：计算当前设定值并发送一次sync_write，到达最后一帧后停止
+        // Bus为STServo或ServoBusGroup；未在播放时返回SERVO_ERR_PARAM
+        template<typename Bus>
+        ServoResult tick(Bus& bus, ServoClock& clock) {
+            if (!begin_tick(clock.micros())) {
+                return ServoResult(SERVO_ERR_PARAM);
+            }
+            ServoResult result = bus.sync_write(_ids, STSRegisters::GOAL_POSITION::ADDRESS, _params);
+            end_tick(clock.micros(), result);
+            return result;
+        }
+
+        const TrajectoryStats& stats() const { return _stats; }
+        void                   reset_stats();
+
+        // 插值核：u为段内归一化时间[0, 1]，m0/m1为按段时长缩放的端点切线（仅CUBIC使用）
+        static float interpolate(TrajectoryProfile profile, float p0, float p1, float m0, float m1, float u);
+
+    private:
+        bool  begin_tick(uint32_t now_us);
+        void  end_tick(uint32_t now_us, const ServoResult& result);
+        float tangent(size_t keyframe, size_t servo) const;
+
+        std::vector<uint8_t>              _ids;
+        std::vector<std::vector<uint8_t>> _params;   // 每个节拍的sync_write数据，重复使用
+        TrajectoryProfile _profile;
+        uint32_t          _timeMs[MAX_KEYFRAMES];
+        uint16_t          _positions[MAX_KEYFRAMES][MAX_SERVOS];
+        size_t            _keyframes;
+        size_t            _segment;                  // 上次插值所在的段，播放时单调前进
+
+        bool              _running;
+        uint32_t          _startUs;
+        uint32_t          _periodUs;
+        uint32_t          _tickIndex;                // 下一个节拍的序号
+        uint32_t          _tickStartUs;
+        bool              _finalTick;
+        TrajectoryStats   _stats;
+};
+
+#endif // STServo_TRAJECTORY_H
@@ -0,0 +1,90 @@
+#include <string.h>
+#include <algorithm>
+#include "write_verifier.h"
+#include "core.h"
+#include "bus_group.h"
+
+WriteVerifier::WriteVerifier() : _count(0) {
+    reset_counters();
+}
+
+void WriteVerifier::reset_counters() {
+    memset(&_counters, 0, sizeof(_counters));
+}
+
+bool WriteVerifier::record(uint8_t dev_id, uint8_t mem_addr, const uint8_t* data, size_t len) {
+    if (len == 0 || len > MAX_DATA || dev_id >= STProtocol::BROADCAST_ID) {
+        return false;
+    }
+    // 同一区间的新写入覆盖旧记录
+    for (size_t i = 0; i < _count; i++) {
+        if (_entries[i].id == dev_id && _entries[i].addr == mem_addr && _entries[i].len == len) {
+            memcpy(_entries[i].data, data, len);
+            return true;
+        }
+    }
+    if (_count >= CAPACITY) {
+        _counters.overflowed++;
+        return false;
+    }
+    Entry& entry = _entries[_count++];
+    entry.id   = dev_id;
+    entry.addr = mem_addr;
+    entry.len  = static_cast<uint8_t>(len);
+    memcpy(entry.data, data, len);
+    return true;
+}
+
+bool WriteVerifier::verify(STServo& bus, std::vector<uint8_t>& failed_ids) {
+    return verify_on(bus, failed_ids);
+}
+
+bool WriteVerifier::verify(ServoBusGroup& group, std::vector<uint8_t>& failed_ids) {
+    return verify_on(group, failed_ids);
+}
+
+template<typename Bus>
+bool WriteVerifier::verify_on(Bus& bus, std::vector<uint8_t>& failed_ids) {
+    failed_ids.clear();
+    bool done[CAPACITY] = {false};
+    std::vector<uint8_t>              ids;
+    std::vector<size_t>               index;
+    std::vector<std::vector<uint8_t>> params_rx_vec;
+    std::vector<ServoResult>          result_vec;
+
+    for (size_t i = 0; i < _count; i++) {
+        if (done[i]) {
+            continue;
+        }
+        // 相同(地址, 长度)的记录合并成一次SYNC_READ
+        ids.clear();
+        index.clear();
+        for (size_t j = i; j < _count; j++) {
+            if (!done[j] && _entries[j].addr == _entries[i].addr && _entries[j].len == _entries[i].len) {
+                ids.push_back(_entries[j].id);
+                index.push_back(j);
+                done[j] = true;
+            }
+        }
+
+        bus.sync_read(ids, _entries[i].addr, _entries[i].len, params_rx_vec, result_vec);
+        for (size_t k = 0; k < ids.size(); k++) {
+            const Entry& entry = _entries[index[k]];
+            bool ok = false;
+            if (!result_vec[k]) {
+                _counters.unreachable++;
+            } else if (params_rx_vec[k].size() != entry.len || memcmp(params_rx_vec[k].data(), entry.data, entry.len) != 0) {
+                _counters.mismatched++;
+            } else {
+                _counters.confirmed++;
+                ok = true;
+            }
+            if (!ok && std::find(failed_ids.begin(), failed_ids.end(), entry.id) == failed_ids.end()) {
+                failed_ids.push_back(entry.id);
+            }
+        }
+    }
+
+    _count = 0;
+    return failed_ids.empty();
+}
@@ -0,0 +1,56 @@
+#ifndef STServo_WRITE_VERIFIER_H
+#define STServo_WRITE_VERIFIER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+class STServo;
+class ServoBusGroup;
+
+struct VerifierCounters {
+    uint32_t confirmed;    // 回读一致的写入
+    uint32_t mismatched;   // 回读不一致的写入
+    uint32_t unreachable;  // 回读时没有有效应答的写入
+    uint32_t overflowed;   // 记录已满被丢弃的写入
+};
+
+// 延迟校验无应答写入：记录写入的数据，之后按(地址, 长度)分组用SYNC_READ回读比较
+// 同一舵机同一区间只保留最后一次写入；REG_WRITE的数据在ACTION之后才生效，应在ACTION之后校验
+class WriteVerifier {
+    public:
+        static const size_t CAPACITY = 32;
+        static const size_t MAX_DATA = 8;
+
+        WriteVerifier();
+
+        // 超过MAX_DATA字节或记录已满时返回false
+        bool   record(uint8_t dev_id, uint8_t mem_addr, const uint8_t* data, size_t len);
+        size_t pending() const { return _count; }
+        void   clear() { _count = 0; }
+
+        // 回读所有记录并清空，全部一致时返回true；failed_ids为不一致或无应答的舵机（不重复）
+        bool   verify(STServo& bus, std::vector<uint8_t>& failed_ids);
+        // 多条总线共用一个WriteVerifier时，按舵机所在总线回读
+        bool   verify(ServoBusGroup& group, std::vector<uint8_t>& failed_ids);
+
+        const VerifierCounters& counters() const { return _counters; }
+        void                    reset_counters();
+
+    private:
+        template<typename Bus>
+        bool verify_on(Bus& bus, std::vector<uint8_t>& failed_ids);
+
+        struct Entry {
+            uint8_t id;
+            uint8_t addr;
+            uint8_t len;
+            uint8_t data[MAX_DATA];
+        };
+
+        Entry            _entries[CAPACITY];
+        size_t           _count;
+        VerifierCounters _counters;
+};
+
+#endif // STServo_WRITE_VERIFIER_H